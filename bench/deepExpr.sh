@@ -0,0 +1,83 @@
+#!/bin/bash
+# Author : LE COQUIL - TOUSSAINT
+# Deep expression benchmark: compiles 'a = 1 + 1 + ... + 1;' whose tree is
+# as deep as it has terms, then looks for the deepest expression the code
+# generator survives with a 1 MiB stack to estimate the stack used per
+# expression node.
+# An unoptimized (-O0) build survives about 16000 nodes, ~64 bytes / node:
+# the script fails once a node costs more than MAX_BYTES_PER_NODE.
+#
+# Usage : bench/deepExpr.sh [compiler] (default: bin/tpcc)
+
+TPCC=$(realpath "${1:-bin/tpcc}")
+if [ ! -x "$TPCC" ]; then
+    echo "Error: '$TPCC' not found or not executable."
+    exit 1
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+MAX_BYTES_PER_NODE=96
+SIGSEGV_STATUS=139
+
+# generate <depth of the expression> <file>
+generate() {
+    {
+        echo "int main(void) {"
+        echo "    int a;"
+        printf "    a = 1"
+        for ((i = 1; i < $1; i++)); do
+            printf " + 1"
+        done
+        echo ";"
+        echo "    return a;"
+        echo "}"
+    } > "$2"
+}
+
+# compiles <depth> : true if the expression compiled within a 1 MiB stack,
+# false if it overflowed it, any other failure aborting the benchmark
+compiles() {
+    generate $1 "deep.tpc"
+    (ulimit -s 1024; "$TPCC" -o deep.asm < deep.tpc) > /dev/null 2>&1
+    STATUS=$?
+    if [ $STATUS -eq $SIGSEGV_STATUS ]; then
+        return 1
+    elif [ $STATUS -ne 0 ]; then
+        echo "Error: depth $1 failed to compile (exit status $STATUS)."
+        exit 1
+    fi
+}
+
+printf "%10s %12s %15s\n" "depth" "time (s)" "us / node"
+for N in 5000 10000 20000; do
+    generate $N "deep$N.tpc"
+    START=$(date +%s.%N)
+    "$TPCC" -o "deep$N.asm" < "deep$N.tpc" > /dev/null 2>&1
+    STATUS=$?
+    END=$(date +%s.%N)
+    if [ $STATUS -ne 0 ]; then
+        echo "Error: depth $N failed to compile (exit status $STATUS)."
+        exit 1
+    fi
+    awk -v n=$N -v s="$START" -v e="$END" \
+        'BEGIN { printf "%10d %12.3f %15.3f\n", n, e - s, (e - s) * 1000000 / n }'
+done
+
+LOW=1
+HIGH=1
+while compiles $HIGH && [ $HIGH -lt 1000000 ]; do
+    LOW=$HIGH
+    HIGH=$((HIGH * 2))
+done
+while [ $((HIGH - LOW)) -gt 1 ]; do
+    MID=$(((LOW + HIGH) / 2))
+    if compiles $MID; then LOW=$MID; else HIGH=$MID; fi
+done
+echo "deepest expression with a 1 MiB stack : $LOW nodes (~$((1048576 / LOW)) bytes of stack / node)"
+if [ $((1048576 / LOW)) -gt $MAX_BYTES_PER_NODE ]; then
+    echo "Error: more than $MAX_BYTES_PER_NODE bytes of stack / node."
+    exit 1
+fi
@@ -0,0 +1,46 @@
+#!/bin/bash
+# Author : LE COQUIL - TOUSSAINT
+# Parse-time regression benchmark: compiles function bodies of growing
+# statement counts and prints the time per statement, which must stay
+# roughly constant (linear growth).
+#
+# Usage : bench/parse.sh [compiler] (default: bin/tpcc)
+
+TPCC=$(realpath "${1:-bin/tpcc}")
+if [ ! -x "$TPCC" ]; then
+    echo "Error: '$TPCC' not found or not executable."
+    exit 1
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+# generate <number of statements> <file>
+generate() {
+    {
+        echo "int main(void) {"
+        echo "    int a;"
+        echo "    a = 0;"
+        for ((i = 0; i < $1; i++)); do
+            echo "    a = a + 1;"
+        done
+        echo "    return 0;"
+        echo "}"
+    } > "$2"
+}
+
+printf "%10s %12s %18s\n" "statements" "time (s)" "us / statement"
+for N in 25000 50000 100000; do
+    generate $N "body$N.tpc"
+    START=$(date +%s.%N)
+    "$TPCC" -o "body$N.asm" < "body$N.tpc" > /dev/null 2>&1
+    STATUS=$?
+    END=$(date +%s.%N)
+    if [ $STATUS -ne 0 ]; then
+        echo "Error: $N statements failed to compile (exit status $STATUS)."
+        exit 1
+    fi
+    awk -v n=$N -v s="$START" -v e="$END" \
+        'BEGIN { printf "%10d %12.3f %18.3f\n", n, e - s, (e - s) * 1000000 / n }'
+done
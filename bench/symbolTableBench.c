@@ -0,0 +1,91 @@
+/**
+ * @file symbolTableBench.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Micro-benchmark of symbol insertion and lookup in a symbol table.
+ * @date 2024-02-10
+ */
+
+/* clock_gettime and CLOCK_MONOTONIC are POSIX, hidden by -std=c17 */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "symbolTable.h"
+
+#define NB_SYMBOLS 1000000
+
+/**
+ * @fn double elapsedSince(struct timespec start)
+ * @brief Get the time elapsed since a point in time.
+ *
+ * @param start struct timespec Starting point.
+ * @return double Elapsed time in seconds.
+ */
+double elapsedSince(struct timespec start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/**
+ * @fn int main(int argc, char *argv[])
+ * @brief Insert NB_SYMBOLS symbols in a symbol table then look every one of them up.
+ *
+ * @param argc int Number of arguments.
+ * @param argv char*[] Arguments, the first one may override the number of symbols.
+ * @return int 0 on success, 1 if the table is inconsistent.
+ */
+int main(int argc, char *argv[])
+{
+    int nbSymbols = argc > 1 ? atoi(argv[1]) : NB_SYMBOLS;
+    SymbolTable t = createNewSymbolTable();
+    char name[SIZE_ID];
+    ident_t *ids = malloc(nbSymbols * sizeof(ident_t));
+    struct timespec start;
+    if (!ids)
+        return 1;
+
+    // Identifiers are interned by the lexer before any table sees them.
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < nbSymbols; i++)
+    {
+        sprintf(name, "v%d", i);
+        ids[i] = internString(name);
+    }
+    double interning = elapsedSince(start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < nbSymbols; i++)
+    {
+        if (addSymbol(&t, ids[i], i % 2 ? "int" : "char", 1, 0, 0) != SUCCESS)
+        {
+            fprintf(stderr, "Could not insert %s.\n", identToString(ids[i]));
+            return 1;
+        }
+    }
+    double insertion = elapsedSince(start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int index;
+    for (int i = 0; i < nbSymbols; i++)
+    {
+        if (isInTable(&t, ids[i], &index) != ID_IN_TABLE || index != i)
+        {
+            fprintf(stderr, "Could not find %s.\n", identToString(ids[i]));
+            return 1;
+        }
+    }
+    double lookup = elapsedSince(start);
+
+    fprintf(stdout, "%d symbols (capacity %d, total size %d)\n", t.len, t.capacity, t.size);
+    fprintf(stdout, "interning : %.3f s (%.1f ns / symbol)\n", interning, interning * 1e9 / nbSymbols);
+    fprintf(stdout, "insertion : %.3f s (%.1f ns / symbol)\n", insertion, insertion * 1e9 / nbSymbols);
+    fprintf(stdout, "lookup    : %.3f s (%.1f ns / symbol)\n", lookup, lookup * 1e9 / nbSymbols);
+
+    freeSymbolTable(&t);
+    free(ids);
+    resetInterner();
+    return 0;
+}
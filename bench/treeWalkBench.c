@@ -0,0 +1,168 @@
+/**
+ * @file treeWalkBench.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Micro-benchmark of the walks done over the abstract tree.
+ * @date 2024-02-10
+ *
+ * A large program is generated and parsed, then its tree is walked the way
+ * printTree does (pre-order over every child) and the way writeInstr does
+ * (dispatch on the label, operands before the operation). The time per node
+ * is mostly the cost of bringing nodes into the cache.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "tree.h"
+#include "tpcas.tab.h"
+
+#define NB_STATEMENTS 200000
+#define NB_WALKS 20
+
+extern Node *root;
+
+/**
+ * @fn double elapsedSince(struct timespec start)
+ * @brief Get the time elapsed since a point in time.
+ *
+ * @param start struct timespec Starting point.
+ * @return double Elapsed time in seconds.
+ */
+double elapsedSince(struct timespec start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/**
+ * @fn int generateProgram(char *path, int nbStatements)
+ * @brief Write a program made of arithmetic statements, ifs and whiles in a temporary file.
+ *
+ * @param path char* Template of the path of the file, updated.
+ * @param nbStatements int Number of statements of the main function.
+ * @return int 0 on success, 1 otherwise.
+ */
+int generateProgram(char *path, int nbStatements)
+{
+    int fd = mkstemp(path);
+    FILE *src = fd == -1 ? NULL : fdopen(fd, "w");
+    if (!src)
+        return 1;
+
+    fprintf(src, "int main(void) {\n    int a, b, c;\n    a = 1;\n    b = 2;\n    c = 3;\n");
+    for (int i = 0; i < nbStatements; i++)
+    {
+        switch (i % 4)
+        {
+        case 0:
+            fprintf(src, "    a = (a + b * %d) - (c / 2 + a);\n", i % 97);
+            break;
+        case 1:
+            fprintf(src, "    if (a < b && c != %d) { b = b - 1; } else { c = c + a; }\n", i % 89);
+            break;
+        case 2:
+            fprintf(src, "    while (c > %d) { c = c - 1; }\n", i % 83);
+            break;
+        default:
+            fprintf(src, "    putInt(a * b + c);\n");
+            break;
+        }
+    }
+    fprintf(src, "    return 0;\n}\n");
+    fclose(src);
+    return 0;
+}
+
+/**
+ * @fn long countNodes(Node *node)
+ * @brief Visit a tree in pre-order like printTree does.
+ *
+ * @param node Node* Root of the tree.
+ * @return long Number of nodes visited.
+ */
+long countNodes(Node *node)
+{
+    long count = 1;
+    for (Node *child = FIRSTCHILD(node); child != NULL; child = NEXTSIBLING(child))
+        count += countNodes(child);
+    return count;
+}
+
+/**
+ * @fn long evaluate(Node *node)
+ * @brief Visit a tree like writeInstr does: dispatch on the label, operands first.
+ *
+ * @param node Node* Root of the tree.
+ * @return long Value folded over the tree, so the walk cannot be optimised out.
+ */
+long evaluate(Node *node)
+{
+    long value = 0;
+    for (Node *child = FIRSTCHILD(node); child != NULL; child = NEXTSIBLING(child))
+        value += evaluate(child);
+
+    switch (node->label)
+    {
+    case Num:
+        return value + node->u.num;
+    case Addsub:
+    case Divstar:
+        return value + node->u.byte;
+    case Eq:
+    case Order:
+        return value + node->u.comp[0];
+    case Ident:
+    case Array:
+        return value ^ node->lineno;
+    default:
+        return value;
+    }
+}
+
+/**
+ * @fn int main(int argc, char *argv[])
+ * @brief Parse a generated program then walk its tree NB_WALKS times each way.
+ *
+ * @param argc int Number of arguments.
+ * @param argv char*[] Arguments, the first one may override the number of statements.
+ * @return int 0 on success, 1 if the program could not be generated or parsed.
+ */
+int main(int argc, char *argv[])
+{
+    int nbStatements = argc > 1 ? atoi(argv[1]) : NB_STATEMENTS;
+    char path[] = "/tmp/treeWalkBenchXXXXXX";
+    if (generateProgram(path, nbStatements) || !freopen(path, "r", stdin))
+    {
+        fprintf(stderr, "Could not generate the program.\n");
+        return 1;
+    }
+    int parsed = yyparse();
+    unlink(path);
+    if (parsed)
+        return 1;
+
+    struct timespec start;
+    long nbNodes = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < NB_WALKS; i++)
+        nbNodes = countNodes(root);
+    double preOrder = elapsedSince(start);
+
+    long value = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < NB_WALKS; i++)
+        value += evaluate(root);
+    double postOrder = elapsedSince(start);
+
+    fprintf(stdout, "%ld nodes of %zu bytes (%.1f MiB)\n", nbNodes, sizeof(Node), nbNodes * sizeof(Node) / 1048576.0);
+    fprintf(stdout, "printTree-like walk  : %.3f s (%.2f ns / node)\n", preOrder, preOrder * 1e9 / (nbNodes * NB_WALKS));
+    fprintf(stdout, "writeInstr-like walk : %.3f s (%.2f ns / node, %ld)\n", postOrder, postOrder * 1e9 / (nbNodes * NB_WALKS), value);
+
+    resetNodeArena();
+    resetInterner();
+    return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef __ARCHIVE_READER_H__
+#define __ARCHIVE_READER_H__
+
+#include "elfWritter.h"
+
+/* Section of a relocatable object, kind NO_SECTION if it is not loaded */
+typedef struct _object_section
+{
+    unsigned char kind;
+    const unsigned char *bytes; /* NULL in the bss */
+    unsigned long len;
+    unsigned long alignment;
+} ObjectSection;
+
+/* Symbol of a relocatable object, its section being 0 when it is only referred to */
+typedef struct _object_symbol
+{
+    ident_t name;       /* Local symbols are prefixed by the name of their object, NO_IDENT if unusable */
+    int section;
+    unsigned long value;
+    unsigned char global;
+} ObjectSymbol;
+
+/* A 32-bit field of a section patched with the address of a symbol */
+typedef struct _object_relocation
+{
+    int section;
+    unsigned long offset;
+    int symbol;
+    long addend;
+    unsigned char relative; /* Displacement from the end of the field, the addend counting from it */
+} ObjectRelocation;
+
+typedef struct _object_file
+{
+    ObjectSection *sections;
+    int nbSections;
+    ObjectSymbol *symbols;
+    int nbSymbols;
+    ObjectRelocation *relocations;
+    int nbRelocations;
+    int relocationsCapacity;
+    int linked;         /* Already linked in the executable */
+} ObjectFile;
+
+/* Objects of an archive, their bytes pointing into the file read at once */
+typedef struct _object_archive
+{
+    unsigned char *file;
+    ObjectFile *objects;
+    int nbObjects;
+    int objectsCapacity;
+} ObjectArchive;
+
+ReturnInfo readArchive(const char *fileName, ObjectArchive *archive);
+
+ObjectFile *findDefiningObject(ObjectArchive *archive, ident_t symbol);
+
+void freeArchive(ObjectArchive *archive);
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef __ASSEMBLER_H__
+#define __ASSEMBLER_H__
+
+#include "utilitaries.h"
+
+/* Register numbers, as encoded in the ModRM and REX bytes */
+#define NO_REGISTER -1
+#define RAX 0
+#define RCX 1
+#define RDX 2
+#define RBX 3
+#define RSP 4
+#define RBP 5
+#define RSI 6
+#define RDI 7
+#define R8 8
+#define R9 9
+#define R10 10
+#define R11 11
+#define R12 12
+#define R13 13
+#define R14 14
+#define R15 15
+
+typedef enum
+{
+    NO_OPERAND,
+    REG_OPERAND,
+    IMM_OPERAND,
+    MEM_OPERAND
+} OperandKind;
+
+/* Register, immediate or memory operand: [base + index * scale + symbol + value] */
+typedef struct _operand
+{
+    unsigned char kind;
+    unsigned char size; /* 1, 2, 4 or 8 bytes, 0 if not given */
+    signed char reg;    /* Register, or base of a memory operand */
+    signed char index;
+    unsigned char scale;
+    ident_t symbol;     /* Label whose address is added to value */
+    long value;
+} Operand;
+
+typedef enum
+{
+    /* Lines which are not instructions */
+    ASM_LABEL,
+    ASM_SECTION,
+    ASM_GLOBAL,
+    ASM_RESERVE,
+    ASM_DATA,
+    ASM_ALIGN,
+    /* Instructions */
+    ASM_MOV,
+    ASM_MOVSX,
+    ASM_MOVZX,
+    ASM_LEA,
+    ASM_PUSH,
+    ASM_POP,
+    ASM_ADD,
+    ASM_OR,
+    ASM_AND,
+    ASM_SUB,
+    ASM_XOR,
+    ASM_CMP,
+    ASM_TEST,
+    ASM_IMUL,
+    ASM_IDIV,
+    ASM_NEG,
+    ASM_NOT,
+    ASM_INC,
+    ASM_DEC,
+    ASM_SHL,
+    ASM_SHR,
+    ASM_SAR,
+    ASM_CALL,
+    ASM_JMP,
+    ASM_JCC,
+    ASM_SETCC,
+    ASM_CMOVCC,
+    ASM_CQO,
+    ASM_RET,
+    ASM_LEAVE,
+    ASM_SYSCALL,
+    ASM_NOP
+} Mnemonic;
+
+/* A line of assembly: an instruction, a label or a directive */
+typedef struct _instruction
+{
+    unsigned char mnemonic;
+    unsigned char cond;  /* Condition code of the ASM_JCC, ASM_SETCC and ASM_CMOVCC */
+    unsigned char nbOperands;
+    int lineno;
+    ident_t symbol;      /* Name of an ASM_LABEL, ASM_SECTION or ASM_GLOBAL */
+    Operand operands[3];
+    const char *data;    /* Bytes of an ASM_DATA, dataLen of them */
+    int dataLen;
+} Instruction;
+
+ReturnInfo parseInstructions(const char *text, unsigned long len, Instruction **insts, int *nb);
+
+void emitInstruction(const Instruction *inst, ident_t scope);
+
+ReturnInfo assembleExecutable(const char *text, unsigned long len, const char *fileName, const char *runtimeArchive);
+
+ReturnInfo assembleEmitted(const char *fileName, const char *runtimeArchive);
+
+#endif
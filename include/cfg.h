@@ -0,0 +1,30 @@
+#ifndef __CFG_H__
+#define __CFG_H__
+
+#include "ir.h"
+
+/* Sets of virtual registers, one bit per virtual register */
+#define SET_WORD_BITS 64
+#define SET_WORDS(nbVregs) (((nbVregs) + SET_WORD_BITS - 1) / SET_WORD_BITS)
+#define IS_IN_SET(set, v) ((set)[(v) / SET_WORD_BITS] >> ((v) % SET_WORD_BITS) & 1)
+#define ADD_TO_SET(set, v) ((set)[(v) / SET_WORD_BITS] |= 1UL << ((v) % SET_WORD_BITS))
+#define REMOVE_FROM_SET(set, v) ((set)[(v) / SET_WORD_BITS] &= ~(1UL << ((v) % SET_WORD_BITS)))
+
+/* Virtual registers live at the entry and at the exit of every block */
+typedef struct _liveness
+{
+    int words;              /* Words of each set */
+    unsigned long *liveIn;  /* Set of the block b starting at liveIn + b * words */
+    unsigned long *liveOut;
+} Liveness;
+
+#define LIVE_IN(live, block) ((live)->liveIn + (block) * (live)->words)
+#define LIVE_OUT(live, block) ((live)->liveOut + (block) * (live)->words)
+
+ReturnInfo buildCfg(IrFunction *ir);
+
+ReturnInfo computeLiveness(const IrFunction *ir, Liveness *live);
+
+void freeLiveness(Liveness *live);
+
+#endif
@@ -2,8 +2,36 @@
 #define __DEFAULT_FUNCTION_WRITTER_H__
 
 #include "utilitaries.h"
-#include <stdio.h>
 
-ReturnInfo writeDefaultFunctions(FILE *f);
+/* Bytes of the buffers of the standard input and output */
+#define IN_BUFFER_SIZE 65536
+#define OUT_BUFFER_SIZE 65536
+
+/* Bytes putInt needs in the output buffer: the sign and up to 19 digits, copied 8 by 8 */
+#define INT_ROOM 32
+
+/* Archive of the runtime built by make runtime, looked for next to the compiler */
+#define RUNTIME_ARCHIVE "libtpcrt.a"
+#define RUNTIME_ARCHIVE_PATH_LEN 4096
+
+/* Parts of the runtime, the ones called by the programs after the ones they use */
+typedef enum
+{
+    RUNTIME_OUTPUT,
+    RUNTIME_INPUT,
+    RUNTIME_GET_CHAR,
+    RUNTIME_GET_INT,
+    RUNTIME_PUT_CHAR,
+    RUNTIME_PUT_INT,
+    NB_RUNTIME_UNITS
+} RuntimeUnit;
+
+int findRuntimeFunction(const char *name);
+
+const char *runtimeFunctionName(RuntimeUnit unit);
+
+ReturnInfo writeLinkedRuntime(const int *called);
+
+ReturnInfo writeRuntimeSources(const char *directory);
 
 #endif
@@ -0,0 +1,40 @@
+#ifndef __ELF_WRITTER_H__
+#define __ELF_WRITTER_H__
+
+#include "utilitaries.h"
+
+/* Sections of a static executable, in the order they are laid out in memory */
+typedef enum
+{
+    NO_SECTION,
+    TEXT_SECTION,
+    DATA_SECTION,
+    BSS_SECTION
+} SectionKind;
+
+typedef struct _elf_symbol
+{
+    ident_t name;
+    unsigned char section;
+    unsigned long address;
+} ElfSymbol;
+
+/* Content and layout of a static, non position independent, executable */
+typedef struct _executable_image
+{
+    const unsigned char *text;
+    unsigned long textLen;
+    const unsigned char *data;
+    unsigned long dataLen;
+    unsigned long bssLen;
+    unsigned long addresses[BSS_SECTION + 1]; /* Address of each section, see layoutExecutable */
+    unsigned long entry;
+    const ElfSymbol *symbols;
+    int nbSymbols;
+} ExecutableImage;
+
+void layoutExecutable(ExecutableImage *image);
+
+ReturnInfo writeExecutable(const ExecutableImage *image, const char *fileName);
+
+#endif
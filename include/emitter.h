@@ -0,0 +1,30 @@
+#ifndef __EMITTER_H__
+#define __EMITTER_H__
+
+#include "utilitaries.h"
+
+/**
+ * @def emitLit(literal)
+ * @brief Append a string literal, its length being known at compile time.
+ */
+#define emitLit(literal) emitBytes("" literal, sizeof(literal) - 1)
+
+ReturnInfo startEmitter();
+
+void emitBytes(const char *bytes, unsigned long len);
+
+void emitStr(const char *str);
+
+void emitInt(long value);
+
+void emit(const char *format, ...);
+
+const char *emittedText(unsigned long *len);
+
+void truncateEmitted(unsigned long len);
+
+ReturnInfo writeEmitted(const char *fileName);
+
+void freeEmitter();
+
+#endif
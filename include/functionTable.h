@@ -7,9 +7,9 @@ FunctionTable createNewFunctionTable();
 
 void freeFunctionTable(FunctionTable *t);
 
-ReturnInfo isFunctionInTable(FunctionTable t, char *id, int *index);
+ReturnInfo isFunctionInTable(const FunctionTable *t, ident_t id, int *index);
 
-ReturnInfo addFunctions(FunctionTable *t, Node *root, ProgTable pt);
+ReturnInfo addFunctions(FunctionTable *t, Node *root, const ProgTable *pt);
 
 ReturnInfo addDefaultFunctions(FunctionTable *t);
 
@@ -0,0 +1,16 @@
+#ifndef __HASH_INDEX_H__
+#define __HASH_INDEX_H__
+
+#include "tables.h"
+
+unsigned int hashString(const char *str, int len);
+
+HashIndex createNewHashIndex();
+
+void freeHashIndex(HashIndex *h);
+
+ReturnInfo addToHashIndex(HashIndex *h, const void *entries, unsigned long stride, int len);
+
+int findInHashIndex(HashIndex h, const void *entries, unsigned long stride, ident_t id);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef __INLINER_H__
+#define __INLINER_H__
+
+#include "cfg.h"
+
+/* Instructions of a function above which it is not inlined by default */
+#define DEFAULT_INLINE_LIMIT 20
+
+ReturnInfo inlineCalls(IrProgram *prog, int limit);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef __INTERN_H__
+#define __INTERN_H__
+
+/* Id of an interned string: two identifiers are equal iff their ids are */
+typedef int ident_t;
+
+/* Id of the empty string, held by nodes which carry no identifier */
+#define NO_IDENT 0
+
+ident_t internString(const char *str);
+
+ident_t internLexeme(const char *str, int len);
+
+const char *identToString(ident_t id);
+
+void resetInterner();
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef __IR_H__
+#define __IR_H__
+
+#include "progTable.h"
+
+/* Virtual register holding a 64-bit value, NO_VREG standing for no register */
+typedef int vreg_t;
+#define NO_VREG -1
+
+/* Operations of the lowered code, dst, a, b and c being virtual registers */
+typedef enum
+{
+    IR_PARAM,     /* dst = parameter number imm of the function */
+    IR_CONST,     /* dst = imm */
+    IR_COPY,      /* dst = a */
+    IR_EXTEND,    /* dst = a sign extended from its size low bytes */
+    IR_ADD,       /* dst = a + b */
+    IR_SUB,       /* dst = a - b */
+    IR_MUL,       /* dst = a * b */
+    IR_DIV,       /* dst = a / b */
+    IR_MOD,       /* dst = a % b */
+    IR_EQ,        /* dst = a == b */
+    IR_NE,        /* dst = a != b */
+    IR_LT,        /* dst = a < b */
+    IR_LE,        /* dst = a <= b */
+    IR_GT,        /* dst = a > b */
+    IR_GE,        /* dst = a >= b */
+    IR_NEG,       /* dst = -a */
+    IR_NOT,       /* dst = a == 0 */
+    IR_ADDR,      /* dst = address of the memory operand */
+    IR_LOAD,      /* dst = memory operand, sign extended from its size bytes */
+    IR_STORE,     /* memory operand = size low bytes of c */
+    IR_CALL,      /* dst = symbol(imm arguments listed from callArgs[a]), dst may be NO_VREG */
+    IR_RET,       /* return a, which may be NO_VREG */
+    IR_LABEL,     /* label number imm */
+    IR_JUMP,      /* jump to label imm */
+    IR_JUMP_EQ,   /* jump to label imm if a == b, b being 0 when NO_VREG */
+    IR_JUMP_NE,   /* jump to label imm if a != b */
+    IR_JUMP_LT,   /* jump to label imm if a < b */
+    IR_JUMP_LE,   /* jump to label imm if a <= b */
+    IR_JUMP_GT,   /* jump to label imm if a > b */
+    IR_JUMP_GE    /* jump to label imm if a >= b */
+} IrOp;
+
+/* Conditional jumps test the comparison of the same rank from IR_EQ */
+#define IS_CONDITIONAL_JUMP(op) ((op) >= IR_JUMP_EQ && (op) <= IR_JUMP_GE)
+#define JUMP_COMPARISON(op) ((op) - IR_JUMP_EQ + IR_EQ)
+
+/* Base of a memory operand [base + b * size + imm], b being NO_VREG without index */
+typedef enum
+{
+    NO_BASE,
+    GLOBAL_BASE,  /* Global variable symbol */
+    FRAME_BASE,   /* Frame pointer, imm being the offset of the variable */
+    POINTER_BASE  /* Address held by a */
+} IrBase;
+
+typedef struct _ir_instr
+{
+    unsigned char op;   /* IrOp of the instruction */
+    unsigned char size; /* Bytes of a memory access or of an extension: 1, 4 or 8 */
+    unsigned char base; /* IrBase of a memory operand */
+    vreg_t dst;
+    vreg_t a, b, c;
+    ident_t symbol;     /* Global of a memory operand or function called */
+    long imm;
+} IrInstr;
+
+#define NO_BLOCK -1
+
+/* Instructions first to end - 1 of a function, only entered by the first one
+   and only left by the last one */
+typedef struct _basic_block
+{
+    int first;
+    int end;
+    int succs[2];   /* Block fallen or jumped into, then block of a conditional jump, NO_BLOCK if none */
+    int firstPred;  /* Predecessors listed from preds[firstPred] */
+    int nbPreds;
+} BasicBlock;
+
+/* Lowered code of a function: parameters are virtual registers 0 to nbParams - 1,
+   defined by the first nbParams instructions, scalar locals the following ones,
+   then the values of the ands and ors, temporaries being numbered after them */
+typedef struct _ir_function
+{
+    const FunctionInfo *fun;
+    IrInstr *instrs;
+    int len;
+    int capacity;
+    vreg_t *callArgs;   /* Arguments of every call, in order */
+    int nbCallArgs;
+    int callArgsCapacity;
+    int nbParams;
+    int nbVariables;    /* Parameters, locals and values of ands and ors, which may be assigned more than once */
+    int nbVregs;
+    int nbLabels;
+    int frameSize;      /* Bytes of the frame taken by the local variables */
+    BasicBlock *blocks; /* Control-flow graph, blocks being in the order of the code */
+    int nbBlocks;
+    int *preds;         /* Predecessors of every block, in order */
+    int *labelBlocks;   /* Block starting with each label */
+} IrFunction;
+
+typedef struct _ir_program
+{
+    IrFunction *functions; /* Lowered functions, in the order of the source */
+    int len;
+    int capacity;
+} IrProgram;
+
+IrInstr makeIr(IrOp op, vreg_t dst, vreg_t a, vreg_t b, long imm);
+
+ReturnInfo appendIr(IrFunction *ir, IrInstr instr);
+
+ReturnInfo lowerFunction(Node *fun, const FunctionInfo *funTable, const ProgTable *pt, IrFunction *ir);
+
+ReturnInfo lowerProg(Node *root, const ProgTable *pt, IrProgram *prog);
+
+int getIrOperandSlots(IrInstr *instr, vreg_t *slots[3]);
+
+int getIrOperands(const IrInstr *instr, vreg_t operands[3]);
+
+void removeIrInstrs(IrFunction *ir, const char *removed);
+
+void printIrProgram(const IrProgram *prog);
+
+void freeIrFunction(IrFunction *ir);
+
+void freeIrProgram(IrProgram *prog);
+
+#endif
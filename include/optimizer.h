@@ -0,0 +1,8 @@
+#ifndef __OPTIMIZER_H__
+#define __OPTIMIZER_H__
+
+#include "ir.h"
+
+ReturnInfo optimizeProg(IrProgram *prog, int inlineLimit);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef __PEEPHOLE_H__
+#define __PEEPHOLE_H__
+
+#include "assembler.h"
+
+/* Instructions a rewriting of the peephole may look at by default, the ones it rewrites included */
+#define DEFAULT_PEEPHOLE_WINDOW 8
+
+/* Smallest window of the peephole, an instruction and the next one, a smaller one disabling it */
+#define MIN_PEEPHOLE_WINDOW 2
+
+typedef enum
+{
+    PEEPHOLE_PUSH_POP,
+    PEEPHOLE_FORWARDED_LOAD,
+    PEEPHOLE_REDUNDANT_MOVE,
+    PEEPHOLE_DEAD_MOVE,
+    PEEPHOLE_PROPAGATED_OPERAND,
+    PEEPHOLE_IMUL_IMMEDIATE,
+    PEEPHOLE_ADD_TO_LEA,
+    PEEPHOLE_JUMP,
+    NB_PEEPHOLE_RULES
+} PeepholeRule;
+
+/* What the peephole did to a function */
+typedef struct _peephole_stats
+{
+    int before;                       /* Instructions before the peephole, labels excepted */
+    int after;                        /* Instructions after it */
+    int applied[NB_PEEPHOLE_RULES];   /* Rewritings done by each rule */
+} PeepholeStats;
+
+ReturnInfo peepholeEmitted(unsigned long start, int window, PeepholeStats *stats);
+
+void printPeepholeStats(const char *function, const PeepholeStats *stats);
+
+#endif
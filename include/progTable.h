@@ -8,11 +8,11 @@ ProgTable createNewProgTable();
 
 ReturnInfo fillProgTable(ProgTable *t, Node *root);
 
-FunctionInfo getFunctionsTable(ProgTable t, char *funName);
+const FunctionInfo *getFunctionsTable(const ProgTable *t, ident_t funName);
 
 void freeProgTable(ProgTable *t);
 
-void printProgTable(ProgTable t, int showAllTables, int showAllFunctions, char *functionToShow, int showGlobals);
+void printProgTable(const ProgTable *t, int showAllTables, int showAllFunctions, char *functionToShow, int showGlobals);
 
 #endif
 
@@ -0,0 +1,25 @@
+#ifndef __REGALLOC_H__
+#define __REGALLOC_H__
+
+#include "ir.h"
+#include "assembler.h"
+
+/* A location below SPILLED is a machine register, SPILLED + n being the spill slot n */
+#define SPILLED 16
+#define NO_LOCATION -1
+
+/* Registers used to pass the arguments of a function */
+extern const int ARG_REGISTERS[6];
+
+typedef struct _allocation
+{
+    int *locations;              /* Location of each virtual register, NO_LOCATION if never used */
+    int nbSpillSlots;
+    unsigned int usedRegisters;  /* Bit mask of the machine registers given to virtual registers */
+} Allocation;
+
+ReturnInfo allocateRegisters(const IrFunction *ir, Allocation *alloc);
+
+void freeAllocation(Allocation *alloc);
+
+#endif
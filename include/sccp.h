@@ -0,0 +1,8 @@
+#ifndef __SCCP_H__
+#define __SCCP_H__
+
+#include "cfg.h"
+
+ReturnInfo propagateConstants(IrFunction *ir);
+
+#endif
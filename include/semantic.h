@@ -0,0 +1,8 @@
+#ifndef __SEMANTIC_H__
+#define __SEMANTIC_H__
+
+#include "progTable.h"
+
+ReturnInfo checkProg(Node *root, const ProgTable *pt);
+
+#endif
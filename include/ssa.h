@@ -0,0 +1,35 @@
+#ifndef __SSA_H__
+#define __SSA_H__
+
+#include "ir.h"
+
+/* Merge of the versions of a variable reaching a block, one per predecessor,
+   the entry block having one more for the function entry */
+typedef struct _phi
+{
+    vreg_t var;     /* Variable merged */
+    vreg_t dst;     /* Version defined */
+    int block;
+    int firstArg;   /* Versions merged, listed from args[firstArg] in the order of the predecessors */
+} Phi;
+
+/* Static single assignment form of a function: every definition of a variable
+   defines a new version, which is a new virtual register */
+typedef struct _ssa
+{
+    Phi *phis;          /* Phis of every block, in the order of the blocks */
+    int nbPhis;
+    int *firstPhi;      /* Phis of the block b are phis[firstPhi[b]] to phis[firstPhi[b + 1] - 1] */
+    vreg_t *args;
+    int nbArgs;
+    vreg_t *variables;  /* Variable of every version, a temporary being its own variable */
+    int nbVregs;        /* Virtual registers of the function before its conversion */
+} Ssa;
+
+int nbPhiArgs(const IrFunction *ir, int block);
+
+ReturnInfo buildSsa(IrFunction *ir, Ssa *ssa);
+
+void leaveSsa(IrFunction *ir, Ssa *ssa);
+
+#endif
@@ -9,15 +9,17 @@ SymbolTable createNewSymbolTable();
 
 void freeSymbolTable(SymbolTable *t);
 
-ReturnInfo isInTable(SymbolTable t, char *id, int *index);
+ReturnInfo isInTable(const SymbolTable *t, ident_t id, int *index);
 
-AuthorizedType getType(char *type);
+ReturnInfo addSymbol(SymbolTable *t, ident_t id, const char *type, int size, int isArray, int isAdress);
+
+AuthorizedType getType(const char *type);
 
 char *typeToString(AuthorizedType type);
 
 void printSymbolTable(SymbolTable t);
 
-ReturnInfo addListOfSymbol(SymbolTable *t, Node *node, ProgTable pt);
+ReturnInfo addListOfSymbol(SymbolTable *t, Node *node, const ProgTable *pt);
 
 ReturnInfo addSymbolsTableFromArray(SymbolTable *table, char *symbols[][2]);
 
@@ -11,9 +11,15 @@ typedef enum
     INT = 4
 } AuthorizedType;
 
+typedef struct _hash_index
+{
+    int *slots;
+    int capacity;
+} HashIndex;
+
 typedef struct _symbol
 {
-    char id[SIZE_ID];
+    ident_t id;
     AuthorizedType type;
     int address;
     int numberOfValues;
@@ -25,12 +31,14 @@ typedef struct _table
 {
     Symbol *symbols;
     int len;
+    int capacity;
     int size;
+    HashIndex index;
 } SymbolTable;
 
 typedef struct _function_info
 {
-    char id[SIZE_ID];
+    ident_t id;
     AuthorizedType type;
     SymbolTable args;
     SymbolTable locals;
@@ -41,7 +49,9 @@ typedef struct _function_table
 {
     FunctionInfo *functions;
     int len;
+    int capacity;
     int size;
+    HashIndex index;
 } FunctionTable;
 
 typedef struct _prog_table
@@ -4,6 +4,10 @@
 #ifndef __TREE__
 #define __TREE__
 
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
+
 #define SIZE_ID 64
 
 typedef enum
@@ -55,21 +59,79 @@ typedef enum
     /* To avoid listing them twice, see https://stackoverflow.com/a/10966395 */
 } label_t;
 
+/* Scope an identifier is bound to by the semantic pass */
+typedef enum
+{
+    UNBOUND,
+    LOCAL_SCOPE,
+    ARG_SCOPE,
+    GLOBAL_SCOPE,
+    FUNCTION_SCOPE
+} scope_t;
+
+/* Type of a node not typed yet (no expression is ever typed Prog) */
+#define UNTYPED Prog
+
+/* Index of a node in the node array, NO_NODE standing for no node at all */
+typedef uint32_t nodeid_t;
+#define NO_NODE 0
+
+/* Nodes are 28 bytes: links are 32-bit indices and enums are packed in bytes */
 typedef struct Node
 {
-    label_t label;
-    struct Node *firstChild, *nextSibling;
     union
     {
         char byte;
         int num;
-        char ident[SIZE_ID];
+        ident_t ident;
         char comp[3];
         char character[3];
     } u;
+    nodeid_t id;          /* Index of the node itself */
+    nodeid_t firstChild;  /* Index of the first child, NO_NODE if none */
+    nodeid_t nextSibling; /* Index of the next sibling, NO_NODE if none */
     int lineno;
+    int binding;          /* Index of the identifier in the table of its scope */
+    unsigned char label;  /* label_t of the node */
+    unsigned char type;   /* Num, Character, Address or Void once typed */
+    unsigned char scope;  /* scope_t of the identifier once bound */
 } Node;
 
+/* The node array is made of chunks that never move, found by the high bits of an index */
+#define NODE_CHUNK_BITS 12
+#define NODE_CHUNK_SIZE (1 << NODE_CHUNK_BITS)
+
+extern Node **nodeChunks;
+
+/**
+ * @fn static inline Node *nodeAt(nodeid_t id)
+ * @brief Get the node at an index of the node array.
+ *
+ * @param id nodeid_t Index of the node.
+ * @return Node* Node found, NULL for NO_NODE.
+ */
+static inline Node *nodeAt(nodeid_t id)
+{
+    return id == NO_NODE ? NULL : &nodeChunks[id >> NODE_CHUNK_BITS][id & (NODE_CHUNK_SIZE - 1)];
+}
+
+/**
+ * @fn static inline nodeid_t nodeId(const Node *node)
+ * @brief Get the index of a node in the node array.
+ *
+ * @param node const Node* Node, may be NULL.
+ * @return nodeid_t Index of the node, NO_NODE for NULL.
+ */
+static inline nodeid_t nodeId(const Node *node)
+{
+    return node ? node->id : NO_NODE;
+}
+
+typedef struct NodeList
+{
+    Node *first, *last;
+} NodeList;
+
 extern const char *StringFromLabel[];
 extern Node *root;
 extern int lineno;
@@ -77,11 +139,15 @@ extern int lineno;
 Node *makeNode(label_t label);
 void addSibling(Node *node, Node *sibling);
 void addChild(Node *parent, Node *child);
-void deleteTree(Node *node);
+NodeList makeList(Node *first);
+void appendToList(NodeList *list, Node *node);
+Node *listToNode(label_t label, NodeList list);
+void resetNodeArena();
 void printTree(Node *node);
 
-#define FIRSTCHILD(node) node->firstChild
-#define SECONDCHILD(node) node->firstChild->nextSibling
-#define THIRDCHILD(node) node->firstChild->nextSibling->nextSibling
+#define FIRSTCHILD(node) nodeAt((node)->firstChild)
+#define NEXTSIBLING(node) nodeAt((node)->nextSibling)
+#define SECONDCHILD(node) NEXTSIBLING(FIRSTCHILD(node))
+#define THIRDCHILD(node) NEXTSIBLING(SECONDCHILD(node))
 
 #endif
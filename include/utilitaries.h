@@ -7,21 +7,22 @@ void printRowsOfChar(char c, int nb);
 
 void printTableLine(int *columnLength, int columnNb);
 
-AuthorizedType getType(char *type);
+AuthorizedType getType(const char *type);
 
 char *typeToString(AuthorizedType type);
 
-ReturnInfo addCell(void **arr, int len, unsigned long size);
+ReturnInfo addCell(void **arr, int len, int *capacity, unsigned long size);
 
 int optionHandler(int argc, char **argv, int *showAllTables,
                   int *showAllFunctions, char *functionToShow, int *showGlobals,
-                  int *printTreeOption, char *outputName);
+                  int *printTreeOption, int *printIrOption, int *inlineLimit,
+                  int *peepholeWindow, int *printPeepholeOption, char *outputName);
 
 Node *getChildLabeled(Node *node, label_t label);
 
 ReturnInfo printReturnInfo(ReturnInfo info);
 
-ReturnInfo getFunId(Node *declFun, char *funId);
+ReturnInfo getFunId(Node *declFun, ident_t *funId);
 
 int charToAsciiCode(const char *character);
 
@@ -32,6 +33,6 @@ int max(int a, int b);
 
 char *sizeToAsm(int size);
 
-label_t getExpressionType(Node *expr, ProgTable pt, FunctionInfo funTable);
+label_t getExpressionType(Node *expr, const ProgTable *pt, const FunctionInfo *funTable);
 
 #endif
@@ -1,8 +1,11 @@
 #ifndef __WRITTER_H__
 #define __WRITTER_H__
 
-#include "progTable.h"
+#include "ir.h"
 
-ReturnInfo writeAll(Node *root, ProgTable pt, char *fileName);
+/* Bytes below rsp a leaf function may use without reserving them */
+#define RED_ZONE 128
+
+ReturnInfo writeAll(const IrProgram *prog, const ProgTable *pt, char *fileName, int peepholeWindow, int printPeephole, int linkArchive);
 
 #endif
@@ -0,0 +1,315 @@
+/**
+ * @file archiveReader.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Reader of the archives of x86-64 ELF relocatable objects, such as the runtime archive.
+ * @date 2024-02-10
+ *
+ * The archive is read at once and each of its objects is cut into the
+ * sections loaded in an executable (code, data and bss), its symbols and the
+ * relocations of those sections. Only the relocations the assembler can
+ * patch are understood: 32-bit addresses and 32-bit displacements.
+ */
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "archiveReader.h"
+
+#define AR_MAGIC "!<arch>\n"
+#define AR_MAGIC_LEN 8
+#define AR_HEADER_LEN 60
+#define AR_SIZE_OFFSET 48
+#define AR_SIZE_LEN 10
+
+/**
+ * @fn ReturnInfo archiveError(const char *fileName, const char *message)
+ * @brief Report an error of an archive.
+ *
+ * @param fileName const char* Name of the archive.
+ * @param message const char* Message to print.
+ * @return ReturnInfo FAILURE.
+ */
+ReturnInfo archiveError(const char *fileName, const char *message)
+{
+    fprintf(stderr, "Error in the archive %s: %s\n", fileName, message);
+    return FAILURE;
+}
+
+/**
+ * @fn int readFile(const char *fileName, unsigned char **bytes, unsigned long *len)
+ * @brief Read a whole file into an allocated buffer.
+ *
+ * @param fileName const char* Name of the file.
+ * @param bytes unsigned char** Content of the file, allocated.
+ * @param len unsigned long* Length of the file, filled.
+ * @return int 1 on success, 0 otherwise.
+ */
+int readFile(const char *fileName, unsigned char **bytes, unsigned long *len)
+{
+    FILE *f = fopen(fileName, "rb");
+    if (!f)
+        return 0;
+    long size = fseek(f, 0, SEEK_END) ? -1 : ftell(f);
+    *bytes = size >= 0 ? malloc(size + 1) : NULL;
+    int read = *bytes && !fseek(f, 0, SEEK_SET) && fread(*bytes, 1, size, f) == (unsigned long)size;
+    fclose(f);
+    if (!read)
+    {
+        free(*bytes);
+        *bytes = NULL;
+        return 0;
+    }
+    *len = size;
+    return 1;
+}
+
+/**
+ * @fn ident_t localSymbolName(int object, const char *name)
+ * @brief Intern the name of a local symbol of an object, prefixed so it never meets the one of another object.
+ *
+ * @param object int Position of the object in its archive.
+ * @param name const char* Name of the symbol in the object.
+ * @return ident_t Interned name.
+ */
+ident_t localSymbolName(int object, const char *name)
+{
+    char qualified[512];
+    snprintf(qualified, sizeof(qualified), "%d:%s", object, name);
+    return internString(qualified);
+}
+
+/**
+ * @fn unsigned char sectionKind(const Elf64_Shdr *header)
+ * @brief Get the section of the executable a section of an object is loaded in.
+ *
+ * @param header const Elf64_Shdr* Header of the section.
+ * @return unsigned char Section of the executable, NO_SECTION if it is not loaded.
+ */
+unsigned char sectionKind(const Elf64_Shdr *header)
+{
+    if (!(header->sh_flags & SHF_ALLOC))
+        return NO_SECTION;
+    if (header->sh_type == SHT_NOBITS)
+        return BSS_SECTION;
+    if (header->sh_type != SHT_PROGBITS)
+        return NO_SECTION;
+    return header->sh_flags & SHF_EXECINSTR ? TEXT_SECTION : DATA_SECTION;
+}
+
+/**
+ * @fn ReturnInfo readRelocations(ObjectFile *o, const unsigned char *bytes, const Elf64_Shdr *header)
+ * @brief Read a relocation section of an object, its target being loaded.
+ *
+ * @param o ObjectFile* Object, its relocations are completed.
+ * @param bytes const unsigned char* Bytes of the object.
+ * @param header const Elf64_Shdr* Header of the relocation section.
+ * @return ReturnInfo Eventual error code, FAILURE for a relocation the assembler cannot patch.
+ */
+ReturnInfo readRelocations(ObjectFile *o, const unsigned char *bytes, const Elf64_Shdr *header)
+{
+    for (unsigned long pos = 0; pos + sizeof(Elf64_Rela) <= header->sh_size; pos += sizeof(Elf64_Rela))
+    {
+        Elf64_Rela rela;
+        memcpy(&rela, bytes + header->sh_offset + pos, sizeof(rela));
+        int type = ELF64_R_TYPE(rela.r_info);
+        int relative = type == R_X86_64_PC32 || type == R_X86_64_PLT32;
+        if (!relative && type != R_X86_64_32 && type != R_X86_64_32S)
+            return FAILURE;
+        if (ELF64_R_SYM(rela.r_info) >= (unsigned long)o->nbSymbols)
+            return FAILURE;
+
+        ReturnInfo info = addCell((void **)&o->relocations, o->nbRelocations, &o->relocationsCapacity, sizeof(ObjectRelocation));
+        if (info != SUCCESS)
+            return info;
+        o->relocations[o->nbRelocations++] = (ObjectRelocation){header->sh_info, rela.r_offset, ELF64_R_SYM(rela.r_info),
+                                                                rela.r_addend + (relative ? 4 : 0), relative};
+    }
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo readSymbols(ObjectFile *o, int object, const unsigned char *bytes, const Elf64_Shdr *table, const Elf64_Shdr *names)
+ * @brief Read the symbol table of an object.
+ *
+ * @param o ObjectFile* Object, its symbols are filled.
+ * @param object int Position of the object in its archive.
+ * @param bytes const unsigned char* Bytes of the object.
+ * @param table const Elf64_Shdr* Header of the symbol table.
+ * @param names const Elf64_Shdr* Header of the names of the symbols.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo readSymbols(ObjectFile *o, int object, const unsigned char *bytes, const Elf64_Shdr *table, const Elf64_Shdr *names)
+{
+    const char *strings = (const char *)bytes + names->sh_offset;
+    if (!names->sh_size || strings[names->sh_size - 1])
+        return FAILURE;
+
+    o->nbSymbols = table->sh_size / sizeof(Elf64_Sym);
+    o->symbols = malloc((o->nbSymbols + 1) * sizeof(ObjectSymbol));
+    if (!o->symbols)
+        return ALLOC_ERROR;
+    for (int i = 0; i < o->nbSymbols; i++)
+    {
+        Elf64_Sym sym;
+        memcpy(&sym, bytes + table->sh_offset + i * sizeof(Elf64_Sym), sizeof(sym));
+        ObjectSymbol *s = &o->symbols[i];
+        *s = (ObjectSymbol){NO_IDENT, 0, sym.st_value, ELF64_ST_BIND(sym.st_info) != STB_LOCAL};
+        if (sym.st_name >= names->sh_size || sym.st_shndx >= o->nbSections)
+            continue; // absolute and common symbols are never referred to by the runtime
+        s->section = sym.st_shndx;
+
+        char sectionName[32];
+        snprintf(sectionName, sizeof(sectionName), "section %d", s->section);
+        if (ELF64_ST_TYPE(sym.st_info) == STT_SECTION)
+            s->name = localSymbolName(object, sectionName);
+        else if (s->global)
+            s->name = internString(strings + sym.st_name);
+        else if (s->section)
+            s->name = localSymbolName(object, strings + sym.st_name);
+    }
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo readObject(ObjectFile *o, int object, const unsigned char *bytes, unsigned long len)
+ * @brief Read a relocatable object: its loaded sections, its symbols and their relocations.
+ *
+ * @param o ObjectFile* Object, filled.
+ * @param object int Position of the object in its archive.
+ * @param bytes const unsigned char* Bytes of the object.
+ * @param len unsigned long Number of bytes of the object.
+ * @return ReturnInfo Eventual error code, FAILURE for an object the assembler cannot link.
+ */
+ReturnInfo readObject(ObjectFile *o, int object, const unsigned char *bytes, unsigned long len)
+{
+    Elf64_Ehdr header;
+    memset(o, 0, sizeof(*o));
+    if (len < sizeof(header))
+        return FAILURE;
+    memcpy(&header, bytes, sizeof(header));
+    if (memcmp(header.e_ident, ELFMAG, SELFMAG) || header.e_ident[EI_CLASS] != ELFCLASS64 ||
+        header.e_type != ET_REL || header.e_machine != EM_X86_64 || header.e_shentsize != sizeof(Elf64_Shdr) ||
+        header.e_shoff > len || header.e_shnum > (len - header.e_shoff) / sizeof(Elf64_Shdr))
+        return FAILURE;
+
+    o->nbSections = header.e_shnum;
+    Elf64_Shdr *headers = malloc((o->nbSections + 1) * sizeof(Elf64_Shdr));
+    o->sections = malloc((o->nbSections + 1) * sizeof(ObjectSection));
+    if (!headers || !o->sections)
+    {
+        free(headers);
+        return ALLOC_ERROR;
+    }
+    memcpy(headers, bytes + header.e_shoff, o->nbSections * sizeof(Elf64_Shdr));
+
+    ReturnInfo info = SUCCESS;
+    int symbols = -1;
+    for (int i = 0; i < o->nbSections && info == SUCCESS; i++)
+    {
+        const Elf64_Shdr *h = &headers[i];
+        if (h->sh_type != SHT_NOBITS && (h->sh_offset > len || h->sh_size > len - h->sh_offset))
+            info = FAILURE;
+        o->sections[i] = (ObjectSection){sectionKind(h), h->sh_type == SHT_NOBITS ? NULL : bytes + h->sh_offset,
+                                         h->sh_size, h->sh_addralign ? h->sh_addralign : 1};
+        if (h->sh_type == SHT_SYMTAB)
+            symbols = i;
+        else if (h->sh_type == SHT_REL)
+            info = FAILURE;
+    }
+    if (info == SUCCESS && (symbols < 0 || headers[symbols].sh_link >= (unsigned int)o->nbSections))
+        info = FAILURE;
+    if (info == SUCCESS)
+        info = readSymbols(o, object, bytes, &headers[symbols], &headers[headers[symbols].sh_link]);
+
+    for (int i = 0; i < o->nbSections && info == SUCCESS; i++)
+        if (headers[i].sh_type == SHT_RELA && headers[i].sh_info < (unsigned int)o->nbSections &&
+            o->sections[headers[i].sh_info].kind != NO_SECTION)
+            info = readRelocations(o, bytes, &headers[i]);
+    free(headers);
+    return info;
+}
+
+/**
+ * @fn ReturnInfo readArchive(const char *fileName, ObjectArchive *archive)
+ * @brief Read the objects of an archive. The symbol table of the archive is not needed,
+ * the symbols being found in the objects themselves.
+ *
+ * @param fileName const char* Name of the archive.
+ * @param archive ObjectArchive* Archive, filled.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo readArchive(const char *fileName, ObjectArchive *archive)
+{
+    unsigned long len;
+    memset(archive, 0, sizeof(*archive));
+    if (!readFile(fileName, &archive->file, &len))
+        return archiveError(fileName, "could not be read");
+    if (len < AR_MAGIC_LEN || memcmp(archive->file, AR_MAGIC, AR_MAGIC_LEN))
+        return archiveError(fileName, "not an archive");
+
+    for (unsigned long pos = AR_MAGIC_LEN; pos + AR_HEADER_LEN <= len;)
+    {
+        char size[AR_SIZE_LEN + 1] = {0};
+        memcpy(size, archive->file + pos + AR_SIZE_OFFSET, AR_SIZE_LEN);
+        unsigned long memberLen = strtoul(size, NULL, 10);
+        const unsigned char *member = archive->file + pos + AR_HEADER_LEN;
+        if (memberLen > len - pos - AR_HEADER_LEN)
+            return archiveError(fileName, "truncated member");
+
+        // the members named / and // are the symbol table and the long names of the archive
+        if (archive->file[pos] != '/')
+        {
+            ReturnInfo info = addCell((void **)&archive->objects, archive->nbObjects, &archive->objectsCapacity, sizeof(ObjectFile));
+            if (info != SUCCESS)
+                return info;
+            info = readObject(&archive->objects[archive->nbObjects], archive->nbObjects, member, memberLen);
+            archive->nbObjects++;
+            if (info == FAILURE)
+                return archiveError(fileName, "object that cannot be linked");
+            if (info != SUCCESS)
+                return info;
+        }
+        pos += AR_HEADER_LEN + memberLen + (memberLen & 1);
+    }
+    return SUCCESS;
+}
+
+/**
+ * @fn ObjectFile *findDefiningObject(ObjectArchive *archive, ident_t symbol)
+ * @brief Find the object of an archive defining a global symbol.
+ *
+ * @param archive ObjectArchive* Archive.
+ * @param symbol ident_t Symbol.
+ * @return ObjectFile* Object defining the symbol, NULL if none does.
+ */
+ObjectFile *findDefiningObject(ObjectArchive *archive, ident_t symbol)
+{
+    for (int i = 0; i < archive->nbObjects; i++)
+        for (int j = 0; j < archive->objects[i].nbSymbols; j++)
+        {
+            const ObjectSymbol *s = &archive->objects[i].symbols[j];
+            if (s->global && s->section && s->name == symbol)
+                return &archive->objects[i];
+        }
+    return NULL;
+}
+
+/**
+ * @fn void freeArchive(ObjectArchive *archive)
+ * @brief Free an archive and its objects.
+ *
+ * @param archive ObjectArchive* Archive to free.
+ */
+void freeArchive(ObjectArchive *archive)
+{
+    for (int i = 0; i < archive->nbObjects; i++)
+    {
+        free(archive->objects[i].sections);
+        free(archive->objects[i].symbols);
+        free(archive->objects[i].relocations);
+    }
+    free(archive->objects);
+    free(archive->file);
+    memset(archive, 0, sizeof(*archive));
+}
@@ -0,0 +1,1831 @@
+/**
+ * @file assembler.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Built-in assembler: translate the emitted assembly into a static executable.
+ * @date 2024-02-10
+ *
+ * Only the part of the NASM syntax the writers produce is understood: labels
+ * (local ones starting with a dot are scoped by the previous label), the
+ * text, data and bss sections, the reservation and data directives, and the
+ * integer instructions of the code generator. global and extern have no effect:
+ * the labels a program refers to without defining them are taken from the
+ * objects of the runtime archive, which are linked in, or from the parts of the
+ * runtime written after the program when there is no archive.
+ *
+ * Jumps and calls always take a 32-bit displacement and labels a 32-bit
+ * absolute address (the executable is not position independent), so the size
+ * of an instruction never depends on the address of a label. Every line is
+ * therefore encoded as soon as it is read, and the references to labels are
+ * patched once all of them are known.
+ *
+ * The parser also gives the peephole (see peephole.c) the lines of a function
+ * as a list, which are emitted back as text once rewritten.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "assembler.h"
+#include "archiveReader.h"
+#include "elfWritter.h"
+#include "emitter.h"
+
+#define MAX_LABEL_LEN 512
+#define KEYWORD_SLOTS 512
+#define MAX_KEYWORD_LEN 8
+
+typedef enum
+{
+    WORD_SYMBOL,
+    WORD_REGISTER,
+    WORD_MNEMONIC
+} WordKind;
+
+/* What a word of the assembly is, the words being interned */
+typedef struct _word_info
+{
+    unsigned char kind;
+    unsigned char value; /* Register number or mnemonic */
+    unsigned char extra; /* Size of a register, condition code or unit of a directive */
+} WordInfo;
+
+typedef struct _keyword
+{
+    const char *name;
+    WordInfo info;
+} Keyword;
+
+static const Keyword KEYWORDS[] = {
+    {"rax", {WORD_REGISTER, 0, 8}}, {"rcx", {WORD_REGISTER, 1, 8}}, {"rdx", {WORD_REGISTER, 2, 8}}, {"rbx", {WORD_REGISTER, 3, 8}},
+    {"rsp", {WORD_REGISTER, 4, 8}}, {"rbp", {WORD_REGISTER, 5, 8}}, {"rsi", {WORD_REGISTER, 6, 8}}, {"rdi", {WORD_REGISTER, 7, 8}},
+    {"r8", {WORD_REGISTER, 8, 8}}, {"r9", {WORD_REGISTER, 9, 8}}, {"r10", {WORD_REGISTER, 10, 8}}, {"r11", {WORD_REGISTER, 11, 8}},
+    {"r12", {WORD_REGISTER, 12, 8}}, {"r13", {WORD_REGISTER, 13, 8}}, {"r14", {WORD_REGISTER, 14, 8}}, {"r15", {WORD_REGISTER, 15, 8}},
+    {"eax", {WORD_REGISTER, 0, 4}}, {"ecx", {WORD_REGISTER, 1, 4}}, {"edx", {WORD_REGISTER, 2, 4}}, {"ebx", {WORD_REGISTER, 3, 4}},
+    {"esp", {WORD_REGISTER, 4, 4}}, {"ebp", {WORD_REGISTER, 5, 4}}, {"esi", {WORD_REGISTER, 6, 4}}, {"edi", {WORD_REGISTER, 7, 4}},
+    {"r8d", {WORD_REGISTER, 8, 4}}, {"r9d", {WORD_REGISTER, 9, 4}}, {"r10d", {WORD_REGISTER, 10, 4}}, {"r11d", {WORD_REGISTER, 11, 4}},
+    {"r12d", {WORD_REGISTER, 12, 4}}, {"r13d", {WORD_REGISTER, 13, 4}}, {"r14d", {WORD_REGISTER, 14, 4}}, {"r15d", {WORD_REGISTER, 15, 4}},
+    {"ax", {WORD_REGISTER, 0, 2}}, {"cx", {WORD_REGISTER, 1, 2}}, {"dx", {WORD_REGISTER, 2, 2}}, {"bx", {WORD_REGISTER, 3, 2}},
+    {"sp", {WORD_REGISTER, 4, 2}}, {"bp", {WORD_REGISTER, 5, 2}}, {"si", {WORD_REGISTER, 6, 2}}, {"di", {WORD_REGISTER, 7, 2}},
+    {"r8w", {WORD_REGISTER, 8, 2}}, {"r9w", {WORD_REGISTER, 9, 2}}, {"r10w", {WORD_REGISTER, 10, 2}}, {"r11w", {WORD_REGISTER, 11, 2}},
+    {"r12w", {WORD_REGISTER, 12, 2}}, {"r13w", {WORD_REGISTER, 13, 2}}, {"r14w", {WORD_REGISTER, 14, 2}}, {"r15w", {WORD_REGISTER, 15, 2}},
+    {"al", {WORD_REGISTER, 0, 1}}, {"cl", {WORD_REGISTER, 1, 1}}, {"dl", {WORD_REGISTER, 2, 1}}, {"bl", {WORD_REGISTER, 3, 1}},
+    {"spl", {WORD_REGISTER, 4, 1}}, {"bpl", {WORD_REGISTER, 5, 1}}, {"sil", {WORD_REGISTER, 6, 1}}, {"dil", {WORD_REGISTER, 7, 1}},
+    {"r8b", {WORD_REGISTER, 8, 1}}, {"r9b", {WORD_REGISTER, 9, 1}}, {"r10b", {WORD_REGISTER, 10, 1}}, {"r11b", {WORD_REGISTER, 11, 1}},
+    {"r12b", {WORD_REGISTER, 12, 1}}, {"r13b", {WORD_REGISTER, 13, 1}}, {"r14b", {WORD_REGISTER, 14, 1}}, {"r15b", {WORD_REGISTER, 15, 1}},
+    {"section", {WORD_MNEMONIC, ASM_SECTION, 0}}, {"segment", {WORD_MNEMONIC, ASM_SECTION, 0}}, {"global", {WORD_MNEMONIC, ASM_GLOBAL, 0}},
+    {"extern", {WORD_MNEMONIC, ASM_GLOBAL, 0}},
+    {"resb", {WORD_MNEMONIC, ASM_RESERVE, 1}}, {"resw", {WORD_MNEMONIC, ASM_RESERVE, 2}}, {"resd", {WORD_MNEMONIC, ASM_RESERVE, 4}}, {"resq", {WORD_MNEMONIC, ASM_RESERVE, 8}},
+    {"db", {WORD_MNEMONIC, ASM_DATA, 1}}, {"dw", {WORD_MNEMONIC, ASM_DATA, 2}}, {"dd", {WORD_MNEMONIC, ASM_DATA, 4}}, {"dq", {WORD_MNEMONIC, ASM_DATA, 8}},
+    {"align", {WORD_MNEMONIC, ASM_ALIGN, 0}},
+    {"mov", {WORD_MNEMONIC, ASM_MOV, 0}}, {"movsx", {WORD_MNEMONIC, ASM_MOVSX, 0}}, {"movsxd", {WORD_MNEMONIC, ASM_MOVSX, 0}}, {"movzx", {WORD_MNEMONIC, ASM_MOVZX, 0}},
+    {"lea", {WORD_MNEMONIC, ASM_LEA, 0}}, {"push", {WORD_MNEMONIC, ASM_PUSH, 0}}, {"pop", {WORD_MNEMONIC, ASM_POP, 0}},
+    {"add", {WORD_MNEMONIC, ASM_ADD, 0}}, {"or", {WORD_MNEMONIC, ASM_OR, 1}}, {"and", {WORD_MNEMONIC, ASM_AND, 4}}, {"sub", {WORD_MNEMONIC, ASM_SUB, 5}},
+    {"xor", {WORD_MNEMONIC, ASM_XOR, 6}}, {"cmp", {WORD_MNEMONIC, ASM_CMP, 7}}, {"test", {WORD_MNEMONIC, ASM_TEST, 0}},
+    {"imul", {WORD_MNEMONIC, ASM_IMUL, 5}}, {"idiv", {WORD_MNEMONIC, ASM_IDIV, 7}}, {"neg", {WORD_MNEMONIC, ASM_NEG, 3}}, {"not", {WORD_MNEMONIC, ASM_NOT, 2}},
+    {"inc", {WORD_MNEMONIC, ASM_INC, 0}}, {"dec", {WORD_MNEMONIC, ASM_DEC, 1}},
+    {"shl", {WORD_MNEMONIC, ASM_SHL, 4}}, {"sal", {WORD_MNEMONIC, ASM_SHL, 4}}, {"shr", {WORD_MNEMONIC, ASM_SHR, 5}}, {"sar", {WORD_MNEMONIC, ASM_SAR, 7}},
+    {"call", {WORD_MNEMONIC, ASM_CALL, 2}}, {"jmp", {WORD_MNEMONIC, ASM_JMP, 4}},
+    {"cqo", {WORD_MNEMONIC, ASM_CQO, 0}}, {"ret", {WORD_MNEMONIC, ASM_RET, 0}}, {"leave", {WORD_MNEMONIC, ASM_LEAVE, 0}},
+    {"syscall", {WORD_MNEMONIC, ASM_SYSCALL, 0}}, {"nop", {WORD_MNEMONIC, ASM_NOP, 0}},
+};
+
+/* Suffixes of the conditional instructions (jcc, setcc, cmovcc) and their condition code */
+static const struct
+{
+    const char *suffix;
+    unsigned char code;
+} CONDITIONS[] = {
+    {"o", 0x0}, {"no", 0x1}, {"b", 0x2}, {"c", 0x2}, {"nae", 0x2}, {"ae", 0x3}, {"nb", 0x3}, {"nc", 0x3},
+    {"e", 0x4}, {"z", 0x4}, {"ne", 0x5}, {"nz", 0x5}, {"be", 0x6}, {"na", 0x6}, {"a", 0x7}, {"nbe", 0x7},
+    {"s", 0x8}, {"ns", 0x9}, {"p", 0xA}, {"pe", 0xA}, {"np", 0xB}, {"po", 0xB}, {"l", 0xC}, {"nge", 0xC},
+    {"ge", 0xD}, {"nl", 0xD}, {"le", 0xE}, {"ng", 0xE}, {"g", 0xF}, {"nle", 0xF}};
+
+/* Slot of the open-addressing table of the keywords, their characters packed in a key */
+typedef struct _keyword_slot
+{
+    unsigned long key;
+    WordInfo info;
+} KeywordSlot;
+
+typedef struct _asm_parser
+{
+    const char *cur;
+    const char *end;
+    int lineno;
+    ident_t scope;        /* Last label not starting with a dot */
+    const char *lexeme;   /* Last word read */
+    int lexemeLen;
+    KeywordSlot keywords[KEYWORD_SLOTS];
+    char *dataBytes;      /* Bytes of the last data directive */
+    int dataLen;
+    int dataCapacity;
+} AsmParser;
+
+typedef struct _byte_buffer
+{
+    unsigned char *bytes;
+    unsigned long len;
+    unsigned long capacity;
+} ByteBuffer;
+
+/* A 32-bit field to patch with the address of a label */
+typedef struct _fixup
+{
+    unsigned long offset;
+    long addend;
+    ident_t symbol;
+    int lineno;
+    unsigned char section;
+    unsigned char relative; /* Displacement from the end of the field instead of an address */
+} Fixup;
+
+typedef struct _label_definition
+{
+    unsigned char section;
+    unsigned long offset;
+} LabelDefinition;
+
+typedef struct _assembly
+{
+    ByteBuffer sections[BSS_SECTION];  /* Bytes of the text and data sections */
+    unsigned long bssLen;
+    unsigned char section;             /* Section being assembled */
+    Fixup *fixups;
+    int nbFixups;
+    int fixupsCapacity;
+    LabelDefinition *labels;           /* Definition of each interned id */
+    int labelsCapacity;
+    ElfSymbol *symbols;
+    int nbSymbols;
+    int symbolsCapacity;
+    int failed;                        /* An allocation failed */
+} Assembly;
+
+/**
+ * @fn ReturnInfo asmError(int lineno, const char *message, const char *detail)
+ * @brief Report an error of the assembly.
+ *
+ * @param lineno int Line of the assembly.
+ * @param message const char* Message to print.
+ * @param detail const char* Detail of the message, may be empty.
+ * @return ReturnInfo FAILURE.
+ */
+ReturnInfo asmError(int lineno, const char *message, const char *detail)
+{
+    fprintf(stderr, "Assembler error at line %d: %s%s\n", lineno, message, detail);
+    return FAILURE;
+}
+
+/* ---------------------------- Parsing of a line --------------------------- */
+
+/**
+ * @fn unsigned long keywordKey(const char *word, int len)
+ * @brief Pack the characters of a word in an integer, so keywords are compared at once.
+ *
+ * @param word const char* Characters of the word.
+ * @param len int Number of characters.
+ * @return unsigned long Key of the word, 0 if it is too long to be a keyword.
+ */
+unsigned long keywordKey(const char *word, int len)
+{
+    if (len > MAX_KEYWORD_LEN)
+        return 0;
+    unsigned long key = 0;
+    for (int i = 0; i < len; i++)
+        key |= (unsigned long)(unsigned char)word[i] << (8 * i);
+    return key;
+}
+
+/**
+ * @fn unsigned int keywordSlot(unsigned long key)
+ * @brief Get the first slot of the probe sequence of a key.
+ *
+ * @param key unsigned long Key of a word.
+ * @return unsigned int Slot.
+ */
+unsigned int keywordSlot(unsigned long key)
+{
+    return (key * 0x9E3779B97F4A7C15ul) >> 55;
+}
+
+/**
+ * @fn void addKeyword(AsmParser *p, const char *name, WordInfo info)
+ * @brief Add a keyword to the table of the parser.
+ *
+ * @param p AsmParser* Parser.
+ * @param name const char* Keyword.
+ * @param info WordInfo What the keyword is.
+ */
+void addKeyword(AsmParser *p, const char *name, WordInfo info)
+{
+    unsigned long key = keywordKey(name, strlen(name));
+    unsigned int slot = keywordSlot(key);
+    while (p->keywords[slot].key && p->keywords[slot].key != key)
+        slot = (slot + 1) % KEYWORD_SLOTS;
+    p->keywords[slot] = (KeywordSlot){key, info};
+}
+
+/**
+ * @fn void initParser(AsmParser *p, const char *text, unsigned long len)
+ * @brief Initialize a parser and its table of keywords.
+ *
+ * @param p AsmParser* Parser to initialize.
+ * @param text const char* Assembly to parse.
+ * @param len unsigned long Length of the assembly.
+ */
+void initParser(AsmParser *p, const char *text, unsigned long len)
+{
+    memset(p, 0, sizeof(AsmParser));
+    p->cur = text;
+    p->end = text + len;
+    p->lineno = 1;
+    for (unsigned long i = 0; i < sizeof(KEYWORDS) / sizeof(KEYWORDS[0]); i++)
+        addKeyword(p, KEYWORDS[i].name, KEYWORDS[i].info);
+
+    const char *prefixes[] = {"j", "set", "cmov"};
+    const unsigned char mnemonics[] = {ASM_JCC, ASM_SETCC, ASM_CMOVCC};
+    for (int i = 0; i < 3; i++)
+    {
+        for (unsigned long j = 0; j < sizeof(CONDITIONS) / sizeof(CONDITIONS[0]); j++)
+        {
+            char name[16];
+            snprintf(name, sizeof(name), "%s%s", prefixes[i], CONDITIONS[j].suffix);
+            addKeyword(p, name, (WordInfo){WORD_MNEMONIC, mnemonics[i], CONDITIONS[j].code});
+        }
+    }
+}
+
+/**
+ * @fn void skipBlanks(AsmParser *p)
+ * @brief Skip the spaces and tabulations.
+ *
+ * @param p AsmParser* Parser.
+ */
+void skipBlanks(AsmParser *p)
+{
+    while (p->cur < p->end && (*p->cur == ' ' || *p->cur == '\t' || *p->cur == '\r'))
+        p->cur++;
+}
+
+/**
+ * @fn int isWordChar(char c, int first)
+ * @brief Tell if a character can be part of a word (identifier, register, mnemonic...).
+ *
+ * @param c char Character.
+ * @param first int The character would start the word.
+ * @return int 1 if it can, 0 otherwise.
+ */
+static inline int isWordChar(char c, int first)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '.' ||
+           c == '$' || c == '@' || c == '?' || (!first && c >= '0' && c <= '9');
+}
+
+/**
+ * @fn int atLineEnd(AsmParser *p)
+ * @brief Tell if the rest of the line is empty or a comment, after skipping the blanks.
+ *
+ * @param p AsmParser* Parser.
+ * @return int 1 at the end of the line, 0 otherwise.
+ */
+int atLineEnd(AsmParser *p)
+{
+    skipBlanks(p);
+    return p->cur >= p->end || *p->cur == '\n' || *p->cur == ';';
+}
+
+/**
+ * @fn int readWord(AsmParser *p, WordInfo *info)
+ * @brief Read a word and tell what it is. Words which are not keywords are symbols, see lexemeId.
+ *
+ * @param p AsmParser* Parser.
+ * @param info WordInfo* What the word is, filled.
+ * @return int 1 if a word was read, 0 otherwise.
+ */
+int readWord(AsmParser *p, WordInfo *info)
+{
+    skipBlanks(p);
+    if (p->cur >= p->end || !isWordChar(*p->cur, 1))
+        return 0;
+    p->lexeme = p->cur;
+    while (p->cur < p->end && isWordChar(*p->cur, 0))
+        p->cur++;
+    p->lexemeLen = p->cur - p->lexeme;
+
+    *info = (WordInfo){WORD_SYMBOL, 0, 0};
+    unsigned long key = keywordKey(p->lexeme, p->lexemeLen);
+    if (!key)
+        return 1;
+    for (unsigned int slot = keywordSlot(key); p->keywords[slot].key; slot = (slot + 1) % KEYWORD_SLOTS)
+    {
+        if (p->keywords[slot].key == key)
+        {
+            *info = p->keywords[slot].info;
+            break;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @fn ident_t lexemeId(const AsmParser *p)
+ * @brief Intern the last word read.
+ *
+ * @param p const AsmParser* Parser.
+ * @return ident_t Id of the word.
+ */
+ident_t lexemeId(const AsmParser *p)
+{
+    return internLexeme(p->lexeme, p->lexemeLen);
+}
+
+/**
+ * @fn ReturnInfo qualifyLabel(AsmParser *p, ident_t *label)
+ * @brief Prefix a local label (starting with a dot) by the label scoping it, as NASM does.
+ *
+ * @param p AsmParser* Parser.
+ * @param label ident_t* Label, replaced by its qualified name.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo qualifyLabel(AsmParser *p, ident_t *label)
+{
+    const char *name = identToString(*label);
+    if (name[0] != '.')
+        return SUCCESS;
+
+    char qualified[MAX_LABEL_LEN];
+    int len = snprintf(qualified, sizeof(qualified), "%s%s", identToString(p->scope), name);
+    if (len >= MAX_LABEL_LEN)
+        return asmError(p->lineno, "label too long: ", name);
+    *label = internLexeme(qualified, len);
+    return SUCCESS;
+}
+
+/**
+ * @fn int readNumber(AsmParser *p, long *value)
+ * @brief Read a decimal or hexadecimal number, or a character constant.
+ *
+ * @param p AsmParser* Parser.
+ * @param value long* Value read, filled.
+ * @return int 1 if a number was read, 0 otherwise.
+ */
+int readNumber(AsmParser *p, long *value)
+{
+    if (*p->cur == '\'' || *p->cur == '"' || *p->cur == '`')
+    {
+        char quote = *p->cur++;
+        *value = 0;
+        for (int shift = 0; p->cur < p->end && *p->cur != quote && *p->cur != '\n'; shift += 8, p->cur++)
+            if (shift < 64)
+                *value |= (long)(unsigned char)*p->cur << shift;
+        if (p->cur >= p->end || *p->cur != quote)
+            return 0;
+        p->cur++;
+        return 1;
+    }
+
+    if (*p->cur < '0' || *p->cur > '9')
+        return 0;
+    // unlike C, NASM reads a leading 0 as a decimal digit
+    char *numberEnd;
+    int hexadecimal = p->cur + 1 < p->end && p->cur[0] == '0' && (p->cur[1] == 'x' || p->cur[1] == 'X');
+    *value = strtoul(p->cur, &numberEnd, hexadecimal ? 16 : 10);
+    p->cur = numberEnd;
+    return 1;
+}
+
+/**
+ * @fn ReturnInfo parseTerms(AsmParser *p, Operand *op)
+ * @brief Parse a sum of registers (possibly scaled), labels and numbers.
+ *
+ * @param p AsmParser* Parser.
+ * @param op Operand* Operand to fill, its registers already set to NO_REGISTER.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo parseTerms(AsmParser *p, Operand *op)
+{
+    int nbTerms = 0;
+    int nbRegisters = 0;
+    while (1)
+    {
+        int sign = 1;
+        skipBlanks(p);
+        while (p->cur < p->end && (*p->cur == '+' || *p->cur == '-'))
+        {
+            if (*p->cur++ == '-')
+                sign = -sign;
+            skipBlanks(p);
+        }
+        if (p->cur >= p->end)
+            return asmError(p->lineno, "unexpected end of the assembly", "");
+
+        WordInfo info;
+        long value;
+        if (readNumber(p, &value))
+        {
+            skipBlanks(p);
+            if (p->cur < p->end && *p->cur == '*')
+            {
+                // number * register
+                p->cur++;
+                if (!readWord(p, &info) || info.kind != WORD_REGISTER || op->index != NO_REGISTER || sign < 0)
+                    return asmError(p->lineno, "invalid scaled index", "");
+                op->index = info.value;
+                op->scale = value;
+                nbRegisters++;
+            }
+            else
+                op->value += sign * value;
+        }
+        else if (readWord(p, &info))
+        {
+            if (info.kind == WORD_REGISTER)
+            {
+                if (sign < 0)
+                    return asmError(p->lineno, "a register can not be subtracted", "");
+                nbRegisters++;
+                op->size = info.extra;
+                skipBlanks(p);
+                if (p->cur < p->end && *p->cur == '*')
+                {
+                    p->cur++;
+                    skipBlanks(p);
+                    if (!readNumber(p, &value) || op->index != NO_REGISTER)
+                        return asmError(p->lineno, "invalid scaled index", "");
+                    op->index = info.value;
+                    op->scale = value;
+                }
+                else if (op->reg == NO_REGISTER)
+                    op->reg = info.value;
+                else if (op->index == NO_REGISTER)
+                {
+                    op->index = info.value;
+                    op->scale = 1;
+                }
+                else
+                    return asmError(p->lineno, "too many registers in an operand", "");
+            }
+            else if (info.kind == WORD_SYMBOL && op->symbol == NO_IDENT && sign > 0)
+            {
+                op->symbol = lexemeId(p);
+                if (qualifyLabel(p, &op->symbol) != SUCCESS)
+                    return FAILURE;
+            }
+            else
+                return asmError(p->lineno, "unexpected word in an operand: ", identToString(lexemeId(p)));
+        }
+        else
+            return asmError(p->lineno, "invalid operand", "");
+
+        nbTerms++;
+        skipBlanks(p);
+        if (p->cur >= p->end || (*p->cur != '+' && *p->cur != '-'))
+            break;
+    }
+
+    if (op->kind == MEM_OPERAND)
+    {
+        if (op->scale != 1 && op->scale != 2 && op->scale != 4 && op->scale != 8 && op->index != NO_REGISTER)
+            return asmError(p->lineno, "invalid scale", "");
+        if (op->index == RSP)
+            return asmError(p->lineno, "rsp can not be an index", "");
+        return SUCCESS;
+    }
+    if (nbRegisters)
+    {
+        if (nbTerms != 1 || op->index != NO_REGISTER)
+            return asmError(p->lineno, "invalid register operand", "");
+        op->kind = REG_OPERAND;
+    }
+    else
+        op->kind = IMM_OPERAND;
+    return SUCCESS;
+}
+
+/**
+ * @fn int readSizeKeyword(AsmParser *p)
+ * @brief Read the size keyword (byte, word, dword or qword) which may start an operand.
+ * The characters are compared in place, as most operands have no size keyword.
+ *
+ * @param p AsmParser* Parser.
+ * @return int Size given by the keyword, 0 if there is none.
+ */
+int readSizeKeyword(AsmParser *p)
+{
+    static const char *SIZE_KEYWORDS[] = {"byte", "word", "dword", "qword"};
+    static const int SIZES[] = {1, 2, 4, 8};
+
+    skipBlanks(p);
+    const char *start = p->cur;
+    while (p->cur < p->end && isWordChar(*p->cur, 0))
+        p->cur++;
+    unsigned long len = p->cur - start;
+    for (int i = 0; i < 4; i++)
+    {
+        if (len == strlen(SIZE_KEYWORDS[i]) && !strncmp(start, SIZE_KEYWORDS[i], len))
+            return SIZES[i];
+    }
+    p->cur = start;
+    return 0;
+}
+
+/**
+ * @fn ReturnInfo parseOperand(AsmParser *p, Operand *op)
+ * @brief Parse an operand: a register, an immediate or a memory reference.
+ *
+ * @param p AsmParser* Parser.
+ * @param op Operand* Operand to fill.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo parseOperand(AsmParser *p, Operand *op)
+{
+    *op = (Operand){NO_OPERAND, 0, NO_REGISTER, NO_REGISTER, 0, NO_IDENT, 0};
+
+    int size = readSizeKeyword(p);
+
+    skipBlanks(p);
+    if (p->cur < p->end && *p->cur == '[')
+    {
+        p->cur++;
+        op->kind = MEM_OPERAND;
+        if (parseTerms(p, op) != SUCCESS)
+            return FAILURE;
+        if (p->cur >= p->end || *p->cur != ']')
+            return asmError(p->lineno, "missing ]", "");
+        p->cur++;
+        op->size = size;
+        return SUCCESS;
+    }
+
+    if (parseTerms(p, op) != SUCCESS)
+        return FAILURE;
+    if (op->kind == IMM_OPERAND)
+        op->size = size;
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo addDataByte(AsmParser *p, unsigned char byte)
+ * @brief Add a byte to the data of the current directive.
+ *
+ * @param p AsmParser* Parser.
+ * @param byte unsigned char Byte to add.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo addDataByte(AsmParser *p, unsigned char byte)
+{
+    ReturnInfo info = addCell((void **)&p->dataBytes, p->dataLen, &p->dataCapacity, sizeof(char));
+    if (info != SUCCESS)
+        return info;
+    p->dataBytes[p->dataLen++] = byte;
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo parseData(AsmParser *p, Instruction *inst, int unit)
+ * @brief Parse the values of a data directive (db, dw, dd or dq).
+ *
+ * @param p AsmParser* Parser.
+ * @param inst Instruction* Directive, its data is filled.
+ * @param unit int Size of every value.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo parseData(AsmParser *p, Instruction *inst, int unit)
+{
+    p->dataLen = 0;
+    do
+    {
+        skipBlanks(p);
+        const char *start = p->cur;
+        long value;
+        if (p->cur < p->end && (*p->cur == '\'' || *p->cur == '"') && readNumber(p, &value) && unit == 1)
+        {
+            // a string gives one byte per character
+            for (const char *c = start + 1; c < p->cur - 1; c++)
+                if (addDataByte(p, *c) != SUCCESS)
+                    return ALLOC_ERROR;
+            continue;
+        }
+
+        p->cur = start;
+        Operand op;
+        if (parseOperand(p, &op) != SUCCESS)
+            return FAILURE;
+        if (op.kind != IMM_OPERAND || op.symbol != NO_IDENT)
+            return asmError(p->lineno, "data must be made of numbers", "");
+        for (int i = 0; i < unit; i++)
+            if (addDataByte(p, op.value >> (8 * i)) != SUCCESS)
+                return ALLOC_ERROR;
+    } while (!atLineEnd(p) && *p->cur++ == ',');
+
+    inst->data = p->dataBytes;
+    inst->dataLen = p->dataLen;
+    return SUCCESS;
+}
+
+/**
+ * @fn int nextInstruction(AsmParser *p, Instruction *inst)
+ * @brief Parse the next label, directive or instruction of the assembly.
+ *
+ * @param p AsmParser* Parser.
+ * @param inst Instruction* Instruction to fill.
+ * @return int 1 if an instruction was parsed, 0 at the end of the assembly, -1 on error.
+ */
+int nextInstruction(AsmParser *p, Instruction *inst)
+{
+    while (atLineEnd(p))
+    {
+        while (p->cur < p->end && *p->cur != '\n')
+            p->cur++;
+        if (p->cur >= p->end)
+            return 0;
+        p->cur++;
+        p->lineno++;
+    }
+
+    WordInfo info;
+    inst->lineno = p->lineno;
+    inst->nbOperands = 0;
+    if (!readWord(p, &info))
+    {
+        asmError(p->lineno, "instruction expected", "");
+        return -1;
+    }
+
+    skipBlanks(p);
+    if (p->cur < p->end && *p->cur == ':')
+    {
+        p->cur++;
+        ident_t id = lexemeId(p);
+        if (identToString(id)[0] != '.')
+            p->scope = id;
+        else if (qualifyLabel(p, &id) != SUCCESS)
+            return -1;
+        inst->mnemonic = ASM_LABEL;
+        inst->symbol = id;
+        return 1;
+    }
+    if (info.kind != WORD_MNEMONIC)
+    {
+        asmError(p->lineno, "unknown instruction: ", identToString(lexemeId(p)));
+        return -1;
+    }
+
+    inst->mnemonic = info.value;
+    inst->cond = info.extra;
+    switch (info.value)
+    {
+    case ASM_SECTION:
+    case ASM_GLOBAL:
+        if (!readWord(p, &info))
+        {
+            asmError(p->lineno, "name expected", "");
+            return -1;
+        }
+        inst->symbol = lexemeId(p);
+        break;
+    case ASM_DATA:
+        if (parseData(p, inst, info.extra) != SUCCESS)
+            return -1;
+        break;
+    default:
+        while (!atLineEnd(p) && inst->nbOperands < 3)
+        {
+            if (parseOperand(p, &inst->operands[inst->nbOperands++]) != SUCCESS)
+                return -1;
+            skipBlanks(p);
+            if (p->cur < p->end && *p->cur == ',')
+                p->cur++;
+            else
+                break;
+        }
+        if (info.value == ASM_RESERVE && inst->nbOperands == 1)
+            inst->operands[0].value *= info.extra;
+        break;
+    }
+
+    if (!atLineEnd(p))
+    {
+        asmError(p->lineno, "unexpected characters after the instruction", "");
+        return -1;
+    }
+    return 1;
+}
+
+/**
+ * @fn ReturnInfo parseInstructions(const char *text, unsigned long len, Instruction **insts, int *nb)
+ * @brief Parse a piece of assembly into a list of lines, its local labels being scoped as in the whole assembly.
+ * The bytes of the data directives are not kept.
+ *
+ * @param text const char* Assembly, starting with the label scoping its local labels.
+ * @param len unsigned long Length of the assembly.
+ * @param insts Instruction** Lines parsed, filled with an allocated array.
+ * @param nb int* Number of lines parsed, filled.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo parseInstructions(const char *text, unsigned long len, Instruction **insts, int *nb)
+{
+    AsmParser p;
+    initParser(&p, text, len);
+    *insts = NULL;
+    *nb = 0;
+    int capacity = 0;
+    ReturnInfo info = SUCCESS;
+    Instruction inst;
+    int parsed;
+    while ((parsed = nextInstruction(&p, &inst)) > 0)
+    {
+        info = addCell((void **)insts, *nb, &capacity, sizeof(Instruction));
+        if (info != SUCCESS)
+            break;
+        inst.data = NULL;
+        (*insts)[(*nb)++] = inst;
+    }
+    free(p.dataBytes);
+    if (info == SUCCESS && parsed < 0)
+        info = FAILURE;
+    if (info != SUCCESS)
+    {
+        free(*insts);
+        *insts = NULL;
+        *nb = 0;
+    }
+    return info;
+}
+
+/* -------------------------- Printing of a line --------------------------- */
+
+/**
+ * @fn const char *keywordName(int kind, int value, int extra)
+ * @brief Get the first name of the keywords of a register or a mnemonic.
+ *
+ * @param kind int WORD_REGISTER or WORD_MNEMONIC.
+ * @param value int Register number or mnemonic.
+ * @param extra int Size of a register, ignored for a mnemonic.
+ * @return const char* Name, NULL if there is none.
+ */
+const char *keywordName(int kind, int value, int extra)
+{
+    for (unsigned long i = 0; i < sizeof(KEYWORDS) / sizeof(KEYWORDS[0]); i++)
+        if (KEYWORDS[i].info.kind == kind && KEYWORDS[i].info.value == value && (kind != WORD_REGISTER || KEYWORDS[i].info.extra == extra))
+            return KEYWORDS[i].name;
+    return NULL;
+}
+
+/**
+ * @fn const char *symbolName(ident_t symbol, ident_t scope)
+ * @brief Get the name of a symbol as written, a local label of the scope losing the prefix it got when parsed.
+ *
+ * @param symbol ident_t Symbol.
+ * @param scope ident_t Label scoping the local labels.
+ * @return const char* Name.
+ */
+const char *symbolName(ident_t symbol, ident_t scope)
+{
+    const char *name = identToString(symbol);
+    if (scope == NO_IDENT)
+        return name;
+    const char *prefix = identToString(scope);
+    unsigned long len = strlen(prefix);
+    if (!strncmp(name, prefix, len) && name[len] == '.')
+        return name + len;
+    return name;
+}
+
+/**
+ * @fn void emitOperand(const Operand *op, ident_t scope)
+ * @brief Emit an operand in the syntax the parser reads.
+ *
+ * @param op const Operand* Operand.
+ * @param scope ident_t Label scoping the local labels.
+ */
+void emitOperand(const Operand *op, ident_t scope)
+{
+    static const char *SIZE_KEYWORDS[] = {NULL, "byte ", "word ", NULL, "dword ", NULL, NULL, NULL, "qword "};
+
+    if (op->kind == REG_OPERAND)
+    {
+        emitStr(keywordName(WORD_REGISTER, op->reg, op->size));
+        return;
+    }
+    if (op->size && op->size <= 8 && SIZE_KEYWORDS[op->size])
+        emitStr(SIZE_KEYWORDS[op->size]);
+    if (op->kind == IMM_OPERAND)
+    {
+        if (op->symbol != NO_IDENT)
+        {
+            emitStr(symbolName(op->symbol, scope));
+            if (op->value)
+                emit(" %c %ld", op->value < 0 ? '-' : '+', op->value < 0 ? -op->value : op->value);
+        }
+        else
+            emitInt(op->value);
+        return;
+    }
+
+    emitLit("[");
+    int terms = 0;
+    if (op->reg != NO_REGISTER)
+    {
+        emitStr(keywordName(WORD_REGISTER, op->reg, 8));
+        terms++;
+    }
+    if (op->index != NO_REGISTER)
+        emit("%s%s*%d", terms++ ? " + " : "", keywordName(WORD_REGISTER, op->index, 8), op->scale);
+    if (op->symbol != NO_IDENT)
+    {
+        if (terms++)
+            emitLit(" + ");
+        emitStr(symbolName(op->symbol, scope));
+    }
+    if (op->value || !terms)
+    {
+        if (terms)
+            emit(" %c ", op->value < 0 ? '-' : '+');
+        emitInt(terms && op->value < 0 ? -op->value : op->value);
+    }
+    emitLit("]");
+}
+
+/**
+ * @fn void emitInstruction(const Instruction *inst, ident_t scope)
+ * @brief Emit a label or an instruction in the syntax the parser reads, back from its parsed form.
+ * The directives are not emitted.
+ *
+ * @param inst const Instruction* Label or instruction.
+ * @param scope ident_t Label scoping the local labels.
+ */
+void emitInstruction(const Instruction *inst, ident_t scope)
+{
+    static const char *PREFIXES[] = {[ASM_JCC] = "j", [ASM_SETCC] = "set", [ASM_CMOVCC] = "cmov"};
+
+    if (inst->mnemonic == ASM_LABEL)
+    {
+        const char *name = symbolName(inst->symbol, scope);
+        emit(name[0] == '.' ? "\n\t%s:\n" : "%s:\n", name);
+        return;
+    }
+    if (inst->mnemonic < ASM_MOV)
+        return;
+
+    emitLit("\t");
+    if (inst->mnemonic == ASM_JCC || inst->mnemonic == ASM_SETCC || inst->mnemonic == ASM_CMOVCC)
+    {
+        const char *suffix = "";
+        for (unsigned long i = 0; i < sizeof(CONDITIONS) / sizeof(CONDITIONS[0]); i++)
+            if (CONDITIONS[i].code == inst->cond)
+            {
+                suffix = CONDITIONS[i].suffix;
+                break;
+            }
+        emit("%s%s", PREFIXES[inst->mnemonic], suffix);
+    }
+    else if (inst->mnemonic == ASM_MOVSX && inst->operands[1].size == 4)
+        emitLit("movsxd");
+    else
+        emitStr(keywordName(WORD_MNEMONIC, inst->mnemonic, 0));
+
+    for (int i = 0; i < inst->nbOperands; i++)
+    {
+        emitStr(i ? ", " : " ");
+        emitOperand(&inst->operands[i], scope);
+    }
+    emitLit("\n");
+}
+
+/* --------------------------- Encoding of a line --------------------------- */
+
+/**
+ * @fn void pushByte(Assembly *as, unsigned char byte)
+ * @brief Append a byte to the section being assembled.
+ *
+ * @param as Assembly* Assembly.
+ * @param byte unsigned char Byte to append.
+ */
+void pushByte(Assembly *as, unsigned char byte)
+{
+    if (as->section == BSS_SECTION)
+    {
+        as->bssLen++;
+        return;
+    }
+    ByteBuffer *b = &as->sections[as->section];
+    if (b->len == b->capacity)
+    {
+        unsigned long capacity = b->capacity ? b->capacity * 2 : 4096;
+        unsigned char *bytes = realloc(b->bytes, capacity);
+        if (!bytes)
+        {
+            as->failed = 1;
+            return;
+        }
+        b->bytes = bytes;
+        b->capacity = capacity;
+    }
+    b->bytes[b->len++] = byte;
+}
+
+/**
+ * @fn void pushValue(Assembly *as, long value, int size)
+ * @brief Append a little-endian value.
+ *
+ * @param as Assembly* Assembly.
+ * @param value long Value to append.
+ * @param size int Number of bytes of the value.
+ */
+void pushValue(Assembly *as, long value, int size)
+{
+    for (int i = 0; i < size; i++)
+        pushByte(as, value >> (8 * i));
+}
+
+/**
+ * @fn unsigned long sectionOffset(const Assembly *as)
+ * @brief Get the offset reached in the section being assembled.
+ *
+ * @param as const Assembly* Assembly.
+ * @return unsigned long Offset.
+ */
+unsigned long sectionOffset(const Assembly *as)
+{
+    if (as->section == BSS_SECTION)
+        return as->bssLen;
+    return as->sections[as->section].len;
+}
+
+/**
+ * @fn void pushAddress(Assembly *as, ident_t symbol, long addend, int relative, int lineno)
+ * @brief Append a 32-bit field holding the address of a label (or the displacement to it).
+ *
+ * @param as Assembly* Assembly.
+ * @param symbol ident_t Label.
+ * @param addend long Value added to the address.
+ * @param relative int The field is a displacement from its end instead of an address.
+ * @param lineno int Line of the reference.
+ */
+void pushAddress(Assembly *as, ident_t symbol, long addend, int relative, int lineno)
+{
+    if (addCell((void **)&as->fixups, as->nbFixups, &as->fixupsCapacity, sizeof(Fixup)) != SUCCESS)
+    {
+        as->failed = 1;
+        return;
+    }
+    as->fixups[as->nbFixups++] = (Fixup){sectionOffset(as), addend, symbol, lineno, as->section, relative};
+    pushValue(as, 0, 4);
+}
+
+/**
+ * @fn void pushImmediate(Assembly *as, const Operand *imm, int size, int lineno)
+ * @brief Append an immediate operand.
+ *
+ * @param as Assembly* Assembly.
+ * @param imm const Operand* Immediate.
+ * @param size int Size of the immediate in the instruction.
+ * @param lineno int Line of the instruction.
+ */
+void pushImmediate(Assembly *as, const Operand *imm, int size, int lineno)
+{
+    if (imm->symbol != NO_IDENT)
+        pushAddress(as, imm->symbol, imm->value, 0, lineno);
+    else
+        pushValue(as, imm->value, size);
+}
+
+/**
+ * @fn int isByteRegister(const Operand *op)
+ * @brief Tell if an operand is spl, bpl, sil or dil, which need a REX prefix.
+ *
+ * @param op const Operand* Operand.
+ * @return int 1 if it is, 0 otherwise.
+ */
+int isByteRegister(const Operand *op)
+{
+    return op->kind == REG_OPERAND && op->size == 1 && op->reg >= RSP && op->reg <= RDI;
+}
+
+/**
+ * @fn int fitsIn(long value, int size)
+ * @brief Tell if a value can be written as a signed integer of the given size.
+ *
+ * @param value long Value.
+ * @param size int Size in bytes.
+ * @return int 1 if it can, 0 otherwise.
+ */
+int fitsIn(long value, int size)
+{
+    if (size >= 8)
+        return 1;
+    long limit = 1L << (8 * size - 1);
+    return value >= -limit && value < limit;
+}
+
+/**
+ * @fn void pushPrefixes(Assembly *as, int size, int wide, int rex)
+ * @brief Append the operand size and REX prefixes.
+ *
+ * @param as Assembly* Assembly.
+ * @param size int Size of the operation.
+ * @param wide int The operation is on 64 bits and needs REX.W.
+ * @param rex int R, X and B bits of the REX prefix, 0x40 to force a REX prefix.
+ */
+void pushPrefixes(Assembly *as, int size, int wide, int rex)
+{
+    if (size == 2)
+        pushByte(as, 0x66);
+    if (wide)
+        rex |= 0x48;
+    if (rex)
+        pushByte(as, 0x40 | rex);
+}
+
+/**
+ * @fn void pushOpcode(Assembly *as, unsigned int opcode)
+ * @brief Append an opcode of one to three bytes, the first ones being the highest.
+ *
+ * @param as Assembly* Assembly.
+ * @param opcode unsigned int Opcode.
+ */
+void pushOpcode(Assembly *as, unsigned int opcode)
+{
+    if (opcode > 0xFFFF)
+        pushByte(as, opcode >> 16);
+    if (opcode > 0xFF)
+        pushByte(as, opcode >> 8);
+    pushByte(as, opcode);
+}
+
+/**
+ * @fn void encodeModRm(Assembly *as, int size, int wide, unsigned int opcode, int regField, int forceRex, const Operand *rm, int lineno)
+ * @brief Append an instruction taking a register or memory operand: prefixes, opcode, ModRM, SIB and displacement.
+ *
+ * @param as Assembly* Assembly.
+ * @param size int Size of the operation.
+ * @param wide int The operation needs REX.W.
+ * @param opcode unsigned int Opcode.
+ * @param regField int Register or opcode extension of the ModRM byte.
+ * @param forceRex int A REX prefix is needed for the byte registers.
+ * @param rm const Operand* Register or memory operand.
+ * @param lineno int Line of the instruction.
+ */
+void encodeModRm(Assembly *as, int size, int wide, unsigned int opcode, int regField, int forceRex, const Operand *rm, int lineno)
+{
+    int rex = (regField & 8) >> 1;
+    if (rm->kind == REG_OPERAND)
+        rex |= (rm->reg & 8) >> 3;
+    else
+    {
+        if (rm->index != NO_REGISTER)
+            rex |= (rm->index & 8) >> 2;
+        if (rm->reg != NO_REGISTER)
+            rex |= (rm->reg & 8) >> 3;
+    }
+    if (forceRex || isByteRegister(rm))
+        rex |= 0x40;
+    pushPrefixes(as, size, wide, rex);
+    pushOpcode(as, opcode);
+
+    int reg = (regField & 7) << 3;
+    if (rm->kind == REG_OPERAND)
+    {
+        pushByte(as, 0xC0 | reg | (rm->reg & 7));
+        return;
+    }
+
+    int scale = rm->scale == 8 ? 3 : rm->scale == 4 ? 2 : rm->scale == 2 ? 1 : 0;
+    int index = rm->index == NO_REGISTER ? RSP : rm->index & 7;
+    if (rm->reg == NO_REGISTER)
+    {
+        // absolute address: no base, 32-bit displacement
+        pushByte(as, 0x04 | reg);
+        pushByte(as, scale << 6 | index << 3 | RBP);
+        if (rm->symbol != NO_IDENT)
+            pushAddress(as, rm->symbol, rm->value, 0, lineno);
+        else
+            pushValue(as, rm->value, 4);
+        return;
+    }
+
+    int mod = 0x80;
+    if (rm->symbol == NO_IDENT && rm->value == 0 && (rm->reg & 7) != RBP)
+        mod = 0x00;
+    else if (rm->symbol == NO_IDENT && fitsIn(rm->value, 1))
+        mod = 0x40;
+
+    if (rm->index != NO_REGISTER || (rm->reg & 7) == RSP)
+    {
+        pushByte(as, mod | reg | RSP);
+        pushByte(as, scale << 6 | index << 3 | (rm->reg & 7));
+    }
+    else
+        pushByte(as, mod | reg | (rm->reg & 7));
+
+    if (mod == 0x40)
+        pushValue(as, rm->value, 1);
+    else if (mod == 0x80 && rm->symbol != NO_IDENT)
+        pushAddress(as, rm->symbol, rm->value, 0, lineno);
+    else if (mod == 0x80)
+        pushValue(as, rm->value, 4);
+}
+
+/**
+ * @fn void encodeRegInOpcode(Assembly *as, int size, int wide, unsigned int opcode, const Operand *reg)
+ * @brief Append an instruction whose register is added to its opcode (push, pop, mov reg, imm).
+ *
+ * @param as Assembly* Assembly.
+ * @param size int Size of the operation.
+ * @param wide int The operation needs REX.W.
+ * @param opcode unsigned int Opcode of the first register.
+ * @param reg const Operand* Register.
+ */
+void encodeRegInOpcode(Assembly *as, int size, int wide, unsigned int opcode, const Operand *reg)
+{
+    pushPrefixes(as, size, wide, (reg->reg & 8) >> 3 | (isByteRegister(reg) ? 0x40 : 0));
+    pushOpcode(as, opcode + (reg->reg & 7));
+}
+
+/**
+ * @fn int instructionSize(const Instruction *inst)
+ * @brief Get the size of the operation of an instruction from its operands.
+ *
+ * @param inst const Instruction* Instruction.
+ * @return int Size of the operation, 0 if no operand gives it.
+ */
+int instructionSize(const Instruction *inst)
+{
+    for (int i = 0; i < inst->nbOperands; i++)
+    {
+        const Operand *op = &inst->operands[i];
+        if (op->kind == REG_OPERAND || (op->kind == MEM_OPERAND && op->size))
+            return op->size;
+    }
+    return 0;
+}
+
+/**
+ * @fn int isRm(const Operand *op)
+ * @brief Tell if an operand is a register or a memory reference.
+ *
+ * @param op const Operand* Operand.
+ * @return int 1 if it is, 0 otherwise.
+ */
+int isRm(const Operand *op)
+{
+    return op->kind == REG_OPERAND || op->kind == MEM_OPERAND;
+}
+
+/**
+ * @fn ReturnInfo encodeArithmetic(Assembly *as, const Instruction *inst, int ext, int size)
+ * @brief Encode add, or, and, sub, xor and cmp.
+ *
+ * @param as Assembly* Assembly.
+ * @param inst const Instruction* Instruction.
+ * @param ext int Opcode extension of the operation.
+ * @param size int Size of the operation.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo encodeArithmetic(Assembly *as, const Instruction *inst, int ext, int size)
+{
+    const Operand *dst = &inst->operands[0];
+    const Operand *src = &inst->operands[1];
+    int byte = size == 1;
+    if (src->kind == IMM_OPERAND && isRm(dst))
+    {
+        if (!fitsIn(src->value, byte ? 2 : 4))
+            return asmError(inst->lineno, "immediate out of range", "");
+        if (byte)
+        {
+            encodeModRm(as, size, 0, 0x80, ext, 0, dst, inst->lineno);
+            pushImmediate(as, src, 1, inst->lineno);
+        }
+        else if (src->symbol == NO_IDENT && fitsIn(src->value, 1))
+        {
+            encodeModRm(as, size, size == 8, 0x83, ext, 0, dst, inst->lineno);
+            pushImmediate(as, src, 1, inst->lineno);
+        }
+        else
+        {
+            encodeModRm(as, size, size == 8, 0x81, ext, 0, dst, inst->lineno);
+            pushImmediate(as, src, size == 2 ? 2 : 4, inst->lineno);
+        }
+    }
+    else if (src->kind == REG_OPERAND && isRm(dst))
+        encodeModRm(as, size, size == 8, ext * 8 + !byte, src->reg, isByteRegister(src), dst, inst->lineno);
+    else if (dst->kind == REG_OPERAND && src->kind == MEM_OPERAND)
+        encodeModRm(as, size, size == 8, ext * 8 + 2 + !byte, dst->reg, isByteRegister(dst), src, inst->lineno);
+    else
+        return asmError(inst->lineno, "invalid operands", "");
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo encodeMov(Assembly *as, const Instruction *inst, int size)
+ * @brief Encode mov.
+ *
+ * @param as Assembly* Assembly.
+ * @param inst const Instruction* Instruction.
+ * @param size int Size of the operation.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo encodeMov(Assembly *as, const Instruction *inst, int size)
+{
+    const Operand *dst = &inst->operands[0];
+    const Operand *src = &inst->operands[1];
+    int byte = size == 1;
+    if (dst->kind == REG_OPERAND && src->kind == IMM_OPERAND)
+    {
+        if (byte)
+        {
+            encodeRegInOpcode(as, size, 0, 0xB0, dst);
+            pushImmediate(as, src, 1, inst->lineno);
+        }
+        else if (size != 8 || src->symbol != NO_IDENT || (src->value >= 0 && src->value <= 0xFFFFFFFFL))
+        {
+            // writing the 32 bits of a register clears its upper half
+            encodeRegInOpcode(as, size, 0, 0xB8, dst);
+            pushImmediate(as, src, size == 2 ? 2 : 4, inst->lineno);
+        }
+        else if (fitsIn(src->value, 4))
+        {
+            encodeModRm(as, size, 1, 0xC7, 0, 0, dst, inst->lineno);
+            pushImmediate(as, src, 4, inst->lineno);
+        }
+        else
+        {
+            encodeRegInOpcode(as, size, 1, 0xB8, dst);
+            pushImmediate(as, src, 8, inst->lineno);
+        }
+    }
+    else if (dst->kind == MEM_OPERAND && src->kind == IMM_OPERAND)
+    {
+        encodeModRm(as, size, size == 8, byte ? 0xC6 : 0xC7, 0, 0, dst, inst->lineno);
+        pushImmediate(as, src, byte ? 1 : size == 2 ? 2 : 4, inst->lineno);
+    }
+    else if (src->kind == REG_OPERAND && isRm(dst))
+        encodeModRm(as, size, size == 8, byte ? 0x88 : 0x89, src->reg, isByteRegister(src), dst, inst->lineno);
+    else if (dst->kind == REG_OPERAND && src->kind == MEM_OPERAND)
+        encodeModRm(as, size, size == 8, byte ? 0x8A : 0x8B, dst->reg, isByteRegister(dst), src, inst->lineno);
+    else
+        return asmError(inst->lineno, "invalid operands", "");
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo encodeExtension(Assembly *as, const Instruction *inst)
+ * @brief Encode movsx and movzx.
+ *
+ * @param as Assembly* Assembly.
+ * @param inst const Instruction* Instruction.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo encodeExtension(Assembly *as, const Instruction *inst)
+{
+    const Operand *dst = &inst->operands[0];
+    const Operand *src = &inst->operands[1];
+    if (dst->kind != REG_OPERAND || !isRm(src) || src->size >= dst->size)
+        return asmError(inst->lineno, "invalid operands", "");
+
+    unsigned int opcode;
+    if (src->size == 4 && inst->mnemonic == ASM_MOVSX)
+        opcode = 0x63;
+    else if (src->size == 1 || src->size == 2)
+        opcode = (inst->mnemonic == ASM_MOVSX ? 0x0FBE : 0x0FB6) + (src->size == 2);
+    else
+        return asmError(inst->lineno, "size of the source not specified", "");
+    encodeModRm(as, dst->size, dst->size == 8, opcode, dst->reg, isByteRegister(src), src, inst->lineno);
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo encodeImul(Assembly *as, const Instruction *inst, int size)
+ * @brief Encode imul, with one, two or three operands.
+ *
+ * @param as Assembly* Assembly.
+ * @param inst const Instruction* Instruction.
+ * @param size int Size of the operation.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo encodeImul(Assembly *as, const Instruction *inst, int size)
+{
+    const Operand *dst = &inst->operands[0];
+    if (inst->nbOperands == 1 && isRm(dst))
+    {
+        encodeModRm(as, size, size == 8, size == 1 ? 0xF6 : 0xF7, 5, 0, dst, inst->lineno);
+        return SUCCESS;
+    }
+    if (dst->kind != REG_OPERAND || size == 1)
+        return asmError(inst->lineno, "invalid operands", "");
+
+    const Operand *src = &inst->operands[1];
+    const Operand *imm = inst->nbOperands == 3 ? &inst->operands[2] : &inst->operands[1];
+    if (inst->nbOperands == 2 && isRm(src))
+        encodeModRm(as, size, size == 8, 0x0FAF, dst->reg, 0, src, inst->lineno);
+    else if (imm->kind == IMM_OPERAND && (inst->nbOperands == 2 || isRm(src)))
+    {
+        const Operand *rm = inst->nbOperands == 3 ? src : dst;
+        int shortImm = imm->symbol == NO_IDENT && fitsIn(imm->value, 1);
+        encodeModRm(as, size, size == 8, shortImm ? 0x6B : 0x69, dst->reg, 0, rm, inst->lineno);
+        pushImmediate(as, imm, shortImm ? 1 : size == 2 ? 2 : 4, inst->lineno);
+    }
+    else
+        return asmError(inst->lineno, "invalid operands", "");
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo encodeShift(Assembly *as, const Instruction *inst, int ext, int size)
+ * @brief Encode shl, shr and sar, by an immediate or by cl.
+ *
+ * @param as Assembly* Assembly.
+ * @param inst const Instruction* Instruction.
+ * @param ext int Opcode extension of the shift.
+ * @param size int Size of the operation.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo encodeShift(Assembly *as, const Instruction *inst, int ext, int size)
+{
+    const Operand *dst = &inst->operands[0];
+    const Operand *count = &inst->operands[1];
+    int byte = size == 1;
+    if (!isRm(dst))
+        return asmError(inst->lineno, "invalid operands", "");
+    if (count->kind == REG_OPERAND && count->reg == RCX && count->size == 1)
+        encodeModRm(as, size, size == 8, byte ? 0xD2 : 0xD3, ext, 0, dst, inst->lineno);
+    else if (count->kind == IMM_OPERAND && count->value == 1)
+        encodeModRm(as, size, size == 8, byte ? 0xD0 : 0xD1, ext, 0, dst, inst->lineno);
+    else if (count->kind == IMM_OPERAND)
+    {
+        encodeModRm(as, size, size == 8, byte ? 0xC0 : 0xC1, ext, 0, dst, inst->lineno);
+        pushImmediate(as, count, 1, inst->lineno);
+    }
+    else
+        return asmError(inst->lineno, "invalid operands", "");
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo encodeBranch(Assembly *as, const Instruction *inst, unsigned int opcode, int ext)
+ * @brief Encode call, jmp and the conditional jumps.
+ *
+ * @param as Assembly* Assembly.
+ * @param inst const Instruction* Instruction.
+ * @param opcode unsigned int Opcode of the jump to a label.
+ * @param ext int Opcode extension of the indirect jump, -1 if there is none.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo encodeBranch(Assembly *as, const Instruction *inst, unsigned int opcode, int ext)
+{
+    const Operand *target = &inst->operands[0];
+    if (target->kind == IMM_OPERAND && target->symbol != NO_IDENT)
+    {
+        pushOpcode(as, opcode);
+        pushAddress(as, target->symbol, target->value, 1, inst->lineno);
+    }
+    else if (ext >= 0 && isRm(target))
+        encodeModRm(as, 4, 0, 0xFF, ext, 0, target, inst->lineno);
+    else
+        return asmError(inst->lineno, "invalid jump target", "");
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo defineLabelAt(Assembly *as, ident_t label, unsigned char section, unsigned long offset, int lineno)
+ * @brief Define a label at an offset of a section.
+ *
+ * @param as Assembly* Assembly.
+ * @param label ident_t Label.
+ * @param section unsigned char Section of the label.
+ * @param offset unsigned long Offset of the label in its section.
+ * @param lineno int Line of the label.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo defineLabelAt(Assembly *as, ident_t label, unsigned char section, unsigned long offset, int lineno)
+{
+    if (label >= as->labelsCapacity)
+    {
+        int capacity = as->labelsCapacity ? as->labelsCapacity : 1024;
+        while (capacity <= label)
+            capacity *= 2;
+        LabelDefinition *labels = realloc(as->labels, capacity * sizeof(LabelDefinition));
+        if (!labels)
+            return ALLOC_ERROR;
+        memset(labels + as->labelsCapacity, 0, (capacity - as->labelsCapacity) * sizeof(LabelDefinition));
+        as->labels = labels;
+        as->labelsCapacity = capacity;
+    }
+    if (as->labels[label].section != NO_SECTION)
+        return asmError(lineno, "label defined twice: ", identToString(label));
+    as->labels[label] = (LabelDefinition){section, offset};
+
+    ReturnInfo info = addCell((void **)&as->symbols, as->nbSymbols, &as->symbolsCapacity, sizeof(ElfSymbol));
+    if (info != SUCCESS)
+        return info;
+    as->symbols[as->nbSymbols++] = (ElfSymbol){label, section, offset};
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo defineLabel(Assembly *as, ident_t label, int lineno)
+ * @brief Define a label at the current offset of the section being assembled.
+ *
+ * @param as Assembly* Assembly.
+ * @param label ident_t Label.
+ * @param lineno int Line of the label.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo defineLabel(Assembly *as, ident_t label, int lineno)
+{
+    return defineLabelAt(as, label, as->section, sectionOffset(as), lineno);
+}
+
+/**
+ * @fn ReturnInfo encodeDirective(Assembly *as, const Instruction *inst)
+ * @brief Handle a label or a directive.
+ *
+ * @param as Assembly* Assembly.
+ * @param inst const Instruction* Label or directive.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo encodeDirective(Assembly *as, const Instruction *inst)
+{
+    const char *name = identToString(inst->symbol);
+    switch (inst->mnemonic)
+    {
+    case ASM_LABEL:
+        return defineLabel(as, inst->symbol, inst->lineno);
+    case ASM_SECTION:
+        if (!strcmp(name, ".text"))
+            as->section = TEXT_SECTION;
+        else if (!strcmp(name, ".data") || !strcmp(name, ".rodata"))
+            as->section = DATA_SECTION;
+        else if (!strcmp(name, ".bss"))
+            as->section = BSS_SECTION;
+        else
+            return asmError(inst->lineno, "unknown section: ", name);
+        return SUCCESS;
+    case ASM_GLOBAL:
+        return SUCCESS;
+    case ASM_RESERVE:
+        if (inst->nbOperands != 1 || inst->operands[0].kind != IMM_OPERAND || inst->operands[0].symbol != NO_IDENT || inst->operands[0].value < 0)
+            return asmError(inst->lineno, "invalid reservation", "");
+        if (as->section == BSS_SECTION)
+            as->bssLen += inst->operands[0].value;
+        else
+            for (long i = 0; i < inst->operands[0].value; i++)
+                pushByte(as, 0);
+        return SUCCESS;
+    case ASM_DATA:
+        if (as->section == BSS_SECTION)
+            return asmError(inst->lineno, "data in the bss section", "");
+        for (int i = 0; i < inst->dataLen; i++)
+            pushByte(as, inst->data[i]);
+        return SUCCESS;
+    case ASM_ALIGN:
+    {
+        long alignment = inst->operands[0].value;
+        if (inst->nbOperands != 1 || alignment <= 0 || (alignment & (alignment - 1)))
+            return asmError(inst->lineno, "invalid alignment", "");
+        while (sectionOffset(as) % alignment)
+            pushByte(as, as->section == TEXT_SECTION ? 0x90 : 0);
+        return SUCCESS;
+    }
+    default:
+        return asmError(inst->lineno, "unknown directive", "");
+    }
+}
+
+/**
+ * @fn ReturnInfo encodeInstruction(Assembly *as, const Instruction *inst)
+ * @brief Encode an instruction in the section being assembled.
+ *
+ * @param as Assembly* Assembly.
+ * @param inst const Instruction* Instruction.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo encodeInstruction(Assembly *as, const Instruction *inst)
+{
+    if (inst->mnemonic < ASM_MOV)
+        return encodeDirective(as, inst);
+    if (as->section == BSS_SECTION)
+        return asmError(inst->lineno, "instruction in the bss section", "");
+
+    static const unsigned char NB_OPERANDS[] = {
+        [ASM_MOV] = 2, [ASM_MOVSX] = 2, [ASM_MOVZX] = 2, [ASM_LEA] = 2, [ASM_PUSH] = 1, [ASM_POP] = 1,
+        [ASM_ADD] = 2, [ASM_OR] = 2, [ASM_AND] = 2, [ASM_SUB] = 2, [ASM_XOR] = 2, [ASM_CMP] = 2, [ASM_TEST] = 2,
+        [ASM_IMUL] = 0, [ASM_IDIV] = 1, [ASM_NEG] = 1, [ASM_NOT] = 1, [ASM_INC] = 1, [ASM_DEC] = 1,
+        [ASM_SHL] = 2, [ASM_SHR] = 2, [ASM_SAR] = 2, [ASM_CALL] = 1, [ASM_JMP] = 1, [ASM_JCC] = 1,
+        [ASM_SETCC] = 1, [ASM_CMOVCC] = 2, [ASM_CQO] = 0, [ASM_RET] = 0, [ASM_LEAVE] = 0, [ASM_SYSCALL] = 0, [ASM_NOP] = 0};
+    if (inst->mnemonic != ASM_IMUL && inst->nbOperands != NB_OPERANDS[inst->mnemonic])
+        return asmError(inst->lineno, "wrong number of operands", "");
+
+    const Operand *dst = &inst->operands[0];
+    const Operand *src = &inst->operands[1];
+    int size = instructionSize(inst);
+    int ext = inst->cond;
+    switch (inst->mnemonic)
+    {
+    case ASM_MOVSX:
+    case ASM_MOVZX:
+        return encodeExtension(as, inst);
+    case ASM_LEA:
+        if (dst->kind != REG_OPERAND || src->kind != MEM_OPERAND)
+            return asmError(inst->lineno, "invalid operands", "");
+        encodeModRm(as, dst->size, dst->size == 8, 0x8D, dst->reg, 0, src, inst->lineno);
+        return SUCCESS;
+    case ASM_PUSH:
+    case ASM_POP:
+        if (dst->kind == REG_OPERAND && dst->size == 8)
+            encodeRegInOpcode(as, 4, 0, inst->mnemonic == ASM_PUSH ? 0x50 : 0x58, dst);
+        else if (dst->kind == MEM_OPERAND)
+            encodeModRm(as, 4, 0, inst->mnemonic == ASM_PUSH ? 0xFF : 0x8F, inst->mnemonic == ASM_PUSH ? 6 : 0, 0, dst, inst->lineno);
+        else if (dst->kind == IMM_OPERAND && inst->mnemonic == ASM_PUSH)
+        {
+            int shortImm = dst->symbol == NO_IDENT && fitsIn(dst->value, 1);
+            pushByte(as, shortImm ? 0x6A : 0x68);
+            pushImmediate(as, dst, shortImm ? 1 : 4, inst->lineno);
+        }
+        else
+            return asmError(inst->lineno, "invalid operand", "");
+        return SUCCESS;
+    case ASM_CALL:
+        return encodeBranch(as, inst, 0xE8, ext);
+    case ASM_JMP:
+        return encodeBranch(as, inst, 0xE9, ext);
+    case ASM_JCC:
+        return encodeBranch(as, inst, 0x0F80 | inst->cond, -1);
+    case ASM_CQO:
+        pushByte(as, 0x48);
+        pushByte(as, 0x99);
+        return SUCCESS;
+    case ASM_RET:
+        pushByte(as, 0xC3);
+        return SUCCESS;
+    case ASM_LEAVE:
+        pushByte(as, 0xC9);
+        return SUCCESS;
+    case ASM_SYSCALL:
+        pushOpcode(as, 0x0F05);
+        return SUCCESS;
+    case ASM_NOP:
+        pushByte(as, 0x90);
+        return SUCCESS;
+    case ASM_SETCC:
+        if (!isRm(dst) || (dst->kind == REG_OPERAND && dst->size != 1))
+            return asmError(inst->lineno, "invalid operand", "");
+        encodeModRm(as, 1, 0, 0x0F90 | inst->cond, 0, 0, dst, inst->lineno);
+        return SUCCESS;
+    default:
+        break;
+    }
+
+    if (!size)
+        return asmError(inst->lineno, "size of the operation not specified", "");
+    switch (inst->mnemonic)
+    {
+    case ASM_MOV:
+        return encodeMov(as, inst, size);
+    case ASM_ADD:
+    case ASM_OR:
+    case ASM_AND:
+    case ASM_SUB:
+    case ASM_XOR:
+    case ASM_CMP:
+        return encodeArithmetic(as, inst, ext, size);
+    case ASM_TEST:
+        if (isRm(dst) && src->kind == REG_OPERAND)
+            encodeModRm(as, size, size == 8, size == 1 ? 0x84 : 0x85, src->reg, isByteRegister(src), dst, inst->lineno);
+        else if (isRm(dst) && src->kind == IMM_OPERAND)
+        {
+            encodeModRm(as, size, size == 8, size == 1 ? 0xF6 : 0xF7, 0, 0, dst, inst->lineno);
+            pushImmediate(as, src, size == 1 ? 1 : size == 2 ? 2 : 4, inst->lineno);
+        }
+        else
+            return asmError(inst->lineno, "invalid operands", "");
+        return SUCCESS;
+    case ASM_IMUL:
+        return encodeImul(as, inst, size);
+    case ASM_IDIV:
+    case ASM_NEG:
+    case ASM_NOT:
+    case ASM_INC:
+    case ASM_DEC:
+        if (!isRm(dst))
+            return asmError(inst->lineno, "invalid operand", "");
+        if (inst->mnemonic == ASM_INC || inst->mnemonic == ASM_DEC)
+            encodeModRm(as, size, size == 8, size == 1 ? 0xFE : 0xFF, ext, 0, dst, inst->lineno);
+        else
+            encodeModRm(as, size, size == 8, size == 1 ? 0xF6 : 0xF7, ext, 0, dst, inst->lineno);
+        return SUCCESS;
+    case ASM_SHL:
+    case ASM_SHR:
+    case ASM_SAR:
+        return encodeShift(as, inst, ext, size);
+    case ASM_CMOVCC:
+        if (dst->kind != REG_OPERAND || !isRm(src) || size == 1)
+            return asmError(inst->lineno, "invalid operands", "");
+        encodeModRm(as, size, size == 8, 0x0F40 | inst->cond, dst->reg, 0, src, inst->lineno);
+        return SUCCESS;
+    default:
+        return asmError(inst->lineno, "unknown instruction", "");
+    }
+}
+
+/* ------------------------ Linking of the archives ------------------------ */
+
+/**
+ * @fn ReturnInfo linkObject(Assembly *as, const ObjectFile *o)
+ * @brief Append the sections of a relocatable object to the ones assembled, define its
+ * symbols and turn its relocations into references to patch.
+ *
+ * @param as Assembly* Assembly.
+ * @param o const ObjectFile* Object to link.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo linkObject(Assembly *as, const ObjectFile *o)
+{
+    unsigned long *bases = malloc((o->nbSections + 1) * sizeof(unsigned long));
+    if (!bases)
+        return ALLOC_ERROR;
+    for (int i = 0; i < o->nbSections; i++)
+    {
+        const ObjectSection *section = &o->sections[i];
+        if (section->kind == NO_SECTION)
+            continue;
+        as->section = section->kind;
+        while (sectionOffset(as) % section->alignment)
+            pushByte(as, as->section == TEXT_SECTION ? 0x90 : 0);
+        bases[i] = sectionOffset(as);
+        if (as->section == BSS_SECTION)
+            as->bssLen += section->len;
+        else
+            for (unsigned long byte = 0; byte < section->len; byte++)
+                pushByte(as, section->bytes[byte]);
+    }
+
+    ReturnInfo info = SUCCESS;
+    for (int i = 0; i < o->nbSymbols && info == SUCCESS; i++)
+    {
+        const ObjectSymbol *symbol = &o->symbols[i];
+        if (symbol->name != NO_IDENT && symbol->section && o->sections[symbol->section].kind != NO_SECTION)
+            info = defineLabelAt(as, symbol->name, o->sections[symbol->section].kind, bases[symbol->section] + symbol->value, 0);
+    }
+    for (int i = 0; i < o->nbRelocations && info == SUCCESS; i++)
+    {
+        const ObjectRelocation *r = &o->relocations[i];
+        ident_t symbol = o->symbols[r->symbol].name;
+        if (symbol == NO_IDENT)
+            info = asmError(0, "relocation against an unsupported symbol of the runtime", "");
+        else
+            info = addCell((void **)&as->fixups, as->nbFixups, &as->fixupsCapacity, sizeof(Fixup));
+        if (info == SUCCESS)
+            as->fixups[as->nbFixups++] = (Fixup){bases[r->section] + r->offset, r->addend, symbol, 0, o->sections[r->section].kind, r->relative};
+    }
+    free(bases);
+    return info;
+}
+
+/**
+ * @fn ReturnInfo linkArchive(Assembly *as, ObjectArchive *archive)
+ * @brief Link the objects of an archive defining the labels referred to but not defined,
+ * the references of the objects linked being followed in turn.
+ *
+ * @param as Assembly* Assembly.
+ * @param archive ObjectArchive* Archive, its objects linked are marked.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo linkArchive(Assembly *as, ObjectArchive *archive)
+{
+    ReturnInfo info = SUCCESS;
+    for (int i = 0; i < as->nbFixups && info == SUCCESS; i++)
+    {
+        ident_t symbol = as->fixups[i].symbol;
+        if (symbol < as->labelsCapacity && as->labels[symbol].section != NO_SECTION)
+            continue;
+        ObjectFile *o = findDefiningObject(archive, symbol);
+        if (o && !o->linked)
+        {
+            o->linked = 1;
+            info = linkObject(as, o);
+        }
+    }
+    return info;
+}
+
+/* ------------------------- Linking of the sections ------------------------ */
+
+/**
+ * @fn ReturnInfo resolveFixups(Assembly *as, const ExecutableImage *image)
+ * @brief Patch every reference to a label with its address, the sections being laid out.
+ *
+ * @param as Assembly* Assembly.
+ * @param image const ExecutableImage* Laid out executable.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo resolveFixups(Assembly *as, const ExecutableImage *image)
+{
+    for (int i = 0; i < as->nbFixups; i++)
+    {
+        const Fixup *fixup = &as->fixups[i];
+        if (fixup->symbol >= as->labelsCapacity || as->labels[fixup->symbol].section == NO_SECTION)
+            return asmError(fixup->lineno, "undefined label: ", identToString(fixup->symbol));
+
+        const LabelDefinition *label = &as->labels[fixup->symbol];
+        long value = image->addresses[label->section] + label->offset + fixup->addend;
+        if (fixup->relative)
+            value -= image->addresses[fixup->section] + fixup->offset + 4;
+        if (!fitsIn(value, 4))
+            return asmError(fixup->lineno, "address out of range: ", identToString(fixup->symbol));
+
+        unsigned char *field = as->sections[fixup->section].bytes + fixup->offset;
+        for (int byte = 0; byte < 4; byte++)
+            field[byte] = (unsigned long)value >> (8 * byte);
+    }
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo linkExecutable(Assembly *as, const char *fileName)
+ * @brief Lay the sections out, patch the references to labels and write the executable.
+ *
+ * @param as Assembly* Assembly.
+ * @param fileName const char* Name of the executable.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo linkExecutable(Assembly *as, const char *fileName)
+{
+    ident_t start = internString("_start");
+    if (start >= as->labelsCapacity || as->labels[start].section != TEXT_SECTION)
+        return asmError(0, "no _start label in the text section", "");
+
+    ExecutableImage image = {as->sections[TEXT_SECTION].bytes, as->sections[TEXT_SECTION].len,
+                             as->sections[DATA_SECTION].bytes, as->sections[DATA_SECTION].len,
+                             as->bssLen, {0}, 0, as->symbols, as->nbSymbols};
+    layoutExecutable(&image);
+    image.entry = image.addresses[TEXT_SECTION] + as->labels[start].offset;
+    for (int i = 0; i < as->nbSymbols; i++)
+        as->symbols[i].address += image.addresses[as->symbols[i].section];
+
+    ReturnInfo info = resolveFixups(as, &image);
+    if (info != SUCCESS)
+        return info;
+    return writeExecutable(&image, fileName);
+}
+
+/**
+ * @fn ReturnInfo assembleExecutable(const char *text, unsigned long len, const char *fileName, const char *runtimeArchive)
+ * @brief Assemble and link a program written in assembly into a static executable.
+ *
+ * @param text const char* Assembly of the program.
+ * @param len unsigned long Length of the assembly.
+ * @param fileName const char* Name of the executable.
+ * @param runtimeArchive const char* Archive of the runtime linked with the program, NULL if the assembly holds it.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo assembleExecutable(const char *text, unsigned long len, const char *fileName, const char *runtimeArchive)
+{
+    AsmParser p;
+    Assembly as;
+    memset(&as, 0, sizeof(as));
+    as.section = TEXT_SECTION;
+
+    initParser(&p, text, len);
+    ReturnInfo info = SUCCESS;
+    Instruction inst;
+    int parsed = 0;
+    while (info == SUCCESS && (parsed = nextInstruction(&p, &inst)) > 0)
+        info = encodeInstruction(&as, &inst);
+    if (info == SUCCESS && parsed < 0)
+        info = FAILURE;
+    ObjectArchive archive = {0};
+    if (info == SUCCESS && runtimeArchive)
+        info = readArchive(runtimeArchive, &archive);
+    if (info == SUCCESS && runtimeArchive)
+        info = linkArchive(&as, &archive);
+    if (info == SUCCESS && as.failed)
+        info = ALLOC_ERROR;
+    if (info == SUCCESS)
+        info = linkExecutable(&as, fileName);
+
+    freeArchive(&archive);
+    free(p.dataBytes);
+    free(as.sections[TEXT_SECTION].bytes);
+    free(as.sections[DATA_SECTION].bytes);
+    free(as.fixups);
+    free(as.labels);
+    free(as.symbols);
+    return info;
+}
+
+/**
+ * @fn ReturnInfo assembleEmitted(const char *fileName, const char *runtimeArchive)
+ * @brief Assemble the text emitted by the writers into a static executable.
+ *
+ * @param fileName const char* Name of the executable.
+ * @param runtimeArchive const char* Archive of the runtime linked with the program, NULL if the text holds it.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo assembleEmitted(const char *fileName, const char *runtimeArchive)
+{
+    unsigned long len;
+    const char *text = emittedText(&len);
+    return assembleExecutable(text, len, fileName, runtimeArchive);
+}
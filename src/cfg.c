@@ -0,0 +1,216 @@
+/**
+ * @file cfg.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Basic blocks, control-flow graph and liveness of a lowered function.
+ * @date 2024-02-10
+ *
+ * The blocks are ranges of the code of the function, which stays a single
+ * array: a block starts at a label or after a jump or a return. The graph is
+ * built again from scratch whenever a pass changes the code.
+ */
+
+#include <stdlib.h>
+#include "cfg.h"
+
+/**
+ * @fn int endsBlock(const IrInstr *instr)
+ * @brief Tell if an instruction is the last one of its block.
+ *
+ * @param instr const IrInstr* Instruction.
+ * @return int 1 for a jump or a return, 0 otherwise.
+ */
+int endsBlock(const IrInstr *instr)
+{
+    return instr->op == IR_JUMP || IS_CONDITIONAL_JUMP(instr->op) || instr->op == IR_RET;
+}
+
+/**
+ * @fn void linkBlocks(IrFunction *ir, int block)
+ * @brief Set the successors of a block from its last instruction.
+ *
+ * @param ir IrFunction* Function whose blocks are built.
+ * @param block int Block linked.
+ */
+void linkBlocks(IrFunction *ir, int block)
+{
+    BasicBlock *b = &ir->blocks[block];
+    const IrInstr *last = &ir->instrs[b->end - 1];
+    int next = block + 1 < ir->nbBlocks ? block + 1 : NO_BLOCK;
+    b->succs[0] = b->succs[1] = NO_BLOCK;
+
+    if (last->op == IR_JUMP)
+        b->succs[0] = ir->labelBlocks[last->imm];
+    else if (IS_CONDITIONAL_JUMP(last->op))
+    {
+        b->succs[0] = next;
+        b->succs[1] = ir->labelBlocks[last->imm];
+    }
+    else if (last->op != IR_RET)
+        b->succs[0] = next;
+}
+
+/**
+ * @fn ReturnInfo buildCfg(IrFunction *ir)
+ * @brief Cut the code of a function into basic blocks and link them, replacing any previous graph.
+ *
+ * @param ir IrFunction* Function whose graph is built.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo buildCfg(IrFunction *ir)
+{
+    free(ir->blocks);
+    free(ir->preds);
+    free(ir->labelBlocks);
+    ir->nbBlocks = 0;
+    for (int pos = 0; pos < ir->len; pos++)
+        if (!pos || ir->instrs[pos].op == IR_LABEL || endsBlock(&ir->instrs[pos - 1]))
+            ir->nbBlocks++;
+
+    ir->blocks = malloc((ir->nbBlocks + 1) * sizeof(BasicBlock));
+    ir->preds = malloc((2 * ir->nbBlocks + 1) * sizeof(int));
+    ir->labelBlocks = malloc((ir->nbLabels + 1) * sizeof(int));
+    if (!ir->blocks || !ir->preds || !ir->labelBlocks)
+        return ALLOC_ERROR;
+
+    for (int label = 0; label < ir->nbLabels; label++)
+        ir->labelBlocks[label] = NO_BLOCK;
+    for (int pos = 0, block = -1; pos < ir->len; pos++)
+    {
+        if (!pos || ir->instrs[pos].op == IR_LABEL || endsBlock(&ir->instrs[pos - 1]))
+            ir->blocks[++block] = (BasicBlock){pos, pos, {NO_BLOCK, NO_BLOCK}, 0, 0};
+        ir->blocks[block].end = pos + 1;
+        if (ir->instrs[pos].op == IR_LABEL)
+            ir->labelBlocks[ir->instrs[pos].imm] = block;
+    }
+
+    for (int b = 0; b < ir->nbBlocks; b++)
+        linkBlocks(ir, b);
+
+    /* Predecessors are counted, then listed by block */
+    for (int b = 0; b < ir->nbBlocks; b++)
+        for (int i = 0; i < 2; i++)
+            if (ir->blocks[b].succs[i] != NO_BLOCK)
+                ir->blocks[ir->blocks[b].succs[i]].nbPreds++;
+    for (int b = 0, first = 0; b < ir->nbBlocks; b++)
+    {
+        ir->blocks[b].firstPred = first;
+        first += ir->blocks[b].nbPreds;
+        ir->blocks[b].nbPreds = 0;
+    }
+    for (int b = 0; b < ir->nbBlocks; b++)
+        for (int i = 0; i < 2; i++)
+        {
+            BasicBlock *succ = ir->blocks[b].succs[i] != NO_BLOCK ? &ir->blocks[ir->blocks[b].succs[i]] : NULL;
+            if (succ)
+                ir->preds[succ->firstPred + succ->nbPreds++] = b;
+        }
+    return SUCCESS;
+}
+
+/**
+ * @fn void addUse(unsigned long *use, const unsigned long *def, vreg_t v)
+ * @brief Record the read of a virtual register not defined before in its block.
+ *
+ * @param use unsigned long* Virtual registers read before being defined in the block.
+ * @param def const unsigned long* Virtual registers defined so far in the block.
+ * @param v vreg_t Virtual register read.
+ */
+void addUse(unsigned long *use, const unsigned long *def, vreg_t v)
+{
+    if (!IS_IN_SET(def, v))
+        ADD_TO_SET(use, v);
+}
+
+/**
+ * @fn void findUsesAndDefs(const IrFunction *ir, const BasicBlock *block, unsigned long *use, unsigned long *def)
+ * @brief Find the virtual registers read before being defined in a block, and the ones it defines.
+ *
+ * @param ir const IrFunction* Function analysed.
+ * @param block const BasicBlock* Block analysed.
+ * @param use unsigned long* Virtual registers read before being defined, filled.
+ * @param def unsigned long* Virtual registers defined, filled.
+ */
+void findUsesAndDefs(const IrFunction *ir, const BasicBlock *block, unsigned long *use, unsigned long *def)
+{
+    for (int pos = block->first; pos < block->end; pos++)
+    {
+        const IrInstr *instr = &ir->instrs[pos];
+        vreg_t operands[3];
+        int nb = getIrOperands(instr, operands);
+        for (int i = 0; i < nb; i++)
+            addUse(use, def, operands[i]);
+        if (instr->op == IR_CALL)
+            for (int i = 0; i < instr->imm; i++)
+                addUse(use, def, ir->callArgs[instr->a + i]);
+        if (instr->dst != NO_VREG)
+            ADD_TO_SET(def, instr->dst);
+    }
+}
+
+/**
+ * @fn ReturnInfo computeLiveness(const IrFunction *ir, Liveness *live)
+ * @brief Compute the virtual registers live at the entry and at the exit of every block,
+ * iterating the backward dataflow equations until they are stable.
+ *
+ * @param ir const IrFunction* Function analysed, whose graph is built.
+ * @param live Liveness* Liveness, filled. To be freed by freeLiveness.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo computeLiveness(const IrFunction *ir, Liveness *live)
+{
+    int words = SET_WORDS(ir->nbVregs);
+    unsigned long size = (ir->nbBlocks * words + 1) * sizeof(unsigned long);
+    *live = (Liveness){words, calloc(1, size), calloc(1, size)};
+    unsigned long *use = calloc(1, size);
+    unsigned long *def = calloc(1, size);
+    if (!live->liveIn || !live->liveOut || !use || !def)
+    {
+        free(use);
+        free(def);
+        freeLiveness(live);
+        return ALLOC_ERROR;
+    }
+
+    for (int b = 0; b < ir->nbBlocks; b++)
+        findUsesAndDefs(ir, &ir->blocks[b], use + b * words, def + b * words);
+
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (int b = ir->nbBlocks - 1; b >= 0; b--)
+        {
+            unsigned long *in = LIVE_IN(live, b), *out = LIVE_OUT(live, b);
+            for (int i = 0; i < 2; i++)
+            {
+                int succ = ir->blocks[b].succs[i];
+                if (succ != NO_BLOCK)
+                    for (int w = 0; w < words; w++)
+                        out[w] |= LIVE_IN(live, succ)[w];
+            }
+            for (int w = 0; w < words; w++)
+            {
+                unsigned long newIn = use[b * words + w] | (out[w] & ~def[b * words + w]);
+                changed |= newIn != in[w];
+                in[w] = newIn;
+            }
+        }
+    }
+
+    free(use);
+    free(def);
+    return SUCCESS;
+}
+
+/**
+ * @fn void freeLiveness(Liveness *live)
+ * @brief Free a liveness.
+ *
+ * @param live Liveness* Liveness to free.
+ */
+void freeLiveness(Liveness *live)
+{
+    free(live->liveIn);
+    free(live->liveOut);
+    *live = (Liveness){0, NULL, NULL};
+}
@@ -4,252 +4,517 @@
  * @brief Contain the functions to write the default input-output functions of every executable.
  * @date 2024-02-10
  *
+ * The runtime is cut into parts, each one a complete assembly unit declaring the symbols
+ * it defines and uses. "make runtime" assembles them once into an archive, which the
+ * programs assembled by nasm are linked with, only the parts they refer to being pulled
+ * in. The built-in assembler gets the same parts after the program instead.
  */
 
-#include "utilitaries.h"
 #include <stdio.h>
+#include <string.h>
+#include "defaultFunctionWritter.h"
+#include "emitter.h"
 
 /**
- * @fn ReturnInfo writeGetCharAux(FILE *f)
- * @brief Write the function __getCharAux__ to the file.
+ * @fn ReturnInfo writeFlush()
+ * @brief Write the function __flush__, that write the output buffer and empty it.
  *
- * @param f The file to write to.
  * @return ReturnInfo The return info.
  */
-ReturnInfo writeGetCharAux(FILE *f)
+ReturnInfo writeFlush()
 {
-    fprintf(f, "__getCharAux__:\n"); // déclaration de la fonction
-    fprintf(f, "\tpush rbp\n");
-    fprintf(f, "\tmov rbp, rsp\n\n");
-
-    fprintf(f, "\tsub rsp, 8\n");   // pour aligner la pile
-    fprintf(f, "\tmov rax, 0\n");   // syscall pour lire
-    fprintf(f, "\tmov rdi, 0\n");   // lire depuis stdin
-    fprintf(f, "\tmov rsi, rsp\n"); // stocker le résultat dans la pile
-    fprintf(f, "\tmov rdx, 1\n");   // lire un seul caractère
-    fprintf(f, "\tsyscall\n");      // exécuter syscall
-    fprintf(f, "\tmovzx rax, byte [rsp]\n\n");
-
-    fprintf(f, "\tmov rsp, rbp\n");
-    fprintf(f, "\tpop rbp\n");
-    fprintf(f, "\tret\n\n");
+    emitLit("__flush__:\n"); // déclaration de la fonction
+    emitLit("\tlea rsi, [__outBuf__]\n");
+    emitLit("\tmov rdx, [__outLen__]\n\n");
+
+    emitLit("\t.write:\n");
+    emitLit("\tcmp rdx, 0\n"); // Tant qu'il reste des caractères
+    emitLit("\tjle .flushed\n");
+    emitLit("\tmov rax, 1\n"); // syscall pour ecrire
+    emitLit("\tmov rdi, 1\n"); // ecrire dans stdout
+    emitLit("\tsyscall\n");
+    emitLit("\tcmp rax, 0\n"); // En cas d'erreur, le reste est perdu
+    emitLit("\tjle .flushed\n");
+    emitLit("\tadd rsi, rax\n"); // L'écriture peut être partielle
+    emitLit("\tsub rdx, rax\n");
+    emitLit("\tjmp .write\n\n");
+
+    emitLit("\t.flushed:\n");
+    emitLit("\tmov qword [__outLen__], 0\n");
+    emitLit("\tret\n\n");
     return SUCCESS;
 }
 
 /**
- * @fn ReturnInfo writeGetChar(FILE *f)
- * @brief Write the function getChar (that read a character and a '\\n') to the file.
+ * @fn ReturnInfo writeExit()
+ * @brief Write the function __exit__, jumped to with the exit code in rdi, that flush the output and end the program.
  *
- * @param f The file to write to.
  * @return ReturnInfo The return info.
  */
-ReturnInfo writeGetChar(FILE *f)
+ReturnInfo writeExit()
 {
-    writeGetCharAux(f);
-    fprintf(f, "getChar:\n"); // déclaration de la fonction
-    fprintf(f, "\tpush rbp\n");
-    fprintf(f, "\tmov rbp, rsp\n\n");
-
-    fprintf(f, "\tcall __getCharAux__\n");
-    fprintf(f, "\tpush rax\n");
-    fprintf(f, "\tcall __getCharAux__\n");
-    fprintf(f, "\tpop rax\n");
-
-    fprintf(f, "\tmov rsp, rbp\n");
-    fprintf(f, "\tpop rbp\n");
-    fprintf(f, "\tret\n\n");
+    emitLit("__exit__:\n"); // déclaration de la fonction
+    emitLit("\tmov rbx, rdi\n");   // rbx n'est pas restauré, le programme ne reprend pas
+    emitLit("\tand rsp, -16\n");   // pour aligner la pile
+    emitLit("\tcall __flush__\n");
+    emitLit("\tmov rdi, rbx\n");
+    emitLit("\tmov rax, 60\n");    // syscall pour terminer
+    emitLit("\tsyscall\n\n");
     return SUCCESS;
 }
 
 /**
- * @fn ReturnInfo writeGetInt(FILE *f)
- * @brief Write the function getInt (that read an integer and a '\\n') to the file.
+ * @fn ReturnInfo writeGetCharAux()
+ * @brief Write the function __getCharAux__, that read a character from the input buffer, refilled when empty.
+ * The output is flushed before each refill, to be seen before the program waits for its input.
  *
- * @param f The file to write to.
  * @return ReturnInfo The return info.
  */
-ReturnInfo writeGetInt(FILE *f)
+ReturnInfo writeGetCharAux()
 {
-    fprintf(f, "getInt:\n"); // déclaration de la fonction
-    fprintf(f, "\tpush rbp\n");
-    fprintf(f, "\tmov rbp, rsp\n\n");
-
-    fprintf(f, "\txor r11, r11\n"); // Initialiser r11 à 0, servira pour la somme
-    fprintf(f, "\txor rax, rax\n"); // Initialiser rax à 0
-    fprintf(f, "\txor rdi, rdi\n"); // Initialiser rdi à 0 (signe)
-
-    fprintf(f, "\tpush r11\n"); // On les push pour les récupérer après l'appel
-    fprintf(f, "\tpush rdi\n\n");
-
-    fprintf(f, "\tpush r15\n");
-    fprintf(f, "\tmov r15, rsp\n");
-    fprintf(f, "\tand rsp, -16\n");
-    fprintf(f, "\tsub rsp, 8\n\n");
-    fprintf(f, "\tcall __getCharAux__\n\n"); // Appeler getChar pour lire le premier caractère
-    fprintf(f, "\tmov rsp, r15\n");
-    fprintf(f, "\tpop r15\n\n");
-
-    fprintf(f, "\tpop rdi\n"); // On les pop pour les récupérer après l'appel
-    fprintf(f, "\tpop r11\n\n");
+    emitLit("__getCharAux__:\n"); // déclaration de la fonction
+    emitLit("\tmov rax, [__inPos__]\n");
+    emitLit("\tcmp rax, [__inLen__]\n"); // Reste-t-il des caractères lus
+    emitLit("\tjb .available\n\n");
+
+    emitLit("\tsub rsp, 8\n"); // pour aligner la pile
+    emitLit("\tcall __flush__\n");
+    emitLit("\tadd rsp, 8\n");
+    emitLit("\tmov rax, 0\n");   // syscall pour lire
+    emitLit("\tmov rdi, 0\n");   // lire depuis stdin
+    emitLit("\tlea rsi, [__inBuf__]\n");
+    emit("\tmov rdx, %d\n", IN_BUFFER_SIZE); // remplir le buffer
+    emitLit("\tsyscall\n");
+    emitLit("\tcmp rax, 0\n");
+    emitLit("\tjg .filled\n");
+    emitLit("\txor eax, eax\n"); // fin de l'entrée : on renvoie 0
+    emitLit("\tret\n\n");
+
+    emitLit("\t.filled:\n");
+    emitLit("\tmov [__inLen__], rax\n");
+    emitLit("\txor eax, eax\n\n");
+
+    emitLit("\t.available:\n");
+    emitLit("\tlea rdx, [rax + 1]\n");
+    emitLit("\tmov [__inPos__], rdx\n");
+    emitLit("\tmovzx rax, byte [__inBuf__ + rax]\n");
+    emitLit("\tret\n\n");
+    return SUCCESS;
+}
 
-    fprintf(f, "\tcmp al, '-'\n");     // Vérifier si c'est un signe négatif
-    fprintf(f, "\tje .is_negative\n"); // Sauter si négatif
-    fprintf(f, "\tjmp .read_digit\n"); // Sinon, commencer à lire les chiffres
-    fprintf(f, "\t\t.is_negative:\n");
-    fprintf(f, "\tmov rdi, 1\n\n"); // Mettre rdi à 1 pour indiquer un nombre négatif
+/**
+ * @fn ReturnInfo writeGetChar()
+ * @brief Write the function getChar (that read a character and a '\\n').
+ *
+ * @return ReturnInfo The return info.
+ */
+ReturnInfo writeGetChar()
+{
+    emitLit("getChar:\n"); // déclaration de la fonction
+    emitLit("\tpush rbp\n");
+    emitLit("\tmov rbp, rsp\n\n");
+
+    emitLit("\tsub rsp, 16\n"); // garde la pile alignée pour les appels
+    emitLit("\tcall __getCharAux__\n");
+    emitLit("\tmov [rsp], rax\n");
+    emitLit("\tcall __getCharAux__\n");
+    emitLit("\tmov rax, [rsp]\n");
+
+    emitLit("\tmov rsp, rbp\n");
+    emitLit("\tpop rbp\n");
+    emitLit("\tret\n\n");
+    return SUCCESS;
+}
 
-    fprintf(f, "\tpush r11\n"); // On les push pour les récupérer après l'appel
-    fprintf(f, "\tpush rdi\n\n");
+/**
+ * @fn ReturnInfo writeEightDigits()
+ * @brief Write the parsing of eight characters loaded in rax: if they are all digits,
+ * rax gets their value, else the parsing jumps to .one_digit. rcx and rdx are used.
+ *
+ * @return ReturnInfo The return info.
+ */
+ReturnInfo writeEightDigits()
+{
+    emitLit("\tmov rcx, rax\n"); // Chaque octet doit valoir de 0x30 à 0x39
+    emitLit("\tmov rdx, 0x0606060606060606\n");
+    emitLit("\tadd rcx, rdx\n");
+    emitLit("\tmov rdx, 0xF0F0F0F0F0F0F0F0\n");
+    emitLit("\tand rcx, rdx\n");
+    emitLit("\tshr rcx, 4\n");
+    emitLit("\tand rdx, rax\n");
+    emitLit("\tor rcx, rdx\n");
+    emitLit("\tmov rdx, 0x3333333333333333\n");
+    emitLit("\tcmp rcx, rdx\n");
+    emitLit("\tjne .one_digit\n\n");
+
+    emitLit("\tmov rdx, 0x3030303030303030\n"); // On convertit les caractères en chiffres
+    emitLit("\tsub rax, rdx\n");
+    emitLit("\timul rcx, rax, 10\n"); // Puis on les regroupe par 2,
+    emitLit("\tshr rax, 8\n");
+    emitLit("\tadd rax, rcx\n");
+    emitLit("\tmov rcx, rax\n"); // par 4 et enfin par 8
+    emitLit("\tshr rcx, 16\n");
+    emitLit("\tmov rdx, 0x000000FF000000FF\n");
+    emitLit("\tand rax, rdx\n");
+    emitLit("\tand rcx, rdx\n");
+    emitLit("\tmov rdx, 0x000F424000000064\n"); // 100 + 1000000 * 2^32
+    emitLit("\timul rax, rdx\n");
+    emitLit("\tmov rdx, 0x0000271000000001\n"); // 1 + 10000 * 2^32
+    emitLit("\timul rcx, rdx\n");
+    emitLit("\tadd rax, rcx\n");
+    emitLit("\tshr rax, 32\n\n");
+    return SUCCESS;
+}
 
-    fprintf(f, "\tpush r15\n");
-    fprintf(f, "\tmov r15, rsp\n");
-    fprintf(f, "\tand rsp, -16\n");
-    fprintf(f, "\tsub rsp, 8\n\n");
-    fprintf(f, "\tcall __getCharAux__\n\n"); // Appeler getChar pour lire le premier caractère
-    fprintf(f, "\tmov rsp, r15\n");
-    fprintf(f, "\tpop r15\n\n");
+/**
+ * @fn ReturnInfo writeGetInt()
+ * @brief Write the function getInt (that read an integer and the character following it).
+ * The digits are parsed straight from the input buffer, eight at once while they are available,
+ * __getCharAux__ being only called for the first character and when the buffer is empty.
+ *
+ * @return ReturnInfo The return info.
+ */
+ReturnInfo writeGetInt()
+{
+    emitLit("getInt:\n"); // déclaration de la fonction
+    emitLit("\tsub rsp, 24\n"); // [rsp] : somme, [rsp + 8] : signe, pile alignée pour les appels
+    emitLit("\tmov qword [rsp], 0\n");
+    emitLit("\tmov qword [rsp + 8], 0\n\n");
+
+    emitLit("\tcall __getCharAux__\n"); // Lire le premier caractère
+    emitLit("\tcmp al, '-'\n");         // Vérifier si c'est un signe négatif
+    emitLit("\tjne .first_digit\n");
+    emitLit("\tmov qword [rsp + 8], 1\n\n");
+
+    emitLit("\t\t.refill:\n");
+    emitLit("\tcall __getCharAux__\n"); // Lire un caractère, en remplissant le buffer
+    emitLit("\t\t.first_digit:\n");
+    emitLit("\tmov r10, [rsp]\n");
+    emitLit("\tsub rax, '0'\n"); // Convertir le caractère en chiffre
+    emitLit("\tcmp rax, 9\n");   // Finir si ce n'est pas un chiffre
+    emitLit("\tja .done\n");
+    emitLit("\tlea r10, [r10 + r10 * 4]\n"); // Multiplier la somme par 10 et ajouter le chiffre
+    emitLit("\tlea r10, [rax + r10 * 2]\n");
+    emitLit("\tmov rsi, [__inPos__]\n");
+    emitLit("\tmov rdi, [__inLen__]\n\n");
+
+    emitLit("\t.eight_digits:\n");
+    emitLit("\tlea rax, [rsi + 8]\n"); // Reste-t-il huit caractères dans le buffer
+    emitLit("\tcmp rax, rdi\n");
+    emitLit("\tja .one_digit\n");
+    emitLit("\tmov rax, [__inBuf__ + rsi]\n");
+    writeEightDigits();
+    emitLit("\timul r10, r10, 100000000\n");
+    emitLit("\tadd r10, rax\n");
+    emitLit("\tadd rsi, 8\n");
+    emitLit("\tjmp .eight_digits\n\n");
+
+    emitLit("\t.one_digit:\n");
+    emitLit("\tcmp rsi, rdi\n"); // Remplir le buffer s'il est vide
+    emitLit("\tjae .empty\n");
+    emitLit("\tmovzx rax, byte [__inBuf__ + rsi]\n");
+    emitLit("\tinc rsi\n");
+    emitLit("\tsub rax, '0'\n");
+    emitLit("\tcmp rax, 9\n");
+    emitLit("\tja .end_of_number\n");
+    emitLit("\tlea r10, [r10 + r10 * 4]\n");
+    emitLit("\tlea r10, [rax + r10 * 2]\n");
+    emitLit("\tjmp .one_digit\n\n");
+
+    emitLit("\t\t.empty:\n");
+    emitLit("\tmov [__inPos__], rsi\n");
+    emitLit("\tmov [rsp], r10\n");
+    emitLit("\tjmp .refill\n");
+    emitLit("\t\t.end_of_number:\n");
+    emitLit("\tmov [__inPos__], rsi\n");
+    emitLit("\tmov [rsp], r10\n\n");
+
+    emitLit("\t\t.done:\n");
+    emitLit("\tmov rax, [rsp]\n");
+    emitLit("\tcmp qword [rsp + 8], 0\n"); // Vérifier si le nombre est négatif
+    emitLit("\tje .theEnd\n");
+    emitLit("\tneg rax\n");
+    emitLit("\t\t.theEnd:\n");
+    emitLit("\tadd rsp, 24\n");
+    emitLit("\tret\n\n");
+    return SUCCESS;
+}
 
-    fprintf(f, "\tpop rdi\n"); // On les pop pour les récupérer après l'appel
-    fprintf(f, "\tpop r11\n\n");
+/**
+ * @fn ReturnInfo writePutChar()
+ * @brief Write the function putChar (that write a character in the output buffer, flushed when full).
+ *
+ * @return ReturnInfo The return info.
+ */
+ReturnInfo writePutChar()
+{
+    emitLit("putChar:\n"); // déclaration de la fonction
+    emitLit("\tmov rax, [__outLen__]\n");
+    emitLit("\tmov [__outBuf__ + rax], dil\n"); // on range le premier et seul argument
+    emitLit("\tinc rax\n");
+    emitLit("\tmov [__outLen__], rax\n");
+    emit("\tcmp rax, %d\n", OUT_BUFFER_SIZE); // on vide le buffer s'il est plein
+    emitLit("\tje __flush__\n");
+    emitLit("\tret\n\n");
+    return SUCCESS;
+}
 
-    fprintf(f, "\t\t.read_digit:\n");
-    fprintf(f, "\tcmp al, '0'\n");       // Vérifier si le caractère est un chiffre
-    fprintf(f, "\tjl .done\n");          // Si moins que '0', finir
-    fprintf(f, "\tcmp al, '9'\n");       // Vérifier si le caractère est un chiffre
-    fprintf(f, "\tjg .done\n");          // Si plus que '9', finir
-    fprintf(f, "\timul r11, r11, 10\n"); // Multiplier r11 par 10 (décaler à gauche)
-    fprintf(f, "\tsub al, '0'\n");       // Convertir le caractère en chiffre
-    fprintf(f, "\tadd r11, rax\n\n");    // Ajouter rax à la somme
+/**
+ * @fn ReturnInfo writePutInt()
+ * @brief Write the function putInt (that write an integer in the output buffer).
+ * The digits are found two by two from the table __digitPairs__, the division by 100
+ * being a multiplication by its reciprocal.
+ *
+ * @return ReturnInfo The return info.
+ */
+ReturnInfo writePutInt()
+{
+    emitLit("putInt:\n"); // déclaration de la fonction
+    emitLit("\tmov rax, [__outLen__]\n");
+    emit("\tcmp rax, %d\n", OUT_BUFFER_SIZE - INT_ROOM); // On vide le buffer s'il n'a plus la place d'un entier
+    emitLit("\tjbe .room\n");
+    emitLit("\tpush rdi\n"); // pile alignée pour l'appel
+    emitLit("\tcall __flush__\n");
+    emitLit("\tpop rdi\n");
+    emitLit("\t\t.room:\n\n");
+
+    emitLit("\tmov r8, [__outLen__]\n"); // r8 est la position d'écriture dans le buffer
+    emitLit("\tmov rax, rdi\n");         // On stocke notre entier de départ
+    emitLit("\tcmp rax, 0\n");           // On écrit un - et on inverse le nombre s'il est négatif
+    emitLit("\tjge .positive\n");
+    emitLit("\tmov byte [__outBuf__ + r8], '-'\n");
+    emitLit("\tinc r8\n");
+    emitLit("\tneg rax\n"); // Le plus petit entier reste lu correctement, sans signe
+    emitLit("\t\t.positive:\n\n");
+
+    emitLit("\tmov r9, rsp\n"); // Chiffres écrits sous rsp, plus aucun appel n'étant fait
+
+    emitLit("\t.trad_pair:\n");
+    emitLit("\tcmp rax, 100\n"); // Tant qu'il reste plus de deux chiffres
+    emitLit("\tjb .last_digits\n");
+    emitLit("\tmov rcx, rax\n");
+    emitLit("\tshr rax, 2\n"); // Quotient par 100 : (rax / 4) * (2^66 / 25) / 2^66
+    emitLit("\tmov rdx, 0x28F5C28F5C28F5C3\n");
+    emitLit("\timul rdx\n");
+    emitLit("\tshr rdx, 2\n");
+    emitLit("\timul rax, rdx, 100\n"); // Reste de la division
+    emitLit("\tsub rcx, rax\n");
+    emitLit("\tmovzx eax, word [__digitPairs__ + rcx * 2]\n");
+    emitLit("\tsub r9, 2\n");
+    emitLit("\tmov [r9], ax\n"); // On range les deux chiffres devant les suivants
+    emitLit("\tmov rax, rdx\n");
+    emitLit("\tjmp .trad_pair\n\n");
+
+    emitLit("\t.last_digits:\n");
+    emitLit("\tcmp rax, 10\n");
+    emitLit("\tjb .last_digit\n");
+    emitLit("\tmovzx eax, word [__digitPairs__ + rax * 2]\n");
+    emitLit("\tsub r9, 2\n");
+    emitLit("\tmov [r9], ax\n");
+    emitLit("\tjmp .copy\n");
+    emitLit("\t\t.last_digit:\n");
+    emitLit("\tadd rax, '0'\n");
+    emitLit("\tdec r9\n");
+    emitLit("\tmov [r9], al\n\n");
+
+    emitLit("\t.copy:\n"); // On copie les chiffres dans le buffer, 8 par 8
+    emitLit("\tmov rax, [r9]\n");
+    emitLit("\tmov [__outBuf__ + r8], rax\n");
+    emitLit("\tmov rax, [r9 + 8]\n");
+    emitLit("\tmov [__outBuf__ + r8 + 8], rax\n");
+    emitLit("\tmov rax, [r9 + 16]\n");
+    emitLit("\tmov [__outBuf__ + r8 + 16], rax\n");
+    emitLit("\tadd r8, rsp\n"); // Puis on avance du nombre de chiffres
+    emitLit("\tsub r8, r9\n");
+    emitLit("\tmov [__outLen__], r8\n");
+    emitLit("\tret\n\n");
+    return SUCCESS;
+}
 
-    fprintf(f, "\tpush r11\n"); // On les push pour les récupérer après l'appel
-    fprintf(f, "\tpush rdi\n\n");
+/* ------- Parts of the runtime -------- */
 
-    fprintf(f, "\tpush r15\n");
-    fprintf(f, "\tmov r15, rsp\n");
-    fprintf(f, "\tand rsp, -16\n");
-    fprintf(f, "\tsub rsp, 8\n\n");
-    fprintf(f, "\tcall __getCharAux__\n\n"); // Appeler getChar pour lire le premier caractère
-    fprintf(f, "\tmov rsp, r15\n");
-    fprintf(f, "\tpop r15\n\n");
+/**
+ * @fn ReturnInfo writeOutputUnit()
+ * @brief Write the part of the runtime holding the output buffer, with __flush__ and __exit__.
+ *
+ * @return ReturnInfo The return info.
+ */
+ReturnInfo writeOutputUnit()
+{
+    emitLit("global __outBuf__\nglobal __outLen__\nglobal __flush__\nglobal __exit__\n\n");
+    emitLit("section .bss\n");
+    emit("\t__outBuf__: resb %d\n", OUT_BUFFER_SIZE);
+    emitLit("\t__outLen__: resq 1\n\n"); // caractères en attente d'écriture
+    emitLit("section .text\n");
+    writeFlush();
+    writeExit();
+    return SUCCESS;
+}
 
-    fprintf(f, "\tpop rdi\n"); // On les pop pour les récupérer après l'appel
-    fprintf(f, "\tpop r11\n\n");
+/**
+ * @fn ReturnInfo writeInputUnit()
+ * @brief Write the part of the runtime holding the input buffer, with __getCharAux__.
+ *
+ * @return ReturnInfo The return info.
+ */
+ReturnInfo writeInputUnit()
+{
+    emitLit("global __inBuf__\nglobal __inPos__\nglobal __inLen__\nglobal __getCharAux__\n");
+    emitLit("extern __flush__\n\n");
+    emitLit("section .bss\n");
+    emit("\t__inBuf__: resb %d\n", IN_BUFFER_SIZE);
+    emitLit("\t__inPos__: resq 1\n"); // prochain caractère à lire
+    emitLit("\t__inLen__: resq 1\n\n"); // caractères lus dans le buffer
+    emitLit("section .text\n");
+    writeGetCharAux();
+    return SUCCESS;
+}
 
-    fprintf(f, "\tjmp .read_digit\n"); // Boucler
-    fprintf(f, "\t\t.done:\n");
-    fprintf(f, "\tcmp rdi, 0\n"); // Vérifier si le nombre est négatif
-    fprintf(f, "\tje .theEnd\n"); // Si zéro, sauter à la fin
-    fprintf(f, "\tneg r11\n");    // Sinon, négatif le nombre dans r11
-    fprintf(f, "\t\t.theEnd:\n");
+/**
+ * @fn ReturnInfo writeGetCharUnit()
+ * @brief Write the part of the runtime defining getChar.
+ *
+ * @return ReturnInfo The return info.
+ */
+ReturnInfo writeGetCharUnit()
+{
+    emitLit("global getChar\nextern __getCharAux__\n\n");
+    emitLit("section .text\n");
+    return writeGetChar();
+}
 
-    fprintf(f, "\tmov rax, r11\n\n"); // Mettre la somme dans rax pour future utilisation
+/**
+ * @fn ReturnInfo writeGetIntUnit()
+ * @brief Write the part of the runtime defining getInt.
+ *
+ * @return ReturnInfo The return info.
+ */
+ReturnInfo writeGetIntUnit()
+{
+    emitLit("global getInt\nextern __getCharAux__\nextern __inBuf__\nextern __inPos__\nextern __inLen__\n\n");
+    emitLit("section .text\n");
+    return writeGetInt();
+}
 
-    fprintf(f, "\tmov rsp, rbp\n");
-    fprintf(f, "\tpop rbp\n");
-    fprintf(f, "\tret\n\n");
-    return SUCCESS;
+/**
+ * @fn ReturnInfo writePutCharUnit()
+ * @brief Write the part of the runtime defining putChar.
+ *
+ * @return ReturnInfo The return info.
+ */
+ReturnInfo writePutCharUnit()
+{
+    emitLit("global putChar\nextern __outBuf__\nextern __outLen__\nextern __flush__\n\n");
+    emitLit("section .text\n");
+    return writePutChar();
 }
 
 /**
- * @fn ReturnInfo writePutChar(FILE *f)
- * @brief Write the function putChar (that write a character) to the file.
+ * @fn ReturnInfo writePutIntUnit()
+ * @brief Write the part of the runtime defining putInt, with its table of the characters of the numbers from 00 to 99.
  *
- * @param f The file to write to.
  * @return ReturnInfo The return info.
  */
-ReturnInfo writePutChar(FILE *f)
+ReturnInfo writePutIntUnit()
 {
-    fprintf(f, "putChar:\n"); // déclaration de la fonction
-    fprintf(f, "\tpush rbp\n");
-    fprintf(f, "\tmov rbp, rsp\n\n");
+    emitLit("global putInt\nextern __outBuf__\nextern __outLen__\nextern __flush__\n\n");
+    emitLit("section .data\n");
+    emitLit("\t__digitPairs__: db \"");
+    for (int i = 0; i < 100; i++)
+        emit("%c%c", '0' + i / 10, '0' + i % 10);
+    emitLit("\"\n\n");
+    emitLit("section .text\n");
+    return writePutInt();
+}
 
-    fprintf(f, "\tpush rdi\n"); // on push le premier et seul argument
+/* Writer of each part of the runtime, and the part whose symbols it uses */
+static const struct
+{
+    const char *name; /* Name of its source, and of its function for the parts called by the programs */
+    ReturnInfo (*write)();
+    int dependency;   /* -1 if none */
+} RUNTIME_UNITS[NB_RUNTIME_UNITS] = {
+    [RUNTIME_OUTPUT] = {"output", writeOutputUnit, -1},
+    [RUNTIME_INPUT] = {"input", writeInputUnit, RUNTIME_OUTPUT},
+    [RUNTIME_GET_CHAR] = {"getChar", writeGetCharUnit, RUNTIME_INPUT},
+    [RUNTIME_GET_INT] = {"getInt", writeGetIntUnit, RUNTIME_INPUT},
+    [RUNTIME_PUT_CHAR] = {"putChar", writePutCharUnit, RUNTIME_OUTPUT},
+    [RUNTIME_PUT_INT] = {"putInt", writePutIntUnit, RUNTIME_OUTPUT},
+};
 
-    fprintf(f, "\tmov rax, 1\n");   // syscall pour ecrire
-    fprintf(f, "\tmov rdi, 1\n");   // ecrire dans stdout
-    fprintf(f, "\tmov rsi, rsp\n"); // écrire le caractère supposé dans r11
-    fprintf(f, "\tmov rdx, 1\n");   // ecrire un seul caractère
-    fprintf(f, "\tsyscall\n\n");    // exécuter syscall
+/**
+ * @fn int findRuntimeFunction(const char *name)
+ * @brief Find the part of the runtime defining a function called by the programs.
+ *
+ * @param name const char* Name of the function.
+ * @return int Part of the runtime, -1 if the function is not one of the runtime.
+ */
+int findRuntimeFunction(const char *name)
+{
+    for (int unit = RUNTIME_GET_CHAR; unit < NB_RUNTIME_UNITS; unit++)
+        if (!strcmp(RUNTIME_UNITS[unit].name, name))
+            return unit;
+    return -1;
+}
 
-    fprintf(f, "\tmov rsp, rbp\n");
-    fprintf(f, "\tpop rbp\n");
-    fprintf(f, "\tret\n\n");
-    return SUCCESS;
+/**
+ * @fn const char *runtimeFunctionName(RuntimeUnit unit)
+ * @brief Get the name of the function defined by a part of the runtime.
+ *
+ * @param unit RuntimeUnit Part of the runtime called by the programs.
+ * @return const char* Name of the function.
+ */
+const char *runtimeFunctionName(RuntimeUnit unit)
+{
+    return RUNTIME_UNITS[unit].name;
 }
 
 /**
- * @fn ReturnInfo writePutInt(FILE *f)
- * @brief Write the function putInt (that write an integer) to the file.
- *
- * @param f The file to write to.
- * @return ReturnInfo The return info.
- */
-ReturnInfo writePutInt(FILE *f)
-{
-    fprintf(f, "putInt:\n"); // déclaration de la fonction
-    fprintf(f, "\tpush rbp\n");
-    fprintf(f, "\tmov rbp, rsp\n\n");
-
-    fprintf(f, "\tcmp rdi, 0\n"); // On affiche un - et on inverse le nombre s'il est négatif
-    fprintf(f, "\tjge .positive\n");
-    fprintf(f, "\tpush rdi\n");
-    fprintf(f, "\tmov rdi, '-'\n");
-    fprintf(f, "\tcall putChar\n");
-    fprintf(f, "\tpop rdi\n");
-    fprintf(f, "\tneg rdi\n");
-    fprintf(f, "\t\t.positive:\n\n");
-
-    fprintf(f, "\tmov rax, rdi\n");  // On stocke notre entier de départ
-    fprintf(f, "\txor r11, r11\n");  // On comptera nos chiffre avec r11
-    fprintf(f, "\tmov r12, 10\n\n"); // On met notre diviseur à 10
-
-    fprintf(f, "\t.trad_digit:\n");
-    fprintf(f, "\tinc r11\n");
-    fprintf(f, "\txor rdx, rdx\n");      // On met rdx à 0
-    fprintf(f, "\tidiv r12\n");          // On divise rax par 10
-    fprintf(f, "\tadd rdx, '0'\n");      // On ajoute le reste à '0' pour le convertir en char
-    fprintf(f, "\tpush rdx\n");          // On push le reste dans la pile
-    fprintf(f, "\tcmp rax, 0\n");        // On vérifie si rax est à 0
-    fprintf(f, "\tjne .trad_digit\n\n"); // Si non, on recommence
-
-    fprintf(f, "\tcmp r11, 0\n");           // On vérifie si r11 est à 0
-    fprintf(f, "\tjle .end_write_digit\n"); // On affiche rien
-    fprintf(f, "\t.write_digit:\n\n");      // On écris chaque chiffre dans le bon ordre
-    fprintf(f, "\tpop rdi\n");
-    fprintf(f, "\tpush r11\n");
-
-    fprintf(f, "\tpush r15\n");
-    fprintf(f, "\tmov r15, rsp\n");
-    fprintf(f, "\tand rsp, -16\n");
-    fprintf(f, "\tsub rsp, 8\n\n");
-    fprintf(f, "\tcall putChar\n"); // On appelle putChar
-    fprintf(f, "\tmov rsp, r15\n");
-    fprintf(f, "\tpop r15\n\n");
-
-    fprintf(f, "\tpop r11\n");
-    fprintf(f, "\tdec r11\n");             // On décrémente r11
-    fprintf(f, "\tcmp r11, 0\n");          // On vérifie si r11 est à 0
-    fprintf(f, "\tjg .write_digit\n");     // On recommence
-    fprintf(f, "\t.end_write_digit:\n\n"); // fin de boucle
-
-    fprintf(f, "\tmov rsp, rbp\n");
-    fprintf(f, "\tpop rbp\n");
-    fprintf(f, "\tret\n\n");
+ * @fn ReturnInfo writeLinkedRuntime(const int *called)
+ * @brief Write the parts of the runtime a program is linked with: the ones it calls, the ones they use,
+ * and the output, flushed at its exit. Each part is written once, after the ones it uses.
+ *
+ * @param called const int* 1 for each part of the runtime called by the program.
+ * @return ReturnInfo The return info.
+ */
+ReturnInfo writeLinkedRuntime(const int *called)
+{
+    int linked[NB_RUNTIME_UNITS] = {[RUNTIME_OUTPUT] = 1};
+    for (int unit = 0; unit < NB_RUNTIME_UNITS; unit++)
+        for (int used = unit; called[unit] && used >= 0; used = RUNTIME_UNITS[used].dependency)
+            linked[used] = 1;
+
+    for (int unit = 0; unit < NB_RUNTIME_UNITS; unit++)
+        if (linked[unit])
+        {
+            emitLit("\n");
+            RUNTIME_UNITS[unit].write();
+        }
     return SUCCESS;
 }
 
 /**
- * @fn ReturnInfo writeDefaultFunctions(FILE *f)
- * @brief Write the default input-output functions to the file.
+ * @fn ReturnInfo writeRuntimeSources(const char *directory)
+ * @brief Write each part of the runtime into its own assembly file, to be assembled once into the runtime archive.
  *
- * @param f The file to write to.
+ * @param directory const char* Directory of the files.
  * @return ReturnInfo The return info.
  */
-ReturnInfo writeDefaultFunctions(FILE *f)
+ReturnInfo writeRuntimeSources(const char *directory)
 {
-    writeGetChar(f);
-    writeGetInt(f);
-    writePutChar(f);
-    writePutInt(f);
+    char fileName[SIZE_ID * 2];
+    for (int unit = 0; unit < NB_RUNTIME_UNITS; unit++)
+    {
+        ReturnInfo info = startEmitter();
+        if (info != SUCCESS)
+            return info;
+        RUNTIME_UNITS[unit].write();
+
+        snprintf(fileName, sizeof(fileName), "%s/%s.asm", directory, RUNTIME_UNITS[unit].name);
+        info = writeEmitted(fileName);
+        if (info != SUCCESS)
+            return info;
+    }
+    freeEmitter();
     return SUCCESS;
 }
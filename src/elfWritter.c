@@ -0,0 +1,282 @@
+/**
+ * @file elfWritter.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Writter of static x86-64 ELF executables.
+ * @date 2024-02-10
+ *
+ * The executable is made of two loadable segments: the headers followed by
+ * the code (read and execute), then the data followed by the bss (read and
+ * write). Section headers and a symbol table are added after them so the
+ * executable can still be read by objdump or gdb.
+ */
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "elfWritter.h"
+
+#define BASE_ADDRESS 0x400000
+#define PAGE_SIZE 0x1000
+#define NB_PROGRAM_HEADERS 3
+#define NB_SECTION_HEADERS 7
+#define TEXT_OFFSET alignUp(sizeof(Elf64_Ehdr) + NB_PROGRAM_HEADERS * sizeof(Elf64_Phdr), 16)
+
+/* Names of the sections, at the offsets given to the section headers */
+static const char SECTION_NAMES[] = "\0.text\0.data\0.bss\0.symtab\0.strtab\0.shstrtab";
+
+/**
+ * @fn unsigned long alignUp(unsigned long value, unsigned long alignment)
+ * @brief Round a value up to a multiple of a power of two.
+ *
+ * @param value unsigned long Value to round.
+ * @param alignment unsigned long Power of two.
+ * @return unsigned long Rounded value.
+ */
+unsigned long alignUp(unsigned long value, unsigned long alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * @fn unsigned long dataOffset(const ExecutableImage *image)
+ * @brief Get the offset of the data in the file.
+ *
+ * @param image const ExecutableImage* Executable.
+ * @return unsigned long Offset of the data.
+ */
+unsigned long dataOffset(const ExecutableImage *image)
+{
+    return alignUp(TEXT_OFFSET + image->textLen, 16);
+}
+
+/**
+ * @fn void layoutExecutable(ExecutableImage *image)
+ * @brief Compute the address of each section from the size of the code and of the data.
+ * The data is mapped one page after the code, at an address congruent to its
+ * offset in the file, and the bss directly follows it.
+ *
+ * @param image ExecutableImage* Executable, its addresses are filled.
+ */
+void layoutExecutable(ExecutableImage *image)
+{
+    image->addresses[NO_SECTION] = 0;
+    image->addresses[TEXT_SECTION] = BASE_ADDRESS + TEXT_OFFSET;
+    image->addresses[DATA_SECTION] = BASE_ADDRESS + PAGE_SIZE + dataOffset(image);
+    image->addresses[BSS_SECTION] = image->addresses[DATA_SECTION] + alignUp(image->dataLen, 16);
+}
+
+/**
+ * @fn int writePadding(FILE *f, unsigned long *written, unsigned long offset)
+ * @brief Write zeros until the given offset of the file.
+ *
+ * @param f FILE* File we are writing to.
+ * @param written unsigned long* Number of bytes already written, updated.
+ * @param offset unsigned long Offset to reach.
+ * @return int 1 on success, 0 otherwise.
+ */
+int writePadding(FILE *f, unsigned long *written, unsigned long offset)
+{
+    for (; *written < offset; (*written)++)
+    {
+        if (fputc(0, f) == EOF)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @fn int writeBlock(FILE *f, unsigned long *written, const void *block, unsigned long len)
+ * @brief Write a block of bytes.
+ *
+ * @param f FILE* File we are writing to.
+ * @param written unsigned long* Number of bytes already written, updated.
+ * @param block const void* Bytes to write.
+ * @param len unsigned long Number of bytes.
+ * @return int 1 on success, 0 otherwise.
+ */
+int writeBlock(FILE *f, unsigned long *written, const void *block, unsigned long len)
+{
+    *written += len;
+    return !len || fwrite(block, 1, len, f) == len;
+}
+
+/**
+ * @fn void fillProgramHeaders(const ExecutableImage *image, Elf64_Phdr *headers)
+ * @brief Fill the headers of the segments loaded by the kernel.
+ *
+ * @param image const ExecutableImage* Executable.
+ * @param headers Elf64_Phdr* Headers to fill, NB_PROGRAM_HEADERS of them.
+ */
+void fillProgramHeaders(const ExecutableImage *image, Elf64_Phdr *headers)
+{
+    memset(headers, 0, NB_PROGRAM_HEADERS * sizeof(Elf64_Phdr));
+
+    headers[0].p_type = PT_LOAD;
+    headers[0].p_flags = PF_R | PF_X;
+    headers[0].p_vaddr = headers[0].p_paddr = BASE_ADDRESS;
+    headers[0].p_filesz = headers[0].p_memsz = TEXT_OFFSET + image->textLen;
+    headers[0].p_align = PAGE_SIZE;
+
+    unsigned long dataSize = alignUp(image->dataLen, 16) + image->bssLen;
+    headers[1].p_type = dataSize ? PT_LOAD : PT_NULL;
+    headers[1].p_flags = PF_R | PF_W;
+    headers[1].p_offset = dataOffset(image);
+    headers[1].p_vaddr = headers[1].p_paddr = image->addresses[DATA_SECTION];
+    headers[1].p_filesz = image->dataLen;
+    headers[1].p_memsz = dataSize;
+    headers[1].p_align = PAGE_SIZE;
+
+    headers[2].p_type = PT_GNU_STACK;
+    headers[2].p_flags = PF_R | PF_W;
+    headers[2].p_align = 16;
+}
+
+/**
+ * @fn void fillSectionHeader(Elf64_Shdr *header, int name, int type, int flags, unsigned long address, unsigned long offset, unsigned long size)
+ * @brief Fill the header of a section.
+ *
+ * @param header Elf64_Shdr* Header to fill.
+ * @param name int Offset of the name of the section in SECTION_NAMES.
+ * @param type int Type of the section.
+ * @param flags int Flags of the section.
+ * @param address unsigned long Address of the section in memory, 0 if not loaded.
+ * @param offset unsigned long Offset of the section in the file.
+ * @param size unsigned long Size of the section.
+ */
+void fillSectionHeader(Elf64_Shdr *header, int name, int type, int flags, unsigned long address, unsigned long offset, unsigned long size)
+{
+    memset(header, 0, sizeof(Elf64_Shdr));
+    header->sh_name = name;
+    header->sh_type = type;
+    header->sh_flags = flags;
+    header->sh_addr = address;
+    header->sh_offset = offset;
+    header->sh_size = size;
+    header->sh_addralign = address ? 16 : 1;
+}
+
+/**
+ * @fn ReturnInfo writeElf(FILE *f, const ExecutableImage *image, const Elf64_Sym *symbols, const char *names, unsigned long namesLen)
+ * @brief Write the headers, the segments, the symbol table and the section headers.
+ *
+ * @param f FILE* File we are writing to.
+ * @param image const ExecutableImage* Executable.
+ * @param symbols const Elf64_Sym* Symbol table, with its null first entry.
+ * @param names const char* Names of the symbols.
+ * @param namesLen unsigned long Size of the names.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo writeElf(FILE *f, const ExecutableImage *image, const Elf64_Sym *symbols, const char *names, unsigned long namesLen)
+{
+    unsigned long symbolsLen = (image->nbSymbols + 1) * sizeof(Elf64_Sym);
+    unsigned long symbolsOffset = alignUp(dataOffset(image) + image->dataLen, 8);
+    unsigned long namesOffset = symbolsOffset + symbolsLen;
+    unsigned long sectionNamesOffset = namesOffset + namesLen;
+    unsigned long sectionHeadersOffset = alignUp(sectionNamesOffset + sizeof(SECTION_NAMES), 8);
+
+    Elf64_Ehdr header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    header.e_type = ET_EXEC;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+    header.e_entry = image->entry;
+    header.e_phoff = sizeof(Elf64_Ehdr);
+    header.e_shoff = sectionHeadersOffset;
+    header.e_ehsize = sizeof(Elf64_Ehdr);
+    header.e_phentsize = sizeof(Elf64_Phdr);
+    header.e_phnum = NB_PROGRAM_HEADERS;
+    header.e_shentsize = sizeof(Elf64_Shdr);
+    header.e_shnum = NB_SECTION_HEADERS;
+    header.e_shstrndx = NB_SECTION_HEADERS - 1;
+
+    Elf64_Phdr programHeaders[NB_PROGRAM_HEADERS];
+    fillProgramHeaders(image, programHeaders);
+
+    Elf64_Shdr sectionHeaders[NB_SECTION_HEADERS];
+    memset(sectionHeaders, 0, sizeof(sectionHeaders));
+    fillSectionHeader(&sectionHeaders[1], 1, SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, image->addresses[TEXT_SECTION], TEXT_OFFSET, image->textLen);
+    fillSectionHeader(&sectionHeaders[2], 7, SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, image->addresses[DATA_SECTION], dataOffset(image), image->dataLen);
+    fillSectionHeader(&sectionHeaders[3], 13, SHT_NOBITS, SHF_ALLOC | SHF_WRITE, image->addresses[BSS_SECTION], dataOffset(image) + image->dataLen, image->bssLen);
+    fillSectionHeader(&sectionHeaders[4], 18, SHT_SYMTAB, 0, 0, symbolsOffset, symbolsLen);
+    sectionHeaders[4].sh_link = 5;
+    sectionHeaders[4].sh_info = image->nbSymbols + 1; // every symbol is local
+    sectionHeaders[4].sh_entsize = sizeof(Elf64_Sym);
+    sectionHeaders[4].sh_addralign = 8;
+    fillSectionHeader(&sectionHeaders[5], 26, SHT_STRTAB, 0, 0, namesOffset, namesLen);
+    fillSectionHeader(&sectionHeaders[6], 34, SHT_STRTAB, 0, 0, sectionNamesOffset, sizeof(SECTION_NAMES));
+
+    unsigned long written = 0;
+    int ok = writeBlock(f, &written, &header, sizeof(header)) &&
+             writeBlock(f, &written, programHeaders, sizeof(programHeaders)) &&
+             writePadding(f, &written, TEXT_OFFSET) &&
+             writeBlock(f, &written, image->text, image->textLen) &&
+             writePadding(f, &written, dataOffset(image)) &&
+             writeBlock(f, &written, image->data, image->dataLen) &&
+             writePadding(f, &written, symbolsOffset) &&
+             writeBlock(f, &written, symbols, symbolsLen) &&
+             writeBlock(f, &written, names, namesLen) &&
+             writeBlock(f, &written, SECTION_NAMES, sizeof(SECTION_NAMES)) &&
+             writePadding(f, &written, sectionHeadersOffset) &&
+             writeBlock(f, &written, sectionHeaders, sizeof(sectionHeaders));
+    return ok ? SUCCESS : FAILURE;
+}
+
+/**
+ * @fn ReturnInfo writeExecutable(const ExecutableImage *image, const char *fileName)
+ * @brief Write a static executable, its sections having been laid out by layoutExecutable.
+ *
+ * @param image const ExecutableImage* Executable to write.
+ * @param fileName const char* Name of the file.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo writeExecutable(const ExecutableImage *image, const char *fileName)
+{
+    const SectionKind sectionIndexes[BSS_SECTION + 1] = {SHN_UNDEF, 1, 2, 3};
+    Elf64_Sym *symbols = calloc(image->nbSymbols + 1, sizeof(Elf64_Sym));
+    unsigned long namesLen = 1;
+    for (int i = 0; i < image->nbSymbols; i++)
+        namesLen += strlen(identToString(image->symbols[i].name)) + 1;
+    char *names = malloc(namesLen);
+    if (!symbols || !names)
+    {
+        free(symbols);
+        free(names);
+        return ALLOC_ERROR;
+    }
+
+    names[0] = '\0';
+    unsigned long nameOffset = 1;
+    for (int i = 0; i < image->nbSymbols; i++)
+    {
+        const ElfSymbol *symbol = &image->symbols[i];
+        const char *name = identToString(symbol->name);
+        int type = symbol->section == TEXT_SECTION ? STT_FUNC : STT_OBJECT;
+        symbols[i + 1].st_name = nameOffset;
+        symbols[i + 1].st_info = ELF64_ST_INFO(STB_LOCAL, strchr(name, '.') ? STT_NOTYPE : type);
+        symbols[i + 1].st_shndx = sectionIndexes[symbol->section];
+        symbols[i + 1].st_value = symbol->address;
+        strcpy(names + nameOffset, name);
+        nameOffset += strlen(name) + 1;
+    }
+
+    ReturnInfo info = COULD_NOT_OPEN_FILE;
+    FILE *f = fopen(fileName, "wb");
+    if (f)
+    {
+        info = writeElf(f, image, symbols, names, namesLen);
+        if (fclose(f) != 0)
+            info = FAILURE;
+        if (info == SUCCESS)
+            chmod(fileName, 0755);
+    }
+    free(symbols);
+    free(names);
+    return info;
+}
@@ -0,0 +1,237 @@
+/**
+ * @file emitter.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief In-memory buffer the assembly is emitted into before being written at once.
+ * @date 2024-02-10
+ *
+ * The writers append their lines to a growing buffer instead of calling
+ * fprintf for every instruction. Formatting only knows what the writers use
+ * (%d, %ld, %s, %c and %%) and converts integers by hand, so most lines cost
+ * a couple of memcpy. An allocation failure is remembered and reported by
+ * writeEmitted, so the emitting functions themselves never fail.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emitter.h"
+
+#define FIRST_CAPACITY 65536
+#define MAX_INT_LEN 20
+
+typedef struct Emitter
+{
+    char *text;
+    unsigned long len;
+    unsigned long capacity;
+    int failed;
+} Emitter;
+
+static Emitter emitter = {NULL, 0, 0, 0};
+
+/**
+ * @fn ReturnInfo startEmitter()
+ * @brief Empty the buffer, keeping its memory for the next emission.
+ *
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo startEmitter()
+{
+    emitter.len = 0;
+    emitter.failed = 0;
+    if (emitter.text)
+        return SUCCESS;
+
+    emitter.text = malloc(FIRST_CAPACITY);
+    if (!emitter.text)
+        return ALLOC_ERROR;
+    emitter.capacity = FIRST_CAPACITY;
+    return SUCCESS;
+}
+
+/**
+ * @fn int reserveBytes(unsigned long len)
+ * @brief Make room for len more bytes, doubling the capacity of the buffer as needed.
+ *
+ * @param len unsigned long Number of bytes about to be appended.
+ * @return int 1 if there is room, 0 if the buffer could not grow.
+ */
+int reserveBytes(unsigned long len)
+{
+    if (emitter.len + len <= emitter.capacity)
+        return 1;
+    if (emitter.failed)
+        return 0;
+
+    unsigned long capacity = emitter.capacity ? emitter.capacity : FIRST_CAPACITY;
+    while (capacity < emitter.len + len)
+        capacity *= 2;
+    char *text = realloc(emitter.text, capacity);
+    if (!text)
+    {
+        emitter.failed = 1;
+        return 0;
+    }
+    emitter.text = text;
+    emitter.capacity = capacity;
+    return 1;
+}
+
+/**
+ * @fn void emitBytes(const char *bytes, unsigned long len)
+ * @brief Append bytes to the buffer.
+ *
+ * @param bytes const char* Bytes to append.
+ * @param len unsigned long Number of bytes.
+ */
+void emitBytes(const char *bytes, unsigned long len)
+{
+    if (!reserveBytes(len))
+        return;
+    memcpy(emitter.text + emitter.len, bytes, len);
+    emitter.len += len;
+}
+
+/**
+ * @fn void emitStr(const char *str)
+ * @brief Append a string (a register, a label, an identifier...) to the buffer.
+ *
+ * @param str const char* String to append.
+ */
+void emitStr(const char *str)
+{
+    emitBytes(str, strlen(str));
+}
+
+/**
+ * @fn void emitInt(long value)
+ * @brief Append the decimal writing of an integer to the buffer.
+ *
+ * @param value long Integer to append.
+ */
+void emitInt(long value)
+{
+    char digits[MAX_INT_LEN + 1];
+    char *start = digits + sizeof(digits);
+    unsigned long magnitude = value < 0 ? -(unsigned long)value : (unsigned long)value;
+
+    do
+    {
+        *--start = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0)
+        *--start = '-';
+
+    emitBytes(start, digits + sizeof(digits) - start);
+}
+
+/**
+ * @fn void emit(const char *format, ...)
+ * @brief Append a formatted line to the buffer, like fprintf would.
+ * Only %d, %ld, %s, %c and %% are understood, which is all the writers use.
+ *
+ * @param format const char* Format of the line.
+ * @param ... Values of the format.
+ */
+void emit(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+
+    const char *chunk = format;
+    for (const char *c = format; *c; c++)
+    {
+        if (*c != '%')
+            continue;
+
+        emitBytes(chunk, c - chunk);
+        switch (*++c)
+        {
+        case 'd':
+            emitInt(va_arg(args, int));
+            break;
+        case 'l':
+            c++;
+            emitInt(va_arg(args, long));
+            break;
+        case 's':
+            emitStr(va_arg(args, const char *));
+            break;
+        case 'c':
+        {
+            char character = va_arg(args, int);
+            emitBytes(&character, 1);
+            break;
+        }
+        default:
+            emitBytes(c, 1);
+            break;
+        }
+        chunk = c + 1;
+    }
+    emitBytes(chunk, strlen(chunk));
+
+    va_end(args);
+}
+
+/**
+ * @fn const char *emittedText(unsigned long *len)
+ * @brief Get the text emitted since the last call to startEmitter.
+ * The text is not ended by '\0'.
+ *
+ * @param len unsigned long* Length of the text, filled.
+ * @return const char* Text emitted.
+ */
+const char *emittedText(unsigned long *len)
+{
+    if (len)
+        *len = emitter.len;
+    return emitter.text;
+}
+
+/**
+ * @fn void truncateEmitted(unsigned long len)
+ * @brief Drop the text emitted after the first len bytes, so it can be emitted again.
+ *
+ * @param len unsigned long Length of the text kept.
+ */
+void truncateEmitted(unsigned long len)
+{
+    if (len < emitter.len)
+        emitter.len = len;
+}
+
+/**
+ * @fn ReturnInfo writeEmitted(const char *fileName)
+ * @brief Write the whole buffer to a file with a single write.
+ *
+ * @param fileName const char* Name of the file.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo writeEmitted(const char *fileName)
+{
+    if (emitter.failed)
+        return ALLOC_ERROR;
+
+    FILE *f = fopen(fileName, "w");
+    if (!f)
+        return COULD_NOT_OPEN_FILE;
+
+    setvbuf(f, NULL, _IONBF, 0);
+    unsigned long written = fwrite(emitter.text, 1, emitter.len, f);
+    if (fclose(f) != 0 || written != emitter.len)
+        return FAILURE;
+    return SUCCESS;
+}
+
+/**
+ * @fn void freeEmitter()
+ * @brief Free the buffer.
+ */
+void freeEmitter()
+{
+    free(emitter.text);
+    emitter = (Emitter){NULL, 0, 0, 0};
+}
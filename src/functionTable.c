@@ -6,6 +6,7 @@
  */
 
 #include "functionTable.h"
+#include "hashIndex.h"
 #include "progTable.h"
 #include "symbolTable.h"
 #include "utilitaries.h"
@@ -21,7 +22,7 @@
  */
 FunctionTable createNewFunctionTable()
 {
-    FunctionTable t = {NULL, 0, 0};
+    FunctionTable t = {NULL, 0, 0, 0, createNewHashIndex()};
     return t;
 }
 
@@ -43,6 +44,7 @@ void freeFunctionTable(FunctionTable *t)
     }
     if (t->functions)
         free(t->functions);
+    freeHashIndex(&t->index);
 
     *t = createNewFunctionTable();
 }
@@ -61,7 +63,7 @@ ReturnInfo addRowOfFun(FunctionTable *t)
     if (!t)
         return NULL_ARGUMENT;
 
-    if (addCell((void **)&t->functions, t->len, sizeof(FunctionInfo)) != SUCCESS)
+    if (addCell((void **)&t->functions, t->len, &t->capacity, sizeof(FunctionInfo)) != SUCCESS)
         return ALLOC_ERROR;
 
     t->functions[t->len].args = createNewSymbolTable();
@@ -72,69 +74,61 @@ ReturnInfo addRowOfFun(FunctionTable *t)
 }
 
 /**
- * @fn ReturnInfo isFunctionInTable(FunctionTable t, char *id, int *index)
+ * @fn ReturnInfo isFunctionInTable(const FunctionTable *t, ident_t id, int *index)
  * @brief Check if a function is in a function table based on it's id.
  * 
- * @param t FunctionTable Table to check.
- * @param id char* Id of the function.
+ * @param t const FunctionTable* Table to check.
+ * @param id ident_t Id of the function.
  * @param index int* Index of the function in the table.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo isFunctionInTable(FunctionTable t, char *id, int *index)
+ReturnInfo isFunctionInTable(const FunctionTable *t, ident_t id, int *index)
 {
-    if (!id)
+    if (!t)
         return NULL_ARGUMENT;
-    for (int i = 0; i < t.len; i++)
-    {
-        if (!strcmp(t.functions[i].id, id))
-        {
-            if (index)
-                *index = i;
-            return ID_IN_TABLE;
-        }
-    }
+    int i = findInHashIndex(t->index, t->functions, sizeof(FunctionInfo), id);
     if (index)
-        *index = -1;
-    return ID_NOT_IN_TABLE;
+        *index = i;
+    return i == -1 ? ID_NOT_IN_TABLE : ID_IN_TABLE;
 }
 
 /**
- * @fn ReturnInfo getFunIdAndType(Node *declFun, char *id, char *type)
+ * @fn ReturnInfo getFunIdAndType(Node *declFun, ident_t *id, char *type)
  * @brief Get the function id and type from a function node.
  * 
  * @param declFun Node* Function node to get id and type from.
- * @param id char* Id of the function.
+ * @param id ident_t* Id of the function.
  * @param type char* Type of the function.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo getFunIdAndType(Node *declFun, char *id, char *type)
+ReturnInfo getFunIdAndType(Node *declFun, ident_t *id, char *type)
 {
-    if (!declFun || !declFun->firstChild || !id || !type)
+    if (!declFun || !FIRSTCHILD(declFun) || !id || !type)
         return NULL_ARGUMENT;
     if (declFun->label != DeclFonct)
         return NOT_A_FUNCTION;
 
-    Node *typeNode = declFun->firstChild;
+    Node *typeNode = FIRSTCHILD(declFun);
     int isVoid = typeNode->label == Void;
     if (typeNode->label != Type && !isVoid)
         return NOT_A_TYPE;
 
-    Node *idNode = isVoid ? typeNode->nextSibling : typeNode->firstChild;
-    strcpy(type, isVoid ? "void" : typeNode->u.ident);
-    strcpy(id, idNode->u.ident);
+    Node *idNode = isVoid ? NEXTSIBLING(typeNode) : FIRSTCHILD(typeNode);
+    strcpy(type, isVoid ? "void" : identToString(typeNode->u.ident));
+    *id = idNode->u.ident;
     return SUCCESS;
 }
 
 /**
- * @fn ReturnInfo addArgs(FunctionTable *t, Node *declFun, ProgTable pt)
+ * @fn ReturnInfo addArgs(FunctionTable *t, Node *declFun, const ProgTable *pt)
  * @brief Add the arguments of a function in a function table.
  * 
  * @param t FunctionTable* Function table to add arguments on.
  * @param declFun Node* Function node to get arguments from.
- * @param pt ProgTable Program table to get the type of the arguments.
+ * @param pt const ProgTable* Program table to get the type of the arguments.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo addArgs(FunctionTable *t, Node *declFun, ProgTable pt)
+ReturnInfo addArgs(FunctionTable *t, Node *declFun, const ProgTable *pt)
 {
     Node *paramList = getChildLabeled(declFun, ParamList);
 
@@ -143,7 +137,7 @@ ReturnInfo addArgs(FunctionTable *t, Node *declFun, ProgTable pt)
     if (declFun->label != DeclFonct)
         return NOT_A_FUNCTION;
 
-    if (paramList->firstChild->label != Void)
+    if (FIRSTCHILD(paramList)->label != Void)
     {
         ReturnInfo argsAdded = addListOfSymbol(&t->functions[t->len - 1].args, paramList, pt);
         if (argsAdded != SUCCESS)
@@ -154,15 +148,15 @@ ReturnInfo addArgs(FunctionTable *t, Node *declFun, ProgTable pt)
 }
 
 /**
- * @fn ReturnInfo addLocals(FunctionTable *t, Node *declFun, ProgTable pt)
+ * @fn ReturnInfo addLocals(FunctionTable *t, Node *declFun, const ProgTable *pt)
  * @brief Add the locals of a function in a function table.
  * 
  * @param t FunctionTable* Function table to add locals on.
  * @param declFun Node* Function node to get locals from.
- * @param pt ProgTable Program table to get the type of the locals.
+ * @param pt const ProgTable* Program table to get the type of the locals.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo addLocals(FunctionTable *t, Node *declFun, ProgTable pt)
+ReturnInfo addLocals(FunctionTable *t, Node *declFun, const ProgTable *pt)
 {
     Node *body = getChildLabeled(declFun, Body);
 
@@ -171,9 +165,9 @@ ReturnInfo addLocals(FunctionTable *t, Node *declFun, ProgTable pt)
     if (declFun->label != DeclFonct)
         return NOT_A_FUNCTION;
 
-    if (body && body->firstChild && body->firstChild->label == DeclVarsLocale)
+    if (body && FIRSTCHILD(body) && FIRSTCHILD(body)->label == DeclVarsLocale)
     {
-        ReturnInfo localsAdded = addListOfSymbol(&t->functions[t->len - 1].locals, body->firstChild, pt);
+        ReturnInfo localsAdded = addListOfSymbol(&t->functions[t->len - 1].locals, FIRSTCHILD(body), pt);
         if (localsAdded != SUCCESS)
             return localsAdded;
     }
@@ -221,15 +215,15 @@ ReturnInfo assignAddress(FunctionTable *t)
 }
 
 /**
- * @fn ReturnInfo addFunction(FunctionTable *t, Node *node, ProgTable pt)
+ * @fn ReturnInfo addFunction(FunctionTable *t, Node *node, const ProgTable *pt)
  * @brief Add a function in a function table.
  * 
  * @param t FunctionTable* Function table to add function on.
  * @param node Node* Function node to add function from.
- * @param pt ProgTable Program table to get the type of the function.
+ * @param pt const ProgTable* Program table to get the type of the function.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo addFunction(FunctionTable *t, Node *node, ProgTable pt)
+ReturnInfo addFunction(FunctionTable *t, Node *node, const ProgTable *pt)
 {
     if (!t || !node)
         return NULL_ARGUMENT;
@@ -237,15 +231,16 @@ ReturnInfo addFunction(FunctionTable *t, Node *node, ProgTable pt)
     if (node->label != DeclFonct)
         return NOT_A_FUNCTION;
 
-    char id[SIZE_ID], type[SIZE_ID];
-    ReturnInfo info = getFunIdAndType(node, id, type);
+    ident_t id;
+    char type[SIZE_ID];
+    ReturnInfo info = getFunIdAndType(node, &id, type);
     if (info != SUCCESS)
         return info;
 
-    ReturnInfo inTable = isFunctionInTable(*t, id, NULL);
-    if (inTable != ID_NOT_IN_TABLE || isInTable(pt.glob, id, NULL) != ID_NOT_IN_TABLE)
+    ReturnInfo inTable = isFunctionInTable(t, id, NULL);
+    if (inTable != ID_NOT_IN_TABLE || isInTable(&pt->glob, id, NULL) != ID_NOT_IN_TABLE)
     {
-        fprintf(stderr, "Function %s is redefined here %d.\n", id, node->lineno);
+        fprintf(stderr, "Function %s is redefined here %d.\n", identToString(id), node->lineno);
         return inTable;
     }
 
@@ -253,9 +248,13 @@ ReturnInfo addFunction(FunctionTable *t, Node *node, ProgTable pt)
     if (rowAdded != SUCCESS)
         return rowAdded;
 
-    sprintf(t->functions[t->len - 1].id, "%s", id);
+    t->functions[t->len - 1].id = id;
     t->functions[t->len - 1].type = getType(type);
 
+    ReturnInfo indexed = addToHashIndex(&t->index, t->functions, sizeof(FunctionInfo), t->len);
+    if (indexed != SUCCESS)
+        return indexed;
+
     ReturnInfo argsAdded = addArgs(t, node, pt);
     if (argsAdded != SUCCESS)
         return argsAdded;
@@ -288,7 +287,7 @@ int getLengthOfLongestFunId(FunctionTable t)
     int l = 0;
     for (int i = 0; i < t.len; i++)
     {
-        l = strlen(t.functions[i].id);
+        l = strlen(identToString(t.functions[i].id));
         max = max < l ? l : max;
     }
     return max;
@@ -331,9 +330,10 @@ void printFunctionTable(FunctionTable t)
         char addressStr[4];
         sprintf(addressStr, "%d", t.functions[i].address);
 
+        const char *id = identToString(t.functions[i].id);
         printTableLine(columnLength, 5);
-        fprintf(stdout, "| %s%*s| %s%*s| %s%*s| %s%*s| %s%*s|\n", t.functions[i].id,
-                (int)(columnLength[0] - strlen(t.functions[i].id)) - 1, " ", typeStr,
+        fprintf(stdout, "| %s%*s| %s%*s| %s%*s| %s%*s| %s%*s|\n", id,
+                (int)(columnLength[0] - strlen(id)) - 1, " ", typeStr,
                 (int)(columnLength[1] - strlen(typeStr)) - 1, " ", nbArgs,
                 (int)(columnLength[2] - strlen(nbArgs)) - 1, " ", nbLocal,
                 (int)(columnLength[3] - strlen(nbLocal)) - 1, " ", addressStr,
@@ -350,7 +350,7 @@ void printFunctionTable(FunctionTable t)
  */
 void printOneFunction(FunctionInfo fun)
 {
-    fprintf(stdout, "Function shown: %s\n", fun.id);
+    fprintf(stdout, "Function shown: %s\n", identToString(fun.id));
     fprintf(stdout, "Argument:\n");
     printSymbolTable(fun.args);
     fprintf(stdout, "\n");
@@ -363,24 +363,24 @@ void printOneFunction(FunctionInfo fun)
  * --------------------------- */
 
 /**
- * @fn ReturnInfo addFunctions(FunctionTable *t, Node *root, ProgTable pt)
+ * @fn ReturnInfo addFunctions(FunctionTable *t, Node *root, const ProgTable *pt)
  * @brief Add functions in a function table.
  * 
  * @param t FunctionTable* Function table to add functions on.
  * @param root Node* Root of the tree to add functions from.
- * @param pt ProgTable Program table to get the type of the functions.
+ * @param pt const ProgTable* Program table to get the type of the functions.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo addFunctions(FunctionTable *t, Node *root, ProgTable pt)
+ReturnInfo addFunctions(FunctionTable *t, Node *root, const ProgTable *pt)
 {
-    if (!t || !root || !root->firstChild)
+    if (!t || !root || !FIRSTCHILD(root))
         return NULL_ARGUMENT;
 
-    Node *child = root->firstChild;
+    Node *child = FIRSTCHILD(root);
     while (child && child->label != DeclFonct)
-        child = child->nextSibling;
+        child = NEXTSIBLING(child);
 
-    for (; child != NULL; child = child->nextSibling)
+    for (; child != NULL; child = NEXTSIBLING(child))
     {
         ReturnInfo added = addFunction(t, child, pt);
         if (added != SUCCESS)
@@ -400,9 +400,9 @@ ReturnInfo addFunctions(FunctionTable *t, Node *root, ProgTable pt)
  */
 ReturnInfo setupFunction(FunctionTable *t, char *id, char *type)
 {
-    sprintf(t->functions[t->len - 1].id, "%s", id);
+    t->functions[t->len - 1].id = internString(id);
     t->functions[t->len - 1].type = getType(type);
-    return SUCCESS;
+    return addToHashIndex(&t->index, t->functions, sizeof(FunctionInfo), t->len);
 }
 
 /**
@@ -0,0 +1,179 @@
+/**
+ * @file hashIndex.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Open-addressing index over the id of the entries of a table.
+ * @date 2024-02-10
+ *
+ * The index only stores positions in the indexed array, so the array itself
+ * (its order and the addresses of its entries) is left untouched. Every
+ * indexed entry must start with its interned id (ident_t), like Symbol and
+ * FunctionInfo do.
+ */
+
+#include "hashIndex.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define EMPTY_SLOT -1
+#define FIRST_CAPACITY 16
+
+/**
+ * @fn HashIndex createNewHashIndex()
+ * @brief Create a new empty hash index.
+ *
+ * @return HashIndex New hash index.
+ */
+HashIndex createNewHashIndex()
+{
+    HashIndex h = {NULL, 0};
+    return h;
+}
+
+/**
+ * @fn void freeHashIndex(HashIndex *h)
+ * @brief Free a hash index.
+ *
+ * @param h HashIndex* Hash index to free.
+ */
+void freeHashIndex(HashIndex *h)
+{
+    if (!h)
+        return;
+    if (h->slots)
+        free(h->slots);
+
+    *h = createNewHashIndex();
+}
+
+/**
+ * @fn unsigned int hashString(const char *str, int len)
+ * @brief Hash a string (FNV-1a), the hash used by the index and by the interner.
+ *
+ * @param str const char* String to hash.
+ * @param len int Length of the string.
+ * @return unsigned int Hash of the string.
+ */
+unsigned int hashString(const char *str, int len)
+{
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < len; i++)
+        hash = (hash ^ (unsigned char)str[i]) * 16777619u;
+    return hash;
+}
+
+/**
+ * @fn unsigned int hashId(ident_t id)
+ * @brief Hash an id, through the bytes of its value.
+ *
+ * @param id ident_t Id to hash.
+ * @return unsigned int Hash of the id.
+ */
+unsigned int hashId(ident_t id)
+{
+    return hashString((const char *)&id, sizeof(id));
+}
+
+/**
+ * @fn ident_t entryId(const void *entries, unsigned long stride, int index)
+ * @brief Get the id of an entry of the indexed array.
+ *
+ * @param entries const void* Indexed array.
+ * @param stride unsigned long Size of an entry.
+ * @param index int Index of the entry.
+ * @return ident_t Id of the entry.
+ */
+ident_t entryId(const void *entries, unsigned long stride, int index)
+{
+    return *(const ident_t *)((const char *)entries + stride * index);
+}
+
+/**
+ * @fn void putInSlot(HashIndex *h, const void *entries, unsigned long stride, int index)
+ * @brief Put an entry in the first free slot of its probe sequence.
+ *
+ * @param h HashIndex* Hash index to put the entry on.
+ * @param entries const void* Indexed array.
+ * @param stride unsigned long Size of an entry.
+ * @param index int Index of the entry.
+ */
+void putInSlot(HashIndex *h, const void *entries, unsigned long stride, int index)
+{
+    unsigned int mask = h->capacity - 1;
+    unsigned int slot = hashId(entryId(entries, stride, index)) & mask;
+    while (h->slots[slot] != EMPTY_SLOT)
+        slot = (slot + 1) & mask;
+    h->slots[slot] = index;
+}
+
+/**
+ * @fn ReturnInfo growHashIndex(HashIndex *h, const void *entries, unsigned long stride, int len)
+ * @brief Double the capacity of a hash index and re-index the entries already in it.
+ *
+ * @param h HashIndex* Hash index to grow.
+ * @param entries const void* Indexed array.
+ * @param stride unsigned long Size of an entry.
+ * @param len int Number of entries already indexed.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo growHashIndex(HashIndex *h, const void *entries, unsigned long stride, int len)
+{
+    int capacity = h->capacity ? h->capacity * 2 : FIRST_CAPACITY;
+    int *slots = malloc(capacity * sizeof(int));
+    if (!slots)
+        return ALLOC_ERROR;
+    memset(slots, EMPTY_SLOT, capacity * sizeof(int));
+
+    free(h->slots);
+    h->slots = slots;
+    h->capacity = capacity;
+    for (int i = 0; i < len; i++)
+        putInSlot(h, entries, stride, i);
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo addToHashIndex(HashIndex *h, const void *entries, unsigned long stride, int len)
+ * @brief Index the last entry of an array (the one at len - 1).
+ *
+ * @param h HashIndex* Hash index to add the entry on.
+ * @param entries const void* Indexed array.
+ * @param stride unsigned long Size of an entry.
+ * @param len int Length of the array, last entry included.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo addToHashIndex(HashIndex *h, const void *entries, unsigned long stride, int len)
+{
+    if (!h || !entries || len <= 0)
+        return NULL_ARGUMENT;
+
+    // Keep the load factor under 1/2 so probe sequences stay short.
+    if (len * 2 > h->capacity)
+        return growHashIndex(h, entries, stride, len);
+
+    putInSlot(h, entries, stride, len - 1);
+    return SUCCESS;
+}
+
+/**
+ * @fn int findInHashIndex(HashIndex h, const void *entries, unsigned long stride, ident_t id)
+ * @brief Find the index of an entry based on its id.
+ *
+ * @param h HashIndex Hash index to search in.
+ * @param entries const void* Indexed array.
+ * @param stride unsigned long Size of an entry.
+ * @param id ident_t Id to find.
+ * @return int Index of the entry in the array, -1 if not found.
+ */
+int findInHashIndex(HashIndex h, const void *entries, unsigned long stride, ident_t id)
+{
+    if (!h.capacity)
+        return -1;
+
+    unsigned int mask = h.capacity - 1;
+    for (unsigned int slot = hashId(id) & mask; h.slots[slot] != EMPTY_SLOT; slot = (slot + 1) & mask)
+    {
+        if (entryId(entries, stride, h.slots[slot]) == id)
+            return h.slots[slot];
+    }
+    return -1;
+}
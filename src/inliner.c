@@ -0,0 +1,363 @@
+/**
+ * @file inliner.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Inlining of the calls to small functions of the program.
+ * @date 2024-02-10
+ *
+ * A call to a function of the program which is not recursive, even through
+ * other functions, and whose code is not longer than the limit is replaced by a copy of that code. The
+ * parameters of the copy are set from the arguments, its returns go to the end
+ * of the copy, and its variables, temporaries, labels and local arrays are
+ * renumbered into the ones of the caller. The variables of the copy stay
+ * variables of the caller, numbered before its temporaries.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "inliner.h"
+#include "utilitaries.h"
+
+/**
+ * @fn IrFunction *findIrFunction(IrProgram *prog, ident_t id)
+ * @brief Find the lowered function of an identifier.
+ *
+ * @param prog IrProgram* Lowered program.
+ * @param id ident_t Identifier of the function.
+ * @return IrFunction* Function, NULL for a function of the runtime.
+ */
+IrFunction *findIrFunction(IrProgram *prog, ident_t id)
+{
+    for (int i = 0; i < prog->len; i++)
+        if (prog->functions[i].fun->id == id)
+            return &prog->functions[i];
+    return NULL;
+}
+
+/**
+ * @fn int inlineCost(const IrFunction *ir)
+ * @brief Get the size of the code a function would add to its callers, its parameters and labels excepted.
+ *
+ * @param ir const IrFunction* Function.
+ * @return int Number of instructions.
+ */
+int inlineCost(const IrFunction *ir)
+{
+    int cost = 0;
+    for (int pos = 0; pos < ir->len; pos++)
+        cost += ir->instrs[pos].op != IR_PARAM && ir->instrs[pos].op != IR_LABEL;
+    return cost;
+}
+
+/**
+ * @fn int reachesFunction(IrProgram *prog, IrFunction *from, const IrFunction *target, char *visited)
+ * @brief Tell if a function calls another one, directly or through the functions it calls.
+ *
+ * @param prog IrProgram* Lowered program.
+ * @param from IrFunction* Function whose calls are followed.
+ * @param target const IrFunction* Function looked for.
+ * @param visited char* 1 for each function of the program already followed, updated.
+ * @return int 1 if it does, 0 otherwise.
+ */
+int reachesFunction(IrProgram *prog, IrFunction *from, const IrFunction *target, char *visited)
+{
+    visited[from - prog->functions] = 1;
+    for (int pos = 0; pos < from->len; pos++)
+    {
+        IrFunction *callee = from->instrs[pos].op == IR_CALL ? findIrFunction(prog, from->instrs[pos].symbol) : NULL;
+        if (callee == target)
+            return 1;
+        if (callee && !visited[callee - prog->functions] && reachesFunction(prog, callee, target, visited))
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @fn ReturnInfo findRecursiveFunctions(IrProgram *prog, char **recursive)
+ * @brief Find the functions of a program which call themselves, directly or through other functions.
+ * Inlining a function which is not one of them never makes another one recursive.
+ *
+ * @param prog IrProgram* Lowered program.
+ * @param recursive char** 1 for each recursive function, in the order of the program, filled with an allocated array.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo findRecursiveFunctions(IrProgram *prog, char **recursive)
+{
+    *recursive = calloc(prog->len + 1, 1);
+    char *visited = malloc(prog->len + 1);
+    if (!*recursive || !visited)
+    {
+        free(*recursive);
+        free(visited);
+        return ALLOC_ERROR;
+    }
+    for (int i = 0; i < prog->len; i++)
+    {
+        memset(visited, 0, prog->len);
+        (*recursive)[i] = reachesFunction(prog, &prog->functions[i], &prog->functions[i], visited);
+    }
+    free(visited);
+    return SUCCESS;
+}
+
+/**
+ * @fn int isInlinable(const IrProgram *prog, const IrFunction *caller, const IrFunction *callee, const char *recursive, int limit)
+ * @brief Tell if a function may be inlined: a small function of the program which is not recursive,
+ * so the calls of a recursion, which may be tail calls, are kept.
+ *
+ * @param prog const IrProgram* Lowered program.
+ * @param caller const IrFunction* Function calling.
+ * @param callee const IrFunction* Function called, NULL for a function of the runtime.
+ * @param recursive const char* 1 for each recursive function, see findRecursiveFunctions.
+ * @param limit int Maximum cost of an inlined function.
+ * @return int 1 if it may be inlined, 0 otherwise.
+ */
+int isInlinable(const IrProgram *prog, const IrFunction *caller, const IrFunction *callee, const char *recursive, int limit)
+{
+    return callee && callee != caller && !recursive[callee - prog->functions] && inlineCost(callee) <= limit;
+}
+
+/**
+ * @fn int returnsAtEnd(const IrFunction *callee)
+ * @brief Tell if the only return of a function is its last instruction, the copy then falling into the caller.
+ *
+ * @param callee const IrFunction* Function.
+ * @return int 1 if so, 0 otherwise.
+ */
+int returnsAtEnd(const IrFunction *callee)
+{
+    for (int pos = 0; pos < callee->len - 1; pos++)
+        if (callee->instrs[pos].op == IR_RET)
+            return 0;
+    return 1;
+}
+
+/**
+ * @fn int inlinedVariables(const IrInstr *call, const IrFunction *callee)
+ * @brief Get the number of variables the copy of a function needs in its caller,
+ * its returned value being one of them when set by several returns.
+ *
+ * @param call const IrInstr* Call inlined.
+ * @param callee const IrFunction* Function called.
+ * @return int Number of variables.
+ */
+int inlinedVariables(const IrInstr *call, const IrFunction *callee)
+{
+    return callee->nbVariables + (call->dst != NO_VREG && !returnsAtEnd(callee));
+}
+
+/**
+ * @fn void shiftTemporaries(IrFunction *ir, int nb)
+ * @brief Make room for new variables by renumbering the temporaries of a function after them.
+ *
+ * @param ir IrFunction* Function changed.
+ * @param nb int Number of new variables.
+ */
+void shiftTemporaries(IrFunction *ir, int nb)
+{
+    for (int pos = 0; pos < ir->len; pos++)
+    {
+        vreg_t *slots[3];
+        int nbSlots = getIrOperandSlots(&ir->instrs[pos], slots);
+        for (int i = 0; i < nbSlots; i++)
+            if (*slots[i] >= ir->nbVariables)
+                *slots[i] += nb;
+        if (ir->instrs[pos].dst >= ir->nbVariables)
+            ir->instrs[pos].dst += nb;
+    }
+    for (int i = 0; i < ir->nbCallArgs; i++)
+        if (ir->callArgs[i] >= ir->nbVariables)
+            ir->callArgs[i] += nb;
+    ir->nbVariables += nb;
+    ir->nbVregs += nb;
+}
+
+/* ------- Copy of a function -------- */
+
+/* Numbering of the copy of a function in its caller */
+typedef struct _renaming
+{
+    const IrFunction *callee;
+    vreg_t variables;   /* Variable of the caller given to the first variable of the callee */
+    vreg_t temporaries; /* Virtual register of the caller given to the first temporary of the callee */
+    int labels;         /* Label of the caller given to the first label of the callee */
+    int frame;          /* Offset of the local arrays of the callee in the frame of the caller */
+} Renaming;
+
+/**
+ * @fn vreg_t renameVreg(const Renaming *r, vreg_t v)
+ * @brief Get the virtual register of the caller given to one of the callee.
+ *
+ * @param r const Renaming* Numbering of the copy.
+ * @param v vreg_t Virtual register of the callee, may be NO_VREG.
+ * @return vreg_t Virtual register of the caller.
+ */
+vreg_t renameVreg(const Renaming *r, vreg_t v)
+{
+    if (v == NO_VREG)
+        return NO_VREG;
+    if (v < r->callee->nbVariables)
+        return r->variables + v;
+    return r->temporaries + v - r->callee->nbVariables;
+}
+
+/**
+ * @fn ReturnInfo copyInstr(IrFunction *caller, const Renaming *r, IrInstr instr)
+ * @brief Append to the caller an instruction of the callee, renumbered.
+ *
+ * @param caller IrFunction* Function the call is inlined into.
+ * @param r const Renaming* Numbering of the copy.
+ * @param instr IrInstr Instruction of the callee.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo copyInstr(IrFunction *caller, const Renaming *r, IrInstr instr)
+{
+    if (instr.op == IR_CALL)
+    {
+        /* The arguments are listed again in the caller, their slots being renumbered too */
+        int first = caller->nbCallArgs;
+        for (int i = 0; i < instr.imm; i++)
+        {
+            ReturnInfo info = addCell((void **)&caller->callArgs, caller->nbCallArgs, &caller->callArgsCapacity, sizeof(vreg_t));
+            if (info != SUCCESS)
+                return info;
+            caller->callArgs[caller->nbCallArgs++] = renameVreg(r, r->callee->callArgs[instr.a + i]);
+        }
+        instr.a = first;
+    }
+    else
+    {
+        vreg_t *slots[3];
+        int nb = getIrOperandSlots(&instr, slots);
+        for (int i = 0; i < nb; i++)
+            *slots[i] = renameVreg(r, *slots[i]);
+    }
+
+    instr.dst = renameVreg(r, instr.dst);
+    if (instr.op == IR_LABEL || instr.op == IR_JUMP || IS_CONDITIONAL_JUMP(instr.op))
+        instr.imm += r->labels;
+    else if ((instr.op == IR_ADDR || instr.op == IR_LOAD || instr.op == IR_STORE) && instr.base == FRAME_BASE)
+        instr.imm -= r->frame;
+    return appendIr(caller, instr);
+}
+
+/**
+ * @fn ReturnInfo inlineCall(IrFunction *caller, const IrInstr *call, const IrFunction *callee, vreg_t variables)
+ * @brief Append to the caller a copy of the function called instead of the call.
+ *
+ * @param caller IrFunction* Function the call is inlined into.
+ * @param call const IrInstr* Call inlined.
+ * @param callee const IrFunction* Function called.
+ * @param variables vreg_t First of the variables kept for the copy, as many as inlinedVariables gives.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo inlineCall(IrFunction *caller, const IrInstr *call, const IrFunction *callee, vreg_t variables)
+{
+    Renaming r = {callee, variables, caller->nbVregs, caller->nbLabels, (caller->frameSize + 7) / 8 * 8};
+    int fallsThrough = returnsAtEnd(callee);
+    vreg_t value = fallsThrough ? call->dst : variables + callee->nbVariables;
+    int endLabel = caller->nbLabels + callee->nbLabels;
+    caller->nbVregs += callee->nbVregs - callee->nbVariables;
+    caller->nbLabels = endLabel + 1;
+    caller->frameSize = r.frame + callee->frameSize;
+
+    for (int pos = 0; pos < callee->len; pos++)
+    {
+        const IrInstr *instr = &callee->instrs[pos];
+        ReturnInfo info = SUCCESS;
+        if (instr->op == IR_PARAM)
+            info = appendIr(caller, makeIr(IR_COPY, renameVreg(&r, instr->dst), caller->callArgs[call->a + instr->imm], NO_VREG, 0));
+        else if (instr->op == IR_RET)
+        {
+            // a function falling off its end returns no value, its result being then 0
+            if (call->dst != NO_VREG && instr->a == NO_VREG)
+                info = appendIr(caller, makeIr(IR_CONST, value, NO_VREG, NO_VREG, 0));
+            else if (call->dst != NO_VREG)
+                info = appendIr(caller, makeIr(IR_COPY, value, renameVreg(&r, instr->a), NO_VREG, 0));
+            if (info == SUCCESS && !fallsThrough)
+                info = appendIr(caller, makeIr(IR_JUMP, NO_VREG, NO_VREG, NO_VREG, endLabel));
+        }
+        else
+            info = copyInstr(caller, &r, *instr);
+        if (info != SUCCESS)
+            return info;
+    }
+
+    if (fallsThrough)
+        return SUCCESS;
+    ReturnInfo info = appendIr(caller, makeIr(IR_LABEL, NO_VREG, NO_VREG, NO_VREG, endLabel));
+    if (info == SUCCESS && call->dst != NO_VREG)
+        info = appendIr(caller, makeIr(IR_COPY, call->dst, value, NO_VREG, 0));
+    return info;
+}
+
+/**
+ * @fn ReturnInfo inlineCallsOf(IrProgram *prog, IrFunction *caller, const char *recursive, int limit)
+ * @brief Inline the calls of a function to the functions small enough, then build its graph again.
+ * The calls coming from the inlined code are left as they are.
+ *
+ * @param prog IrProgram* Lowered program.
+ * @param caller IrFunction* Function whose calls are inlined.
+ * @param recursive const char* 1 for each recursive function, see findRecursiveFunctions.
+ * @param limit int Maximum cost of an inlined function.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo inlineCallsOf(IrProgram *prog, IrFunction *caller, const char *recursive, int limit)
+{
+    int nbVariables = 0;
+    for (int pos = 0; pos < caller->len; pos++)
+    {
+        const IrInstr *instr = &caller->instrs[pos];
+        if (instr->op == IR_CALL && isInlinable(prog, caller, findIrFunction(prog, instr->symbol), recursive, limit))
+            nbVariables += inlinedVariables(instr, findIrFunction(prog, instr->symbol));
+    }
+    if (!nbVariables)
+        return SUCCESS;
+
+    vreg_t variables = caller->nbVariables;
+    shiftTemporaries(caller, nbVariables);
+
+    /* The code is built again, the instructions before a call being kept as they are */
+    IrInstr *instrs = caller->instrs;
+    int len = caller->len;
+    caller->instrs = NULL;
+    caller->len = caller->capacity = 0;
+
+    ReturnInfo info = SUCCESS;
+    for (int pos = 0; pos < len && info == SUCCESS; pos++)
+    {
+        IrFunction *callee = instrs[pos].op == IR_CALL ? findIrFunction(prog, instrs[pos].symbol) : NULL;
+        if (callee && isInlinable(prog, caller, callee, recursive, limit))
+        {
+            info = inlineCall(caller, &instrs[pos], callee, variables);
+            variables += inlinedVariables(&instrs[pos], callee);
+        }
+        else
+            info = appendIr(caller, instrs[pos]);
+    }
+
+    free(instrs);
+    if (info != SUCCESS)
+        return info;
+    return buildCfg(caller);
+}
+
+/**
+ * @fn ReturnInfo inlineCalls(IrProgram *prog, int limit)
+ * @brief Inline the calls to the small functions of a program, in the order of the functions.
+ *
+ * @param prog IrProgram* Lowered program.
+ * @param limit int Maximum cost of an inlined function, 0 inlining nothing.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo inlineCalls(IrProgram *prog, int limit)
+{
+    if (limit <= 0)
+        return SUCCESS;
+    char *recursive;
+    ReturnInfo info = findRecursiveFunctions(prog, &recursive);
+    for (int i = 0; i < prog->len && info == SUCCESS; i++)
+        info = inlineCallsOf(prog, &prog->functions[i], recursive, limit);
+    free(recursive);
+    return info;
+}
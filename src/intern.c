@@ -0,0 +1,206 @@
+/**
+ * @file intern.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief String interner: every identifier is stored once and referred to by its id.
+ * @date 2024-02-10
+ *
+ * The characters of every string are kept back to back in chunks that never
+ * move, and an open-addressing table maps them to their id, so interning
+ * costs one hash of the lexeme and later comparisons are integer comparisons.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+#include "hashIndex.h"
+
+#define EMPTY_SLOT -1
+#define FIRST_CAPACITY 256
+#define STRING_CHUNK_SIZE 65536
+
+typedef struct StringChunk
+{
+    struct StringChunk *next;
+    int used;
+    int capacity;
+    char chars[];
+} StringChunk;
+
+typedef struct Interner
+{
+    StringChunk *pool;    /* Characters of the strings, each one ended by '\0' */
+    const char **strings; /* String of each id */
+    int len;
+    int capacity;
+    int *slots;           /* Open-addressing table of ids */
+    int slotsCapacity;
+} Interner;
+
+static Interner interner = {NULL, NULL, 0, 0, NULL, 0};
+
+/**
+ * @fn void *growOrDie(void *arr, int *capacity, int needed, unsigned long size)
+ * @brief Double the capacity of an array until it can hold the needed cells.
+ *
+ * @param arr void* Array to grow.
+ * @param capacity int* Capacity of the array, updated.
+ * @param needed int Number of cells needed.
+ * @param size unsigned long Size of a cell.
+ * @return void* Array grown.
+ */
+void *growOrDie(void *arr, int *capacity, int needed, unsigned long size)
+{
+    if (needed <= *capacity)
+        return arr;
+    int newCapacity = *capacity ? *capacity : FIRST_CAPACITY;
+    while (newCapacity < needed)
+        newCapacity *= 2;
+    arr = realloc(arr, newCapacity * size);
+    if (!arr)
+    {
+        fprintf(stderr, "Ran out of memory\n");
+        exit(2);
+    }
+    *capacity = newCapacity;
+    return arr;
+}
+
+/**
+ * @fn void putIdInSlot(ident_t id)
+ * @brief Put an id in the first free slot of its probe sequence.
+ *
+ * @param id ident_t Id to put.
+ */
+void putIdInSlot(ident_t id)
+{
+    const char *str = interner.strings[id];
+    unsigned int mask = interner.slotsCapacity - 1;
+    unsigned int slot = hashString(str, strlen(str)) & mask;
+    while (interner.slots[slot] != EMPTY_SLOT)
+        slot = (slot + 1) & mask;
+    interner.slots[slot] = id;
+}
+
+/**
+ * @fn void rehashInterner()
+ * @brief Double the table of ids and put every id back in it.
+ */
+void rehashInterner()
+{
+    int capacity = interner.slotsCapacity ? interner.slotsCapacity * 2 : FIRST_CAPACITY;
+    free(interner.slots);
+    interner.slotsCapacity = 0;
+    interner.slots = growOrDie(NULL, &interner.slotsCapacity, capacity, sizeof(int));
+    memset(interner.slots, EMPTY_SLOT, interner.slotsCapacity * sizeof(int));
+    for (ident_t id = 0; id < interner.len; id++)
+        putIdInSlot(id);
+}
+
+/**
+ * @fn ident_t addString(const char *str, int len)
+ * @brief Add a string which is not interned yet.
+ *
+ * @param str const char* String to add.
+ * @param len int Length of the string.
+ * @return ident_t Id of the string.
+ */
+ident_t addString(const char *str, int len)
+{
+    if (!interner.pool || interner.pool->used + len + 1 > interner.pool->capacity)
+    {
+        int capacity = len + 1 > STRING_CHUNK_SIZE ? len + 1 : STRING_CHUNK_SIZE;
+        StringChunk *chunk = malloc(sizeof(StringChunk) + capacity);
+        if (!chunk)
+        {
+            fprintf(stderr, "Ran out of memory\n");
+            exit(2);
+        }
+        chunk->next = interner.pool;
+        chunk->used = 0;
+        chunk->capacity = capacity;
+        interner.pool = chunk;
+    }
+    interner.strings = growOrDie(interner.strings, &interner.capacity, interner.len + 1, sizeof(char *));
+
+    char *copy = interner.pool->chars + interner.pool->used;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    interner.pool->used += len + 1;
+    interner.strings[interner.len] = copy;
+
+    ident_t id = interner.len++;
+    // Keep the load factor under 1/2 so probe sequences stay short.
+    if (interner.len * 2 > interner.slotsCapacity)
+        rehashInterner();
+    else
+        putIdInSlot(id);
+    return id;
+}
+
+/**
+ * @fn ident_t internLexeme(const char *str, int len)
+ * @brief Get the id of the len first characters of a string, interning them on their first occurrence.
+ * The empty string is always interned first, so its id is NO_IDENT.
+ *
+ * @param str const char* Characters to intern, not necessarily ended by '\0'.
+ * @param len int Number of characters.
+ * @return ident_t Id of the string.
+ */
+ident_t internLexeme(const char *str, int len)
+{
+    if (!interner.len)
+        addString("", 0);
+
+    unsigned int mask = interner.slotsCapacity - 1;
+    for (unsigned int slot = hashString(str, len) & mask; interner.slots[slot] != EMPTY_SLOT; slot = (slot + 1) & mask)
+    {
+        const char *candidate = interner.strings[interner.slots[slot]];
+        if (!strncmp(candidate, str, len) && candidate[len] == '\0')
+            return interner.slots[slot];
+    }
+    return addString(str, len);
+}
+
+/**
+ * @fn ident_t internString(const char *str)
+ * @brief Get the id of a string, interning it on its first occurrence.
+ *
+ * @param str const char* String to intern.
+ * @return ident_t Id of the string.
+ */
+ident_t internString(const char *str)
+{
+    return internLexeme(str, strlen(str));
+}
+
+/**
+ * @fn const char *identToString(ident_t id)
+ * @brief Get the string of an interned id.
+ *
+ * @param id ident_t Id of the string.
+ * @return const char* String of the id.
+ */
+const char *identToString(ident_t id)
+{
+    if (id <= NO_IDENT || id >= interner.len)
+        return "";
+    return interner.strings[id];
+}
+
+/**
+ * @fn void resetInterner()
+ * @brief Release every interned string at once.
+ */
+void resetInterner()
+{
+    while (interner.pool)
+    {
+        StringChunk *next = interner.pool->next;
+        free(interner.pool);
+        interner.pool = next;
+    }
+    free(interner.strings);
+    free(interner.slots);
+    interner = (Interner){NULL, NULL, 0, 0, NULL, 0};
+}
@@ -0,0 +1,986 @@
+/**
+ * @file ir.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Lowering of the tree of a function into three-address code on virtual registers.
+ * @date 2024-02-10
+ *
+ * Every expression is computed into a fresh virtual register, scalar locals and
+ * parameters being virtual registers themselves. Only arrays and globals stay in
+ * memory. The register allocator then decides which virtual registers live in a
+ * machine register and which ones are spilled to the frame.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cfg.h"
+#include "utilitaries.h"
+
+static const ProgTable *pt;
+static vreg_t nextResult; /* Next variable kept for the value of an and or an or */
+
+ReturnInfo lowerExpression(IrFunction *ir, Node *exp, vreg_t *result);
+ReturnInfo lowerInstr(IrFunction *ir, Node *instr);
+ReturnInfo lowerShortCircuit(IrFunction *ir, Node *exp, vreg_t *result);
+
+/**
+ * @fn ReturnInfo appendIr(IrFunction *ir, IrInstr instr)
+ * @brief Append an instruction to the code of the function.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param instr IrInstr Instruction to append.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo appendIr(IrFunction *ir, IrInstr instr)
+{
+    ReturnInfo info = addCell((void **)&ir->instrs, ir->len, &ir->capacity, sizeof(IrInstr));
+    if (info != SUCCESS)
+        return info;
+    ir->instrs[ir->len++] = instr;
+    return SUCCESS;
+}
+
+/**
+ * @fn IrInstr makeIr(IrOp op, vreg_t dst, vreg_t a, vreg_t b, long imm)
+ * @brief Make an instruction without memory operand.
+ *
+ * @param op IrOp Operation.
+ * @param dst vreg_t Virtual register written, NO_VREG if none.
+ * @param a vreg_t First operand, NO_VREG if none.
+ * @param b vreg_t Second operand, NO_VREG if none.
+ * @param imm long Constant, label or parameter number of the instruction.
+ * @return IrInstr Instruction made.
+ */
+IrInstr makeIr(IrOp op, vreg_t dst, vreg_t a, vreg_t b, long imm)
+{
+    return (IrInstr){op, 8, NO_BASE, dst, a, b, NO_VREG, NO_IDENT, imm};
+}
+
+/**
+ * @fn vreg_t newVreg(IrFunction *ir)
+ * @brief Get a new temporary virtual register.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @return vreg_t Virtual register.
+ */
+vreg_t newVreg(IrFunction *ir)
+{
+    return ir->nbVregs++;
+}
+
+/**
+ * @fn ReturnInfo appendOperation(IrFunction *ir, IrOp op, vreg_t a, vreg_t b, vreg_t *result)
+ * @brief Append an operation computing a new virtual register.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param op IrOp Operation.
+ * @param a vreg_t First operand.
+ * @param b vreg_t Second operand, NO_VREG for unary operations.
+ * @param result vreg_t* Virtual register computed, filled.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo appendOperation(IrFunction *ir, IrOp op, vreg_t a, vreg_t b, vreg_t *result)
+{
+    *result = newVreg(ir);
+    return appendIr(ir, makeIr(op, *result, a, b, 0));
+}
+
+/* ------- Variables -------- */
+
+/**
+ * @fn vreg_t localVreg(const IrFunction *ir, int localIndex)
+ * @brief Get the virtual register of a scalar local.
+ *
+ * @param ir const IrFunction* Function lowered.
+ * @param localIndex int Index of the local in the function table.
+ * @return vreg_t Virtual register of the local.
+ */
+vreg_t localVreg(const IrFunction *ir, int localIndex)
+{
+    return ir->nbParams + localIndex;
+}
+
+/**
+ * @fn ReturnInfo getMemoryOperand(IrFunction *ir, Node *ident, IrInstr *mem, int *inMemory)
+ * @brief Get the memory operand of a variable, lowering its index if any.
+ * A scalar local or parameter is not in memory, its virtual register being used instead.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param ident Node* Variable, bound by the semantic pass.
+ * @param mem IrInstr* Instruction whose memory operand is filled.
+ * @param inMemory int* Set to 0 if the variable lives in a virtual register.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo getMemoryOperand(IrFunction *ir, Node *ident, IrInstr *mem, int *inMemory)
+{
+    const Symbol *var;
+    *inMemory = 1;
+    switch (ident->scope)
+    {
+    case LOCAL_SCOPE:
+        var = &ir->fun->locals.symbols[ident->binding];
+        if (!var->isArray)
+        {
+            *inMemory = 0;
+            return SUCCESS;
+        }
+        mem->base = FRAME_BASE;
+        mem->imm = -(long)(var->address + (int)var->type * var->numberOfValues);
+        break;
+    case ARG_SCOPE:
+        var = &ir->fun->args.symbols[ident->binding];
+        if (!var->isAddress)
+        {
+            *inMemory = 0;
+            return SUCCESS;
+        }
+        mem->base = POINTER_BASE;
+        mem->a = ident->binding;
+        break;
+    case GLOBAL_SCOPE:
+        var = &pt->glob.symbols[ident->binding];
+        mem->base = GLOBAL_BASE;
+        mem->symbol = var->id;
+        break;
+    default:
+        return ID_NOT_IN_TABLE;
+    }
+
+    mem->size = var->type;
+    if (!FIRSTCHILD(ident))
+        return SUCCESS;
+    return lowerExpression(ir, FIRSTCHILD(ident), &mem->b);
+}
+
+/**
+ * @fn ReturnInfo lowerVariable(IrFunction *ir, Node *ident, vreg_t *result)
+ * @brief Lower the read of a variable. An array without index gives its address.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param ident Node* Variable read.
+ * @param result vreg_t* Virtual register holding the value, filled.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerVariable(IrFunction *ir, Node *ident, vreg_t *result)
+{
+    int inMemory;
+    IrInstr mem = makeIr(IR_LOAD, NO_VREG, NO_VREG, NO_VREG, 0);
+    ReturnInfo info = getMemoryOperand(ir, ident, &mem, &inMemory);
+    if (info != SUCCESS)
+        return info;
+
+    if (!inMemory)
+    {
+        *result = ident->scope == LOCAL_SCOPE ? localVreg(ir, ident->binding) : ident->binding;
+        return SUCCESS;
+    }
+    if (mem.base == POINTER_BASE && mem.b == NO_VREG)
+    {
+        *result = mem.a;
+        return SUCCESS;
+    }
+    if (!FIRSTCHILD(ident) && (ident->scope == LOCAL_SCOPE || pt->glob.symbols[ident->binding].isArray))
+        mem.op = IR_ADDR;
+
+    mem.dst = *result = newVreg(ir);
+    return appendIr(ir, mem);
+}
+
+/**
+ * @fn ReturnInfo lowerEgual(IrFunction *ir, Node *eg)
+ * @brief Lower an assignment. The value is computed before the index of the variable.
+ * Scalar locals keep the sign extension their slot in memory would have given them.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param eg Node* Assignment.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerEgual(IrFunction *ir, Node *eg)
+{
+    Node *target = FIRSTCHILD(eg);
+    vreg_t value;
+    ReturnInfo info = lowerExpression(ir, NEXTSIBLING(target), &value);
+    if (info != SUCCESS)
+        return info;
+
+    int inMemory;
+    IrInstr mem = makeIr(IR_STORE, NO_VREG, NO_VREG, NO_VREG, 0);
+    info = getMemoryOperand(ir, target, &mem, &inMemory);
+    if (info != SUCCESS)
+        return info;
+
+    if (inMemory)
+    {
+        mem.c = value;
+        return appendIr(ir, mem);
+    }
+    if (target->scope == ARG_SCOPE)
+        return appendIr(ir, makeIr(IR_COPY, target->binding, value, NO_VREG, 0));
+
+    IrInstr extend = makeIr(IR_EXTEND, localVreg(ir, target->binding), value, NO_VREG, 0);
+    extend.size = ir->fun->locals.symbols[target->binding].type;
+    return appendIr(ir, extend);
+}
+
+/* ------- Function calls -------- */
+
+/**
+ * @fn ReturnInfo lowerArgs(IrFunction *ir, Node *arg, int slot)
+ * @brief Lower the arguments of a call, from the last one to the first one.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param arg Node* First argument left to lower.
+ * @param slot int Slot of the argument in the arguments of the call.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerArgs(IrFunction *ir, Node *arg, int slot)
+{
+    if (!arg)
+        return SUCCESS;
+
+    ReturnInfo info = lowerArgs(ir, NEXTSIBLING(arg), slot + 1);
+    if (info != SUCCESS)
+        return info;
+
+    vreg_t value;
+    info = lowerExpression(ir, arg, &value);
+    if (info != SUCCESS)
+        return info;
+    ir->callArgs[slot] = value;
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo lowerCall(IrFunction *ir, Node *call, int valueUsed, vreg_t *result)
+ * @brief Lower the call of a function bound by the semantic pass.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param call Node* Call to lower.
+ * @param valueUsed int Is the returned value used.
+ * @param result vreg_t* Virtual register holding the returned value, filled.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerCall(IrFunction *ir, Node *call, int valueUsed, vreg_t *result)
+{
+    const FunctionInfo *called = &pt->functions.functions[call->binding];
+    Node *args = FIRSTCHILD(FIRSTCHILD(call));
+    if (args && args->label == Void)
+        args = NULL;
+
+    int first = ir->nbCallArgs, nbArgs = 0;
+    for (Node *arg = args; arg; arg = NEXTSIBLING(arg), nbArgs++)
+    {
+        ReturnInfo info = addCell((void **)&ir->callArgs, ir->nbCallArgs, &ir->callArgsCapacity, sizeof(vreg_t));
+        if (info != SUCCESS)
+            return info;
+        ir->nbCallArgs++;
+    }
+
+    ReturnInfo info = lowerArgs(ir, args, first);
+    if (info != SUCCESS)
+        return info;
+
+    *result = valueUsed && called->type != VOID_TYPE ? newVreg(ir) : NO_VREG;
+    IrInstr instr = makeIr(IR_CALL, *result, first, NO_VREG, nbArgs);
+    instr.symbol = call->u.ident;
+    return appendIr(ir, instr);
+}
+
+/* ------- Expressions -------- */
+
+/**
+ * @fn IrOp comparisonOp(const Node *comp)
+ * @brief Get the operation of a comparison.
+ *
+ * @param comp const Node* Eq or Order node.
+ * @return IrOp Operation.
+ */
+IrOp comparisonOp(const Node *comp)
+{
+    if (comp->label == Eq)
+        return comp->u.comp[0] == '=' ? IR_EQ : IR_NE;
+    if (comp->u.comp[0] == '<')
+        return comp->u.comp[1] == '=' ? IR_LE : IR_LT;
+    return comp->u.comp[1] == '=' ? IR_GE : IR_GT;
+}
+
+/**
+ * @fn ReturnInfo lowerConstant(IrFunction *ir, long value, vreg_t *result)
+ * @brief Lower a constant.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param value long Value of the constant.
+ * @param result vreg_t* Virtual register holding the value, filled.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerConstant(IrFunction *ir, long value, vreg_t *result)
+{
+    *result = newVreg(ir);
+    return appendIr(ir, makeIr(IR_CONST, *result, NO_VREG, NO_VREG, value));
+}
+
+/**
+ * @fn int operationOf(const Node *exp, IrOp *op)
+ * @brief Get the operation an expression computes from the values of its operands.
+ *
+ * @param exp const Node* Expression.
+ * @param op IrOp* Operation, filled.
+ * @return int 1 for such an operation, 0 for an expression lowered otherwise.
+ */
+int operationOf(const Node *exp, IrOp *op)
+{
+    switch (exp->label)
+    {
+    case Addsub:
+        if (!SECONDCHILD(exp))
+        {
+            *op = IR_NEG;
+            return exp->u.byte == '-';
+        }
+        *op = exp->u.byte == '+' ? IR_ADD : IR_SUB;
+        return 1;
+    case Divstar:
+        *op = exp->u.byte == '*' ? IR_MUL : exp->u.byte == '/' ? IR_DIV : IR_MOD;
+        return 1;
+    case Eq:
+    case Order:
+        *op = comparisonOp(exp);
+        return 1;
+    case ExclamationPoint:
+        *op = IR_NOT;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @fn ReturnInfo lowerTerm(IrFunction *ir, Node *exp, vreg_t *result)
+ * @brief Lower an expression which is not an operation on the values of its operands
+ * (switch to the right function).
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param exp Node* Expression.
+ * @param result vreg_t* Virtual register holding the value, filled.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerTerm(IrFunction *ir, Node *exp, vreg_t *result)
+{
+    switch (exp->label)
+    {
+    case Num:
+        return lowerConstant(ir, exp->u.num, result);
+    case Character:
+        return lowerConstant(ir, charToAsciiCode(exp->u.character), result);
+    case Ident:
+    case Array:
+        if (exp->scope == FUNCTION_SCOPE)
+            return lowerCall(ir, exp, 1, result);
+        return lowerVariable(ir, exp, result);
+    case Addsub:
+        return lowerExpression(ir, FIRSTCHILD(exp), result);
+    case And:
+    case Or:
+        return lowerShortCircuit(ir, exp, result);
+    default:
+        fprintf(stderr, "Unexpected %s in an expression at line %d\n", StringFromLabel[exp->label], exp->lineno);
+        return FAILURE;
+    }
+}
+
+/**
+ * @fn ReturnInfo lowerExpression(IrFunction *ir, Node *exp, vreg_t *result)
+ * @brief Lower an expression. The operands of an operation are lowered here, the left one
+ * first, so a deep expression only keeps one small frame on the stack for each of its levels.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param exp Node* Expression.
+ * @param result vreg_t* Virtual register holding the value, filled.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerExpression(IrFunction *ir, Node *exp, vreg_t *result)
+{
+    IrOp op;
+    if (!operationOf(exp, &op))
+        return lowerTerm(ir, exp, result);
+
+    vreg_t a, b = NO_VREG;
+    ReturnInfo info = lowerExpression(ir, FIRSTCHILD(exp), &a);
+    if (info == SUCCESS && SECONDCHILD(exp))
+        info = lowerExpression(ir, SECONDCHILD(exp), &b);
+    if (info != SUCCESS)
+        return info;
+    return appendOperation(ir, op, a, b, result);
+}
+
+/* ------- Conditions -------- */
+
+/**
+ * @fn IrOp negateJump(IrOp jump)
+ * @brief Get the conditional jump taken exactly when another one is not.
+ *
+ * @param jump IrOp Conditional jump.
+ * @return IrOp Opposite conditional jump.
+ */
+IrOp negateJump(IrOp jump)
+{
+    static const IrOp OPPOSITES[] = {IR_JUMP_NE, IR_JUMP_EQ, IR_JUMP_GE, IR_JUMP_GT, IR_JUMP_LE, IR_JUMP_LT};
+    return OPPOSITES[jump - IR_JUMP_EQ];
+}
+
+/**
+ * @fn ReturnInfo lowerCondition(IrFunction *ir, Node *cond, int label, int jumpIf)
+ * @brief Lower a condition into jumps, going to a label when it has a given truth value
+ * and falling through otherwise. A comparison becomes a single conditional jump on its
+ * operands, and the operands of an and or an or a chain of jumps, the right one being
+ * skipped when the left one decides.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param cond Node* Condition.
+ * @param label int Label jumped to.
+ * @param jumpIf int Truth value of the condition for which the jump is taken, 0 or 1.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerCondition(IrFunction *ir, Node *cond, int label, int jumpIf)
+{
+    ReturnInfo info;
+    vreg_t a, b = NO_VREG;
+    IrOp jump = IR_JUMP_NE;
+
+    switch (cond->label)
+    {
+    case ExclamationPoint:
+        return lowerCondition(ir, FIRSTCHILD(cond), label, !jumpIf);
+    case And:
+    case Or:
+        /* The left operand decides alone when it is false for an and, true for an or */
+        if (jumpIf == (cond->label == Or))
+        {
+            info = lowerCondition(ir, FIRSTCHILD(cond), label, jumpIf);
+            if (info != SUCCESS)
+                return info;
+            return lowerCondition(ir, SECONDCHILD(cond), label, jumpIf);
+        }
+        else
+        {
+            int skipLabel = ir->nbLabels++;
+            info = lowerCondition(ir, FIRSTCHILD(cond), skipLabel, !jumpIf);
+            if (info != SUCCESS)
+                return info;
+            info = lowerCondition(ir, SECONDCHILD(cond), label, jumpIf);
+            if (info != SUCCESS)
+                return info;
+            return appendIr(ir, makeIr(IR_LABEL, NO_VREG, NO_VREG, NO_VREG, skipLabel));
+        }
+    case Eq:
+    case Order:
+        info = lowerExpression(ir, FIRSTCHILD(cond), &a);
+        if (info != SUCCESS)
+            return info;
+        info = lowerExpression(ir, SECONDCHILD(cond), &b);
+        jump = comparisonOp(cond) - IR_EQ + IR_JUMP_EQ;
+        break;
+    default:
+        info = lowerExpression(ir, cond, &a);
+        break;
+    }
+
+    if (info != SUCCESS)
+        return info;
+    return appendIr(ir, makeIr(jumpIf ? jump : negateJump(jump), NO_VREG, a, b, label));
+}
+
+/**
+ * @fn ReturnInfo lowerShortCircuit(IrFunction *ir, Node *exp, vreg_t *result)
+ * @brief Lower the value of an and or an or, giving 0 or 1. Its operands are lowered
+ * as a condition, the right one being skipped when the left one decides. The value,
+ * set on both ways, is held by one of the variables kept for it by lowerFunction.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param exp Node* And or Or.
+ * @param result vreg_t* Virtual register holding the value, filled.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerShortCircuit(IrFunction *ir, Node *exp, vreg_t *result)
+{
+    int endLabel = ir->nbLabels++;
+    *result = nextResult++;
+    ReturnInfo info = appendIr(ir, makeIr(IR_CONST, *result, NO_VREG, NO_VREG, 0));
+    if (info != SUCCESS)
+        return info;
+    info = lowerCondition(ir, exp, endLabel, 0);
+    if (info != SUCCESS)
+        return info;
+    info = appendIr(ir, makeIr(IR_CONST, *result, NO_VREG, NO_VREG, 1));
+    if (info != SUCCESS)
+        return info;
+    return appendIr(ir, makeIr(IR_LABEL, NO_VREG, NO_VREG, NO_VREG, endLabel));
+}
+
+/**
+ * @fn int countShortCircuits(Node *node)
+ * @brief Count the ands and ors under a node, each one needing at most a variable for its value.
+ *
+ * @param node Node* Node whose descendants are counted.
+ * @return int Number of And and Or nodes.
+ */
+int countShortCircuits(Node *node)
+{
+    int nb = 0;
+    for (Node *child = FIRSTCHILD(node); child; child = NEXTSIBLING(child))
+        nb += (child->label == And || child->label == Or) + countShortCircuits(child);
+    return nb;
+}
+
+/* ------- Instructions -------- */
+
+/**
+ * @fn ReturnInfo lowerBlock(IrFunction *ir, Node *instr)
+ * @brief Lower a list of instructions, stopping at an Else.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param instr Node* First instruction of the list, may be NULL.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerBlock(IrFunction *ir, Node *instr)
+{
+    for (; instr && instr->label != Else; instr = NEXTSIBLING(instr))
+    {
+        ReturnInfo info = lowerInstr(ir, instr);
+        if (info != SUCCESS)
+            return info;
+    }
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo lowerIf(IrFunction *ir, Node *ifInstr)
+ * @brief Lower an if and its eventual else.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param ifInstr Node* If to lower.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerIf(IrFunction *ir, Node *ifInstr)
+{
+    Node *cond = FIRSTCHILD(ifInstr);
+    Node *maybeElse = getChildLabeled(ifInstr, Else);
+    int elseLabel = ir->nbLabels++;
+    int endLabel = maybeElse ? ir->nbLabels++ : elseLabel;
+
+    ReturnInfo info = lowerCondition(ir, cond, elseLabel, 0);
+    if (info != SUCCESS)
+        return info;
+
+    info = lowerBlock(ir, NEXTSIBLING(cond));
+    if (info != SUCCESS)
+        return info;
+
+    if (maybeElse)
+    {
+        info = appendIr(ir, makeIr(IR_JUMP, NO_VREG, NO_VREG, NO_VREG, endLabel));
+        if (info != SUCCESS)
+            return info;
+        info = appendIr(ir, makeIr(IR_LABEL, NO_VREG, NO_VREG, NO_VREG, elseLabel));
+        if (info != SUCCESS)
+            return info;
+        info = lowerBlock(ir, FIRSTCHILD(maybeElse));
+        if (info != SUCCESS)
+            return info;
+    }
+    return appendIr(ir, makeIr(IR_LABEL, NO_VREG, NO_VREG, NO_VREG, endLabel));
+}
+
+/**
+ * @fn ReturnInfo lowerWhile(IrFunction *ir, Node *whileInstr)
+ * @brief Lower a while loop.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param whileInstr Node* While to lower.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerWhile(IrFunction *ir, Node *whileInstr)
+{
+    Node *cond = FIRSTCHILD(whileInstr);
+    int loopLabel = ir->nbLabels++;
+    int endLabel = ir->nbLabels++;
+
+    ReturnInfo info = appendIr(ir, makeIr(IR_LABEL, NO_VREG, NO_VREG, NO_VREG, loopLabel));
+    if (info != SUCCESS)
+        return info;
+
+    info = lowerCondition(ir, cond, endLabel, 0);
+    if (info != SUCCESS)
+        return info;
+
+    info = lowerBlock(ir, NEXTSIBLING(cond));
+    if (info != SUCCESS)
+        return info;
+
+    info = appendIr(ir, makeIr(IR_JUMP, NO_VREG, NO_VREG, NO_VREG, loopLabel));
+    if (info != SUCCESS)
+        return info;
+    return appendIr(ir, makeIr(IR_LABEL, NO_VREG, NO_VREG, NO_VREG, endLabel));
+}
+
+/**
+ * @fn ReturnInfo lowerReturn(IrFunction *ir, Node *retInstr)
+ * @brief Lower a return, with or without value.
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param retInstr Node* Return to lower.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerReturn(IrFunction *ir, Node *retInstr)
+{
+    vreg_t value = NO_VREG;
+    if (FIRSTCHILD(retInstr))
+    {
+        ReturnInfo info = lowerExpression(ir, FIRSTCHILD(retInstr), &value);
+        if (info != SUCCESS)
+            return info;
+    }
+    return appendIr(ir, makeIr(IR_RET, NO_VREG, value, NO_VREG, 0));
+}
+
+/**
+ * @fn ReturnInfo lowerInstr(IrFunction *ir, Node *instr)
+ * @brief Lower any instruction (switch to the right function).
+ *
+ * @param ir IrFunction* Function lowered.
+ * @param instr Node* Instruction to lower.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerInstr(IrFunction *ir, Node *instr)
+{
+    vreg_t ignored;
+    switch (instr->label)
+    {
+    case DeclVarsLocale:
+        return SUCCESS;
+    case If:
+        return lowerIf(ir, instr);
+    case While:
+        return lowerWhile(ir, instr);
+    case Return:
+        return lowerReturn(ir, instr);
+    case Egual:
+        return lowerEgual(ir, instr);
+    case Ident:
+        if (instr->scope == FUNCTION_SCOPE)
+            return lowerCall(ir, instr, 0, &ignored);
+        return lowerExpression(ir, instr, &ignored);
+    default:
+        return lowerExpression(ir, instr, &ignored);
+    }
+}
+
+/**
+ * @fn ReturnInfo lowerFunction(Node *fun, const FunctionInfo *funTable, const ProgTable *progt, IrFunction *ir)
+ * @brief Lower the body of a function and build its control-flow graph. The code always ends with a return.
+ *
+ * @param fun Node* DeclFonct of the function.
+ * @param funTable const FunctionInfo* Function table of the function.
+ * @param progt const ProgTable* Program table.
+ * @param ir IrFunction* Lowered function, filled.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerFunction(Node *fun, const FunctionInfo *funTable, const ProgTable *progt, IrFunction *ir)
+{
+    pt = progt;
+    *ir = (IrFunction){.fun = funTable};
+    ir->nbParams = funTable->args.len;
+    ir->frameSize = funTable->locals.size;
+    Node *body = getChildLabeled(fun, Body);
+    nextResult = funTable->args.len + funTable->locals.len;
+    ir->nbVariables = ir->nbVregs = nextResult + (body ? countShortCircuits(body) : 0);
+
+    for (int i = 0; i < ir->nbParams; i++)
+    {
+        ReturnInfo info = appendIr(ir, makeIr(IR_PARAM, i, NO_VREG, NO_VREG, i));
+        if (info != SUCCESS)
+            return info;
+    }
+
+    if (body)
+    {
+        ReturnInfo info = lowerBlock(ir, FIRSTCHILD(body));
+        if (info != SUCCESS)
+            return info;
+    }
+
+    if (!ir->len || ir->instrs[ir->len - 1].op != IR_RET)
+    {
+        ReturnInfo info = appendIr(ir, makeIr(IR_RET, NO_VREG, NO_VREG, NO_VREG, 0));
+        if (info != SUCCESS)
+            return info;
+    }
+    return buildCfg(ir);
+}
+
+/**
+ * @fn ReturnInfo lowerProg(Node *root, const ProgTable *progt, IrProgram *prog)
+ * @brief Lower every function of a program checked by the semantic pass.
+ *
+ * @param root Node* Root of the program.
+ * @param progt const ProgTable* Program table.
+ * @param prog IrProgram* Lowered program, filled. To be freed by freeIrProgram.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo lowerProg(Node *root, const ProgTable *progt, IrProgram *prog)
+{
+    *prog = (IrProgram){NULL, 0, 0};
+    for (Node *fun = FIRSTCHILD(root); fun; fun = NEXTSIBLING(fun))
+    {
+        if (fun->label == DeclVarsGlobale)
+            continue;
+
+        ident_t id;
+        getFunId(fun, &id);
+        const FunctionInfo *funTable = getFunctionsTable(progt, id);
+        if (!funTable)
+            return NOT_A_FUNCTION;
+
+        ReturnInfo info = addCell((void **)&prog->functions, prog->len, &prog->capacity, sizeof(IrFunction));
+        if (info != SUCCESS)
+            return info;
+        info = lowerFunction(fun, funTable, progt, &prog->functions[prog->len++]);
+        if (info != SUCCESS)
+            return info;
+    }
+    return SUCCESS;
+}
+
+/**
+ * @fn int getIrOperandSlots(IrInstr *instr, vreg_t *slots[3])
+ * @brief Get the fields of an instruction holding the virtual registers it reads, the arguments of a call excepted.
+ *
+ * @param instr IrInstr* Instruction.
+ * @param slots vreg_t*[3] Fields read, filled.
+ * @return int Number of fields read.
+ */
+int getIrOperandSlots(IrInstr *instr, vreg_t *slots[3])
+{
+    int nb = 0;
+    switch (instr->op)
+    {
+    case IR_PARAM:
+    case IR_CONST:
+    case IR_CALL:
+    case IR_LABEL:
+    case IR_JUMP:
+        return 0;
+    case IR_ADDR:
+    case IR_LOAD:
+    case IR_STORE:
+        if (instr->base == POINTER_BASE)
+            slots[nb++] = &instr->a;
+        if (instr->b != NO_VREG)
+            slots[nb++] = &instr->b;
+        if (instr->op == IR_STORE)
+            slots[nb++] = &instr->c;
+        return nb;
+    default:
+        if (instr->a != NO_VREG)
+            slots[nb++] = &instr->a;
+        if (instr->b != NO_VREG)
+            slots[nb++] = &instr->b;
+        return nb;
+    }
+}
+
+/**
+ * @fn int getIrOperands(const IrInstr *instr, vreg_t operands[3])
+ * @brief Get the virtual registers read by an instruction, the arguments of a call excepted.
+ *
+ * @param instr const IrInstr* Instruction.
+ * @param operands vreg_t[3] Virtual registers read, filled.
+ * @return int Number of virtual registers read.
+ */
+int getIrOperands(const IrInstr *instr, vreg_t operands[3])
+{
+    vreg_t *slots[3];
+    int nb = getIrOperandSlots((IrInstr *)instr, slots);
+    for (int i = 0; i < nb; i++)
+        operands[i] = *slots[i];
+    return nb;
+}
+
+/**
+ * @fn void removeIrInstrs(IrFunction *ir, const char *removed)
+ * @brief Remove instructions from the code of a function, keeping the order of the other ones.
+ * The control-flow graph has to be built again afterwards.
+ *
+ * @param ir IrFunction* Function changed.
+ * @param removed const char* Non-zero for every instruction to remove.
+ */
+void removeIrInstrs(IrFunction *ir, const char *removed)
+{
+    int len = 0;
+    for (int pos = 0; pos < ir->len; pos++)
+        if (!removed[pos])
+            ir->instrs[len++] = ir->instrs[pos];
+    ir->len = len;
+}
+
+/* ------- Dump -------- */
+
+/* Names of the operations, in the order of IrOp */
+static const char *IR_OP_NAMES[] = {"param", "const", "copy", "extend", "add", "sub", "mul", "div", "mod",
+                                    "eq", "ne", "lt", "le", "gt", "ge", "neg", "not",
+                                    "addr", "load", "store", "call", "ret", "label", "jump",
+                                    "jeq", "jne", "jlt", "jle", "jgt", "jge"};
+
+/**
+ * @fn void printMemoryOperand(const IrInstr *instr)
+ * @brief Print the memory operand of an instruction.
+ *
+ * @param instr const IrInstr* Instruction with a memory operand.
+ */
+void printMemoryOperand(const IrInstr *instr)
+{
+    if (instr->base == GLOBAL_BASE)
+        printf("[%s", identToString(instr->symbol));
+    else if (instr->base == FRAME_BASE)
+        printf("[frame %ld", instr->imm);
+    else
+        printf("[v%d", instr->a);
+    if (instr->b != NO_VREG)
+        printf(" + v%d * %d", instr->b, instr->size);
+    printf("]");
+}
+
+/**
+ * @fn void printIrInstr(const IrFunction *ir, const IrInstr *instr)
+ * @brief Print an instruction of a lowered function.
+ *
+ * @param ir const IrFunction* Function of the instruction.
+ * @param instr const IrInstr* Instruction to print.
+ */
+void printIrInstr(const IrFunction *ir, const IrInstr *instr)
+{
+    printf("    ");
+    if (instr->dst != NO_VREG)
+        printf("v%d = ", instr->dst);
+    printf("%s", IR_OP_NAMES[instr->op]);
+
+    switch (instr->op)
+    {
+    case IR_PARAM:
+    case IR_CONST:
+        printf(" %ld", instr->imm);
+        break;
+    case IR_EXTEND:
+        printf("%d v%d", 8 * instr->size, instr->a);
+        break;
+    case IR_ADDR:
+    case IR_LOAD:
+        printf("%d ", 8 * instr->size);
+        printMemoryOperand(instr);
+        break;
+    case IR_STORE:
+        printf("%d ", 8 * instr->size);
+        printMemoryOperand(instr);
+        printf(", v%d", instr->c);
+        break;
+    case IR_CALL:
+        printf(" %s(", identToString(instr->symbol));
+        for (int i = 0; i < instr->imm; i++)
+            printf(i ? ", v%d" : "v%d", ir->callArgs[instr->a + i]);
+        printf(")");
+        break;
+    case IR_LABEL:
+    case IR_JUMP:
+        printf(" .L%ld", instr->imm);
+        break;
+    case IR_JUMP_EQ:
+    case IR_JUMP_NE:
+    case IR_JUMP_LT:
+    case IR_JUMP_LE:
+    case IR_JUMP_GT:
+    case IR_JUMP_GE:
+        if (instr->b != NO_VREG)
+            printf(" v%d, v%d, .L%ld", instr->a, instr->b, instr->imm);
+        else
+            printf(" v%d, 0, .L%ld", instr->a, instr->imm);
+        break;
+    default:
+        if (instr->a != NO_VREG)
+            printf(" v%d", instr->a);
+        if (instr->b != NO_VREG)
+            printf(", v%d", instr->b);
+        break;
+    }
+    printf("\n");
+}
+
+/**
+ * @fn void printIrFunction(const IrFunction *ir)
+ * @brief Print the blocks of a lowered function, with their predecessors and successors.
+ *
+ * @param ir const IrFunction* Function to print.
+ */
+void printIrFunction(const IrFunction *ir)
+{
+    printf("function %s (%d parameters, %d variables, %d virtual registers)\n",
+           identToString(ir->fun->id), ir->nbParams, ir->nbVariables, ir->nbVregs);
+    for (int b = 0; b < ir->nbBlocks; b++)
+    {
+        const BasicBlock *block = &ir->blocks[b];
+        printf("  B%d:", b);
+        if (block->nbPreds)
+            printf(" from");
+        for (int i = 0; i < block->nbPreds; i++)
+            printf(" B%d", ir->preds[block->firstPred + i]);
+        if (block->succs[0] != NO_BLOCK)
+            printf(" to B%d", block->succs[0]);
+        if (block->succs[1] != NO_BLOCK)
+            printf(" B%d", block->succs[1]);
+        printf("\n");
+
+        for (int pos = block->first; pos < block->end; pos++)
+            printIrInstr(ir, &ir->instrs[pos]);
+    }
+    printf("\n");
+}
+
+/**
+ * @fn void printIrProgram(const IrProgram *prog)
+ * @brief Print every lowered function of a program.
+ *
+ * @param prog const IrProgram* Program to print.
+ */
+void printIrProgram(const IrProgram *prog)
+{
+    for (int i = 0; i < prog->len; i++)
+        printIrFunction(&prog->functions[i]);
+}
+
+/**
+ * @fn void freeIrFunction(IrFunction *ir)
+ * @brief Free the code of a lowered function.
+ *
+ * @param ir IrFunction* Function to free.
+ */
+void freeIrFunction(IrFunction *ir)
+{
+    free(ir->instrs);
+    free(ir->callArgs);
+    free(ir->blocks);
+    free(ir->preds);
+    free(ir->labelBlocks);
+    *ir = (IrFunction){NULL};
+}
+
+/**
+ * @fn void freeIrProgram(IrProgram *prog)
+ * @brief Free every lowered function of a program.
+ *
+ * @param prog IrProgram* Program to free.
+ */
+void freeIrProgram(IrProgram *prog)
+{
+    for (int i = 0; i < prog->len; i++)
+        freeIrFunction(&prog->functions[i]);
+    free(prog->functions);
+    *prog = (IrProgram){NULL, 0, 0};
+}
@@ -5,30 +5,40 @@
  * @date 2024-02-10
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/syscall.h>
 #include <unistd.h>
 
 #include "writter.h"
+#include "defaultFunctionWritter.h"
+#include "optimizer.h"
+#include "inliner.h"
+#include "peephole.h"
+#include "assembler.h"
+#include "emitter.h"
+#include "semantic.h"
 #include "utilitaries.h"
 #include "tpcas.tab.h"
 
 extern Node *root;
 
 /**
- * @fn void printOptions(ProgTable t, int showAllTables, int showAllFunctions, char *functionToShow, int showGlobals, int printTreeOption)
+ * @fn void printOptions(const ProgTable *t, int showAllTables, int showAllFunctions, char *functionToShow, int showGlobals, int printTreeOption)
  * @brief Print the options chose by the user.
  * 
- * @param t ProgTable Table to print.
+ * @param t const ProgTable* Table to print.
  * @param showAllTables int Show all the tables.
  * @param showAllFunctions int Show all the functions.
  * @param functionToShow char* Function to show.
  * @param showGlobals int Show the globals.
  * @param printTreeOption int Print the tree.
  */
-void printOptions(ProgTable t, int showAllTables, int showAllFunctions,
+void printOptions(const ProgTable *t, int showAllTables, int showAllFunctions,
                   char *functionToShow, int showGlobals, int printTreeOption)
 {
   if (printTreeOption)
@@ -41,6 +51,49 @@ void printOptions(ProgTable t, int showAllTables, int showAllFunctions,
                  showGlobals);
 }
 
+/**
+ * @fn void getExecutableName(const char *outputName, char *executableName)
+ * @brief Get the name of the executable from the name of the assembly file:
+ * prog.asm gives prog, any other name is followed by .out.
+ *
+ * @param outputName const char* Name of the assembly file.
+ * @param executableName char* Name of the executable, filled.
+ */
+void getExecutableName(const char *outputName, char *executableName)
+{
+  int len = strlen(outputName);
+  strcpy(executableName, outputName);
+  if (len > 4 && !strcmp(outputName + len - 4, ".asm"))
+    executableName[len - 4] = '\0';
+  else
+    strcat(executableName, ".out");
+}
+
+/**
+ * @fn int findRuntimeArchive(char *archiveName)
+ * @brief Find the runtime archive next to the compiler, where make runtime builds it.
+ * An archive older than the compiler may hold another runtime, and is not used.
+ *
+ * @param archiveName char* Path of the archive, filled, RUNTIME_ARCHIVE_PATH_LEN bytes.
+ * @return int 1 if the archive may be linked, 0 if the runtime has to be assembled with the program.
+ */
+int findRuntimeArchive(char *archiveName)
+{
+  ssize_t len = readlink("/proc/self/exe", archiveName, RUNTIME_ARCHIVE_PATH_LEN - 1);
+  if (len <= 0)
+    return 0;
+  archiveName[len] = '\0';
+
+  char *slash = strrchr(archiveName, '/');
+  if (!slash || slash + 1 - archiveName + strlen(RUNTIME_ARCHIVE) >= RUNTIME_ARCHIVE_PATH_LEN)
+    return 0;
+  struct stat compiler, archive;
+  if (stat(archiveName, &compiler))
+    return 0;
+  strcpy(slash + 1, RUNTIME_ARCHIVE);
+  return !stat(archiveName, &archive) && archive.st_mtime >= compiler.st_mtime;
+}
+
 /**
  * @fn int main(int argc, char *argv[])
  * @brief Main function of the project.
@@ -52,6 +105,10 @@ void printOptions(ProgTable t, int showAllTables, int showAllFunctions,
 int main(int argc, char *argv[])
 {
   int printTreeOption = 0;
+  int printIrOption = 0;
+  int inlineLimit = DEFAULT_INLINE_LIMIT;
+  int peepholeWindow = DEFAULT_PEEPHOLE_WINDOW;
+  int printPeepholeOption = 0;
   int showAllFunctions = 0;
   int showAllTables = 0;
   int showGlobals = 0;
@@ -59,7 +116,8 @@ int main(int argc, char *argv[])
   char outputName[SIZE_ID] = "_anonymous.asm";
   int chosenOption =
       optionHandler(argc, argv, &showAllTables, &showAllFunctions,
-                    functionToShow, &showGlobals, &printTreeOption, outputName);
+                    functionToShow, &showGlobals, &printTreeOption, &printIrOption,
+                    &inlineLimit, &peepholeWindow, &printPeepholeOption, outputName);
 
   if (chosenOption)
     return chosenOption;
@@ -75,17 +133,40 @@ int main(int argc, char *argv[])
     return getErrorCode(errorCode);
   }
 
-  printOptions(t, showAllTables, showAllFunctions, functionToShow, showGlobals,
+  printOptions(&t, showAllTables, showAllFunctions, functionToShow, showGlobals,
                printTreeOption);
 
-  errorCode = writeAll(root, t, outputName);
+  errorCode = checkProg(root, &t);
+  if (errorCode != SUCCESS)
+    return getErrorCode(errorCode);
+
+  IrProgram prog;
+  errorCode = lowerProg(root, &t, &prog);
   if (errorCode == SUCCESS)
-    system("make assemble");
-  else
+    errorCode = optimizeProg(&prog, inlineLimit);
+  if (errorCode != SUCCESS)
+    return getErrorCode(errorCode);
+
+  if (printIrOption)
+    printIrProgram(&prog);
+
+  char runtimeArchive[RUNTIME_ARCHIVE_PATH_LEN];
+  int linkArchive = findRuntimeArchive(runtimeArchive);
+  errorCode = writeAll(&prog, &t, outputName, peepholeWindow, printPeepholeOption, linkArchive);
+  if (errorCode != SUCCESS)
+    return getErrorCode(errorCode);
+
+  char executableName[SIZE_ID + 4];
+  getExecutableName(outputName, executableName);
+  errorCode = assembleEmitted(executableName, linkArchive ? runtimeArchive : NULL);
+  if (errorCode != SUCCESS)
     return getErrorCode(errorCode);
 
+  freeIrProgram(&prog);
   freeProgTable(&t);
+  freeEmitter();
 
-  deleteTree(root);
+  resetNodeArena();
+  resetInterner();
   return 0;
 }
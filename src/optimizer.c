@@ -0,0 +1,102 @@
+/**
+ * @file optimizer.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Optimization passes run on the lowered program before it is written.
+ * @date 2024-02-10
+ */
+
+#include <stdlib.h>
+#include "optimizer.h"
+#include "inliner.h"
+#include "sccp.h"
+
+/**
+ * @fn ReturnInfo removeUnreachableFunctions(IrProgram *prog)
+ * @brief Remove the functions main never calls, directly or not, walking the call graph from main.
+ * The parts of the runtime are linked from the calls left, so the unused ones go away too.
+ *
+ * @param prog IrProgram* Program changed.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo removeUnreachableFunctions(IrProgram *prog)
+{
+    ident_t mainId = internString("main");
+    ident_t maxId = mainId;
+    for (int i = 0; i < prog->len; i++)
+        if (prog->functions[i].fun->id > maxId)
+            maxId = prog->functions[i].fun->id;
+
+    int *indexes = malloc((maxId + 1) * sizeof(int)); /* Function of each identifier, -1 if none */
+    int *stack = malloc((prog->len + 1) * sizeof(int));
+    char *reached = calloc(prog->len + 1, 1);
+    if (!indexes || !stack || !reached)
+    {
+        free(indexes);
+        free(stack);
+        free(reached);
+        return ALLOC_ERROR;
+    }
+    for (ident_t id = 0; id <= maxId; id++)
+        indexes[id] = -1;
+    for (int i = 0; i < prog->len; i++)
+        indexes[prog->functions[i].fun->id] = i;
+
+    int top = 0;
+    if (indexes[mainId] >= 0)
+    {
+        reached[indexes[mainId]] = 1;
+        stack[top++] = indexes[mainId];
+    }
+    while (top)
+    {
+        const IrFunction *ir = &prog->functions[stack[--top]];
+        for (int pos = 0; pos < ir->len; pos++)
+        {
+            int callee = ir->instrs[pos].op == IR_CALL && ir->instrs[pos].symbol <= maxId ? indexes[ir->instrs[pos].symbol] : -1;
+            if (callee >= 0 && !reached[callee])
+            {
+                reached[callee] = 1;
+                stack[top++] = callee;
+            }
+        }
+    }
+
+    int len = 0;
+    for (int i = 0; i < prog->len; i++)
+        if (reached[i])
+            prog->functions[len++] = prog->functions[i];
+        else
+            freeIrFunction(&prog->functions[i]);
+    prog->len = len;
+
+    free(indexes);
+    free(stack);
+    free(reached);
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo optimizeProg(IrProgram *prog, int inlineLimit)
+ * @brief Optimize a lowered program: small functions are inlined first, then every function is optimized.
+ * The functions main does not reach are removed once inlined, then again once the constant branches are gone.
+ *
+ * @param prog IrProgram* Program optimized.
+ * @param inlineLimit int Maximum size of an inlined function, 0 inlining nothing.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo optimizeProg(IrProgram *prog, int inlineLimit)
+{
+    ReturnInfo info = inlineCalls(prog, inlineLimit);
+    if (info == SUCCESS)
+        info = removeUnreachableFunctions(prog);
+    if (info != SUCCESS)
+        return info;
+
+    for (int i = 0; i < prog->len; i++)
+    {
+        info = propagateConstants(&prog->functions[i]);
+        if (info != SUCCESS)
+            return info;
+    }
+    return removeUnreachableFunctions(prog);
+}
@@ -0,0 +1,809 @@
+/**
+ * @file peephole.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Peephole optimization of the assembly emitted for a function.
+ * @date 2024-02-10
+ *
+ * Once a function is written, its lines are parsed back into a list of
+ * instructions (see assembler.c), rewritten, and emitted again when something
+ * changed, so the assembly file and the built-in assembler both get them. A
+ * rule rewrites an instruction with the one following it, and may look further
+ * to prove that a register or the flags it stops setting are never read again.
+ * That look follows the jumps to the labels of the function, but never goes
+ * beyond the window: a rewriting looks at no more instructions than it allows.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "peephole.h"
+#include "emitter.h"
+
+/* Pseudo register standing for the flags, when looking if a value is read again */
+#define FLAGS 16
+
+/* Names of the rules, in the order of PeepholeRule */
+static const char *RULE_NAMES[NB_PEEPHOLE_RULES] = {
+    "push-pop", "forwarded load", "redundant move", "dead move",
+    "propagated operand", "imul immediate", "add to lea", "jump"};
+
+/* Lines of a function being rewritten */
+typedef struct _code
+{
+    Instruction *insts;
+    int len;
+    int window;
+} Code;
+
+/* ------- Registers and flags read or written -------- */
+
+/**
+ * @fn int isRegisterOf(const Operand *op, int reg)
+ * @brief Tell if an operand is a register, whatever its size.
+ *
+ * @param op const Operand* Operand.
+ * @param reg int Register number.
+ * @return int 1 if so, 0 otherwise.
+ */
+int isRegisterOf(const Operand *op, int reg)
+{
+    return op->kind == REG_OPERAND && op->reg == reg;
+}
+
+/**
+ * @fn int addresses(const Operand *op, int reg)
+ * @brief Tell if a memory operand uses a register in its address.
+ *
+ * @param op const Operand* Operand.
+ * @param reg int Register number.
+ * @return int 1 if so, 0 otherwise.
+ */
+int addresses(const Operand *op, int reg)
+{
+    return op->kind == MEM_OPERAND && (op->reg == reg || op->index == reg);
+}
+
+/**
+ * @fn int fitsImm32(long value)
+ * @brief Tell if a value can be the 32-bit immediate of an instruction working on 64 bits.
+ *
+ * @param value long Value.
+ * @return int 1 if so, 0 otherwise.
+ */
+int fitsImm32(long value)
+{
+    return value >= -2147483648L && value <= 2147483647L;
+}
+
+/**
+ * @fn int isZeroing(const Instruction *inst)
+ * @brief Tell if an instruction is the xor of a register with itself, which sets it to 0.
+ *
+ * @param inst const Instruction* Instruction.
+ * @return int 1 if so, 0 otherwise.
+ */
+int isZeroing(const Instruction *inst)
+{
+    return inst->mnemonic == ASM_XOR && inst->operands[0].kind == REG_OPERAND && inst->operands[0].size >= 4 &&
+           isRegisterOf(&inst->operands[1], inst->operands[0].reg);
+}
+
+/**
+ * @fn int isCallerSaved(int reg)
+ * @brief Tell if a register is not kept by a call.
+ *
+ * @param reg int Register number.
+ * @return int 1 if so, 0 otherwise.
+ */
+int isCallerSaved(int reg)
+{
+    return reg == RAX || reg == RCX || reg == RDX || reg == RSI || reg == RDI || (reg >= R8 && reg <= R11);
+}
+
+/**
+ * @fn int isArgumentRegister(int reg)
+ * @brief Tell if a register passes an argument to a call.
+ *
+ * @param reg int Register number.
+ * @return int 1 if so, 0 otherwise.
+ */
+int isArgumentRegister(int reg)
+{
+    return reg == RDI || reg == RSI || reg == RDX || reg == RCX || reg == R8 || reg == R9;
+}
+
+/**
+ * @fn int readsResource(const Instruction *inst, int r)
+ * @brief Tell if an instruction may read a register, or the flags, or only write part of it.
+ *
+ * @param inst const Instruction* Instruction.
+ * @param r int Register number, or FLAGS.
+ * @return int 1 if it may, 0 otherwise.
+ */
+int readsResource(const Instruction *inst, int r)
+{
+    int m = inst->mnemonic;
+    if (r == FLAGS)
+    {
+        // a shift by 0 keeps the flags, inc and dec keep the carry
+        if (m == ASM_SHL || m == ASM_SHR || m == ASM_SAR)
+            return inst->operands[1].kind != IMM_OPERAND || !(inst->operands[1].value & 63);
+        return m == ASM_JCC || m == ASM_SETCC || m == ASM_CMOVCC || m == ASM_INC || m == ASM_DEC;
+    }
+    if (isZeroing(inst))
+        return 0;
+
+    const Operand *dst = &inst->operands[0];
+    for (int i = 0; i < inst->nbOperands; i++)
+        if (addresses(&inst->operands[i], r) || (i && isRegisterOf(&inst->operands[i], r)))
+            return 1;
+    if (inst->nbOperands && isRegisterOf(dst, r))
+    {
+        switch (m)
+        {
+        case ASM_MOV:
+        case ASM_MOVSX:
+        case ASM_MOVZX:
+        case ASM_LEA:
+            return dst->size < 4;
+        case ASM_POP:
+            return 0;
+        case ASM_IMUL:
+            return inst->nbOperands < 3;
+        default:
+            return 1;
+        }
+    }
+
+    switch (m)
+    {
+    case ASM_CQO:
+        return r == RAX;
+    case ASM_IDIV:
+        return r == RAX || r == RDX;
+    case ASM_PUSH:
+    case ASM_POP:
+        return r == RSP;
+    case ASM_CALL:
+        return r == RSP || isArgumentRegister(r);
+    case ASM_RET:
+        return r == RSP || r == RAX;
+    case ASM_LEAVE:
+        return r == RBP;
+    case ASM_SYSCALL:
+        return r == RAX || r == R10 || (r != RCX && isArgumentRegister(r));
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @fn int writesResource(const Instruction *inst, int r)
+ * @brief Tell if an instruction which does not read a register, or the flags, sets all of it.
+ *
+ * @param inst const Instruction* Instruction.
+ * @param r int Register number, or FLAGS.
+ * @return int 1 if so, 0 otherwise.
+ */
+int writesResource(const Instruction *inst, int r)
+{
+    int m = inst->mnemonic;
+    if (r == FLAGS)
+        return m == ASM_ADD || m == ASM_OR || m == ASM_AND || m == ASM_SUB || m == ASM_XOR || m == ASM_CMP ||
+               m == ASM_TEST || m == ASM_IMUL || m == ASM_NEG || m == ASM_SHL || m == ASM_SHR || m == ASM_SAR;
+    if (inst->nbOperands && isRegisterOf(&inst->operands[0], r))
+        return inst->operands[0].size >= 4; // a 32-bit write clears the upper half
+    return (m == ASM_CQO && r == RDX) || (m == ASM_SYSCALL && (r == RCX || r == R11));
+}
+
+/**
+ * @fn int findLabel(const Code *c, const Operand *target)
+ * @brief Find the label of the function a jump goes to.
+ *
+ * @param c const Code* Function.
+ * @param target const Operand* Operand of the jump.
+ * @return int Position of the label, -1 if it is not in the function.
+ */
+int findLabel(const Code *c, const Operand *target)
+{
+    if (target->kind != IMM_OPERAND || target->symbol == NO_IDENT || target->value)
+        return -1;
+    for (int i = 0; i < c->len; i++)
+        if (c->insts[i].mnemonic == ASM_LABEL && c->insts[i].symbol == target->symbol)
+            return i;
+    return -1;
+}
+
+/**
+ * @fn int isDeadAfter(const Code *c, int pos, int r, int *budget)
+ * @brief Tell if a register, or the flags, is set again before being read on every path leaving an instruction.
+ *
+ * @param c const Code* Function.
+ * @param pos int Position of the instruction.
+ * @param r int Register number, or FLAGS.
+ * @param budget int* Instructions which may still be looked at, decreased by the ones looked at.
+ * @return int 1 if it is proved, 0 otherwise.
+ */
+int isDeadAfter(const Code *c, int pos, int r, int *budget)
+{
+    for (int i = pos + 1; i < c->len; i++)
+    {
+        if ((*budget)-- <= 0)
+            return 0;
+        const Instruction *inst = &c->insts[i];
+        if (inst->mnemonic == ASM_LABEL)
+            continue;
+        if (readsResource(inst, r))
+            return 0;
+
+        int target;
+        switch (inst->mnemonic)
+        {
+        case ASM_JMP:
+            // a jump to another function reads its arguments, then returns to the caller
+            target = findLabel(c, &inst->operands[0]);
+            if (target < 0)
+                return r == FLAGS || (isCallerSaved(r) && r != RAX && !isArgumentRegister(r));
+            i = target;
+            break;
+        case ASM_JCC:
+            target = findLabel(c, &inst->operands[0]);
+            if (target < 0 || !isDeadAfter(c, target, r, budget))
+                return 0;
+            break;
+        case ASM_CALL:
+            if (r == FLAGS || isCallerSaved(r))
+                return 1;
+            break;
+        case ASM_RET:
+            return r == FLAGS || isCallerSaved(r);
+        default:
+            if (writesResource(inst, r))
+                return 1;
+            break;
+        }
+    }
+    return 0;
+}
+
+/* ------- Rules -------- */
+
+/**
+ * @fn void removeInstruction(Code *c, int pos)
+ * @brief Remove an instruction of the function.
+ *
+ * @param c Code* Function.
+ * @param pos int Position of the instruction.
+ */
+void removeInstruction(Code *c, int pos)
+{
+    memmove(&c->insts[pos], &c->insts[pos + 1], (c->len - pos - 1) * sizeof(Instruction));
+    c->len--;
+}
+
+/**
+ * @fn int sameAddress(const Operand *a, const Operand *b)
+ * @brief Tell if two memory operands have the same address.
+ *
+ * @param a const Operand* First operand.
+ * @param b const Operand* Second operand.
+ * @return int 1 if so, 0 otherwise.
+ */
+int sameAddress(const Operand *a, const Operand *b)
+{
+    return a->kind == MEM_OPERAND && b->kind == MEM_OPERAND && a->reg == b->reg && a->index == b->index &&
+           (a->index == NO_REGISTER || a->scale == b->scale) && a->symbol == b->symbol && a->value == b->value;
+}
+
+/**
+ * @fn int isRegisterCopy(const Instruction *inst)
+ * @brief Tell if an instruction copies a whole register into another.
+ *
+ * @param inst const Instruction* Instruction.
+ * @return int 1 if so, 0 otherwise.
+ */
+int isRegisterCopy(const Instruction *inst)
+{
+    return inst->mnemonic == ASM_MOV && inst->operands[0].kind == REG_OPERAND && inst->operands[0].size == 8 &&
+           inst->operands[1].kind == REG_OPERAND && inst->operands[1].size == 8;
+}
+
+/**
+ * @fn int definedValue(const Instruction *inst, Operand *value)
+ * @brief Get the value an instruction gives a whole register: another register, a number or a memory operand.
+ *
+ * @param inst const Instruction* Instruction.
+ * @param value Operand* Value given, filled.
+ * @return int 1 if the instruction only sets a register to such a value, 0 otherwise.
+ */
+int definedValue(const Instruction *inst, Operand *value)
+{
+    if (isZeroing(inst))
+    {
+        *value = (Operand){IMM_OPERAND, 0, NO_REGISTER, NO_REGISTER, 0, NO_IDENT, 0};
+        return 1;
+    }
+    const Operand *src = &inst->operands[1];
+    if (inst->mnemonic != ASM_MOV || inst->operands[0].kind != REG_OPERAND || inst->operands[0].size != 8 ||
+        inst->operands[0].reg == RSP)
+        return 0;
+    if ((src->kind == REG_OPERAND && src->size == 8) || (src->kind == IMM_OPERAND && src->symbol == NO_IDENT) ||
+        (src->kind == MEM_OPERAND && (src->size == 0 || src->size == 8)))
+    {
+        *value = *src;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @fn int substituteOperand(Instruction *inst, int reg, const Operand *value)
+ * @brief Make an instruction read a value instead of a register it only reads as a source.
+ *
+ * @param inst Instruction* Instruction, changed only if the substitution is possible.
+ * @param reg int Register read.
+ * @param value const Operand* Value of the register: a register, a number or a memory operand.
+ * @return int 1 if the instruction was changed, 0 otherwise.
+ */
+int substituteOperand(Instruction *inst, int reg, const Operand *value)
+{
+    int m = inst->mnemonic;
+    Operand *dst = &inst->operands[0];
+    if (!inst->nbOperands || addresses(dst, reg) || m == ASM_SHL || m == ASM_SHR || m == ASM_SAR)
+        return 0;
+    if (m == ASM_PUSH)
+    {
+        if (!isRegisterOf(dst, reg) || (value->kind == IMM_OPERAND && !fitsImm32(value->value)))
+            return 0;
+        *dst = *value;
+        dst->size = 8;
+        return 1;
+    }
+    if (isRegisterOf(dst, reg) || inst->nbOperands < 2 || !isRegisterOf(&inst->operands[1], reg))
+        return 0;
+
+    Operand *use = &inst->operands[1];
+    int arithmetic = m == ASM_MOV || m == ASM_ADD || m == ASM_OR || m == ASM_AND || m == ASM_SUB || m == ASM_XOR ||
+                     m == ASM_CMP || m == ASM_TEST;
+    switch (value->kind)
+    {
+    case REG_OPERAND:
+        use->reg = value->reg;
+        return 1;
+    case IMM_OPERAND:
+        if (use->size != 8)
+            return 0;
+        if (m == ASM_MOV && dst->kind == REG_OPERAND)
+        {
+            *use = *value;
+            return 1;
+        }
+        if (!fitsImm32(value->value))
+            return 0;
+        if (m == ASM_IMUL && inst->nbOperands == 2)
+        {
+            inst->operands[2] = *value;
+            *use = *dst;
+            inst->nbOperands = 3;
+            return 1;
+        }
+        if (!arithmetic)
+            return 0;
+        if (dst->kind == MEM_OPERAND && !dst->size)
+            dst->size = 8;
+        *use = *value;
+        return 1;
+    case MEM_OPERAND:
+        if (use->size != 8 || dst->kind != REG_OPERAND || !(arithmetic || (m == ASM_IMUL && inst->nbOperands == 2)))
+            return 0;
+        *use = *value;
+        use->size = 8;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @fn int pushPop(Code *c, int i)
+ * @brief push a; pop b becomes mov b, a, or nothing when a and b are the same register.
+ *
+ * @param c Code* Function.
+ * @param i int Position of the first instruction.
+ * @return int 1 if the code was rewritten, 0 otherwise.
+ */
+int pushPop(Code *c, int i)
+{
+    Instruction *push = &c->insts[i];
+    Instruction *pop = push + 1;
+    if (i + 1 >= c->len || push->mnemonic != ASM_PUSH || pop->mnemonic != ASM_POP)
+        return 0;
+    Operand src = push->operands[0];
+    Operand dst = pop->operands[0];
+    if (isRegisterOf(&src, RSP) || addresses(&src, RSP) || isRegisterOf(&dst, RSP) || addresses(&dst, RSP) ||
+        (src.kind == MEM_OPERAND && dst.kind == MEM_OPERAND))
+        return 0;
+
+    if (src.kind == REG_OPERAND && isRegisterOf(&dst, src.reg))
+    {
+        removeInstruction(c, i + 1);
+        removeInstruction(c, i);
+        return 1;
+    }
+    if (dst.kind == MEM_OPERAND)
+        dst.size = 8;
+    pop->mnemonic = ASM_MOV;
+    pop->nbOperands = 2;
+    pop->operands[0] = dst;
+    pop->operands[1] = src;
+    removeInstruction(c, i);
+    return 1;
+}
+
+/**
+ * @fn int forwardedLoad(Code *c, int i)
+ * @brief A load of the value just stored becomes a copy of the register stored, or disappears.
+ *
+ * @param c Code* Function.
+ * @param i int Position of the first instruction.
+ * @return int 1 if the code was rewritten, 0 otherwise.
+ */
+int forwardedLoad(Code *c, int i)
+{
+    Instruction *store = &c->insts[i];
+    Instruction *load = store + 1;
+    if (i + 1 >= c->len || store->mnemonic != ASM_MOV || load->mnemonic != ASM_MOV)
+        return 0;
+    const Operand *value = &store->operands[1];
+    const Operand *dst = &load->operands[0];
+    const Operand *src = &load->operands[1];
+    if (value->kind != REG_OPERAND || value->size < 4 || dst->kind != REG_OPERAND || dst->size != value->size ||
+        !sameAddress(&store->operands[0], src) || (src->size && src->size != value->size))
+        return 0;
+
+    if (dst->reg == value->reg)
+        removeInstruction(c, i + 1);
+    else
+        load->operands[1] = *value;
+    return 1;
+}
+
+/**
+ * @fn int redundantMove(Code *c, int i)
+ * @brief Remove the copy of a register into itself, or back into the register it was just copied from.
+ *
+ * @param c Code* Function.
+ * @param i int Position of the first instruction.
+ * @return int 1 if the code was rewritten, 0 otherwise.
+ */
+int redundantMove(Code *c, int i)
+{
+    const Instruction *copy = &c->insts[i];
+    if (!isRegisterCopy(copy))
+        return 0;
+    if (copy->operands[0].reg == copy->operands[1].reg)
+    {
+        removeInstruction(c, i);
+        return 1;
+    }
+    const Instruction *back = copy + 1;
+    if (i + 1 >= c->len || !isRegisterCopy(back) || back->operands[0].reg != copy->operands[1].reg ||
+        back->operands[1].reg != copy->operands[0].reg)
+        return 0;
+    removeInstruction(c, i + 1);
+    return 1;
+}
+
+/**
+ * @fn int deadMove(Code *c, int i)
+ * @brief Remove an instruction setting a register which is set again before being read.
+ *
+ * @param c Code* Function.
+ * @param i int Position of the instruction.
+ * @return int 1 if the code was rewritten, 0 otherwise.
+ */
+int deadMove(Code *c, int i)
+{
+    const Instruction *inst = &c->insts[i];
+    int m = inst->mnemonic;
+    const Operand *dst = &inst->operands[0];
+    if (!(m == ASM_MOV || m == ASM_MOVSX || m == ASM_MOVZX || m == ASM_LEA || isZeroing(inst)) ||
+        dst->kind != REG_OPERAND || dst->size < 4 || dst->reg == RSP || dst->reg == RBP)
+        return 0;
+
+    int budget = c->window - 1;
+    if (!isDeadAfter(c, i, dst->reg, &budget))
+        return 0;
+    budget = c->window - 1;
+    if (isZeroing(inst) && !isDeadAfter(c, i, FLAGS, &budget))
+        return 0;
+    removeInstruction(c, i);
+    return 1;
+}
+
+/**
+ * @fn int propagatedOperand(Code *c, int i)
+ * @brief A register set then read by the next instruction and never again is replaced there by its value.
+ *
+ * @param c Code* Function.
+ * @param i int Position of the first instruction.
+ * @return int 1 if the code was rewritten, 0 otherwise.
+ */
+int propagatedOperand(Code *c, int i)
+{
+    const Instruction *def = &c->insts[i];
+    Operand value;
+    if (i + 1 >= c->len || c->insts[i + 1].mnemonic < ASM_MOV || !definedValue(def, &value))
+        return 0;
+    int reg = def->operands[0].reg;
+    Instruction use = c->insts[i + 1];
+    if (!substituteOperand(&use, reg, &value) || readsResource(&use, reg))
+        return 0;
+
+    int budget = c->window - 2;
+    if (!isDeadAfter(c, i + 1, reg, &budget))
+        return 0;
+    budget = c->window - 1;
+    if (isZeroing(def) && !isDeadAfter(c, i, FLAGS, &budget))
+        return 0;
+    c->insts[i + 1] = use;
+    removeInstruction(c, i);
+    return 1;
+}
+
+/**
+ * @fn int imulImmediate(Code *c, int i)
+ * @brief mov r, n; imul r, x becomes imul r, x, n.
+ *
+ * @param c Code* Function.
+ * @param i int Position of the first instruction.
+ * @return int 1 if the code was rewritten, 0 otherwise.
+ */
+int imulImmediate(Code *c, int i)
+{
+    const Instruction *def = &c->insts[i];
+    Instruction *mul = &c->insts[i + 1];
+    const Operand *dst = &def->operands[0];
+    const Operand *factor = &def->operands[1];
+    if (i + 1 >= c->len || def->mnemonic != ASM_MOV || dst->kind != REG_OPERAND || dst->size != 8 ||
+        factor->kind != IMM_OPERAND || factor->symbol != NO_IDENT || !fitsImm32(factor->value))
+        return 0;
+    if (mul->mnemonic != ASM_IMUL || mul->nbOperands != 2 || !isRegisterOf(&mul->operands[0], dst->reg) ||
+        mul->operands[0].size != 8 || isRegisterOf(&mul->operands[1], dst->reg) || addresses(&mul->operands[1], dst->reg))
+        return 0;
+
+    mul->operands[2] = *factor;
+    mul->nbOperands = 3;
+    removeInstruction(c, i);
+    return 1;
+}
+
+/**
+ * @fn int addToLea(Code *c, int i)
+ * @brief A copy followed by an addition to the copy becomes a lea, when the flags are not read.
+ *
+ * @param c Code* Function.
+ * @param i int Position of the first instruction.
+ * @return int 1 if the code was rewritten, 0 otherwise.
+ */
+int addToLea(Code *c, int i)
+{
+    const Instruction *def = &c->insts[i];
+    Instruction *add = &c->insts[i + 1];
+    if (i + 1 >= c->len || def->mnemonic != ASM_MOV || (add->mnemonic != ASM_ADD && add->mnemonic != ASM_SUB))
+        return 0;
+    const Operand *dst = &def->operands[0];
+    const Operand *init = &def->operands[1];
+    const Operand *added = &add->operands[1];
+    if (dst->kind != REG_OPERAND || dst->size != 8 || !isRegisterOf(&add->operands[0], dst->reg) || add->operands[0].size != 8)
+        return 0;
+
+    Operand address = {MEM_OPERAND, 0, NO_REGISTER, NO_REGISTER, 0, NO_IDENT, 0};
+    if (init->kind == REG_OPERAND && init->size == 8 && added->kind == IMM_OPERAND && added->symbol == NO_IDENT &&
+        fitsImm32(added->value) && fitsImm32(-added->value))
+    {
+        address.reg = init->reg;
+        address.value = add->mnemonic == ASM_SUB ? -added->value : added->value;
+    }
+    else if (add->mnemonic == ASM_ADD && added->kind == REG_OPERAND && added->size == 8)
+    {
+        if (init->kind == REG_OPERAND && init->size == 8)
+        {
+            address.reg = init->reg;
+            address.index = added->reg == dst->reg ? init->reg : added->reg;
+            address.scale = 1;
+        }
+        else if (init->kind == IMM_OPERAND && init->symbol == NO_IDENT && fitsImm32(init->value) && added->reg != dst->reg)
+        {
+            address.reg = added->reg;
+            address.value = init->value;
+        }
+        else
+            return 0;
+        if (address.index == RSP)
+        {
+            address.index = address.reg;
+            address.reg = RSP;
+        }
+        if (address.index == RSP)
+            return 0;
+    }
+    else
+        return 0;
+
+    int budget = c->window - 2;
+    if (!isDeadAfter(c, i + 1, FLAGS, &budget))
+        return 0;
+    add->mnemonic = ASM_LEA;
+    add->operands[1] = address;
+    removeInstruction(c, i);
+    return 1;
+}
+
+/**
+ * @fn int labelFollows(const Code *c, int pos, const Operand *target)
+ * @brief Tell if a label a jump goes to is among the labels starting at a position.
+ *
+ * @param c const Code* Function.
+ * @param pos int Position.
+ * @param target const Operand* Operand of the jump.
+ * @return int 1 if so, 0 otherwise.
+ */
+int labelFollows(const Code *c, int pos, const Operand *target)
+{
+    for (; pos < c->len && c->insts[pos].mnemonic == ASM_LABEL; pos++)
+        if (target->kind == IMM_OPERAND && !target->value && c->insts[pos].symbol == target->symbol)
+            return 1;
+    return 0;
+}
+
+/**
+ * @fn int jump(Code *c, int i)
+ * @brief Remove a jump to the next instruction, and make a conditional jump over a jump go to its target instead.
+ *
+ * @param c Code* Function.
+ * @param i int Position of the first instruction.
+ * @return int 1 if the code was rewritten, 0 otherwise.
+ */
+int jump(Code *c, int i)
+{
+    Instruction *inst = &c->insts[i];
+    if (inst->mnemonic == ASM_JMP && labelFollows(c, i + 1, &inst->operands[0]))
+    {
+        removeInstruction(c, i);
+        return 1;
+    }
+    if (inst->mnemonic != ASM_JCC || c->window < 3 || i + 1 >= c->len || c->insts[i + 1].mnemonic != ASM_JMP ||
+        !labelFollows(c, i + 2, &inst->operands[0]))
+        return 0;
+
+    inst->cond ^= 1; // the condition codes go by pairs of opposites
+    inst->operands[0] = c->insts[i + 1].operands[0];
+    removeInstruction(c, i + 1);
+    return 1;
+}
+
+/* Rules in the order they are tried on an instruction, as in PeepholeRule */
+static int (*const RULES[NB_PEEPHOLE_RULES])(Code *, int) = {
+    pushPop, forwardedLoad, redundantMove, deadMove, propagatedOperand, imulImmediate, addToLea, jump};
+
+/* ------- Whole function -------- */
+
+/**
+ * @fn int countInstructions(const Code *c)
+ * @brief Count the instructions of a function, its labels excepted.
+ *
+ * @param c const Code* Function.
+ * @return int Number of instructions.
+ */
+int countInstructions(const Code *c)
+{
+    int nb = 0;
+    for (int i = 0; i < c->len; i++)
+        nb += c->insts[i].mnemonic >= ASM_MOV;
+    return nb;
+}
+
+/**
+ * @fn int isRewritable(const Code *c)
+ * @brief Tell if a function only holds labels and instructions, which are all the peephole knows.
+ *
+ * @param c const Code* Function.
+ * @return int 1 if so, 0 otherwise.
+ */
+int isRewritable(const Code *c)
+{
+    for (int i = 0; i < c->len; i++)
+        if (c->insts[i].mnemonic != ASM_LABEL && c->insts[i].mnemonic < ASM_MOV)
+            return 0;
+    return 1;
+}
+
+/**
+ * @fn int rewriteCode(Code *c, PeepholeStats *stats)
+ * @brief Try the rules once on every instruction of a function.
+ *
+ * @param c Code* Function.
+ * @param stats PeepholeStats* Statistics, the rewritings being counted.
+ * @return int 1 if the code was rewritten, 0 otherwise.
+ */
+int rewriteCode(Code *c, PeepholeStats *stats)
+{
+    int changed = 0;
+    for (int i = 0; i < c->len; i++)
+    {
+        for (int rule = 0; rule < NB_PEEPHOLE_RULES && c->insts[i].mnemonic >= ASM_MOV; rule++)
+        {
+            if (RULES[rule](c, i))
+            {
+                stats->applied[rule]++;
+                changed = 1;
+                break;
+            }
+        }
+    }
+    return changed;
+}
+
+/**
+ * @fn ReturnInfo peepholeEmitted(unsigned long start, int window, PeepholeStats *stats)
+ * @brief Rewrite the function emitted last, until no rule applies, and emit it again if it changed.
+ *
+ * @param start unsigned long Offset of the function in the emitted text, which it ends.
+ * @param window int Instructions a rewriting may look at, below MIN_PEEPHOLE_WINDOW nothing being done.
+ * @param stats PeepholeStats* Statistics of the function, filled.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo peepholeEmitted(unsigned long start, int window, PeepholeStats *stats)
+{
+    memset(stats, 0, sizeof(PeepholeStats));
+    if (window < MIN_PEEPHOLE_WINDOW)
+        return SUCCESS;
+
+    unsigned long len;
+    const char *text = emittedText(&len);
+    Code c = {NULL, 0, window};
+    ReturnInfo info = parseInstructions(text + start, len - start, &c.insts, &c.len);
+    if (info != SUCCESS)
+        return info;
+
+    stats->before = countInstructions(&c);
+    int changed = 0;
+    if (isRewritable(&c))
+        while (rewriteCode(&c, stats))
+            changed = 1;
+    stats->after = countInstructions(&c);
+
+    if (changed)
+    {
+        // the local labels are emitted unqualified, as the writer gave them
+        ident_t scope = c.len && c.insts[0].mnemonic == ASM_LABEL ? c.insts[0].symbol : NO_IDENT;
+        truncateEmitted(start);
+        for (int i = 0; i < c.len; i++)
+            emitInstruction(&c.insts[i], scope);
+    }
+    free(c.insts);
+    return SUCCESS;
+}
+
+/**
+ * @fn void printPeepholeStats(const char *function, const PeepholeStats *stats)
+ * @brief Print what the peephole did to a function.
+ *
+ * @param function const char* Name of the function.
+ * @param stats const PeepholeStats* Statistics of the function.
+ */
+void printPeepholeStats(const char *function, const PeepholeStats *stats)
+{
+    fprintf(stdout, "%s: %d -> %d instructions", function, stats->before, stats->after);
+    const char *separator = " (";
+    for (int rule = 0; rule < NB_PEEPHOLE_RULES; rule++)
+    {
+        if (stats->applied[rule])
+        {
+            fprintf(stdout, "%s%s %d", separator, RULE_NAMES[rule], stats->applied[rule]);
+            separator = ", ";
+        }
+    }
+    fprintf(stdout, "%s\n", separator[0] == ',' ? ")" : "");
+}
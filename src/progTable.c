@@ -40,7 +40,7 @@ ReturnInfo fillProgTable(ProgTable *t, Node *root)
     Node *declGlob = getChildLabeled(root, DeclVarsGlobale);
     if (declGlob)
     {
-        ReturnInfo localsAdded = addListOfSymbol(&t->glob, declGlob, *t);
+        ReturnInfo localsAdded = addListOfSymbol(&t->glob, declGlob, t);
         if (localsAdded != SUCCESS)
             return localsAdded;
     }
@@ -49,7 +49,7 @@ ReturnInfo fillProgTable(ProgTable *t, Node *root)
     if (defaultFunctionsAdded != SUCCESS)
         return defaultFunctionsAdded;
 
-    ReturnInfo functionsAdded = addFunctions(&t->functions, root, *t);
+    ReturnInfo functionsAdded = addFunctions(&t->functions, root, t);
     if (functionsAdded != SUCCESS)
         return functionsAdded;
 
@@ -60,22 +60,19 @@ ReturnInfo fillProgTable(ProgTable *t, Node *root)
 }
 
 /**
- * @fn FunctionInfo getFunctionsTable(ProgTable t, char *funName)
+ * @fn const FunctionInfo *getFunctionsTable(const ProgTable *t, ident_t funName)
  * @brief Get a function from a program table based on it's name.
  * 
- * @param t ProgTable Table to get the function from.
- * @param funName char* Name of the function.
- * @return FunctionInfo Function found.
+ * @param t const ProgTable* Table to get the function from.
+ * @param funName ident_t Name of the function.
+ * @return const FunctionInfo* Function found, NULL if there is none.
  */
-FunctionInfo getFunctionsTable(ProgTable t, char *funName)
+const FunctionInfo *getFunctionsTable(const ProgTable *t, ident_t funName)
 {
-    for (int i = 0; i < t.functions.len || !funName; i++)
-    {
-        if (!strcmp(t.functions.functions[i].id, funName))
-            return t.functions.functions[i];
-    }
-    FunctionInfo err = {"err"};
-    return err;
+    int index;
+    if (isFunctionInTable(&t->functions, funName, &index) == ID_IN_TABLE)
+        return &t->functions.functions[index];
+    return NULL;
 }
 
 /**
@@ -94,47 +91,47 @@ void freeProgTable(ProgTable *t)
 }
 
 /**
- * @fn void printProgTable(ProgTable t, int showAllTables, int showAllFunctions, char *functionToShow, int showGlobals)
+ * @fn void printProgTable(const ProgTable *t, int showAllTables, int showAllFunctions, char *functionToShow, int showGlobals)
  * @brief Print a program table.
  * 
- * @param t ProgTable Table to print.
+ * @param t const ProgTable* Table to print.
  * @param showAllTables int Show all the tables.
  * @param showAllFunctions int Show all the functions.
  * @param functionToShow char* Function to show.
  * @param showGlobals int Show the globals.
  */
-void printProgTable(ProgTable t, int showAllTables, int showAllFunctions,
+void printProgTable(const ProgTable *t, int showAllTables, int showAllFunctions,
                     char *functionToShow, int showGlobals)
 {
     if (showGlobals || showAllTables)
     {
         fprintf(stdout, "Global variable's table:\n");
-        printSymbolTable(t.glob);
+        printSymbolTable(t->glob);
         fprintf(stdout, "\n");
     }
 
     if (showAllFunctions || showAllTables)
     {
         fprintf(stdout, "Function's table:\n");
-        printFunctionTable(t.functions);
+        printFunctionTable(t->functions);
         fprintf(stdout, "\n");
     }
 
     if (showAllTables)
     {
-        for (int i = 0; i < t.functions.len; i++)
+        for (int i = 0; i < t->functions.len; i++)
         {
-            printOneFunction(t.functions.functions[i]);
+            printOneFunction(t->functions.functions[i]);
             fprintf(stdout, "\n");
         }
     }
 
     if (strlen(functionToShow))
     {
-        FunctionInfo toShow = getFunctionsTable(t, functionToShow);
-        if (strcmp(toShow.id, "err"))
+        const FunctionInfo *toShow = getFunctionsTable(t, internString(functionToShow));
+        if (toShow)
         {
-            printOneFunction(toShow);
+            printOneFunction(*toShow);
             fprintf(stdout, "\n");
         }
         else
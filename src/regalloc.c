@@ -0,0 +1,345 @@
+/**
+ * @file regalloc.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Linear scan allocation of the virtual registers of a lowered function.
+ * @date 2024-02-10
+ *
+ * Each virtual register gets the interval of instructions it is live on, from
+ * the liveness of the blocks of the control-flow graph. The intervals are
+ * scanned by increasing start, taking a free machine register or spilling the
+ * interval which ends the last when none is left. rax, rcx and rdx are kept as
+ * scratch registers by the writer, so they are never given. An interval
+ * crossing a call only gets a callee-saved register, caller-saved ones being
+ * clobbered by the call.
+ * A free register is chosen from hints when possible: the register a parameter
+ * arrives in or an argument leaves to, else the one of the operand an
+ * instruction overwrites, so that the writer has no move to write.
+ */
+
+#include <stdlib.h>
+#include "regalloc.h"
+#include "cfg.h"
+
+#define CALLEE_SAVED_MASK (1 << RBX | 1 << R12 | 1 << R13 | 1 << R14 | 1 << R15)
+
+const int ARG_REGISTERS[6] = {RDI, RSI, RDX, RCX, R8, R9};
+
+/* Registers given to intervals which do not cross a call, the callee-saved ones last */
+static const int ALLOCATABLE[] = {RSI, RDI, R8, R9, R10, R11, RBX, R12, R13, R14, R15};
+#define NB_ALLOCATABLE (int)(sizeof(ALLOCATABLE) / sizeof(ALLOCATABLE[0]))
+
+typedef struct _interval
+{
+    vreg_t vreg;
+    int start;
+    int end;
+    int crossesCall;
+    int hint;           /* Register the value arrives in or leaves to, NO_REGISTER if none */
+    vreg_t hintVreg;    /* Operand overwritten by the instruction defining the value, NO_VREG if none */
+} Interval;
+
+/**
+ * @fn void touchInterval(Interval *intervals, vreg_t vreg, int position)
+ * @brief Extend the interval of a virtual register to a position it is live at.
+ *
+ * @param intervals Interval* Interval of each virtual register.
+ * @param vreg vreg_t Virtual register live.
+ * @param position int Position of the instruction.
+ */
+void touchInterval(Interval *intervals, vreg_t vreg, int position)
+{
+    Interval *interval = &intervals[vreg];
+    if (interval->start < 0 || position < interval->start)
+        interval->start = position;
+    if (position > interval->end)
+        interval->end = position;
+}
+
+/**
+ * @fn void scanBlock(const IrFunction *ir, const BasicBlock *block, unsigned long *live, Interval *intervals)
+ * @brief Walk a block backward from the virtual registers live at its exit,
+ * marking the ones still live after a call as crossing it.
+ *
+ * @param ir const IrFunction* Function allocated.
+ * @param block const BasicBlock* Block walked.
+ * @param live unsigned long* Virtual registers live at the exit of the block, updated.
+ * @param intervals Interval* Interval of each virtual register.
+ */
+void scanBlock(const IrFunction *ir, const BasicBlock *block, unsigned long *live, Interval *intervals)
+{
+    for (int pos = block->end - 1; pos >= block->first; pos--)
+    {
+        const IrInstr *instr = &ir->instrs[pos];
+        if (instr->dst != NO_VREG)
+        {
+            touchInterval(intervals, instr->dst, pos);
+            REMOVE_FROM_SET(live, instr->dst);
+        }
+
+        vreg_t operands[3];
+        int nb = getIrOperands(instr, operands);
+        if (instr->op == IR_CALL)
+        {
+            for (vreg_t v = 0; v < ir->nbVregs; v++)
+                if (IS_IN_SET(live, v))
+                    intervals[v].crossesCall = 1;
+            for (int i = 0; i < instr->imm; i++)
+            {
+                touchInterval(intervals, ir->callArgs[instr->a + i], pos);
+                ADD_TO_SET(live, ir->callArgs[instr->a + i]);
+            }
+        }
+        for (int i = 0; i < nb; i++)
+        {
+            touchInterval(intervals, operands[i], pos);
+            ADD_TO_SET(live, operands[i]);
+        }
+    }
+}
+
+/**
+ * @fn void findHints(const IrFunction *ir, Interval *intervals)
+ * @brief Find the register hints of the virtual registers: the argument register of a
+ * parameter or of a call argument first, the operand a two-operand instruction overwrites next.
+ *
+ * @param ir const IrFunction* Function allocated.
+ * @param intervals Interval* Interval of each virtual register, updated.
+ */
+void findHints(const IrFunction *ir, Interval *intervals)
+{
+    for (int pos = 0; pos < ir->len; pos++)
+    {
+        const IrInstr *instr = &ir->instrs[pos];
+        switch (instr->op)
+        {
+        case IR_PARAM:
+            if (instr->imm < 6)
+                intervals[instr->dst].hint = ARG_REGISTERS[instr->imm];
+            break;
+        case IR_CALL:
+            for (int i = 0; i < instr->imm && i < 6; i++)
+                if (intervals[ir->callArgs[instr->a + i]].hint == NO_REGISTER)
+                    intervals[ir->callArgs[instr->a + i]].hint = ARG_REGISTERS[i];
+            break;
+        case IR_COPY:
+        case IR_EXTEND:
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_NEG:
+            intervals[instr->dst].hintVreg = instr->a;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * @fn ReturnInfo buildIntervals(const IrFunction *ir, Interval *intervals)
+ * @brief Compute the interval of every virtual register, which covers every
+ * instruction referencing it and every block it is live at the entry or exit of.
+ *
+ * @param ir const IrFunction* Function allocated, whose graph is built.
+ * @param intervals Interval* Interval of each virtual register, filled.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo buildIntervals(const IrFunction *ir, Interval *intervals)
+{
+    Liveness live;
+    ReturnInfo info = computeLiveness(ir, &live);
+    if (info != SUCCESS)
+        return info;
+    unsigned long *current = malloc((live.words + 1) * sizeof(unsigned long));
+    if (!current)
+    {
+        freeLiveness(&live);
+        return ALLOC_ERROR;
+    }
+
+    for (vreg_t v = 0; v < ir->nbVregs; v++)
+        intervals[v] = (Interval){v, -1, -1, 0, NO_REGISTER, NO_VREG};
+    findHints(ir, intervals);
+
+    for (int b = 0; b < ir->nbBlocks; b++)
+    {
+        const BasicBlock *block = &ir->blocks[b];
+        for (vreg_t v = 0; v < ir->nbVregs; v++)
+        {
+            if (IS_IN_SET(LIVE_IN(&live, b), v))
+                touchInterval(intervals, v, block->first);
+            if (IS_IN_SET(LIVE_OUT(&live, b), v))
+                touchInterval(intervals, v, block->end - 1);
+        }
+        for (int w = 0; w < live.words; w++)
+            current[w] = LIVE_OUT(&live, b)[w];
+        scanBlock(ir, block, current, intervals);
+    }
+
+    /* A parameter only referenced by its IR_PARAM is never read and needs no location */
+    for (vreg_t v = 0; v < ir->nbParams; v++)
+        if (intervals[v].end == v)
+            intervals[v].start = -1;
+
+    free(current);
+    freeLiveness(&live);
+    return SUCCESS;
+}
+
+/**
+ * @fn int compareStarts(const void *a, const void *b)
+ * @brief Order intervals by increasing start, then by virtual register.
+ *
+ * @param a const void* First interval.
+ * @param b const void* Second interval.
+ * @return int Comparison result, as expected by qsort.
+ */
+int compareStarts(const void *a, const void *b)
+{
+    const Interval *first = a, *second = b;
+    if (first->start != second->start)
+        return first->start - second->start;
+    return first->vreg - second->vreg;
+}
+
+/**
+ * @fn int takeSpillSlot(int *slotEnds, int *nbSlots, const Interval *interval)
+ * @brief Get a spill slot free on the whole interval, reusing the slot of an ended interval if any.
+ *
+ * @param slotEnds int* End of the last interval spilled to each slot.
+ * @param nbSlots int* Number of slots, updated when one is added.
+ * @param interval const Interval* Interval spilled.
+ * @return int Spill slot.
+ */
+int takeSpillSlot(int *slotEnds, int *nbSlots, const Interval *interval)
+{
+    int slot = 0;
+    while (slot < *nbSlots && slotEnds[slot] > interval->start)
+        slot++;
+    if (slot == *nbSlots)
+        (*nbSlots)++;
+    slotEnds[slot] = interval->end;
+    return slot;
+}
+
+/**
+ * @fn ReturnInfo allocateRegisters(const IrFunction *ir, Allocation *alloc)
+ * @brief Give a location to every virtual register of a function.
+ *
+ * @param ir const IrFunction* Function allocated.
+ * @param alloc Allocation* Allocation, filled. To be freed by freeAllocation.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo allocateRegisters(const IrFunction *ir, Allocation *alloc)
+{
+    *alloc = (Allocation){malloc((ir->nbVregs + 1) * sizeof(int)), 0, 0};
+    Interval *intervals = malloc((ir->nbVregs + 1) * sizeof(Interval));
+    int *slotEnds = malloc((ir->nbVregs + 1) * sizeof(int));
+    if (!alloc->locations || !intervals || !slotEnds)
+    {
+        free(intervals);
+        free(slotEnds);
+        freeAllocation(alloc);
+        return ALLOC_ERROR;
+    }
+
+    ReturnInfo info = buildIntervals(ir, intervals);
+    if (info != SUCCESS)
+    {
+        free(intervals);
+        free(slotEnds);
+        freeAllocation(alloc);
+        return info;
+    }
+
+    for (vreg_t v = 0; v < ir->nbVregs; v++)
+        alloc->locations[v] = NO_LOCATION;
+    qsort(intervals, ir->nbVregs, sizeof(Interval), compareStarts);
+
+    /* Intervals holding a register, by increasing end */
+    const Interval *active[NB_ALLOCATABLE];
+    int nbActive = 0;
+    unsigned int freeRegisters = 0;
+    for (int i = 0; i < NB_ALLOCATABLE; i++)
+        freeRegisters |= 1 << ALLOCATABLE[i];
+
+    for (int i = 0; i < ir->nbVregs; i++)
+    {
+        const Interval *cur = &intervals[i];
+        if (cur->start < 0)
+            continue;
+
+        while (nbActive && active[0]->end <= cur->start)
+        {
+            freeRegisters |= 1 << alloc->locations[active[0]->vreg];
+            nbActive--;
+            for (int j = 0; j < nbActive; j++)
+                active[j] = active[j + 1];
+        }
+
+        unsigned int allowed = cur->crossesCall ? CALLEE_SAVED_MASK : ~0u;
+        int reg = NO_REGISTER;
+        int hints[2] = {cur->hint, cur->hintVreg != NO_VREG ? alloc->locations[cur->hintVreg] : NO_LOCATION};
+        for (int j = 0; j < 2 && reg == NO_REGISTER; j++)
+            if (hints[j] >= 0 && hints[j] < SPILLED && freeRegisters & allowed & 1 << hints[j])
+                reg = hints[j];
+        /* Without a hint, the registers hinted by the intervals starting before the end are left to them */
+        unsigned int wanted = 0;
+        for (int j = i + 1; j < ir->nbVregs && intervals[j].start <= cur->end; j++)
+            if (intervals[j].hint != NO_REGISTER)
+                wanted |= 1u << intervals[j].hint;
+        for (int j = 0; j < NB_ALLOCATABLE && reg == NO_REGISTER; j++)
+            if (freeRegisters & allowed & ~wanted & 1 << ALLOCATABLE[j])
+                reg = ALLOCATABLE[j];
+        for (int j = 0; j < NB_ALLOCATABLE && reg == NO_REGISTER; j++)
+            if (freeRegisters & allowed & 1 << ALLOCATABLE[j])
+                reg = ALLOCATABLE[j];
+
+        if (reg == NO_REGISTER)
+        {
+            int victim = -1;
+            for (int j = 0; j < nbActive; j++)
+                if (allowed & 1 << alloc->locations[active[j]->vreg])
+                    victim = j;
+            if (victim < 0 || active[victim]->end <= cur->end)
+            {
+                alloc->locations[cur->vreg] = SPILLED + takeSpillSlot(slotEnds, &alloc->nbSpillSlots, cur);
+                continue;
+            }
+            const Interval *spilled = active[victim];
+            reg = alloc->locations[spilled->vreg];
+            alloc->locations[spilled->vreg] = SPILLED + takeSpillSlot(slotEnds, &alloc->nbSpillSlots, spilled);
+            nbActive--;
+            for (int j = victim; j < nbActive; j++)
+                active[j] = active[j + 1];
+            freeRegisters |= 1 << reg;
+        }
+
+        freeRegisters &= ~(1u << reg);
+        alloc->locations[cur->vreg] = reg;
+        alloc->usedRegisters |= 1 << reg;
+        int j = nbActive++;
+        while (j > 0 && active[j - 1]->end > cur->end)
+        {
+            active[j] = active[j - 1];
+            j--;
+        }
+        active[j] = cur;
+    }
+
+    free(intervals);
+    free(slotEnds);
+    return SUCCESS;
+}
+
+/**
+ * @fn void freeAllocation(Allocation *alloc)
+ * @brief Free an allocation.
+ *
+ * @param alloc Allocation* Allocation to free.
+ */
+void freeAllocation(Allocation *alloc)
+{
+    free(alloc->locations);
+    *alloc = (Allocation){NULL, 0, 0};
+}
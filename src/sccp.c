@@ -0,0 +1,646 @@
+/**
+ * @file sccp.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Sparse conditional constant propagation on the static single assignment form of a function.
+ * @date 2024-02-10
+ *
+ * Every virtual register starts unknown and only goes down to constant then to
+ * varying, while the blocks start unreached and are only reached through the
+ * edges the known conditions take. Once both are stable, the constant values
+ * are computed at compile time, the branches never taken and the blocks never
+ * reached are removed, then the pure instructions whose result is never read.
+ */
+
+#include <limits.h>
+#include <stdlib.h>
+#include "sccp.h"
+#include "ssa.h"
+
+typedef enum
+{
+    UNKNOWN,
+    CONSTANT,
+    VARYING
+} Level;
+
+typedef struct _sccp
+{
+    IrFunction *ir;
+    Ssa *ssa;
+    unsigned char *levels;  /* Level of each virtual register */
+    long *values;           /* Value of each constant virtual register */
+    int *blockOf;           /* Block of each instruction */
+    char *reached;          /* Is each block reached */
+    char *taken;            /* Is the edge to each successor of each block taken, two per block */
+    int *firstUser;         /* Users of v are users[firstUser[v]] to users[firstUser[v + 1] - 1] */
+    int *users;             /* Position of an instruction, or -1 - index of a phi */
+    int *edgeWork;          /* Edges to follow, as block * 2 + successor */
+    int nbEdgeWork;
+    vreg_t *vregWork;       /* Virtual registers whose level went down */
+    int nbVregWork;
+} Sccp;
+
+/* ------- Lattice -------- */
+
+/**
+ * @fn void lowerLevel(Sccp *s, vreg_t v, Level level, long value)
+ * @brief Lower the level of a virtual register, its users being visited again if it changed.
+ *
+ * @param s Sccp* Propagation.
+ * @param v vreg_t Virtual register.
+ * @param level Level New level, ignored if not lower than the current one.
+ * @param value long Value if constant.
+ */
+void lowerLevel(Sccp *s, vreg_t v, Level level, long value)
+{
+    if (v == NO_VREG || level <= s->levels[v])
+        return;
+    s->levels[v] = level;
+    s->values[v] = value;
+    s->vregWork[s->nbVregWork++] = v;
+}
+
+/**
+ * @fn int foldOperation(IrOp op, long a, long b, int size, long *result)
+ * @brief Compute an operation on constants as the processor would, on 64 bits.
+ *
+ * @param op IrOp Operation.
+ * @param a long First operand.
+ * @param b long Second operand, ignored by unary operations.
+ * @param size int Bytes sign extended by an IR_EXTEND.
+ * @param result long* Value computed, filled.
+ * @return int 0 if the operation faults (division by 0 or overflow), 1 otherwise.
+ */
+int foldOperation(IrOp op, long a, long b, int size, long *result)
+{
+    switch (op)
+    {
+    case IR_COPY:
+        *result = a;
+        return 1;
+    case IR_EXTEND:
+        *result = size == 1 ? (long)(signed char)a : size == 4 ? (long)(int)a : a;
+        return 1;
+    case IR_ADD:
+        *result = (long)((unsigned long)a + (unsigned long)b);
+        return 1;
+    case IR_SUB:
+        *result = (long)((unsigned long)a - (unsigned long)b);
+        return 1;
+    case IR_MUL:
+        *result = (long)((unsigned long)a * (unsigned long)b);
+        return 1;
+    case IR_DIV:
+    case IR_MOD:
+        if (!b || (a == LONG_MIN && b == -1))
+            return 0;
+        *result = op == IR_DIV ? a / b : a % b;
+        return 1;
+    case IR_EQ:
+        *result = a == b;
+        return 1;
+    case IR_NE:
+        *result = a != b;
+        return 1;
+    case IR_LT:
+        *result = a < b;
+        return 1;
+    case IR_LE:
+        *result = a <= b;
+        return 1;
+    case IR_GT:
+        *result = a > b;
+        return 1;
+    case IR_GE:
+        *result = a >= b;
+        return 1;
+    case IR_NEG:
+        *result = (long)(0UL - (unsigned long)a);
+        return 1;
+    case IR_NOT:
+        *result = !a;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* ------- Propagation -------- */
+
+/**
+ * @fn void takeEdge(Sccp *s, int block, int succ)
+ * @brief Take the edge from a block to one of its successors, if not taken yet.
+ *
+ * @param s Sccp* Propagation.
+ * @param block int Block left.
+ * @param succ int Index of the successor, 0 or 1.
+ */
+void takeEdge(Sccp *s, int block, int succ)
+{
+    if (s->ir->blocks[block].succs[succ] == NO_BLOCK || s->taken[2 * block + succ])
+        return;
+    s->taken[2 * block + succ] = 1;
+    s->edgeWork[s->nbEdgeWork++] = 2 * block + succ;
+}
+
+/**
+ * @fn int isEdgeTaken(const Sccp *s, int pred, int block)
+ * @brief Tell if an edge from a predecessor to a block is taken.
+ *
+ * @param s const Sccp* Propagation.
+ * @param pred int Predecessor.
+ * @param block int Block entered.
+ * @return int 1 if taken, 0 otherwise.
+ */
+int isEdgeTaken(const Sccp *s, int pred, int block)
+{
+    const BasicBlock *p = &s->ir->blocks[pred];
+    return (p->succs[0] == block && s->taken[2 * pred]) || (p->succs[1] == block && s->taken[2 * pred + 1]);
+}
+
+/**
+ * @fn void visitPhi(Sccp *s, int index)
+ * @brief Meet the levels of the versions merged by a phi through the taken edges.
+ *
+ * @param s Sccp* Propagation.
+ * @param index int Index of the phi.
+ */
+void visitPhi(Sccp *s, int index)
+{
+    const Phi *phi = &s->ssa->phis[index];
+    const BasicBlock *block = &s->ir->blocks[phi->block];
+    if (!s->reached[phi->block])
+        return;
+
+    Level level = UNKNOWN;
+    long value = 0;
+    for (int j = 0; j < nbPhiArgs(s->ir, phi->block) && level != VARYING; j++)
+    {
+        if (j < block->nbPreds && !isEdgeTaken(s, s->ir->preds[block->firstPred + j], phi->block))
+            continue;
+        vreg_t arg = s->ssa->args[phi->firstArg + j];
+        if (s->levels[arg] == VARYING || (s->levels[arg] == CONSTANT && level == CONSTANT && s->values[arg] != value))
+            level = VARYING;
+        else if (s->levels[arg] == CONSTANT)
+        {
+            level = CONSTANT;
+            value = s->values[arg];
+        }
+    }
+    lowerLevel(s, phi->dst, level, value);
+}
+
+/**
+ * @fn Level operandsLevel(const Sccp *s, const IrInstr *instr)
+ * @brief Get the lowest level of the operands a and b of an instruction, a missing b being the constant 0.
+ *
+ * @param s const Sccp* Propagation.
+ * @param instr const IrInstr* Instruction.
+ * @return Level Level of the operands.
+ */
+Level operandsLevel(const Sccp *s, const IrInstr *instr)
+{
+    Level a = s->levels[instr->a];
+    Level b = instr->b == NO_VREG ? CONSTANT : s->levels[instr->b];
+    return a > b ? a : b;
+}
+
+/**
+ * @fn long operandValue(const Sccp *s, vreg_t v)
+ * @brief Get the value of a constant operand, a missing one being 0.
+ *
+ * @param s const Sccp* Propagation.
+ * @param v vreg_t Operand, may be NO_VREG.
+ * @return long Value.
+ */
+long operandValue(const Sccp *s, vreg_t v)
+{
+    return v == NO_VREG ? 0 : s->values[v];
+}
+
+/**
+ * @fn void visitInstr(Sccp *s, int pos)
+ * @brief Compute the level of the virtual register an instruction defines, or the edges it takes.
+ *
+ * @param s Sccp* Propagation.
+ * @param pos int Position of the instruction.
+ */
+void visitInstr(Sccp *s, int pos)
+{
+    const IrInstr *instr = &s->ir->instrs[pos];
+    int block = s->blockOf[pos];
+    long result;
+
+    switch (instr->op)
+    {
+    case IR_CONST:
+        lowerLevel(s, instr->dst, CONSTANT, instr->imm);
+        break;
+    case IR_PARAM:
+    case IR_ADDR:
+    case IR_LOAD:
+    case IR_CALL:
+        lowerLevel(s, instr->dst, VARYING, 0);
+        break;
+    case IR_STORE:
+    case IR_RET:
+    case IR_LABEL:
+        break;
+    case IR_JUMP:
+        takeEdge(s, block, 0);
+        return;
+    case IR_JUMP_EQ:
+    case IR_JUMP_NE:
+    case IR_JUMP_LT:
+    case IR_JUMP_LE:
+    case IR_JUMP_GT:
+    case IR_JUMP_GE:
+        {
+            Level level = operandsLevel(s, instr);
+            int jumps = level == CONSTANT && foldOperation(JUMP_COMPARISON(instr->op), s->values[instr->a], operandValue(s, instr->b), 8, &result) && result;
+            if (level == VARYING || (level == CONSTANT && !jumps))
+                takeEdge(s, block, 0);
+            if (level == VARYING || jumps)
+                takeEdge(s, block, 1);
+        }
+        return;
+    default:
+        {
+            Level level = operandsLevel(s, instr);
+            if (level == VARYING)
+                lowerLevel(s, instr->dst, VARYING, 0);
+            else if (level == CONSTANT)
+            {
+                if (foldOperation(instr->op, s->values[instr->a], operandValue(s, instr->b), instr->size, &result))
+                    lowerLevel(s, instr->dst, CONSTANT, result);
+                else
+                    lowerLevel(s, instr->dst, VARYING, 0);
+            }
+        }
+        break;
+    }
+
+    if (pos == s->ir->blocks[block].end - 1 && instr->op != IR_RET)
+        takeEdge(s, block, 0);
+}
+
+/**
+ * @fn void followEdge(Sccp *s, int edge)
+ * @brief Enter a block through a newly taken edge: its phis are visited again,
+ * and its instructions too if it is reached for the first time.
+ *
+ * @param s Sccp* Propagation.
+ * @param edge int Edge taken, as block * 2 + successor.
+ */
+void followEdge(Sccp *s, int edge)
+{
+    int block = s->ir->blocks[edge / 2].succs[edge % 2];
+    int firstTime = !s->reached[block];
+    s->reached[block] = 1;
+
+    for (int p = s->ssa->firstPhi[block]; p < s->ssa->firstPhi[block + 1]; p++)
+        visitPhi(s, p);
+    if (firstTime)
+        for (int pos = s->ir->blocks[block].first; pos < s->ir->blocks[block].end; pos++)
+            visitInstr(s, pos);
+}
+
+/**
+ * @fn void propagate(Sccp *s)
+ * @brief Propagate the levels and the reached blocks from the entry until they are stable.
+ *
+ * @param s Sccp* Propagation, initialized.
+ */
+void propagate(Sccp *s)
+{
+    s->reached[0] = 1;
+    for (int p = s->ssa->firstPhi[0]; p < s->ssa->firstPhi[1]; p++)
+        visitPhi(s, p);
+    for (int pos = s->ir->blocks[0].first; pos < s->ir->blocks[0].end; pos++)
+        visitInstr(s, pos);
+
+    while (s->nbEdgeWork || s->nbVregWork)
+    {
+        if (s->nbEdgeWork)
+        {
+            followEdge(s, s->edgeWork[--s->nbEdgeWork]);
+            continue;
+        }
+
+        vreg_t v = s->vregWork[--s->nbVregWork];
+        for (int u = s->firstUser[v]; u < s->firstUser[v + 1]; u++)
+        {
+            int user = s->users[u];
+            if (user < 0)
+                visitPhi(s, -1 - user);
+            else if (s->reached[s->blockOf[user]])
+                visitInstr(s, user);
+        }
+    }
+}
+
+/* ------- Rewriting -------- */
+
+/**
+ * @fn void forEachUse(Sccp *s, const IrInstr *instr, int *counts, int delta)
+ * @brief Add a delta to the use count of every virtual register an instruction reads.
+ *
+ * @param s Sccp* Propagation.
+ * @param instr const IrInstr* Instruction.
+ * @param counts int* Use count of each virtual register.
+ * @param delta int Delta added.
+ */
+void forEachUse(Sccp *s, const IrInstr *instr, int *counts, int delta)
+{
+    vreg_t operands[3];
+    int nb = getIrOperands(instr, operands);
+    for (int i = 0; i < nb; i++)
+        counts[operands[i]] += delta;
+    if (instr->op == IR_CALL)
+        for (int i = 0; i < instr->imm; i++)
+            counts[s->ir->callArgs[instr->a + i]] += delta;
+}
+
+/**
+ * @fn void rewriteInstrs(Sccp *s, char *removed)
+ * @brief Replace the instructions computing a constant by the constant, and the
+ * conditional jumps on a constant by the jump they always do, if any.
+ * The instructions of the blocks never reached are removed.
+ *
+ * @param s Sccp* Propagation, stable.
+ * @param removed char* Is each instruction removed, filled.
+ */
+void rewriteInstrs(Sccp *s, char *removed)
+{
+    for (int pos = 0; pos < s->ir->len; pos++)
+    {
+        IrInstr *instr = &s->ir->instrs[pos];
+        if (!s->reached[s->blockOf[pos]])
+            removed[pos] = 1;
+        else if (IS_CONDITIONAL_JUMP(instr->op) && operandsLevel(s, instr) == CONSTANT)
+        {
+            /* The edge of the jump is only taken when the constant comparison holds */
+            if (!s->taken[2 * s->blockOf[pos] + 1])
+                removed[pos] = 1;
+            else
+                *instr = (IrInstr){IR_JUMP, 8, NO_BASE, NO_VREG, NO_VREG, NO_VREG, NO_VREG, NO_IDENT, instr->imm};
+        }
+        else if (instr->dst != NO_VREG && instr->op != IR_CONST && s->levels[instr->dst] == CONSTANT)
+            *instr = (IrInstr){IR_CONST, 8, NO_BASE, instr->dst, NO_VREG, NO_VREG, NO_VREG, NO_IDENT, s->values[instr->dst]};
+    }
+}
+
+/**
+ * @fn int isPure(IrOp op)
+ * @brief Tell if an instruction only computes its result, and may be removed when it is never read.
+ *
+ * @param op IrOp Operation of the instruction.
+ * @return int 1 if pure, 0 otherwise.
+ */
+int isPure(IrOp op)
+{
+    switch (op)
+    {
+    case IR_PARAM:
+    case IR_DIV:
+    case IR_MOD:
+    case IR_STORE:
+    case IR_CALL:
+    case IR_RET:
+    case IR_LABEL:
+    case IR_JUMP:
+    case IR_JUMP_EQ:
+    case IR_JUMP_NE:
+    case IR_JUMP_LT:
+    case IR_JUMP_LE:
+    case IR_JUMP_GT:
+    case IR_JUMP_GE:
+        return 0;
+    default:
+        return 1;
+    }
+}
+
+/**
+ * @fn ReturnInfo removeDeadCode(Sccp *s, char *removed)
+ * @brief Remove the pure instructions and phis whose result is never read, then
+ * the ones only they read, and forget the results of calls never read.
+ *
+ * @param s Sccp* Propagation, rewritten.
+ * @param removed char* Is each instruction removed, updated.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo removeDeadCode(Sccp *s, char *removed)
+{
+    int *counts = calloc(s->ir->nbVregs + 1, sizeof(int));
+    int *defs = malloc((s->ir->nbVregs + 1) * sizeof(int));
+    char *deadPhis = calloc(s->ssa->nbPhis + 1, 1);
+    if (!counts || !defs || !deadPhis)
+    {
+        free(counts);
+        free(defs);
+        free(deadPhis);
+        return ALLOC_ERROR;
+    }
+
+    /* Definition of each virtual register: position, -1 - index of a phi, or NO_VREG */
+    for (vreg_t v = 0; v < s->ir->nbVregs; v++)
+        defs[v] = NO_VREG;
+    for (int pos = 0; pos < s->ir->len; pos++)
+        if (!removed[pos])
+        {
+            forEachUse(s, &s->ir->instrs[pos], counts, 1);
+            if (s->ir->instrs[pos].dst != NO_VREG)
+                defs[s->ir->instrs[pos].dst] = pos;
+        }
+    for (int p = 0; p < s->ssa->nbPhis; p++)
+        if (s->reached[s->ssa->phis[p].block])
+        {
+            defs[s->ssa->phis[p].dst] = -1 - p;
+            for (int j = 0; j < nbPhiArgs(s->ir, s->ssa->phis[p].block); j++)
+                counts[s->ssa->args[s->ssa->phis[p].firstArg + j]]++;
+        }
+
+    /* vregWork is free again and holds the virtual registers found unread */
+    s->nbVregWork = 0;
+    for (vreg_t v = 0; v < s->ir->nbVregs; v++)
+        if (!counts[v] && defs[v] != NO_VREG)
+            s->vregWork[s->nbVregWork++] = v;
+
+    while (s->nbVregWork)
+    {
+        vreg_t v = s->vregWork[--s->nbVregWork];
+        int def = defs[v];
+        int before = s->nbVregWork;
+        if (def < 0)
+        {
+            const Phi *phi = &s->ssa->phis[-1 - def];
+            deadPhis[-1 - def] = 1;
+            for (int j = 0; j < nbPhiArgs(s->ir, phi->block); j++)
+                if (!--counts[s->ssa->args[phi->firstArg + j]])
+                    s->vregWork[s->nbVregWork++] = s->ssa->args[phi->firstArg + j];
+        }
+        else if (isPure(s->ir->instrs[def].op))
+        {
+            vreg_t operands[3];
+            int nb = getIrOperands(&s->ir->instrs[def], operands);
+            removed[def] = 1;
+            for (int i = 0; i < nb; i++)
+                if (!--counts[operands[i]])
+                    s->vregWork[s->nbVregWork++] = operands[i];
+        }
+        else if (s->ir->instrs[def].op == IR_CALL)
+            s->ir->instrs[def].dst = NO_VREG;
+
+        /* Only the virtual registers with a definition left may be removed */
+        for (int i = before; i < s->nbVregWork; i++)
+            if (defs[s->vregWork[i]] == NO_VREG)
+                s->vregWork[i--] = s->vregWork[--s->nbVregWork];
+    }
+
+    free(counts);
+    free(defs);
+    free(deadPhis);
+    return SUCCESS;
+}
+
+/**
+ * @fn void removeUnusedLabels(IrFunction *ir, char *removed)
+ * @brief Remove the labels no jump left goes to, merging their block with the previous one.
+ *
+ * @param ir IrFunction* Function rewritten.
+ * @param removed char* Is each instruction removed, updated.
+ */
+void removeUnusedLabels(IrFunction *ir, char *removed)
+{
+    char *used = calloc(ir->nbLabels + 1, 1);
+    if (!used)
+        return;
+    for (int pos = 0; pos < ir->len; pos++)
+        if (!removed[pos] && (ir->instrs[pos].op == IR_JUMP || IS_CONDITIONAL_JUMP(ir->instrs[pos].op)))
+            used[ir->instrs[pos].imm] = 1;
+    for (int pos = 0; pos < ir->len; pos++)
+        if (ir->instrs[pos].op == IR_LABEL && !used[ir->instrs[pos].imm])
+            removed[pos] = 1;
+    free(used);
+}
+
+/* ------- Pass -------- */
+
+/**
+ * @fn ReturnInfo initSccp(IrFunction *ir, Ssa *ssa, Sccp *s)
+ * @brief Allocate a propagation and list the users of every virtual register.
+ * The variables not defined yet at the entry are varying, their value being unknown.
+ *
+ * @param ir IrFunction* Function in static single assignment form.
+ * @param ssa Ssa* Form of the function.
+ * @param s Sccp* Propagation, filled. To be freed by freeSccp.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo initSccp(IrFunction *ir, Ssa *ssa, Sccp *s)
+{
+    int n = ir->nbVregs + 1;
+    *s = (Sccp){ir, ssa, calloc(n, 1), calloc(n, sizeof(long)), malloc((ir->len + 1) * sizeof(int)),
+                calloc(ir->nbBlocks + 1, 1), calloc(2 * ir->nbBlocks + 1, 1), calloc(n + 1, sizeof(int)), NULL,
+                malloc((2 * ir->nbBlocks + 1) * sizeof(int)), 0, malloc(2 * n * sizeof(vreg_t)), 0};
+    if (!s->levels || !s->values || !s->blockOf || !s->reached || !s->taken || !s->firstUser || !s->edgeWork || !s->vregWork)
+        return ALLOC_ERROR;
+
+    for (vreg_t v = 0; v < ir->nbVariables; v++)
+        s->levels[v] = VARYING;
+    for (int b = 0; b < ir->nbBlocks; b++)
+        for (int pos = ir->blocks[b].first; pos < ir->blocks[b].end; pos++)
+            s->blockOf[pos] = b;
+
+    /* Users are counted in firstUser shifted by one, then listed */
+    for (int pos = 0; pos < ir->len; pos++)
+        forEachUse(s, &ir->instrs[pos], s->firstUser + 1, 1);
+    for (int i = 0; i < ssa->nbArgs; i++)
+        s->firstUser[ssa->args[i] + 1]++;
+    for (vreg_t v = 0; v < ir->nbVregs; v++)
+        s->firstUser[v + 1] += s->firstUser[v];
+    s->users = malloc((s->firstUser[ir->nbVregs] + 1) * sizeof(int));
+    int *filled = calloc(n, sizeof(int));
+    if (!s->users || !filled)
+    {
+        free(filled);
+        return ALLOC_ERROR;
+    }
+
+    for (int pos = 0; pos < ir->len; pos++)
+    {
+        vreg_t operands[3];
+        int nb = getIrOperands(&ir->instrs[pos], operands);
+        for (int i = 0; i < nb; i++)
+            s->users[s->firstUser[operands[i]] + filled[operands[i]]++] = pos;
+        if (ir->instrs[pos].op == IR_CALL)
+            for (int i = 0; i < ir->instrs[pos].imm; i++)
+            {
+                vreg_t arg = ir->callArgs[ir->instrs[pos].a + i];
+                s->users[s->firstUser[arg] + filled[arg]++] = pos;
+            }
+    }
+    for (int p = 0; p < ssa->nbPhis; p++)
+        for (int j = 0; j < nbPhiArgs(ir, ssa->phis[p].block); j++)
+        {
+            vreg_t arg = ssa->args[ssa->phis[p].firstArg + j];
+            s->users[s->firstUser[arg] + filled[arg]++] = -1 - p;
+        }
+    free(filled);
+    return SUCCESS;
+}
+
+/**
+ * @fn void freeSccp(Sccp *s)
+ * @brief Free a propagation.
+ *
+ * @param s Sccp* Propagation to free.
+ */
+void freeSccp(Sccp *s)
+{
+    free(s->levels);
+    free(s->values);
+    free(s->blockOf);
+    free(s->reached);
+    free(s->taken);
+    free(s->firstUser);
+    free(s->users);
+    free(s->edgeWork);
+    free(s->vregWork);
+}
+
+/**
+ * @fn ReturnInfo propagateConstants(IrFunction *ir)
+ * @brief Fold the constants of a function and remove the code they make dead, then build its graph again.
+ *
+ * @param ir IrFunction* Function optimized, whose graph is built.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo propagateConstants(IrFunction *ir)
+{
+    Ssa ssa;
+    ReturnInfo info = buildSsa(ir, &ssa);
+    if (info != SUCCESS)
+        return info;
+
+    Sccp s;
+    char *removed = calloc(ir->len + 1, 1);
+    info = initSccp(ir, &ssa, &s);
+    if (info == SUCCESS && !removed)
+        info = ALLOC_ERROR;
+    if (info == SUCCESS)
+    {
+        propagate(&s);
+        rewriteInstrs(&s, removed);
+        info = removeDeadCode(&s, removed);
+    }
+    if (info == SUCCESS)
+        removeUnusedLabels(ir, removed);
+
+    if (info == SUCCESS)
+        removeIrInstrs(ir, removed);
+    leaveSsa(ir, &ssa);
+    freeSccp(&s);
+    free(removed);
+    return info == SUCCESS ? buildCfg(ir) : info;
+}
@@ -0,0 +1,577 @@
+/**
+ * @file semantic.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Semantic pass: types every expression once, binds every identifier
+ * to its table and checks the program before anything is written.
+ * @date 2024-02-10
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "semantic.h"
+#include "functionTable.h"
+#include "symbolTable.h"
+#include "utilitaries.h"
+
+ReturnInfo checkInstr(Node *instr, const FunctionInfo *funTable);
+ReturnInfo checkFunctionCall(Node *call, const FunctionInfo *funTable);
+
+static const ProgTable *pt;
+
+/**
+ * @fn label_t typeOf(Node *expr, const FunctionInfo *funTable)
+ * @brief Get the type of an expression, computed on the first request only.
+ *
+ * @param expr Node* Expression to type.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return label_t Type of the expression.
+ */
+label_t typeOf(Node *expr, const FunctionInfo *funTable)
+{
+    return getExpressionType(expr, pt, funTable);
+}
+
+/**
+ * @fn const Symbol *bindVariable(Node *ident, const FunctionInfo *funTable)
+ * @brief Bind an identifier to the local, argument or global variable it refers to.
+ *
+ * @param ident Node* Identifier to bind.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return const Symbol* Variable bound, NULL if there is none.
+ */
+const Symbol *bindVariable(Node *ident, const FunctionInfo *funTable)
+{
+    if (isInTable(&funTable->locals, ident->u.ident, &ident->binding) == ID_IN_TABLE)
+    {
+        ident->scope = LOCAL_SCOPE;
+        return &funTable->locals.symbols[ident->binding];
+    }
+    if (isInTable(&funTable->args, ident->u.ident, &ident->binding) == ID_IN_TABLE)
+    {
+        ident->scope = ARG_SCOPE;
+        return &funTable->args.symbols[ident->binding];
+    }
+    if (isInTable(&pt->glob, ident->u.ident, &ident->binding) == ID_IN_TABLE)
+    {
+        ident->scope = GLOBAL_SCOPE;
+        return &pt->glob.symbols[ident->binding];
+    }
+    fprintf(stderr, "Unidentified indetififer : %s. Line %d\n", identToString(ident->u.ident), ident->lineno);
+    return NULL;
+}
+
+/**
+ * @fn ReturnInfo checkIndex(Node *indexNode, const FunctionInfo *funTable)
+ * @brief Check the index of an array access.
+ *
+ * @param indexNode Node* Index to check, may be NULL.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkIndex(Node *indexNode, const FunctionInfo *funTable)
+{
+    if (!indexNode)
+        return SUCCESS;
+    if (typeOf(indexNode, funTable) == Void)
+    {
+        fprintf(stderr, "Void-like expression used to describe an index at line %d.\n", indexNode->lineno);
+        return VOID_INDEX;
+    }
+    return checkInstr(indexNode, funTable);
+}
+
+/**
+ * @fn ReturnInfo checkPushIdent(Node *ident, const FunctionInfo *funTable)
+ * @brief Check an identifier whose value is read.
+ *
+ * @param ident Node* Identifier to check.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkPushIdent(Node *ident, const FunctionInfo *funTable)
+{
+    if (FIRSTCHILD(ident) && FIRSTCHILD(ident)->label == Arguments)
+        return checkFunctionCall(ident, funTable);
+
+    const Symbol *var = bindVariable(ident, funTable);
+    if (!var)
+        return ID_NOT_IN_TABLE;
+
+    int indexable = ident->scope == ARG_SCOPE ? var->isAddress : var->isArray;
+    if (indexable && FIRSTCHILD(ident))
+        return checkIndex(FIRSTCHILD(ident), funTable);
+    if (FIRSTCHILD(ident))
+    {
+        fprintf(stderr, "Array unexpected at line %d\n", ident->lineno);
+        return ARRAY_UNEXPECTED;
+    }
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo checkGetIdent(Node *ident, const FunctionInfo *funTable)
+ * @brief Check an identifier which is assigned.
+ *
+ * @param ident Node* Identifier to check.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkGetIdent(Node *ident, const FunctionInfo *funTable)
+{
+    const Symbol *var = bindVariable(ident, funTable);
+    if (!var)
+        return ID_NOT_IN_TABLE;
+
+    switch (ident->scope)
+    {
+    case LOCAL_SCOPE:
+        if (var->isArray && FIRSTCHILD(ident))
+            return checkIndex(FIRSTCHILD(ident), funTable);
+        break;
+    case ARG_SCOPE:
+        if (var->isAddress)
+            return checkIndex(FIRSTCHILD(ident), funTable);
+        break;
+    default:
+        /* An index on a global scalar is ignored when assigning it */
+        if (var->isArray)
+            return checkIndex(FIRSTCHILD(ident), funTable);
+        return SUCCESS;
+    }
+
+    if (FIRSTCHILD(ident))
+    {
+        fprintf(stderr, "Array unexpected at line %d\n", ident->lineno);
+        return ARRAY_UNEXPECTED;
+    }
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo checkArgummentType(Node *arg, const FunctionInfo *callingFun, int argIndex, const FunctionInfo *funCalled)
+ * @brief Check if the type of the argument is correct.
+ *
+ * @param arg Node* Argument to check.
+ * @param callingFun const FunctionInfo* Function we are calling.
+ * @param argIndex int Index of the argument.
+ * @param funCalled const FunctionInfo* Function we are calling.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkArgummentType(Node *arg, const FunctionInfo *callingFun, int argIndex, const FunctionInfo *funCalled)
+{
+    int callingFunctionsVariablesIndex;
+    const Symbol *funCalledArg = &funCalled->args.symbols[argIndex];
+    if (isInTable(&callingFun->args, arg->u.ident, &callingFunctionsVariablesIndex) == ID_IN_TABLE)
+    {
+        const Symbol *callingArg = &callingFun->args.symbols[callingFunctionsVariablesIndex];
+        if (callingArg->isAddress && funCalledArg->isAddress)
+        {
+            if (callingArg->type != funCalled->args.symbols[argIndex].type)
+            {
+                fprintf(stderr, "ERROR: %s[] expected, got %s[] at line %d\n", funCalledArg->type == INT ? "int" : "char", callingArg->type == INT ? "int" : "char", arg->lineno);
+                return INVALID_ARGUMENT_TYPE;
+            }
+        }
+        else if (callingArg->isAddress && !FIRSTCHILD(arg) && !funCalledArg->isAddress)
+        {
+            fprintf(stderr, "ERROR: %s[] expected, got %s at line %d\n", funCalledArg->type == INT ? "int" : "char", callingArg->type == INT ? "int" : "char", arg->lineno);
+            return INVALID_ARGUMENT_TYPE;
+        }
+        else if (!callingArg->isAddress && funCalledArg->isAddress)
+        {
+            fprintf(stderr, "ERROR: %s expected, got %s[] at line %d\n", funCalledArg->type == INT ? "int" : "char", callingArg->type == INT ? "int" : "char", arg->lineno);
+            return INVALID_ARGUMENT_TYPE;
+        }
+    }
+    else
+    {
+        const Symbol *callingArg;
+        if (isInTable(&callingFun->locals, arg->u.ident, &callingFunctionsVariablesIndex) == ID_IN_TABLE)
+            callingArg = &callingFun->locals.symbols[callingFunctionsVariablesIndex];
+        else if (isInTable(&pt->glob, arg->u.ident, &callingFunctionsVariablesIndex) == ID_IN_TABLE)
+            callingArg = &pt->glob.symbols[callingFunctionsVariablesIndex];
+        else
+            return SUCCESS;
+
+        if (callingArg->isArray && !FIRSTCHILD(arg) && !funCalledArg->isAddress)
+        {
+            fprintf(stderr, "ERROR: %s expected, got %s[] at line %d\n", funCalledArg->type == INT ? "int" : "char", callingArg->type == INT ? "int" : "char", arg->lineno);
+            return INVALID_ARGUMENT_TYPE;
+        }
+        else if (callingArg->isArray && FIRSTCHILD(arg) && funCalledArg->isAddress)
+        {
+            fprintf(stderr, "ERROR: %s[] expected, got %s at line %d\n", funCalledArg->type == INT ? "int" : "char", callingArg->type == INT ? "int" : "char", arg->lineno);
+            return INVALID_ARGUMENT_TYPE;
+        }
+        else if (callingArg->isArray && !FIRSTCHILD(arg) && funCalledArg->isAddress && callingArg->type != funCalledArg->type)
+        {
+            fprintf(stderr, "ERROR: %s[] expected, got %s[] at line %d\n", funCalledArg->type == INT ? "int" : "char", callingArg->type == INT ? "int" : "char", arg->lineno);
+            return INVALID_ARGUMENT_TYPE;
+        }
+        else if (!callingArg->isArray && funCalledArg->isAddress)
+        {
+            fprintf(stderr, "ERROR: %s[] expected, got %s at line %d\n", funCalledArg->type == INT ? "int" : "char", callingArg->type == INT ? "int" : "char", arg->lineno);
+            return INVALID_ARGUMENT_TYPE;
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo checkArg(Node *arg, const FunctionInfo *funTable, int argIndex, const FunctionInfo *funCalled)
+ * @brief Check the arguments of a call, from the last one to the first one.
+ *
+ * @param arg Node* Argument list to check.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @param argIndex int Index of the argument.
+ * @param funCalled const FunctionInfo* Function we are calling.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkArg(Node *arg, const FunctionInfo *funTable, int argIndex, const FunctionInfo *funCalled)
+{
+    if (!arg || arg->label == Void)
+        return SUCCESS;
+
+    if (typeOf(arg, funTable) == Void)
+    {
+        fprintf(stderr, "Error: Void-like argument passed to a function at line %d.\n", arg->lineno);
+        return VOID_ARGUMENT_PASSED;
+    }
+
+    ReturnInfo info = checkArg(NEXTSIBLING(arg), funTable, argIndex + 1, funCalled);
+    if (info != SUCCESS)
+        return info;
+
+    if (arg->label == Ident || arg->label == Array || arg->label == Address)
+    {
+        info = checkArgummentType(arg, funTable, argIndex, funCalled);
+        if (info != SUCCESS)
+            return info;
+    }
+    else if (funCalled->args.symbols[argIndex].isAddress)
+    {
+        fprintf(stderr, "Error: Passing a %s as a %s[] at line %d.\n", funCalled->args.symbols[argIndex].type == INT ? "int" : "char", funCalled->args.symbols[argIndex].type == INT ? "int" : "char", arg->lineno);
+        return ARRAY_EXPECTED;
+    }
+
+    if (typeOf(arg, funTable) == Num && funCalled->args.symbols[argIndex].type == CHAR)
+        fprintf(stderr, "Warning: Int passed as a character at line %d. May cause a problem if below 0 or above 256.\n", arg->lineno);
+
+    return checkInstr(arg, funTable);
+}
+
+/**
+ * @fn ReturnInfo checkFunctionCall(Node *call, const FunctionInfo *funTable)
+ * @brief Bind a call to the function called and check its arguments.
+ *
+ * @param call Node* Call to check.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkFunctionCall(Node *call, const FunctionInfo *funTable)
+{
+    if (isFunctionInTable(&pt->functions, call->u.ident, &call->binding) != ID_IN_TABLE)
+    {
+        fprintf(stderr, "Unidentified function indetififer : %s. Line %d\n", identToString(call->u.ident), call->lineno);
+        return NOT_A_FUNCTION;
+    }
+    call->scope = FUNCTION_SCOPE;
+    const FunctionInfo *funCalled = &pt->functions.functions[call->binding];
+
+    int nbArg = 0;
+    Node *arg = FIRSTCHILD(FIRSTCHILD(call));
+    for (Node *cur = arg; cur; cur = NEXTSIBLING(cur))
+        nbArg++;
+    if (arg->label == Void)
+        nbArg = 0;
+
+    if (funCalled->args.len == 0 && arg->label != Void)
+    {
+        fprintf(stderr, "Trying to call a function with arguments but the function does not take any. Line %d\n", call->lineno);
+        return TOO_MANY_ARGUMENT;
+    }
+    else if (nbArg != funCalled->args.len)
+    {
+        fprintf(stderr, "Trying to call a function with too %s arguments. Expected %d, got %d. Line %d\n", nbArg > funCalled->args.len ? "many" : "few", funCalled->args.len, nbArg, call->lineno);
+        return nbArg > funCalled->args.len ? TOO_MANY_ARGUMENT : TOO_FEW_ARGUMENT;
+    }
+
+    return checkArg(arg, funTable, 0, funCalled);
+}
+
+/**
+ * @fn ReturnInfo checkOperands(Node *op, const FunctionInfo *funTable)
+ * @brief Check that no operand of an arithmetic operation (one operand if unary) is void-like.
+ * The operands themselves are checked by checkInstr, so a deep expression only keeps
+ * the frame of checkInstr on the stack for each of its levels.
+ *
+ * @param op Node* Operation to check.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkOperands(Node *op, const FunctionInfo *funTable)
+{
+    for (Node *operand = FIRSTCHILD(op); operand; operand = NEXTSIBLING(operand))
+        if (typeOf(operand, funTable) == Void)
+        {
+            if (op->label == Addsub)
+            {
+                fprintf(stderr, "Error: Addition or subtraction of a void-like expression at line %d.\n", op->lineno);
+                return VOID_ADDSUB;
+            }
+            fprintf(stderr, "Error: Division or multiplication of a void-like expression at line %d.\n", op->lineno);
+            return VOID_DIVSTA;
+        }
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo checkComparedTypes(Node *comp, label_t left, label_t right)
+ * @brief Check the types of the two members of a comparison.
+ *
+ * @param comp Node* Comparison to check.
+ * @param left label_t Type of the left member.
+ * @param right label_t Type of the right member.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkComparedTypes(Node *comp, label_t left, label_t right)
+{
+    if (left == Void || right == Void)
+    {
+        fprintf(stderr, "Error: Comparison of a void-like expression at line %d.\n", comp->lineno);
+        return VOID_COMPARATION;
+    }
+    if (left == Address || right == Address)
+    {
+        fprintf(stderr, "Error: Comparison with an address at line %d.\n", comp->lineno);
+        return INVALID_ARGUMENT_TYPE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo checkBooleanComp(Node *comp, const FunctionInfo *funTable)
+ * @brief Check a boolean operation and its two members.
+ *
+ * @param comp Node* Comparison to check.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkBooleanComp(Node *comp, const FunctionInfo *funTable)
+{
+    ReturnInfo info = checkComparedTypes(comp, typeOf(FIRSTCHILD(comp), funTable), typeOf(NEXTSIBLING(FIRSTCHILD(comp)), funTable));
+    if (info != SUCCESS)
+        return info;
+
+    info = checkInstr(FIRSTCHILD(comp), funTable);
+    if (info != SUCCESS)
+        return info;
+    return checkInstr(NEXTSIBLING(FIRSTCHILD(comp)), funTable);
+}
+
+/**
+ * @fn ReturnInfo checkNegation(Node *neg, const FunctionInfo *funTable)
+ * @brief Check a logical negation, which compares its operand with 0.
+ *
+ * @param neg Node* Negation to check.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkNegation(Node *neg, const FunctionInfo *funTable)
+{
+    ReturnInfo info = checkComparedTypes(neg, Num, typeOf(FIRSTCHILD(neg), funTable));
+    if (info != SUCCESS)
+        return info;
+    return checkInstr(FIRSTCHILD(neg), funTable);
+}
+
+/**
+ * @fn ReturnInfo checkEgual(Node *eg, const FunctionInfo *funTable)
+ * @brief Check an assignment.
+ *
+ * @param eg Node* Assignment to check.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkEgual(Node *eg, const FunctionInfo *funTable)
+{
+    if (typeOf(FIRSTCHILD(eg), funTable) == Void || typeOf(NEXTSIBLING(FIRSTCHILD(eg)), funTable) == Void)
+    {
+        fprintf(stderr, "Error: Assignation of a void-like expression at line %d.\n", eg->lineno);
+        return VOID_ASSIGNMENT;
+    }
+
+    ReturnInfo info = checkInstr(NEXTSIBLING(FIRSTCHILD(eg)), funTable);
+    if (info != SUCCESS)
+        return info;
+
+    info = checkGetIdent(FIRSTCHILD(eg), funTable);
+    if (info != SUCCESS)
+        return info;
+
+    if (typeOf(NEXTSIBLING(FIRSTCHILD(eg)), funTable) == Num && typeOf(FIRSTCHILD(eg), funTable) == Character)
+        fprintf(stderr, "Warning: Int passed as a character at line %d. May cause a problem if below 0 or above 256.\n", eg->lineno);
+
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo checkReturn(Node *retInstr, const FunctionInfo *funTable)
+ * @brief Check a return against the type of the function.
+ *
+ * @param retInstr Node* Return to check.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkReturn(Node *retInstr, const FunctionInfo *funTable)
+{
+    if (funTable->type == VOID_TYPE && FIRSTCHILD(retInstr))
+    {
+        fprintf(stderr, "Error: No value should be returned in void typed function at line %d.\n", retInstr->lineno);
+        return VOID_RETURN_ILLEGAL;
+    }
+    else if (funTable->type != VOID_TYPE && (!FIRSTCHILD(retInstr) || typeOf(FIRSTCHILD(retInstr), funTable) == Void))
+    {
+        fprintf(stderr, "Error: No value or void-like value returned at line %d while a %s is expected.\n", retInstr->lineno, funTable->type == INT ? "int" : "char");
+        return MISSING_RETURN_VALUE;
+    }
+    else if (funTable->type == CHAR && typeOf(FIRSTCHILD(retInstr), funTable) == Num)
+        fprintf(stderr, "Warning: Int returned while a character is expected at line %d. May cause a problem if below 0 or above 256.\n", retInstr->lineno);
+
+    if (!FIRSTCHILD(retInstr))
+        return SUCCESS;
+    return checkInstr(FIRSTCHILD(retInstr), funTable);
+}
+
+/**
+ * @fn ReturnInfo checkBlock(Node *block, const FunctionInfo *funTable)
+ * @brief Check every instruction of a block.
+ *
+ * @param block Node* First instruction of the block.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkBlock(Node *block, const FunctionInfo *funTable)
+{
+    for (; block; block = NEXTSIBLING(block))
+    {
+        ReturnInfo info = block->label == Else ? checkBlock(FIRSTCHILD(block), funTable) : checkInstr(block, funTable);
+        if (info != SUCCESS)
+            return info;
+    }
+    return SUCCESS;
+}
+
+/**
+ * @fn ReturnInfo checkConditional(Node *condInstr, const FunctionInfo *funTable)
+ * @brief Check an if or a while loop. A bare identifier condition is compared with 0.
+ *
+ * @param condInstr Node* If or While to check.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkConditional(Node *condInstr, const FunctionInfo *funTable)
+{
+    Node *cond = FIRSTCHILD(condInstr);
+    ReturnInfo info;
+    if (cond->label == Ident)
+    {
+        info = checkComparedTypes(cond, Num, typeOf(cond, funTable));
+        if (info != SUCCESS)
+            return info;
+    }
+
+    info = checkInstr(cond, funTable);
+    if (info != SUCCESS)
+        return info;
+    return checkBlock(NEXTSIBLING(cond), funTable);
+}
+
+/**
+ * @fn ReturnInfo checkInstr(Node *instr, const FunctionInfo *funTable)
+ * @brief Check any instruction (switch to the right function).
+ *
+ * @param instr Node* Instruction to check.
+ * @param funTable const FunctionInfo* Function table we are in.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkInstr(Node *instr, const FunctionInfo *funTable)
+{
+    ReturnInfo info;
+    switch (instr->label)
+    {
+    case DeclVarsLocale:
+    case Num:
+    case Character:
+        return SUCCESS;
+    case Else:
+        return checkBlock(FIRSTCHILD(instr), funTable);
+    case Array:
+    case Ident:
+        return checkPushIdent(instr, funTable);
+    case If:
+    case While:
+        return checkConditional(instr, funTable);
+    case Return:
+        return checkReturn(instr, funTable);
+    case Or:
+    case And:
+    case Eq:
+    case Order:
+        return checkBooleanComp(instr, funTable);
+    case ExclamationPoint:
+        return checkNegation(instr, funTable);
+    case Addsub:
+    case Divstar:
+        info = checkOperands(instr, funTable);
+        for (Node *operand = FIRSTCHILD(instr); operand && info == SUCCESS; operand = NEXTSIBLING(operand))
+            info = checkInstr(operand, funTable);
+        return info;
+    case Egual:
+        return checkEgual(instr, funTable);
+    default:
+        fprintf(stderr, "huh ?\t%s\t%s\n\n", StringFromLabel[instr->label], identToString(instr->u.ident));
+        break;
+    }
+
+    return FAILURE;
+}
+
+/**
+ * @fn ReturnInfo checkProg(Node *root, const ProgTable *progt)
+ * @brief Check the whole program, function by function.
+ *
+ * @param root Node* Root of the program to check.
+ * @param progt const ProgTable* Program table we are in.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo checkProg(Node *root, const ProgTable *progt)
+{
+    pt = progt;
+    if (!root || pt->size <= 0)
+        return FAILURE;
+
+    if (!getFunctionsTable(pt, internString("main")))
+    {
+        fprintf(stderr, "No main function found in the program.\n");
+        return NO_MAIN_FUNCTION;
+    }
+
+    for (Node *fun = FIRSTCHILD(root); fun; fun = NEXTSIBLING(fun))
+    {
+        if (fun->label == DeclVarsGlobale)
+            continue;
+
+        ident_t id;
+        getFunId(fun, &id);
+        const FunctionInfo *funTable = getFunctionsTable(pt, id);
+        Node *body = getChildLabeled(fun, Body);
+        if (!funTable || !body)
+            continue;
+
+        ReturnInfo info = checkBlock(FIRSTCHILD(body), funTable);
+        if (info != SUCCESS)
+            return info;
+    }
+    return SUCCESS;
+}
@@ -0,0 +1,561 @@
+/**
+ * @file ssa.c
+ * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
+ * @brief Conversion of a lowered function to static single assignment form and back.
+ * @date 2024-02-10
+ *
+ * Only the variables (parameters, locals and values of ands and ors) are
+ * renamed, temporaries being assigned once by the lowering. Phis are placed on
+ * the iterated dominance frontier of the definitions of a variable, where it is
+ * live, then every definition gets a new version by walking the dominator
+ * tree. The phis are kept beside the code and never written in it. As long as
+ * the versions of a variable are never live at the same time, leaving the form
+ * only gives them their variable back.
+ */
+
+#include <stdlib.h>
+#include "ssa.h"
+#include "cfg.h"
+#include "utilitaries.h"
+
+typedef struct _dominators
+{
+    int *order;         /* Reachable blocks in reverse postorder */
+    int nbOrdered;
+    int *rank;          /* Rank of every block in order, -1 if unreachable */
+    int *idom;          /* Immediate dominator of every block, the entry being its own */
+    int *firstChild;    /* Children of the block b in the tree are children[firstChild[b]] to children[firstChild[b + 1] - 1] */
+    int *children;
+    int *firstFrontier; /* Frontier of the block b is frontier[firstFrontier[b]] to frontier[firstFrontier[b + 1] - 1] */
+    int *frontier;
+} Dominators;
+
+/* Renaming state, the current version of each variable and the changes to undo when leaving a block */
+static vreg_t *current;
+static vreg_t *undoVars;
+static vreg_t *undoVersions;
+static int nbUndo;
+
+/**
+ * @fn int nbPhiArgs(const IrFunction *ir, int block)
+ * @brief Get the number of versions merged by a phi of a block.
+ *
+ * @param ir const IrFunction* Function of the block.
+ * @param block int Block.
+ * @return int One per predecessor, and one more for the entry block.
+ */
+int nbPhiArgs(const IrFunction *ir, int block)
+{
+    return ir->blocks[block].nbPreds + !block;
+}
+
+/* ------- Dominators -------- */
+
+/**
+ * @fn void postorder(const IrFunction *ir, int block, char *visited, int *order, int *nb)
+ * @brief List the blocks reachable from a block in postorder.
+ *
+ * @param ir const IrFunction* Function walked.
+ * @param block int Block reached.
+ * @param visited char* Is each block already listed or being walked.
+ * @param order int* Blocks listed, filled.
+ * @param nb int* Number of blocks listed, updated.
+ */
+void postorder(const IrFunction *ir, int block, char *visited, int *order, int *nb)
+{
+    visited[block] = 1;
+    for (int i = 0; i < 2; i++)
+    {
+        int succ = ir->blocks[block].succs[i];
+        if (succ != NO_BLOCK && !visited[succ])
+            postorder(ir, succ, visited, order, nb);
+    }
+    order[(*nb)++] = block;
+}
+
+/**
+ * @fn int intersect(const Dominators *dom, int a, int b)
+ * @brief Get the nearest common dominator of two blocks.
+ *
+ * @param dom const Dominators* Dominators known so far.
+ * @param a int First block.
+ * @param b int Second block.
+ * @return int Nearest common dominator.
+ */
+int intersect(const Dominators *dom, int a, int b)
+{
+    while (a != b)
+    {
+        while (dom->rank[a] > dom->rank[b])
+            a = dom->idom[a];
+        while (dom->rank[b] > dom->rank[a])
+            b = dom->idom[b];
+    }
+    return a;
+}
+
+/**
+ * @fn void findIdoms(const IrFunction *ir, Dominators *dom)
+ * @brief Compute the immediate dominators of the reachable blocks, refining them in reverse postorder until they are stable.
+ *
+ * @param ir const IrFunction* Function analysed.
+ * @param dom Dominators* Dominators, whose order and ranks are known, filled.
+ */
+void findIdoms(const IrFunction *ir, Dominators *dom)
+{
+    for (int b = 0; b < ir->nbBlocks; b++)
+        dom->idom[b] = -1;
+    dom->idom[0] = 0;
+
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (int k = 1; k < dom->nbOrdered; k++)
+        {
+            int b = dom->order[k], newIdom = -1;
+            for (int i = 0; i < ir->blocks[b].nbPreds; i++)
+            {
+                int pred = ir->preds[ir->blocks[b].firstPred + i];
+                if (dom->idom[pred] != -1)
+                    newIdom = newIdom == -1 ? pred : intersect(dom, pred, newIdom);
+            }
+            if (dom->idom[b] != newIdom)
+            {
+                dom->idom[b] = newIdom;
+                changed = 1;
+            }
+        }
+    }
+}
+
+/**
+ * @fn int walkFrontiers(const IrFunction *ir, Dominators *dom, int *lastAdded, int fill)
+ * @brief Walk up from the predecessors of every join block to its immediate dominator,
+ * the join block being in the dominance frontier of every block met.
+ *
+ * @param ir const IrFunction* Function analysed.
+ * @param dom Dominators* Dominators, whose frontiers are listed if fill is set.
+ * @param lastAdded int* Last block added to the frontier of each block.
+ * @param fill int Are the frontiers listed, or only counted in firstFrontier.
+ * @return int Total size of the frontiers.
+ */
+int walkFrontiers(const IrFunction *ir, Dominators *dom, int *lastAdded, int fill)
+{
+    int total = 0;
+    for (int b = 0; b < ir->nbBlocks; b++)
+        lastAdded[b] = -1;
+
+    for (int k = 0; k < dom->nbOrdered; k++)
+    {
+        int b = dom->order[k];
+        if (nbPhiArgs(ir, b) < 2)
+            continue;
+        for (int i = 0; i < ir->blocks[b].nbPreds; i++)
+        {
+            int runner = ir->preds[ir->blocks[b].firstPred + i];
+            if (dom->rank[runner] < 0)
+                continue;
+            /* The entry block, joining the function entry, is in the frontier of the blocks up to the entry */
+            int stop = b ? dom->idom[b] : -1;
+            while (runner != stop)
+            {
+                if (lastAdded[runner] != b)
+                {
+                    lastAdded[runner] = b;
+                    if (fill)
+                        dom->frontier[dom->firstFrontier[runner + 1]++] = b;
+                    else
+                        dom->firstFrontier[runner + 1]++;
+                    total++;
+                }
+                runner = runner ? dom->idom[runner] : stop;
+            }
+        }
+    }
+    return total;
+}
+
+/**
+ * @fn ReturnInfo computeDominators(const IrFunction *ir, Dominators *dom)
+ * @brief Compute the dominator tree and the dominance frontiers of a function.
+ *
+ * @param ir const IrFunction* Function analysed, whose graph is built.
+ * @param dom Dominators* Dominators, filled. To be freed by freeDominators.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo computeDominators(const IrFunction *ir, Dominators *dom)
+{
+    int n = ir->nbBlocks + 1;
+    *dom = (Dominators){malloc(n * sizeof(int)), 0, malloc(n * sizeof(int)), malloc(n * sizeof(int)),
+                        calloc(n + 1, sizeof(int)), malloc(n * sizeof(int)), calloc(n + 1, sizeof(int)), NULL};
+    char *visited = calloc(n, 1);
+    int *postOrder = malloc(n * sizeof(int));
+    if (!dom->order || !dom->rank || !dom->idom || !dom->firstChild || !dom->children || !dom->firstFrontier || !visited || !postOrder)
+    {
+        free(visited);
+        free(postOrder);
+        return ALLOC_ERROR;
+    }
+
+    postorder(ir, 0, visited, postOrder, &dom->nbOrdered);
+    for (int b = 0; b < ir->nbBlocks; b++)
+        dom->rank[b] = -1;
+    for (int k = 0; k < dom->nbOrdered; k++)
+    {
+        dom->order[k] = postOrder[dom->nbOrdered - 1 - k];
+        dom->rank[dom->order[k]] = k;
+    }
+    free(visited);
+    free(postOrder);
+    findIdoms(ir, dom);
+
+    /* Children are counted, then listed by parent */
+    for (int k = 1; k < dom->nbOrdered; k++)
+        dom->firstChild[dom->idom[dom->order[k]] + 1]++;
+    for (int b = 0; b < ir->nbBlocks; b++)
+        dom->firstChild[b + 1] += dom->firstChild[b];
+    int *filled = calloc(n, sizeof(int));
+    if (!filled)
+        return ALLOC_ERROR;
+    for (int k = 1; k < dom->nbOrdered; k++)
+    {
+        int parent = dom->idom[dom->order[k]];
+        dom->children[dom->firstChild[parent] + filled[parent]++] = dom->order[k];
+    }
+
+    /* Frontiers are counted, then listed, the counts being turned into starts in between */
+    int total = walkFrontiers(ir, dom, filled, 0);
+    dom->frontier = malloc((total + 1) * sizeof(int));
+    if (!dom->frontier)
+    {
+        free(filled);
+        return ALLOC_ERROR;
+    }
+    for (int b = 0; b < ir->nbBlocks; b++)
+        dom->firstFrontier[b + 1] += dom->firstFrontier[b];
+    for (int b = ir->nbBlocks; b > 0; b--)
+        dom->firstFrontier[b] = dom->firstFrontier[b - 1];
+    walkFrontiers(ir, dom, filled, 1);
+
+    free(filled);
+    return SUCCESS;
+}
+
+/**
+ * @fn void freeDominators(Dominators *dom)
+ * @brief Free the dominators of a function.
+ *
+ * @param dom Dominators* Dominators to free.
+ */
+void freeDominators(Dominators *dom)
+{
+    free(dom->order);
+    free(dom->rank);
+    free(dom->idom);
+    free(dom->firstChild);
+    free(dom->children);
+    free(dom->firstFrontier);
+    free(dom->frontier);
+}
+
+/* ------- Phis -------- */
+
+/**
+ * @fn ReturnInfo placePhis(const IrFunction *ir, const Dominators *dom, Ssa *ssa)
+ * @brief Place the phis of every variable on the iterated dominance frontier of its definitions,
+ * in the blocks it is live at the entry of.
+ *
+ * @param ir const IrFunction* Function converted.
+ * @param dom const Dominators* Dominators of the function.
+ * @param ssa Ssa* Form whose phis are placed.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo placePhis(const IrFunction *ir, const Dominators *dom, Ssa *ssa)
+{
+    Liveness live;
+    ReturnInfo info = computeLiveness(ir, &live);
+    if (info != SUCCESS)
+        return info;
+
+    int n = ir->nbBlocks + 1;
+    int *work = malloc(n * sizeof(int));
+    int *phiMark = malloc(n * sizeof(int));
+    int *workMark = malloc(n * sizeof(int));
+    int *firstDef = calloc(ir->nbVariables + 2, sizeof(int));
+    int *defBlocks = malloc((ir->len + 1) * sizeof(int));
+    int capacity = 0;
+    ssa->firstPhi = calloc(n + 1, sizeof(int));
+    if (!work || !phiMark || !workMark || !firstDef || !defBlocks || !ssa->firstPhi)
+        info = ALLOC_ERROR;
+
+    /* Blocks defining each variable, counted then listed by variable */
+    for (int k = 0; k < dom->nbOrdered && info == SUCCESS; k++)
+        for (int pos = ir->blocks[dom->order[k]].first; pos < ir->blocks[dom->order[k]].end; pos++)
+            if (ir->instrs[pos].dst != NO_VREG && ir->instrs[pos].dst < ir->nbVariables)
+                firstDef[ir->instrs[pos].dst + 2]++;
+    for (vreg_t var = 0; var < ir->nbVariables && info == SUCCESS; var++)
+        firstDef[var + 2] += firstDef[var + 1];
+    for (int k = 0; k < dom->nbOrdered && info == SUCCESS; k++)
+        for (int pos = ir->blocks[dom->order[k]].first; pos < ir->blocks[dom->order[k]].end; pos++)
+            if (ir->instrs[pos].dst != NO_VREG && ir->instrs[pos].dst < ir->nbVariables)
+                defBlocks[firstDef[ir->instrs[pos].dst + 1]++] = dom->order[k];
+
+    for (int b = 0; b < ir->nbBlocks && info == SUCCESS; b++)
+        phiMark[b] = workMark[b] = -1;
+    for (vreg_t var = 0; var < ir->nbVariables && info == SUCCESS; var++)
+    {
+        int nbWork = 0;
+        for (int d = firstDef[var]; d < firstDef[var + 1]; d++)
+            if (workMark[defBlocks[d]] != var)
+            {
+                workMark[defBlocks[d]] = var;
+                work[nbWork++] = defBlocks[d];
+            }
+
+        while (nbWork && info == SUCCESS)
+        {
+            int x = work[--nbWork];
+            for (int f = dom->firstFrontier[x]; f < dom->firstFrontier[x + 1] && info == SUCCESS; f++)
+            {
+                int y = dom->frontier[f];
+                if (phiMark[y] == var)
+                    continue;
+                phiMark[y] = var;
+                if (IS_IN_SET(LIVE_IN(&live, y), var))
+                {
+                    info = addCell((void **)&ssa->phis, ssa->nbPhis, &capacity, sizeof(Phi));
+                    if (info == SUCCESS)
+                        ssa->phis[ssa->nbPhis++] = (Phi){var, NO_VREG, y, 0};
+                }
+                if (workMark[y] != var)
+                {
+                    workMark[y] = var;
+                    work[nbWork++] = y;
+                }
+            }
+        }
+    }
+
+    free(work);
+    free(phiMark);
+    free(workMark);
+    free(firstDef);
+    free(defBlocks);
+    freeLiveness(&live);
+    if (info != SUCCESS)
+        return info;
+
+    /* Phis are sorted by block, keeping the order of the variables, and get their arguments */
+    Phi *sorted = malloc((ssa->nbPhis + 1) * sizeof(Phi));
+    int *filled = calloc(n, sizeof(int));
+    if (!sorted || !filled)
+    {
+        free(sorted);
+        free(filled);
+        return ALLOC_ERROR;
+    }
+    for (int i = 0; i < ssa->nbPhis; i++)
+        ssa->firstPhi[ssa->phis[i].block + 1]++;
+    for (int b = 0; b < ir->nbBlocks; b++)
+        ssa->firstPhi[b + 1] += ssa->firstPhi[b];
+    for (int i = 0; i < ssa->nbPhis; i++)
+    {
+        int b = ssa->phis[i].block;
+        sorted[ssa->firstPhi[b] + filled[b]++] = ssa->phis[i];
+    }
+    free(ssa->phis);
+    free(filled);
+    ssa->phis = sorted;
+
+    for (int i = 0; i < ssa->nbPhis; i++)
+    {
+        ssa->phis[i].firstArg = ssa->nbArgs;
+        ssa->nbArgs += nbPhiArgs(ir, ssa->phis[i].block);
+    }
+    ssa->args = malloc((ssa->nbArgs + 1) * sizeof(vreg_t));
+    if (!ssa->args)
+        return ALLOC_ERROR;
+
+    /* The renaming never reaches the unreachable predecessors, whose arguments stay the variable itself */
+    for (int i = 0; i < ssa->nbPhis; i++)
+        for (int j = 0; j < nbPhiArgs(ir, ssa->phis[i].block); j++)
+            ssa->args[ssa->phis[i].firstArg + j] = ssa->phis[i].var;
+    return SUCCESS;
+}
+
+/* ------- Renaming -------- */
+
+/**
+ * @fn vreg_t newVersion(IrFunction *ir, Ssa *ssa, vreg_t var)
+ * @brief Get a new version of a variable, which becomes its current one.
+ *
+ * @param ir IrFunction* Function converted.
+ * @param ssa Ssa* Form of the function.
+ * @param var vreg_t Variable defined.
+ * @return vreg_t Version.
+ */
+vreg_t newVersion(IrFunction *ir, Ssa *ssa, vreg_t var)
+{
+    vreg_t version = ir->nbVregs++;
+    ssa->variables[version] = var;
+    undoVars[nbUndo] = var;
+    undoVersions[nbUndo++] = current[var];
+    current[var] = version;
+    return version;
+}
+
+/**
+ * @fn void renameUse(const IrFunction *ir, vreg_t *slot)
+ * @brief Replace a variable read by its current version.
+ *
+ * @param ir const IrFunction* Function converted.
+ * @param slot vreg_t* Field holding the virtual register read.
+ */
+void renameUse(const IrFunction *ir, vreg_t *slot)
+{
+    if (*slot != NO_VREG && *slot < ir->nbVariables)
+        *slot = current[*slot];
+}
+
+/**
+ * @fn void renameBlock(IrFunction *ir, Ssa *ssa, const Dominators *dom, int block)
+ * @brief Rename the variables of a block, fill the phis of its successors,
+ * then rename the blocks it dominates.
+ *
+ * @param ir IrFunction* Function converted.
+ * @param ssa Ssa* Form of the function.
+ * @param dom const Dominators* Dominators of the function.
+ * @param block int Block renamed.
+ */
+void renameBlock(IrFunction *ir, Ssa *ssa, const Dominators *dom, int block)
+{
+    int undoMark = nbUndo;
+    for (int i = ssa->firstPhi[block]; i < ssa->firstPhi[block + 1]; i++)
+        ssa->phis[i].dst = newVersion(ir, ssa, ssa->phis[i].var);
+
+    for (int pos = ir->blocks[block].first; pos < ir->blocks[block].end; pos++)
+    {
+        IrInstr *instr = &ir->instrs[pos];
+        vreg_t *slots[3];
+        int nb = getIrOperandSlots(instr, slots);
+        for (int i = 0; i < nb; i++)
+            renameUse(ir, slots[i]);
+        if (instr->op == IR_CALL)
+            for (int i = 0; i < instr->imm; i++)
+                renameUse(ir, &ir->callArgs[instr->a + i]);
+        if (instr->dst != NO_VREG && instr->dst < ir->nbVariables && instr->op != IR_PARAM)
+            instr->dst = newVersion(ir, ssa, instr->dst);
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        int succ = ir->blocks[block].succs[i];
+        if (succ == NO_BLOCK || (i && succ == ir->blocks[block].succs[0]))
+            continue;
+        for (int j = 0; j < ir->blocks[succ].nbPreds; j++)
+            if (ir->preds[ir->blocks[succ].firstPred + j] == block)
+                for (int p = ssa->firstPhi[succ]; p < ssa->firstPhi[succ + 1]; p++)
+                    ssa->args[ssa->phis[p].firstArg + j] = current[ssa->phis[p].var];
+    }
+
+    for (int c = dom->firstChild[block]; c < dom->firstChild[block + 1]; c++)
+        renameBlock(ir, ssa, dom, dom->children[c]);
+
+    while (nbUndo > undoMark)
+    {
+        nbUndo--;
+        current[undoVars[nbUndo]] = undoVersions[nbUndo];
+    }
+}
+
+/**
+ * @fn void freeSsa(Ssa *ssa)
+ * @brief Free the phis and versions of a form.
+ *
+ * @param ssa Ssa* Form to free.
+ */
+void freeSsa(Ssa *ssa)
+{
+    free(ssa->phis);
+    free(ssa->firstPhi);
+    free(ssa->args);
+    free(ssa->variables);
+    *ssa = (Ssa){NULL, 0, NULL, NULL, 0, NULL, 0};
+}
+
+/**
+ * @fn ReturnInfo buildSsa(IrFunction *ir, Ssa *ssa)
+ * @brief Convert a function to static single assignment form. The code of the
+ * unreachable blocks is left untouched, and the arguments of the phis coming
+ * from them are the variable itself, never read as their edges are never taken.
+ *
+ * @param ir IrFunction* Function converted, whose graph is built.
+ * @param ssa Ssa* Form of the function, filled. Left and freed by leaveSsa.
+ * @return ReturnInfo Eventual error code.
+ */
+ReturnInfo buildSsa(IrFunction *ir, Ssa *ssa)
+{
+    *ssa = (Ssa){NULL, 0, NULL, NULL, 0, NULL, ir->nbVregs};
+    Dominators dom;
+    ReturnInfo info = computeDominators(ir, &dom);
+    if (info == SUCCESS)
+        info = placePhis(ir, &dom, ssa);
+
+    /* Every definition of a variable and every phi gets a version */
+    int maxVersions = ssa->nbPhis;
+    for (int pos = 0; pos < ir->len; pos++)
+        maxVersions += ir->instrs[pos].dst != NO_VREG && ir->instrs[pos].dst < ir->nbVariables;
+    ssa->variables = malloc((ir->nbVregs + maxVersions + 1) * sizeof(vreg_t));
+    current = malloc((ir->nbVariables + 1) * sizeof(vreg_t));
+    undoVars = malloc((maxVersions + 1) * sizeof(vreg_t));
+    undoVersions = malloc((maxVersions + 1) * sizeof(vreg_t));
+    if (info == SUCCESS && (!ssa->variables || !current || !undoVars || !undoVersions))
+        info = ALLOC_ERROR;
+
+    if (info == SUCCESS)
+    {
+        for (vreg_t v = 0; v < ir->nbVregs; v++)
+            ssa->variables[v] = v;
+        for (vreg_t var = 0; var < ir->nbVariables; var++)
+            current[var] = var;
+        for (int p = ssa->firstPhi[0]; p < ssa->firstPhi[1]; p++)
+            ssa->args[ssa->phis[p].firstArg + ir->blocks[0].nbPreds] = ssa->phis[p].var;
+        nbUndo = 0;
+        renameBlock(ir, ssa, &dom, 0);
+    }
+
+    free(current);
+    free(undoVars);
+    free(undoVersions);
+    freeDominators(&dom);
+    if (info != SUCCESS)
+        freeSsa(ssa);
+    return info;
+}
+
+/**
+ * @fn void leaveSsa(IrFunction *ir, Ssa *ssa)
+ * @brief Give every version its variable back and free the form of the function.
+ *
+ * @param ir IrFunction* Function converted back.
+ * @param ssa Ssa* Form of the function, freed.
+ */
+void leaveSsa(IrFunction *ir, Ssa *ssa)
+{
+    for (int pos = 0; pos < ir->len; pos++)
+    {
+        IrInstr *instr = &ir->instrs[pos];
+        vreg_t *slots[3];
+        int nb = getIrOperandSlots(instr, slots);
+        for (int i = 0; i < nb; i++)
+            *slots[i] = ssa->variables[*slots[i]];
+        if (instr->op == IR_CALL)
+            for (int i = 0; i < instr->imm; i++)
+                ir->callArgs[instr->a + i] = ssa->variables[ir->callArgs[instr->a + i]];
+        if (instr->dst != NO_VREG)
+            instr->dst = ssa->variables[instr->dst];
+    }
+    ir->nbVregs = ssa->nbVregs;
+    freeSsa(ssa);
+}
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include "hashIndex.h"
 #include "progTable.h"
 #include "symbolTable.h"
 #include "utilitaries.h"
@@ -20,7 +21,7 @@
  */
 SymbolTable createNewSymbolTable()
 {
-    SymbolTable t = {NULL, 0, 0};
+    SymbolTable t = {NULL, 0, 0, 0, createNewHashIndex()};
     return t;
 }
 
@@ -36,6 +37,7 @@ void freeSymbolTable(SymbolTable *t)
         return;
     if (t->symbols)
         free(t->symbols);
+    freeHashIndex(&t->index);
 
     *t = createNewSymbolTable();
 }
@@ -54,63 +56,55 @@ ReturnInfo addRow(SymbolTable *t)
     if (!t)
         return NULL_ARGUMENT;
 
-    if (addCell((void **)&t->symbols, t->len, sizeof(Symbol)) != SUCCESS)
+    if (addCell((void **)&t->symbols, t->len, &t->capacity, sizeof(Symbol)) != SUCCESS)
         return ALLOC_ERROR;
     t->len++;
     return SUCCESS;
 }
 
 /**
- * @fn ReturnInfo isInTable(SymbolTable t, char *id, int *index)
+ * @fn ReturnInfo isInTable(const SymbolTable *t, ident_t id, int *index)
  * @brief Check if a symbol is in a symbol table.
  *
- * @param t SymbolTable Table to check.
- * @param id char* Id of the symbol to check.
+ * @param t const SymbolTable* Table to check.
+ * @param id ident_t Id of the symbol to check.
  * @param index int* Index of the symbol in the table.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo isInTable(SymbolTable t, char *id, int *index)
+ReturnInfo isInTable(const SymbolTable *t, ident_t id, int *index)
 {
-    if (!id)
+    if (!t)
         return NULL_ARGUMENT;
-    for (int i = 0; i < t.len; i++)
-    {
-        if (!strcmp(t.symbols[i].id, id))
-        {
-            if (index)
-                *index = i;
-            return ID_IN_TABLE;
-        }
-    }
+    int i = findInHashIndex(t->index, t->symbols, sizeof(Symbol), id);
     if (index)
-        *index = -1;
-    return ID_NOT_IN_TABLE;
+        *index = i;
+    return i == -1 ? ID_NOT_IN_TABLE : ID_IN_TABLE;
 }
 
 /**
- * @fn ReturnInfo putSymbolInTable(SymbolTable *t, char *id, AuthorizedType type, int size, int isArray, int isAdress)
+ * @fn ReturnInfo putSymbolInTable(SymbolTable *t, ident_t id, AuthorizedType type, int size, int isArray, int isAdress)
  * @brief Put a symbol in a symbol table.
  *
  * @param t SymbolTable* Symbol table to put the symbol on.
- * @param id char* Id of the symbol.
+ * @param id ident_t Id of the symbol.
  * @param type AuthorizedType Type of the symbol.
  * @param size int Size of the symbol.
  * @param isArray int Is the symbol an array.
  * @param isAdress int Is the symbol an address (for function argument).
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo putSymbolInTable(SymbolTable *t, char *id, AuthorizedType type, int size, int isArray, int isAdress)
+ReturnInfo putSymbolInTable(SymbolTable *t, ident_t id, AuthorizedType type, int size, int isArray, int isAdress)
 {
-    if (!t || !id || !t->symbols || size <= 0)
+    if (!t || !t->symbols || size <= 0)
         return NULL_ARGUMENT;
 
     if (type == UNAUTHORIZED)
         return FAILURE;
 
-    if (strlen(id) >= SIZE_ID)
+    if (strlen(identToString(id)) >= SIZE_ID)
         return TOO_LONG_ID;
 
-    sprintf(t->symbols[t->len - 1].id, "%s", id);
+    t->symbols[t->len - 1].id = id;
     t->symbols[t->len - 1].type = type;
     t->symbols[t->len - 1].numberOfValues = size;
     t->symbols[t->len - 1].isArray = isArray;
@@ -126,27 +120,27 @@ ReturnInfo putSymbolInTable(SymbolTable *t, char *id, AuthorizedType type, int s
     }
     t->size += (isArray && size == 1) ? 8 : t->symbols[t->len - 1].type * size;
 
-    return SUCCESS;
+    return addToHashIndex(&t->index, t->symbols, sizeof(Symbol), t->len);
 }
 
 /**
- * @fn ReturnInfo addSymbol(SymbolTable *t, char *id, char *type, int size, int isArray, int isAdress)
+ * @fn ReturnInfo addSymbol(SymbolTable *t, ident_t id, const char *type, int size, int isArray, int isAdress)
  * @brief Add a symbol in a symbol table and check every field.
  *
  * @param t SymbolTable* Symbol table to add the symbol on.
- * @param id char* Id of the symbol.
- * @param type char* Type of the symbol.
+ * @param id ident_t Id of the symbol.
+ * @param type const char* Type of the symbol.
  * @param size int Size of the symbol.
  * @param isArray int Is the symbol an array.
  * @param isAdress int Is the symbol an address (for function argument).
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo addSymbol(SymbolTable *t, char *id, char *type, int size, int isArray, int isAdress)
+ReturnInfo addSymbol(SymbolTable *t, ident_t id, const char *type, int size, int isArray, int isAdress)
 {
-    if (!t || !id || !type)
+    if (!t || !type)
         return NULL_ARGUMENT;
 
-    ReturnInfo inTable = isInTable(*t, id, NULL);
+    ReturnInfo inTable = isInTable(t, id, NULL);
     if (inTable != ID_NOT_IN_TABLE)
         return inTable;
 
@@ -180,7 +174,7 @@ int getLengthOfLongestId(SymbolTable t)
     int l = 0;
     for (int i = 0; i < t.len; i++)
     {
-        l = strlen(t.symbols[i].id);
+        l = strlen(identToString(t.symbols[i].id));
         max = max < l ? l : max;
     }
     return max;
@@ -216,7 +210,8 @@ void printSymbolTable(SymbolTable t)
         sprintf(addressStr, "%d", t.symbols[i].address);
 
         printTableLine(columnLength, 3);
-        fprintf(stdout, "| %s%*s| %s%*s| %s%*s|\n", t.symbols[i].id, (int)(columnLength[0] - strlen(t.symbols[i].id)) - 1, " ",
+        const char *id = identToString(t.symbols[i].id);
+        fprintf(stdout, "| %s%*s| %s%*s| %s%*s|\n", id, (int)(columnLength[0] - strlen(id)) - 1, " ",
                 typeStr, (int)(columnLength[1] - strlen(typeStr)) - 1, " ",
                 addressStr, (int)(columnLength[2] - strlen(addressStr)) - 1, " ");
     }
@@ -226,32 +221,32 @@ void printSymbolTable(SymbolTable t)
 /* -------------------------------- CREATION OF TABLES WITH ROOT -------------------------------- */
 
 /**
- * @fn ReturnInfo addParamList(SymbolTable *t, Node *param, ProgTable pt)
+ * @fn ReturnInfo addParamList(SymbolTable *t, Node *param, const ProgTable *pt)
  * @brief Add a parameter list in a symbol table.
  *
  * @param t SymbolTable* Symbol table to add the parameter list on.
  * @param param Node* Parameter list to add.
- * @param pt ProgTable Program table to get the type of the parameters.
+ * @param pt const ProgTable* Program table to get the type of the parameters.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo addParamList(SymbolTable *t, Node *param, ProgTable pt)
+ReturnInfo addParamList(SymbolTable *t, Node *param, const ProgTable *pt)
 {
     if (!t || !param)
         return NULL_ARGUMENT;
 
-    for (Node *child = param->firstChild; child != NULL; child = child->nextSibling)
+    for (Node *child = FIRSTCHILD(param); child != NULL; child = NEXTSIBLING(child))
     {
-        for (Node *var = child->firstChild; var != NULL; var = var->nextSibling)
+        for (Node *var = FIRSTCHILD(child); var != NULL; var = NEXTSIBLING(var))
         {
             if (var->label == Ident || var->label == Array)
             {
-                if (isInTable(*t, var->u.ident, NULL) == ID_IN_TABLE)
+                if (isInTable(t, var->u.ident, NULL) == ID_IN_TABLE)
                 {
-                    fprintf(stderr, "Redefinition of %s at line %d.\n", var->u.ident, var->lineno);
+                    fprintf(stderr, "Redefinition of %s at line %d.\n", identToString(var->u.ident), var->lineno);
                     return ID_IN_TABLE;
                 }
 
-                ReturnInfo added = addSymbol(t, var->u.ident, child->u.ident, 1, 0, var->label == Array);
+                ReturnInfo added = addSymbol(t, var->u.ident, identToString(child->u.ident), 1, 0, var->label == Array);
                 if (added != SUCCESS)
                     return added;
             }
@@ -261,32 +256,32 @@ ReturnInfo addParamList(SymbolTable *t, Node *param, ProgTable pt)
 }
 
 /**
- * @fn ReturnInfo addListGlobal(SymbolTable *t, Node *globs, ProgTable pt)
+ * @fn ReturnInfo addListGlobal(SymbolTable *t, Node *globs, const ProgTable *pt)
  * @brief Add a list of global variables in a symbol table.
  *
  * @param t SymbolTable* Symbol table to add the list of global variables on.
  * @param globs Node* List of global variables to add.
- * @param pt ProgTable Program table to get the type of the global variables.
+ * @param pt const ProgTable* Program table to get the type of the global variables.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo addListGlobal(SymbolTable *t, Node *globs, ProgTable pt)
+ReturnInfo addListGlobal(SymbolTable *t, Node *globs, const ProgTable *pt)
 {
     if (!t || !globs)
         return NULL_ARGUMENT;
 
-    for (Node *child = globs->firstChild; child != NULL; child = child->nextSibling)
+    for (Node *child = FIRSTCHILD(globs); child != NULL; child = NEXTSIBLING(child))
     {
-        for (Node *var = child->firstChild; var != NULL; var = var->nextSibling)
+        for (Node *var = FIRSTCHILD(child); var != NULL; var = NEXTSIBLING(var))
         {
             if (var->label == Ident || var->label == Array)
             {
-                if (isInTable(*t, var->u.ident, NULL) == ID_IN_TABLE)
+                if (isInTable(t, var->u.ident, NULL) == ID_IN_TABLE)
                 {
-                    fprintf(stderr, "Redefinition of %s at line %d.\n", var->u.ident, var->lineno);
+                    fprintf(stderr, "Redefinition of %s at line %d.\n", identToString(var->u.ident), var->lineno);
                     return ID_IN_TABLE;
                 }
 
-                ReturnInfo added = addSymbol(t, var->u.ident, child->u.ident, (var->label == Array && var->nextSibling->label == Num) ? var->nextSibling->u.num : 1, var->label == Array, 0);
+                ReturnInfo added = addSymbol(t, var->u.ident, identToString(child->u.ident), (var->label == Array && NEXTSIBLING(var)->label == Num) ? NEXTSIBLING(var)->u.num : 1, var->label == Array, 0);
                 if (added != SUCCESS)
                     return added;
             }
@@ -296,15 +291,15 @@ ReturnInfo addListGlobal(SymbolTable *t, Node *globs, ProgTable pt)
 }
 
 /**
- * @fn ReturnInfo addListOfSymbol(SymbolTable *t, Node *node, ProgTable pt)
+ * @fn ReturnInfo addListOfSymbol(SymbolTable *t, Node *node, const ProgTable *pt)
  * @brief Add a list of symbols in a symbol table.
  *
  * @param t SymbolTable* Symbol table to add the list of symbols on.
  * @param node Node* List of symbols to add.
- * @param pt ProgTable Program table to get the type of the symbols.
+ * @param pt const ProgTable* Program table to get the type of the symbols.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo addListOfSymbol(SymbolTable *t, Node *node, ProgTable pt)
+ReturnInfo addListOfSymbol(SymbolTable *t, Node *node, const ProgTable *pt)
 {
     if (!t || !node)
         return NULL_ARGUMENT;
@@ -316,19 +311,19 @@ ReturnInfo addListOfSymbol(SymbolTable *t, Node *node, ProgTable pt)
     if (node->label == DeclVarsGlobale)
         return addListGlobal(t, node, pt);
 
-    for (Node *child = node->firstChild; child != NULL; child = child->nextSibling)
+    for (Node *child = FIRSTCHILD(node); child != NULL; child = NEXTSIBLING(child))
     {
-        for (Node *var = child->firstChild; var != NULL; var = var->nextSibling)
+        for (Node *var = FIRSTCHILD(child); var != NULL; var = NEXTSIBLING(var))
         {
             if (var->label == Ident || var->label == Array)
             {
-                if (isInTable(*t, var->u.ident, NULL) == ID_IN_TABLE)
+                if (isInTable(t, var->u.ident, NULL) == ID_IN_TABLE)
                 {
-                    fprintf(stderr, "Redefinition of %s at line %d.\n", var->u.ident, var->lineno);
+                    fprintf(stderr, "Redefinition of %s at line %d.\n", identToString(var->u.ident), var->lineno);
                     return ID_IN_TABLE;
                 }
 
-                ReturnInfo added = addSymbol(t, var->u.ident, child->u.ident, (var->firstChild && var->firstChild->label == Num) ? var->firstChild->u.num : 1, var->label == Array, 0);
+                ReturnInfo added = addSymbol(t, var->u.ident, identToString(child->u.ident), (FIRSTCHILD(var) && FIRSTCHILD(var)->label == Num) ? FIRSTCHILD(var)->u.num : 1, var->label == Array, 0);
                 if (added != SUCCESS)
                     return added;
             }
@@ -351,7 +346,7 @@ ReturnInfo addSymbolsTableFromArray(SymbolTable *table, char *symbols[][2])
     {
         for (char **symbol = symbols[0]; symbol[0] != NULL; symbol += 2)
         {
-            ReturnInfo symbolAdded = addSymbol(table, symbol[1], symbol[0], 1, 0, 0);
+            ReturnInfo symbolAdded = addSymbol(table, internString(symbol[1]), symbol[0], 1, 0, 0);
             if (symbolAdded != SUCCESS)
                 return symbolAdded;
         }
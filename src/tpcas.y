@@ -17,14 +17,16 @@ Node * node_type;
 
 %union {
   Node * node;
+  NodeList list;
   char byte;
   int num;
-  char ident[64];
+  ident_t ident;
   char comp[3];
   char character[3];
 }
 
-%type <node> Prog DeclVarsGlobale Declarateurs DeclVarsLocale InitVarsLocale DeclFoncts DeclFonct EnTeteFonct Parametres ListTypVar Corps SuiteInstr Instr  Exp TB FB M E T F LValue Arguments ListExp
+%type <node> Prog Declarateurs InitVarsLocale DeclFonct EnTeteFonct Parametres ListTypVar Corps Instr  Exp TB FB M E T F LValue Arguments
+%type <list> DeclVarsGlobale DeclVarsLocale DeclFoncts SuiteInstr ListExp
 
 %token <node> VOID IF ELSE WHILE RETURN OR AND
 %token <ident> TYPE IDENT ARRAY
@@ -42,41 +44,37 @@ Node * node_type;
 
 Prog: DeclVarsGlobale DeclFoncts{
 			$$ = makeNode(Prog);
-			addChild($$, $1);
-			addChild($$, $2);
+			addChild($$, listToNode(DeclVarsGlobale, $1));
+			addChild($$, $2.first);
 			root = $$;
 			}
     ;
 
 DeclVarsGlobale: DeclVarsGlobale TYPE Declarateurs ';' {
-		if($$ != NULL) {
-					$$ = $1; }
-		else{
-			$$ = makeNode(DeclVarsGlobale);
-			}
-			node_type = makeNode(Type); strcpy(node_type->u.ident, $2);
-			addChild($$, node_type); addChild(node_type, $3);
+			$$ = $1;
+			node_type = makeNode(Type); node_type->u.ident = $2;
+			appendToList(&$$, node_type); addChild(node_type, $3);
 			}
-		| { $$ = NULL; }
+		| { $$ = makeList(NULL); }
     ;
 
 Declarateurs: IDENT{
-			$$ = makeNode(Ident); strcpy($$->u.ident, $1);
+			$$ = makeNode(Ident); $$->u.ident = $1;
 			}
 
 		| IDENT ',' Declarateurs {
-			$$ = makeNode(Ident); strcpy($$->u.ident, $1);
+			$$ = makeNode(Ident); $$->u.ident = $1;
 			addSibling($$, $3);
 			}
 
 		| IDENT '[' NUM ']' ',' Declarateurs {
-			$$ = makeNode(Array); strcpy($$->u.ident, $1);
+			$$ = makeNode(Array); $$->u.ident = $1;
 			node_type = makeNode(Num); node_type->u.num = $3;
 			addSibling($$, node_type); addChild($$, $6);
 			}
 
 		| IDENT '[' NUM ']' {
-			$$ = makeNode(Array); strcpy($$->u.ident, $1);
+			$$ = makeNode(Array); $$->u.ident = $1;
 			Node* tmp = makeNode(Num); tmp->u.num = $3;
 			addSibling($$, tmp);
 			}
@@ -85,34 +83,31 @@ Declarateurs: IDENT{
     ;
 
 DeclVarsLocale: DeclVarsLocale TYPE InitVarsLocale ';' {
-		if($$ != NULL) {
-			$$ = $1;}
-		else{
-			$$ = makeNode(DeclVarsLocale);}
+			$$ = $1;
 			node_type = makeNode(Type);
-			strcpy(node_type->u.ident, $2);
-			addChild($$, node_type); addChild(node_type, $3); }
+			node_type->u.ident = $2;
+			appendToList(&$$, node_type); addChild(node_type, $3); }
 
-		| {$$ = NULL; }
+		| { $$ = makeList(NULL); }
 		;
 
 InitVarsLocale: IDENT {
-			$$ = makeNode(Ident); strcpy($$->u.ident, $1);
+			$$ = makeNode(Ident); $$->u.ident = $1;
 			}
 
 		| IDENT ',' InitVarsLocale  {
-		  $$ = makeNode(Ident); strcpy($$->u.ident, $1);
+		  $$ = makeNode(Ident); $$->u.ident = $1;
 			addSibling($$, $3);
 			}
 
 		| IDENT '[' NUM ']' ',' InitVarsLocale {
-			$$ = makeNode(Array); strcpy($$->u.ident, $1);
+			$$ = makeNode(Array); $$->u.ident = $1;
 			node_type = makeNode(Num); node_type->u.num = $3;
 			addChild($$, node_type); addSibling($$, $6);
 			}
 
 		|	IDENT '[' NUM ']' {
-			$$ = makeNode(Array); strcpy($$->u.ident, $1);
+			$$ = makeNode(Array); $$->u.ident = $1;
 			node_type = makeNode(Num); node_type->u.num = $3;
 			addChild($$, node_type);
 			}
@@ -121,11 +116,11 @@ InitVarsLocale: IDENT {
 		;
 
 DeclFoncts: DeclFoncts DeclFonct {
-			$$ = $1; addSibling($1, $2);
+			$$ = $1; appendToList(&$$, $2);
 			}
 
     | DeclFonct
-			{ $$ = $1; }
+			{ $$ = makeList($1); }
     ;
 
 DeclFonct: EnTeteFonct Corps {
@@ -134,14 +129,14 @@ DeclFonct: EnTeteFonct Corps {
     ;
 
 EnTeteFonct: TYPE IDENT '(' Parametres ')' {
-			$$ = makeNode(Type); strcpy($$->u.ident, $1);
-			node_type = makeNode(Ident); strcpy(node_type->u.ident, $2);
+			$$ = makeNode(Type); $$->u.ident = $1;
+			node_type = makeNode(Ident); node_type->u.ident = $2;
 			addChild($$, node_type); addSibling($$, $4);
 			}
 
     | VOID IDENT '(' Parametres ')' {
 			$$ = makeNode(Void);
-			node_type = makeNode(Ident); strcpy(node_type->u.ident, $2);
+			node_type = makeNode(Ident); node_type->u.ident = $2;
 			addSibling($$, node_type); addSibling($$, $4); }
     ;
 
@@ -157,26 +152,26 @@ Parametres: VOID {
     ;
 
 ListTypVar: TYPE IDENT{
-			$$ = makeNode(Type); strcpy($$->u.ident, $1);
-			node_type = makeNode(Ident); strcpy(node_type->u.ident, $2);
+			$$ = makeNode(Type); $$->u.ident = $1;
+			node_type = makeNode(Ident); node_type->u.ident = $2;
 			addChild($$, node_type);
 			}
 
 		| TYPE IDENT ',' ListTypVar {
-			$$ = makeNode(Type); strcpy($$->u.ident, $1);
-			node_type = makeNode(Ident); strcpy(node_type->u.ident, $2);
+			$$ = makeNode(Type); $$->u.ident = $1;
+			node_type = makeNode(Ident); node_type->u.ident = $2;
 			addChild($$, node_type); addSibling($$, $4);
 			}
 
 		| TYPE IDENT '[' ']' ',' ListTypVar {
-			$$ = makeNode(Type); strcpy($$->u.ident, $1);
-			node_type = makeNode(Array); strcpy(node_type->u.ident, $2);
+			$$ = makeNode(Type); $$->u.ident = $1;
+			node_type = makeNode(Array); node_type->u.ident = $2;
 			addChild($$, node_type); addSibling($$, $6);
 			}
 
 		| TYPE IDENT '['']' {
-			$$ = makeNode(Type); strcpy($$->u.ident, $1);
-			Node* tmp = makeNode(Array); strcpy(tmp->u.ident, $2);
+			$$ = makeNode(Type); $$->u.ident = $1;
+			Node* tmp = makeNode(Array); tmp->u.ident = $2;
 			addChild($$, tmp);
 			}
 
@@ -184,22 +179,18 @@ ListTypVar: TYPE IDENT{
     ;
 
 Corps: '{' DeclVarsLocale SuiteInstr '}' {
-		if($2 != NULL || $3 != NULL) {
+		if($2.first != NULL || $3.first != NULL) {
 			$$ = makeNode(Body);
-			addChild($$, $2); addChild($$, $3);
+			addChild($$, listToNode(DeclVarsLocale, $2)); addChild($$, $3.first);
 				}
 		else{ $$ = NULL; }
 			}
     ;
 
 SuiteInstr: SuiteInstr Instr {
-		if($1 != NULL) {
-			$$ = $1;
-			addSibling($1, $2);
+			$$ = $1; appendToList(&$$, $2);
 			}
-		else { $$ = $2; }
-					}
-    | { $$ = NULL; }
+    | { $$ = makeList(NULL); }
     ;
 
 Instr: LValue '=' Exp ';' {
@@ -225,7 +216,7 @@ Instr: LValue '=' Exp ';' {
 
     | IDENT '(' Arguments ')' ';'{
 			$$ = makeNode(Ident);
-			strcpy($$->u.ident, $1);
+			$$->u.ident = $1;
 			addChild($$, $3);
 			}
 
@@ -239,7 +230,7 @@ Instr: LValue '=' Exp ';' {
 			}
 
     | '{' SuiteInstr '}'
-			{ $$ = $2; }
+			{ $$ = $2.first; }
 
     | ';' { $$ = NULL; }
     ;
@@ -321,23 +312,23 @@ F   : ADDSUB F {
 			{ $$ = $1; }
 
     | IDENT '(' Arguments ')' {
-			$$ = makeNode(Ident); strcpy($$->u.ident, $1);
+			$$ = makeNode(Ident); $$->u.ident = $1;
 			addChild($$, $3);
 			}
     ;
 
 LValue: IDENT
-			{ $$ = makeNode(Ident); strcpy($$->u.ident, $1); }
+			{ $$ = makeNode(Ident); $$->u.ident = $1; }
 
 		|	IDENT '[' Exp ']' {
-			$$ = makeNode(Array); strcpy($$->u.ident, $1);
+			$$ = makeNode(Array); $$->u.ident = $1;
 			addChild($$, $3);
 			}
     ;
 
 Arguments: ListExp {
 			$$ = makeNode(Arguments);
-			addChild($$, $1);
+			addChild($$, $1.first);
 				}
 
    		| { $$ = makeNode(Arguments);
@@ -346,10 +337,10 @@ Arguments: ListExp {
     ;
 
 ListExp: ListExp ',' Exp {
-			$$ = $1; addSibling($1, $3);
+			$$ = $1; appendToList(&$$, $3);
 				}
 
-		| Exp { $$ = $1; }
+		| Exp { $$ = makeList($1); }
     ;
 
 %%
@@ -60,24 +60,44 @@ const char *StringFromLabel[] = {
     /* To avoid listing them twice, see https://stackoverflow.com/a/10966395 */
 };
 
+/* Nodes are never freed one by one: they are bump-allocated in chunks and the
+ * whole tree is released at once with resetNodeArena(). The chunks are listed
+ * in nodeChunks so a node is found from its 32-bit index. */
+Node **nodeChunks = NULL;
+static int nbNodeChunks = 0;
+static nodeid_t nextNodeId = NO_NODE;
+
 /**
  * @fn Node* makeNode(label_t label)
- * @brief Create a new node.
+ * @brief Create a new node in the node arena.
  * 
  * @param label label_t Label of the node.
  * @return Node* New node.
  */
 Node *makeNode(label_t label)
 {
-    Node *node = malloc(sizeof(Node));
-    if (!node)
+    // Index 0 is NO_NODE, so the first slot of the first chunk is never used.
+    if (nextNodeId == NO_NODE)
+        nextNodeId = 1;
+    if ((int)(nextNodeId >> NODE_CHUNK_BITS) == nbNodeChunks)
     {
-        fprintf(stderr, "Ran out of memory\n");
-        exit(2);
+        Node **chunks = realloc(nodeChunks, (nbNodeChunks + 1) * sizeof(Node *));
+        Node *chunk = calloc(NODE_CHUNK_SIZE, sizeof(Node));
+        if (!chunks || !chunk)
+        {
+            fprintf(stderr, "Ran out of memory\n");
+            exit(2);
+        }
+        nodeChunks = chunks;
+        nodeChunks[nbNodeChunks++] = chunk;
     }
+    Node *node = nodeAt(nextNodeId);
+    node->id = nextNodeId++;
     node->label = label;
-    node->firstChild = node->nextSibling = NULL;
+    node->firstChild = node->nextSibling = NO_NODE;
     node->lineno = lineno;
+    node->type = UNTYPED;
+    node->scope = UNBOUND;
     return node;
 }
 
@@ -91,9 +111,9 @@ Node *makeNode(label_t label)
 void addSibling(Node *node, Node *sibling)
 {
     Node *curr = node;
-    while (curr->nextSibling != NULL)
-        curr = curr->nextSibling;
-    curr->nextSibling = sibling;
+    while (curr->nextSibling != NO_NODE)
+        curr = NEXTSIBLING(curr);
+    curr->nextSibling = nodeId(sibling);
 }
 
 /**
@@ -105,27 +125,76 @@ void addSibling(Node *node, Node *sibling)
  */
 void addChild(Node *parent, Node *child)
 {
-    if (parent->firstChild == NULL)
-        parent->firstChild = child;
+    if (parent->firstChild == NO_NODE)
+        parent->firstChild = nodeId(child);
     else
-        addSibling(parent->firstChild, child);
+        addSibling(FIRSTCHILD(parent), child);
 }
 
 /**
- * @fn void deleteTree(Node *node)
- * @brief Delete a tree.
+ * @fn NodeList makeList(Node *first)
+ * @brief Create a list of siblings starting with a node (or an empty one).
  * 
- * @param node Node* Node to delete.
+ * @param first Node* First node of the list, may be NULL.
+ * @return NodeList New list.
  */
-void deleteTree(Node *node)
+NodeList makeList(Node *first)
+{
+    NodeList list = {NULL, NULL};
+    appendToList(&list, first);
+    return list;
+}
+
+/**
+ * @fn void appendToList(NodeList *list, Node *node)
+ * @brief Append a node (and its own siblings) at the end of a list.
+ * Only the appended chain is walked, so appending is constant time for single nodes.
+ * 
+ * @param list NodeList* List to append the node on.
+ * @param node Node* Node to append, may be NULL.
+ */
+void appendToList(NodeList *list, Node *node)
 {
     if (!node)
         return;
-    if (node->firstChild)
-        deleteTree(node->firstChild);
-    if (node->nextSibling)
-        deleteTree(node->nextSibling);
-    free(node);
+    if (!list->first)
+        list->first = node;
+    else
+        list->last->nextSibling = nodeId(node);
+    list->last = node;
+    while (list->last->nextSibling != NO_NODE)
+        list->last = NEXTSIBLING(list->last);
+}
+
+/**
+ * @fn Node *listToNode(label_t label, NodeList list)
+ * @brief Create a node holding the list as its children.
+ * 
+ * @param label label_t Label of the node.
+ * @param list NodeList Children of the node.
+ * @return Node* New node, NULL if the list is empty.
+ */
+Node *listToNode(label_t label, NodeList list)
+{
+    if (!list.first)
+        return NULL;
+    Node *node = makeNode(label);
+    node->firstChild = nodeId(list.first);
+    return node;
+}
+
+/**
+ * @fn void resetNodeArena()
+ * @brief Release every node created by makeNode at once.
+ */
+void resetNodeArena()
+{
+    for (int i = 0; i < nbNodeChunks; i++)
+        free(nodeChunks[i]);
+    free(nodeChunks);
+    nodeChunks = NULL;
+    nbNodeChunks = 0;
+    nextNodeId = NO_NODE;
 }
 
 /**
@@ -150,12 +219,12 @@ void printTree(Node *node)
     switch (node->label)
     {
     case Type:
-        printf("\033[31m(%s)\033[0m", node->u.ident);
+        printf("\033[31m(%s)\033[0m", identToString(node->u.ident));
         break;
     case Ident:
-        printf("\033[31m(%s)\033[0m", node->u.ident);
+        printf("\033[31m(%s)\033[0m", identToString(node->u.ident));
         break;
-    case Array: printf("\033[90m(%s)\033[0m", node->u.ident); /*pour differencier un tableau*/
+    case Array: printf("\033[90m(%s)\033[0m", identToString(node->u.ident)); /*pour differencier un tableau*/
         break;
     case Eq:
         printf("\033[32m(%s)\033[0m", node->u.comp);
@@ -180,9 +249,9 @@ void printTree(Node *node)
     }
     printf("\n");
     depth++;
-    for (Node *child = node->firstChild; child != NULL; child = child->nextSibling)
+    for (Node *child = FIRSTCHILD(node); child != NULL; child = NEXTSIBLING(child))
     {
-        rightmost[depth] = (child->nextSibling) ? false : true;
+        rightmost[depth] = (child->nextSibling != NO_NODE) ? false : true;
         printTree(child);
     }
     depth--;
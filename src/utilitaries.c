@@ -7,6 +7,7 @@
 
 #include "utilitaries.h"
 #include "progTable.h"
+#include "defaultFunctionWritter.h"
 
 #include <getopt.h>
 #include <stdio.h>
@@ -44,25 +45,31 @@ void printTableLine(int *columnLength, int columnNb)
 }
 
 /**
- * @fn ReturnInfo addCell(void **arr, int len, unsigned long size)
- * @brief Add a cell to the array.
+ * @fn ReturnInfo addCell(void **arr, int len, int *capacity, unsigned long size)
+ * @brief Make room for one more cell in the array, doubling its capacity when it is full.
  *
  * @param arr The array to add to.
  * @param len The length of the array.
+ * @param capacity The number of cells allocated for the array, updated on growth.
  * @param size The size of the cell.
  * @return ReturnInfo The return info.
  */
-ReturnInfo addCell(void **arr, int len, unsigned long size)
+ReturnInfo addCell(void **arr, int len, int *capacity, unsigned long size)
 {
-    if (!arr || !size)
+    if (!arr || !capacity || !size)
         return NULL_ARGUMENT;
 
-    if (!(*arr))
-        *arr = malloc(size);
-    else
-        *arr = realloc(*arr, (len + 1) * size);
+    if (*arr && len < *capacity)
+        return SUCCESS;
+
+    int newCapacity = *capacity ? *capacity * 2 : 4;
+    void *grown = realloc(*arr, newCapacity * size);
+    if (!grown)
+        return ALLOC_ERROR;
 
-    return *arr == NULL ? ALLOC_ERROR : SUCCESS;
+    *arr = grown;
+    *capacity = newCapacity;
+    return SUCCESS;
 }
 
 /**
@@ -93,6 +100,23 @@ void help(const char *programName)
     fprintf(stdout,
             "   -t, --tree : Print the abstract tree created after the "
             "analysis of the program.\n");
+    fprintf(stdout,
+            "   -i, --ir : Print the three-address code of every function, "
+            "cut into basic blocks.\n");
+    fprintf(stdout,
+            "   -l [size], --inline-limit [size] : Inline the calls to the "
+            "functions of at most size instructions (20 by default, 0 to disable).\n");
+    fprintf(stdout,
+            "   -w [size], --peephole-window [size] : Let the peephole look at "
+            "size instructions for each rewriting (8 by default, 0 to disable).\n");
+    fprintf(stdout,
+            "   -p, --peephole : Print the instructions of every function before "
+            "and after the peephole, and the rewritings done.\n");
+    fprintf(stdout,
+            "   -r [directory], --runtime [directory] : Write the sources of the "
+            "runtime into directory, one per part, and terminates execution. "
+            "The executables are linked with the archive libtpcrt.a found next "
+            "to the compiler when it is not older than it.\n");
     fprintf(stdout,
             "   -h, --help : Displays a description of the user interface "
             "and terminates execution.\n");
@@ -115,13 +139,13 @@ void help(const char *programName)
 }
 
 /**
- * @fn AuthorizedType getType(char *type)
+ * @fn AuthorizedType getType(const char *type)
  * @brief Get the type of the node.
  *
  * @param type The type of the node.
  * @return AuthorizedType The authorized type.
  */
-AuthorizedType getType(char *type)
+AuthorizedType getType(const char *type)
 {
     if (!type)
         return UNAUTHORIZED;
@@ -159,7 +183,7 @@ char *typeToString(AuthorizedType type)
 }
 
 /**
- * @fn int optionSwitch(int opt, char *exec, int *showAllTables, int *showAllFunctions, char *functionToShow, int *showGlobals, int *printTreeOption, char *outputName)
+ * @fn int optionSwitch(int opt, char *exec, int *showAllTables, int *showAllFunctions, char *functionToShow, int *showGlobals, int *printTreeOption, int *printIrOption, int *inlineLimit, int *peepholeWindow, int *printPeepholeOption, char *outputName)
  * @brief Handle the option switch.
  *
  * @param opt The option to handle.
@@ -169,10 +193,14 @@ char *typeToString(AuthorizedType type)
  * @param functionToShow The function to show.
  * @param showGlobals The flag to show the globals.
  * @param printTreeOption The flag to print the tree.
+ * @param printIrOption The flag to print the lowered code.
+ * @param inlineLimit The maximum size of an inlined function.
+ * @param peepholeWindow The number of instructions a rewriting of the peephole may look at.
+ * @param printPeepholeOption The flag to print what the peephole did.
  * @param outputName The name of the output file.
  * @return int The return verification value.
  */
-int optionSwitch(int opt, char *exec, int *showAllTables, int *showAllFunctions, char *functionToShow, int *showGlobals, int *printTreeOption, char *outputName)
+int optionSwitch(int opt, char *exec, int *showAllTables, int *showAllFunctions, char *functionToShow, int *showGlobals, int *printTreeOption, int *printIrOption, int *inlineLimit, int *peepholeWindow, int *printPeepholeOption, char *outputName)
 {
     switch (opt)
     {
@@ -192,6 +220,27 @@ int optionSwitch(int opt, char *exec, int *showAllTables, int *showAllFunctions,
     case 't':
         *printTreeOption = 1;
         break;
+    case 'i':
+        *printIrOption = 1;
+        break;
+    case 'l':
+        *inlineLimit = atoi(optarg);
+        if (*inlineLimit < 0)
+            *inlineLimit = 0;
+        break;
+    case 'w':
+        *peepholeWindow = atoi(optarg);
+        if (*peepholeWindow < 0)
+            *peepholeWindow = 0;
+        break;
+    case 'p':
+        *printPeepholeOption = 1;
+        break;
+    case 'r':
+    {
+        ReturnInfo info = writeRuntimeSources(optarg);
+        exit(info == SUCCESS ? EXIT_SUCCESS : getErrorCode(info));
+    }
     case 'o':
         if (outputName && strlen(optarg) < SIZE_ID)
             strcpy(outputName, optarg);
@@ -208,7 +257,7 @@ int optionSwitch(int opt, char *exec, int *showAllTables, int *showAllFunctions,
 }
 
 /**
- * @fn int optionHandler(int argc, char **argv, int *showAllTables, int *showAllFunctions, char *functionToShow, int *showGlobals, int *printTreeOption, char *outputName)
+ * @fn int optionHandler(int argc, char **argv, int *showAllTables, int *showAllFunctions, char *functionToShow, int *showGlobals, int *printTreeOption, int *printIrOption, int *inlineLimit, int *peepholeWindow, int *printPeepholeOption, char *outputName)
  * @brief Handle the options of the program.
  *
  * @param argc The number of arguments.
@@ -218,10 +267,14 @@ int optionSwitch(int opt, char *exec, int *showAllTables, int *showAllFunctions,
  * @param functionToShow The function to show.
  * @param showGlobals The flag to show the globals.
  * @param printTreeOption The flag to print the tree.
+ * @param printIrOption The flag to print the lowered code.
+ * @param inlineLimit The maximum size of an inlined function.
+ * @param peepholeWindow The number of instructions a rewriting of the peephole may look at.
+ * @param printPeepholeOption The flag to print what the peephole did.
  * @param outputName The name of the output file.
  * @return int The return verification value.
  */
-int optionHandler(int argc, char **argv, int *showAllTables, int *showAllFunctions, char *functionToShow, int *showGlobals, int *printTreeOption, char *outputName)
+int optionHandler(int argc, char **argv, int *showAllTables, int *showAllFunctions, char *functionToShow, int *showGlobals, int *printTreeOption, int *printIrOption, int *inlineLimit, int *peepholeWindow, int *printPeepholeOption, char *outputName)
 {
     int opt;
 
@@ -231,14 +284,19 @@ int optionHandler(int argc, char **argv, int *showAllTables, int *showAllFunctio
         {"function-table", required_argument, NULL, 'f'},
         {"global-table", no_argument, NULL, 'g'},
         {"tree", no_argument, NULL, 't'},
+        {"ir", no_argument, NULL, 'i'},
+        {"inline-limit", required_argument, NULL, 'l'},
+        {"peephole-window", required_argument, NULL, 'w'},
+        {"peephole", no_argument, NULL, 'p'},
+        {"runtime", required_argument, NULL, 'r'},
         {"output", required_argument, NULL, 'o'},
         {"help", no_argument, NULL, 'h'},
         {0, 0, 0, 0}};
 
-    while ((opt = getopt_long(argc, argv, "sFf:gtho:", long_options, NULL)) != -1)
+    while ((opt = getopt_long(argc, argv, "sFf:gtil:w:pr:ho:", long_options, NULL)) != -1)
     {
         int switchRet =
-            optionSwitch(opt, argv[0], showAllTables, showAllFunctions, functionToShow, showGlobals, printTreeOption, outputName);
+            optionSwitch(opt, argv[0], showAllTables, showAllFunctions, functionToShow, showGlobals, printTreeOption, printIrOption, inlineLimit, peepholeWindow, printPeepholeOption, outputName);
         if (switchRet)
             return switchRet;
     }
@@ -255,12 +313,12 @@ int optionHandler(int argc, char **argv, int *showAllTables, int *showAllFunctio
  */
 Node *getChildLabeled(Node *node, label_t label)
 {
-    if (!node || !node->firstChild)
+    if (!node || !FIRSTCHILD(node))
         return NULL;
 
-    Node *child = node->firstChild;
+    Node *child = FIRSTCHILD(node);
     while (child && child->label != label)
-        child = child->nextSibling;
+        child = NEXTSIBLING(child);
     return child;
 }
 
@@ -395,24 +453,24 @@ int getErrorCode(ReturnInfo info)
 }
 
 /**
- * @fn ReturnInfo getFunId(Node *declFun, char *funId)
+ * @fn ReturnInfo getFunId(Node *declFun, ident_t *funId)
  * @brief Get the function id.
  *
  * @param declFun The declaration's node.
  * @param funId The function id.
  * @return ReturnInfo The return info.
  */
-ReturnInfo getFunId(Node *declFun, char *funId)
+ReturnInfo getFunId(Node *declFun, ident_t *funId)
 {
     if (!declFun || !funId)
         return NULL_ARGUMENT;
     if (declFun->label != DeclFonct)
         return NOT_A_FUNCTION;
 
-    if (declFun->firstChild->label == Void)
-        strcpy(funId, declFun->firstChild->nextSibling->u.ident);
+    if (FIRSTCHILD(declFun)->label == Void)
+        *funId = NEXTSIBLING(FIRSTCHILD(declFun))->u.ident;
     else
-        strcpy(funId, declFun->firstChild->firstChild->u.ident);
+        *funId = FIRSTCHILD(FIRSTCHILD(declFun))->u.ident;
     return SUCCESS;
 }
 
@@ -508,42 +566,43 @@ char *sizeToAsm(int size)
 }
 
 /**
- * @fn label_t getExpressionType(Node *expr, ProgTable pt, FunctionInfo funTable)
- * @brief Get the type of the expression.
+ * @fn label_t computeExpressionType(Node *expr, const ProgTable *pt, const FunctionInfo *funTable)
+ * @brief Compute the type of the expression.
  * 
  * @param expr The expression to get the type from.
  * @param pt The program table.
  * @param funTable The function table we are in.
  * @return label_t The type of the expression.
  */
-label_t getExpressionType(Node *expr, ProgTable pt, FunctionInfo funTable)
+label_t computeExpressionType(Node *expr, const ProgTable *pt, const FunctionInfo *funTable)
 {
     int index;
     switch (expr->label)
     {
     case Array:
-        if (!expr->firstChild)
+        if (!FIRSTCHILD(expr))
             return Address;
     case Ident:
-        if (isInTable(funTable.locals, expr->u.ident, &index) == ID_IN_TABLE)
-            return (funTable.locals.symbols[index].isArray && !expr->firstChild) ? Address : (funTable.locals.symbols[index].type == INT ? Num : Character);
-        else if (isInTable(funTable.args, expr->u.ident, &index) == ID_IN_TABLE)
-            return (funTable.args.symbols[index].isArray && !expr->firstChild) ? Address : (funTable.args.symbols[index].type == INT ? Num : Character);
-        else if (isInTable(pt.glob, expr->u.ident, &index) == ID_IN_TABLE)
-            return (pt.glob.symbols[index].isArray && !expr->firstChild) ? Address : (pt.glob.symbols[index].type == INT ? Num : Character);
+        if (isInTable(&funTable->locals, expr->u.ident, &index) == ID_IN_TABLE)
+            return (funTable->locals.symbols[index].isArray && !FIRSTCHILD(expr)) ? Address : (funTable->locals.symbols[index].type == INT ? Num : Character);
+        else if (isInTable(&funTable->args, expr->u.ident, &index) == ID_IN_TABLE)
+            return (funTable->args.symbols[index].isArray && !FIRSTCHILD(expr)) ? Address : (funTable->args.symbols[index].type == INT ? Num : Character);
+        else if (isInTable(&pt->glob, expr->u.ident, &index) == ID_IN_TABLE)
+            return (pt->glob.symbols[index].isArray && !FIRSTCHILD(expr)) ? Address : (pt->glob.symbols[index].type == INT ? Num : Character);
         else
         {
-            FunctionInfo call = getFunctionsTable(pt, expr->u.ident);
-            if (!strcmp(call.id, "err"))
+            const FunctionInfo *call = getFunctionsTable(pt, expr->u.ident);
+            if (!call)
                 return Void;
-            return call.type == INT ? Num : (call.type == CHAR ? Character : Void);
+            return call->type == INT ? Num : (call->type == CHAR ? Character : Void);
         }
     case Instr:
-        return getExpressionType(expr->firstChild, pt, funTable);
+        return getExpressionType(FIRSTCHILD(expr), pt, funTable);
     case Or:
     case And:
     case Eq:
     case Order:
+    case ExclamationPoint:
     case Addsub:
     case Divstar:
     case Num:
@@ -561,10 +620,25 @@ label_t getExpressionType(Node *expr, ProgTable pt, FunctionInfo funTable)
     case T:
     case F:
     case LValue:
-    case ExclamationPoint:
         printf("J'étais pas sur de son type donc vérifie ce que c'est.\n");
         printTree(expr);
     default:
         return Void;
     }
 }
+
+/**
+ * @fn label_t getExpressionType(Node *expr, const ProgTable *pt, const FunctionInfo *funTable)
+ * @brief Get the type of the expression, computed once then kept in the node.
+ * 
+ * @param expr The expression to get the type from.
+ * @param pt The program table.
+ * @param funTable The function table we are in.
+ * @return label_t The type of the expression.
+ */
+label_t getExpressionType(Node *expr, const ProgTable *pt, const FunctionInfo *funTable)
+{
+    if (expr->type == UNTYPED)
+        expr->type = computeExpressionType(expr, pt, funTable);
+    return expr->type;
+}
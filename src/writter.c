@@ -3,6 +3,12 @@
  * @author Marc LE COQUIL - Lesly Jumelle TOUSSAINT
  * @brief Writter and translater from tpc to nasm.
  * @date 2024-02-10
+ *
+ * Every function comes lowered to three-address code (see ir.c), its virtual
+ * registers are given a machine register or a spill slot (see regalloc.c),
+ * then each instruction is translated on the locations it got. rax, rcx and
+ * rdx are scratch registers, used for spilled operands, divisions and the
+ * index and base of memory operands.
  */
 
 #include <stdio.h>
@@ -11,1437 +17,961 @@
 #include "functionTable.h"
 #include "writter.h"
 #include "defaultFunctionWritter.h"
+#include "emitter.h"
+#include "regalloc.h"
+#include "peephole.h"
 
-// Node used to compare the value of a variable with 0.
-Node COMPARAISON_NODE = {Ident, NULL, NULL};
-Node ZERO = {Num, NULL, &COMPARAISON_NODE, {.num = 0}};
-Node IMPLCITE_IF_NODE = {Eq, &ZERO, NULL, {.ident = "!="}};
-Node IMPLCITE_SUB_NODE = {Addsub, &ZERO, NULL, {.ident = "-"}};
-
-// Registers used to pass the arguments of a function.
-char *ARG_REGISTERS[6] = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
-
-ReturnInfo writeInstr(Node *instr, FunctionInfo funTable);
-ReturnInfo writeCall(Node *call, FunctionInfo funTable, FunctionInfo funCalled);
-void writeAlignStackBeforeFunCall(FILE *f);
-void writeAlignStackAfterFunCall(FILE *f);
-ReturnInfo handleLocalGetIdent(Node *maybeLocal, FunctionInfo funTable);
-ReturnInfo handleLocalPushIdent(Node *maybeLocal, FunctionInfo funTable);
-ReturnInfo handleFunctionCall(Node *maybeCall, FunctionInfo funTable);
-ReturnInfo writeElse(Node *elseInstr, FunctionInfo funTable, int curIfCount);
-
-int ifCount = 0;
-int whileCount = 0;
-int conditionCount = 0;
-int assignementCount = 0;
-FILE *f;
-ProgTable pt;
+// Names of the registers, by size of the value held.
+const char *QWORD_REGISTERS[16] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+                                   "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"};
+const char *DWORD_REGISTERS[16] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+                                   "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"};
+const char *BYTE_REGISTERS[16] = {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+                                  "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"};
 
-/**
- * @fn ReturnInfo quickVerif(Node *root, char *fileName)
- * @brief Quick verification of the program.
- *
- * @param root Node* Root of the tree.
- * @param fileName char* Name of the file.
- * @return ReturnInfo Eventual error code.
- */
-ReturnInfo quickVerif(Node *root, char *fileName)
-{
-    if (!root || !fileName || pt.size <= 0)
-        return FAILURE;
+// Condition codes of the comparisons, in the order of IrOp.
+const char *CONDITIONS[6] = {"e", "ne", "l", "le", "g", "ge"};
 
-    FunctionInfo maybeMain = getFunctionsTable(pt, "main");
-    if (strcmp(maybeMain.id, "main"))
-    {
-        fprintf(stderr, "No main function found in the program.\n");
-        return NO_MAIN_FUNCTION;
-    }
+// Callee-saved registers a function has to restore if it uses them.
+#define NB_CALLEE_SAVED 5
+const int CALLEE_SAVED[NB_CALLEE_SAVED] = {RBX, R12, R13, R14, R15};
 
-    return SUCCESS;
-}
+const ProgTable *pt;
+ident_t mainId;
+
+// Function being written, with the locations of its virtual registers.
+const IrFunction *curIr;
+Allocation curAlloc;
+int savedBase;
+int spillBase;
+
+// Register addressing the frame, rbp or rsp in a leaf function, and the offset of
+// the top of the frame from it. The locals are below the top, the arguments passed
+// on the stack above the return address.
+int frameRegister;
+int frameTop;
+
+// Window of the peephole run on every function written, and if what it did is printed.
+int peepholeWindow;
+int printPeephole;
 
-/* ----------------- Writing of basics value (int and char) ----------------- */
 /**
- * @fn ReturnInfo writeNum(Node *num, FunctionInfo funTable)
- * @brief Write the translation of pushing a number on the stack.
+ * @fn ReturnInfo quickVerif(const IrProgram *prog, char *fileName)
+ * @brief Quick verification of the program. Semantic checks are done before by checkProg.
  *
- * @param num Node* Number to push.
- * @param funTable FunctionInfo Function table we are in.
+ * @param prog const IrProgram* Lowered program.
+ * @param fileName char* Name of the file.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo writeNum(Node *num, FunctionInfo funTable)
+ReturnInfo quickVerif(const IrProgram *prog, char *fileName)
 {
-    fprintf(f, "\tmov rax, %d\n", num->u.num);
-    fprintf(f, "\tpush rax\n\n");
+    if (!prog || !fileName || pt->size <= 0)
+        return FAILURE;
     return SUCCESS;
 }
 
+/* ------- Writing of operands -------- */
+
 /**
- * @fn ReturnInfo writeCharacter(Node *chr, FunctionInfo funTable)
- * @brief Write the translation of pushing a character on the stack.
+ * @fn int isRegister(int location)
+ * @brief Tell if a location is a machine register.
  *
- * @param chr Node* Character to push.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @param location int Location.
+ * @return int 1 for a register, 0 for a spill slot.
  */
-ReturnInfo writeCharacter(Node *chr, FunctionInfo funTable)
+int isRegister(int location)
 {
-    fprintf(f, "\txor rax, rax\n");
-    fprintf(f, "\tmov al, %d\n", charToAsciiCode(chr->u.character));
-    fprintf(f, "\tpush rax\n\n");
-    return SUCCESS;
+    return location >= 0 && location < SPILLED;
 }
 
 /**
- * @fn ReturnInfo writeEventualIndex(Node *indexNode, FunctionInfo funTable, Symbol var)
- * @brief Write the translation of an eventual index.
+ * @fn int locationOf(vreg_t vreg)
+ * @brief Get the location of a virtual register of the function being written.
  *
- * @param indexNode Node* Index to write.
- * @param funTable FunctionInfo Function table we are in.
- * @param var Symbol Variable wich the index refers to.
- * @return ReturnInfo Eventual error code.
+ * @param vreg vreg_t Virtual register.
+ * @return int Location.
  */
-ReturnInfo writeEventualIndex(Node *indexNode, FunctionInfo funTable, Symbol var)
+int locationOf(vreg_t vreg)
 {
-    if (!indexNode && !var.isArray)
-    {
-        fprintf(f, "\txor rax, rax\n");
-        fprintf(f, "\tpush rax\n\n");
-        return SUCCESS;
-    }
-    if (!indexNode && var.isArray)
-    {
-        fprintf(f, "\tmov rax, -1\n");
-        fprintf(f, "\tpush rax\n\n");
-        return SUCCESS;
-    }
-    if (getExpressionType(indexNode, pt, funTable) == Void)
-    {
-        fprintf(stderr, "Void-like expression used to describe an index at line %d.\n", indexNode->lineno);
-        return VOID_INDEX;
-    }
-    return writeInstr(indexNode, funTable);
+    return curAlloc.locations[vreg];
 }
 
 /**
- * @fn ReturnInfo writeGlobalVariablePushValue(int globalValueIndex)
- * @brief Write the translation of pushing a global variable on the stack.
+ * @fn void writeFrameAddress(long offset)
+ * @brief Write the address of a slot of the frame, from the register addressing it.
  *
- * @param globalValueIndex int Index of the global variable in the program table.
- * @return ReturnInfo Eventual error code.
+ * @param offset long Offset of the slot from the top of the frame.
  */
-ReturnInfo writeGlobalVariablePushValue(int globalValueIndex)
+void writeFrameAddress(long offset)
 {
-    if (pt.glob.symbols[globalValueIndex].isArray)
-    {
-        fprintf(f, "\tpop rbx\n");
-        fprintf(f, "\tcmp rbx, -1\n");
-        fprintf(f, "\tjne .not_address%d\n", assignementCount);
-        fprintf(f, "\tlea rax, [%s]\n", pt.glob.symbols[globalValueIndex].id);
-        fprintf(f, "\tjmp .end_assignement%d\n", assignementCount);
-        fprintf(f, "\t\t.not_address%d:\n", assignementCount);
-        fprintf(f, "\timul rbx, %d\n", pt.glob.symbols[globalValueIndex].type);
-        fprintf(f, "\txor rax, rax\n");
-        fprintf(f, "\tmovsx rax, %s [%s + rbx]\n",
-                pt.glob.symbols[globalValueIndex].type == INT ? "dword" : "byte",
-                pt.glob.symbols[globalValueIndex].id);
-        fprintf(f, "\t\t.end_assignement%d:\n", assignementCount);
-        assignementCount++;
-    }
-    else
-    {
-        fprintf(f, "\txor rax, rax\n");
-        fprintf(f, "\tmovsx rax, %s [%s]\n",
-                pt.glob.symbols[globalValueIndex].type == INT ? "dword" : "byte",
-                pt.glob.symbols[globalValueIndex].id);
-    }
-    fprintf(f, "\tpush rax\n\n");
-
-    return SUCCESS;
+    long disp = frameTop + offset;
+    emitStr(QWORD_REGISTERS[frameRegister]);
+    if (disp)
+        emit(" %c %ld", disp < 0 ? '-' : '+', disp < 0 ? -disp : disp);
 }
 
 /**
- * @fn ReturnInfo writeGlobalVariableGetValue(int globalValueIndex)
- * @brief Write the translation of getting a global variable of the stack.
+ * @fn void writeOperand(int location, int size)
+ * @brief Write a register, or the memory of a spill slot.
  *
- * @param globalValueIndex int Index of the global variable in the program table.
- * @return ReturnInfo Eventual error code.
+ * @param location int Location written.
+ * @param size int Size of the operand: 1, 4 or 8 bytes.
  */
-ReturnInfo writeGlobalVariableGetValue(int globalValueIndex)
+void writeOperand(int location, int size)
 {
-    if (pt.glob.symbols[globalValueIndex].isArray)
+    if (isRegister(location))
     {
-        fprintf(f, "\tpop rbx\n");
-        fprintf(f, "\timul rbx, %d\n", pt.glob.symbols[globalValueIndex].type);
-        fprintf(f, "\tpop rax\n");
-        fprintf(f, "\tmov [%s + rbx], %s\n",
-                pt.glob.symbols[globalValueIndex].id,
-                pt.glob.symbols[globalValueIndex].type == INT ? "eax" : "al");
+        emitStr(size == 8 ? QWORD_REGISTERS[location] : size == 4 ? DWORD_REGISTERS[location] : BYTE_REGISTERS[location]);
+        return;
     }
-    else
-    {
-        fprintf(f, "\tpop rax\n");
-        fprintf(f, "\tmov %s [%s], %s\n",
-                pt.glob.symbols[globalValueIndex].type == INT ? "dword" : "byte",
-                pt.glob.symbols[globalValueIndex].id,
-                pt.glob.symbols[globalValueIndex].type == INT ? "eax" : "al");
-    }
-    return SUCCESS;
+    emit("%s [", size == 8 ? "qword" : size == 4 ? "dword" : "byte");
+    writeFrameAddress(-(spillBase + 8 * (location - SPILLED + 1)));
+    emitLit("]");
 }
 
 /**
- * @fn ReturnInfo writeLocalVariablePushValue(FunctionInfo funTable, int localValueIndex)
- * @brief Write the translation of pushing a local variable on the stack.
+ * @fn void writeOperation(const char *mnemonic, int dst, int src)
+ * @brief Write an instruction on two 64-bit operands.
  *
- * @param funTable FunctionInfo Function table we are in.
- * @param localValueIndex int Index of the local variable in the function table.
- * @return ReturnInfo Eventual error code.
+ * @param mnemonic const char* Mnemonic of the instruction.
+ * @param dst int Location of the first operand.
+ * @param src int Location of the second operand.
  */
-ReturnInfo writeLocalVariablePushValue(FunctionInfo funTable, int localValueIndex)
+void writeOperation(const char *mnemonic, int dst, int src)
 {
-    if (funTable.locals.symbols[localValueIndex].isArray)
-    {
-        fprintf(f, "\tpop rbx\n");
-        fprintf(f, "\tcmp rbx, -1\n");
-        fprintf(f, "\tjne .not_address%d\n", assignementCount);
-        fprintf(f, "\tlea rax, [rbp - %d]\n", funTable.locals.symbols[localValueIndex].address + funTable.locals.symbols[localValueIndex].type * funTable.locals.symbols[localValueIndex].numberOfValues);
-        fprintf(f, "\tjmp .end_assignement%d\n", assignementCount);
-        fprintf(f, "\t\t.not_address%d:\n", assignementCount);
-        fprintf(f, "\timul rbx, %d\n", funTable.locals.symbols[localValueIndex].type);
-        fprintf(f, "\txor rax, rax\n");
-        fprintf(f, "\tmovsx rax, %s [rbp - %d + rbx]\n",
-                funTable.locals.symbols[localValueIndex].type == INT ? "dword" : "byte",
-                funTable.locals.symbols[localValueIndex].address + funTable.locals.symbols[localValueIndex].type * funTable.locals.symbols[localValueIndex].numberOfValues);
-        fprintf(f, "\t\t.end_assignement%d:\n", assignementCount);
-        assignementCount++;
-    }
-    else
-    {
-        fprintf(f, "\txor rax, rax\n");
-        fprintf(f, "\tmovsx rax, %s [rbp - %d]\n",
-                funTable.locals.symbols[localValueIndex].type == INT ? "dword" : "byte",
-                funTable.locals.symbols[localValueIndex].address + funTable.locals.symbols[localValueIndex].type);
-    }
-    fprintf(f, "\tpush rax\n\n");
-    return SUCCESS;
+    emit("\t%s ", mnemonic);
+    writeOperand(dst, 8);
+    emitLit(", ");
+    writeOperand(src, 8);
+    emitLit("\n");
 }
 
 /**
- * @fn ReturnInfo writeLocalVariableGetValue(FunctionInfo funTable, int localValueIndex)
- * @brief Write the translation of getting a local variable of the stack.
+ * @fn void writeMove(int dst, int src)
+ * @brief Write the move of a location into another one, through rax if both are in memory.
  *
- * @param funTable FunctionInfo Function table we are in.
- * @param localValueIndex int Index of the local variable in the function table.
- * @return ReturnInfo Eventual error code.
+ * @param dst int Location written.
+ * @param src int Location read.
  */
-ReturnInfo writeLocalVariableGetValue(FunctionInfo funTable, int localValueIndex)
+void writeMove(int dst, int src)
 {
-    if (funTable.locals.symbols[localValueIndex].isArray)
-    {
-        fprintf(f, "\tpop rbx\n");
-        fprintf(f, "\timul rbx, %d\n", funTable.locals.symbols[localValueIndex].type);
-        fprintf(f, "\tpop rax\n");
-        fprintf(f, "\tmov [rbp - %d + rbx], %s\n",
-                funTable.locals.symbols[localValueIndex].address + funTable.locals.symbols[localValueIndex].type * funTable.locals.symbols[localValueIndex].numberOfValues,
-                funTable.locals.symbols[localValueIndex].type == INT ? "eax" : "al");
-    }
-    else
+    if (dst == src)
+        return;
+    if (!isRegister(dst) && !isRegister(src))
     {
-        fprintf(f, "\tpop rax\n");
-        fprintf(f, "\tmov [rbp - %d], %s\n",
-                funTable.locals.symbols[localValueIndex].address + funTable.locals.symbols[localValueIndex].type,
-                funTable.locals.symbols[localValueIndex].type == INT ? "eax" : "al");
+        writeOperation("mov", RAX, src);
+        src = RAX;
     }
-
-    return SUCCESS;
+    writeOperation("mov", dst, src);
 }
 
 /**
- * @fn ReturnInfo writeArgVariablePushValue(FunctionInfo funTable, int argValueIndex)
- * @brief Write the translation of pushing a argument variable on the stack.
+ * @fn void writeParallelMove(int *dsts, int *srcs, int nb)
+ * @brief Write moves which all happen at once, a location being read before it is overwritten.
+ * Cycles of registers are broken through rax. The destinations are all different.
  *
- * @param funTable FunctionInfo Function table we are in.
- * @param argValueIndex int Index of the argument variable in the function table.
- * @return ReturnInfo Eventual error code.
+ * @param dsts int* Locations written.
+ * @param srcs int* Locations read, updated while moving.
+ * @param nb int Number of moves.
  */
-ReturnInfo writeArgVariablePushValue(FunctionInfo funTable, int argValueIndex)
+void writeParallelMove(int *dsts, int *srcs, int nb)
 {
-    // TODO
-    if (argValueIndex < 6)
+    int left = 0;
+    for (int i = 0; i < nb; i++)
+        if (dsts[i] != srcs[i])
+            left++;
+        else
+            dsts[i] = NO_LOCATION;
+
+    while (left)
     {
-        if (funTable.args.symbols[argValueIndex].isAddress)
+        int ready = -1, pending = -1;
+        for (int i = 0; i < nb && ready < 0; i++)
         {
-            fprintf(f, "\tpop rbx\n");
-            fprintf(f, "\tcmp rbx, -1\n");
-            fprintf(f, "\tjne .not_address%d\n", assignementCount);
-            fprintf(f, "\tmov rax, %s\n", ARG_REGISTERS[argValueIndex]);
-            fprintf(f, "\tjmp .end_assignement%d\n", assignementCount);
-            fprintf(f, "\t\t.not_address%d:\n", assignementCount);
-            fprintf(f, "\timul rbx, %d\n", funTable.args.symbols[argValueIndex].type);
-            fprintf(f, "\txor rax, rax\n");
-            fprintf(f, "\tmovsx rax, %s [%s + rbx]\n",
-                    funTable.args.symbols[argValueIndex].type == INT ? "dword" : "byte", ARG_REGISTERS[argValueIndex]);
-            fprintf(f, "\t\t.end_assignement%d:\n", assignementCount);
-            fprintf(f, "\tpush rax\n\n");
-            assignementCount++;
+            if (dsts[i] == NO_LOCATION)
+                continue;
+            pending = i;
+            ready = i;
+            for (int j = 0; j < nb; j++)
+                if (j != i && dsts[j] != NO_LOCATION && srcs[j] == dsts[i])
+                    ready = -1;
         }
-        else
-            fprintf(f, "\tpush %s\n", ARG_REGISTERS[argValueIndex]);
+
+        if (ready < 0)
+        {
+            writeMove(RAX, dsts[pending]);
+            for (int j = 0; j < nb; j++)
+                if (dsts[j] != NO_LOCATION && srcs[j] == dsts[pending])
+                    srcs[j] = RAX;
+            continue;
+        }
+        writeMove(dsts[ready], srcs[ready]);
+        dsts[ready] = NO_LOCATION;
+        left--;
     }
-    else
-        fprintf(f, "\tpush %s\n", ARG_REGISTERS[argValueIndex - 6]);
-    return SUCCESS;
 }
 
 /**
- * @fn ReturnInfo writeArgVariableGetValue(FunctionInfo funTable, int argValueIndex)
- * @brief Write the translation of getting a argument variable of the stack.
+ * @fn void writeMemoryRegisters(const IrInstr *instr, int *base, int *index)
+ * @brief Get the base and index of a memory operand in registers, loading them in rdx and rcx if spilled.
  *
- * @param funTable FunctionInfo Function table we are in.
- * @param argValueIndex int Index of the argument variable in the function table.
- * @return ReturnInfo Eventual error code.
+ * @param instr const IrInstr* Instruction with a memory operand.
+ * @param base int* Register holding the address of a POINTER_BASE operand, filled.
+ * @param index int* Register holding the index, NO_REGISTER if none, filled.
  */
-ReturnInfo writeArgVariableGetValue(FunctionInfo funTable, int argValueIndex)
+void writeMemoryRegisters(const IrInstr *instr, int *base, int *index)
 {
-    // TODO
-    if (argValueIndex < 6)
+    *base = *index = NO_REGISTER;
+    if (instr->base == POINTER_BASE)
     {
-        if (funTable.args.symbols[argValueIndex].isAddress)
+        *base = locationOf(instr->a);
+        if (!isRegister(*base))
         {
-            fprintf(f, "\tpop rbx\n");
-            fprintf(f, "\timul rbx, %d\n", funTable.args.symbols[argValueIndex].type);
-            fprintf(f, "\tmov rax, %s\n", ARG_REGISTERS[argValueIndex]);
-            fprintf(f, "\tadd rax, rbx\n");
-            fprintf(f, "\tpop rbx\n");
-            fprintf(f, "\tmov [rax], %s\n", funTable.args.symbols[argValueIndex].type == INT ? "ebx" : "bl");
+            writeMove(RDX, *base);
+            *base = RDX;
         }
-        else
+    }
+    if (instr->b != NO_VREG)
+    {
+        *index = locationOf(instr->b);
+        if (!isRegister(*index))
         {
-            fprintf(f, "\tpop rax\n");
-            fprintf(f, "\tmov %s, rax\n", ARG_REGISTERS[argValueIndex]);
+            writeMove(RCX, *index);
+            *index = RCX;
         }
     }
-    else
-        fprintf(f, "\tmov %s, rax\n", ARG_REGISTERS[argValueIndex - 6]);
-
-    return SUCCESS;
 }
 
 /**
- * @fn ReturnInfo processInstructionBlock(Node *block, FunctionInfo funTable)
- * @brief Write the translation of every instruction in a block.
+ * @fn void writeMemory(const IrInstr *instr, int base, int index)
+ * @brief Write the memory operand of an instruction.
  *
- * @param block Node* Block of instructions to write.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @param instr const IrInstr* Instruction with a memory operand.
+ * @param base int Register holding the address of a POINTER_BASE operand.
+ * @param index int Register holding the index, NO_REGISTER if none.
  */
-ReturnInfo processInstructionBlock(Node *block, FunctionInfo funTable)
+void writeMemory(const IrInstr *instr, int base, int index)
 {
-    ReturnInfo info;
-    if (!block)
-        return SUCCESS;
-    do
-    {
-        info = writeInstr(block, funTable);
-        if (info != SUCCESS)
-            return info;
-
-    } while ((block = block->nextSibling) != NULL);
-    return SUCCESS;
+    emitLit("[");
+    if (instr->base == GLOBAL_BASE)
+        emitStr(identToString(instr->symbol));
+    else if (instr->base == FRAME_BASE)
+        writeFrameAddress(instr->imm);
+    else
+        emitStr(QWORD_REGISTERS[base]);
+    if (index != NO_REGISTER)
+        emit(" + %s * %d", QWORD_REGISTERS[index], instr->size);
+    emitLit("]");
 }
 
-/* ------- Identifier handlers -------- */
-/**
- * @fn ReturnInfo writeGetIdent(Node *ident, FunctionInfo funTable)
- * @brief Write the translation of putting the value of an identifier from the stack.
- *
- * @param ident Node* Identifier to get.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
- */
-ReturnInfo writeGetIdent(Node *ident, FunctionInfo funTable)
-{
-    ReturnInfo info = handleLocalGetIdent(ident, funTable);
-    if (info != SUCCESS)
-        return info;
-    fprintf(f, "\n");
-    return SUCCESS;
-}
+/* ------- Function calls -------- */
 
 /**
- * @fn ReturnInfo writePushIdent(Node *ident, FunctionInfo funTable)
- * @brief Write the translation of pushing the value of an identifier on the stack.
+ * @fn void writeCall(const IrInstr *call)
+ * @brief Write a call: the arguments after the sixth are pushed, then the first six are moved in their registers.
+ * Values live across the call are in callee-saved registers or in memory, so nothing is saved.
+ * The frame keeps rsp aligned on 16 bytes, so only an odd number of pushed arguments needs 8 bytes of padding.
  *
- * @param ident Node* Identifier to push.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @param call const IrInstr* Call to write.
  */
-ReturnInfo writePushIdent(Node *ident, FunctionInfo funTable)
+void writeCall(const IrInstr *call)
 {
-    ReturnInfo info = (ident && ident->firstChild && ident->firstChild->label == Arguments) ? handleFunctionCall(ident, funTable) : handleLocalPushIdent(ident, funTable);
-    if (info != SUCCESS)
-        return info;
-    fprintf(f, "\n");
-    return SUCCESS;
-}
+    const vreg_t *args = &curIr->callArgs[call->a];
+    int dsts[6], srcs[6];
+    int nbArgs = call->imm;
+    int nbPushed = nbArgs > 6 ? nbArgs - 6 : 0;
+    int pushedSize = 8 * (nbPushed + nbPushed % 2);
 
-/* ---------------------- Writing of basics operation ----------------------- */
-
-/**
- * @fn ReturnInfo writeAddsub(Node *addsub, FunctionInfo funTable)
- * @brief Write the translation of an addition or subtraction.
- *
- * @param addsub Node* Addition or subtraction to write.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
- */
-ReturnInfo writeAddsub(Node *addsub, FunctionInfo funTable)
-{
-    if (!addsub->firstChild->nextSibling && !strcmp(addsub->u.ident, "-"))
+    if (nbPushed % 2)
+        emitLit("\tsub rsp, 8\n");
+    for (int i = nbArgs - 1; i >= 6; i--)
     {
-        ZERO.nextSibling = addsub->firstChild;
-        addsub = &IMPLCITE_SUB_NODE;
+        emitLit("\tpush ");
+        writeOperand(locationOf(args[i]), 8);
+        emitLit("\n");
     }
-
-    if (getExpressionType(addsub->firstChild, pt, funTable) == Void || getExpressionType(addsub->firstChild->nextSibling, pt, funTable) == Void)
+    for (int i = 0; i < nbArgs && i < 6; i++)
     {
-
-        fprintf(stderr, "Error: Addition or subtraction of a void-like expression at line %d.\n", addsub->lineno);
-        return VOID_ADDSUB;
+        dsts[i] = ARG_REGISTERS[i];
+        srcs[i] = locationOf(args[i]);
     }
+    writeParallelMove(dsts, srcs, nbArgs < 6 ? nbArgs : 6);
 
-    ReturnInfo info = writeInstr(addsub->firstChild, funTable);
-    if (info != SUCCESS)
-        return info;
-
-    info = writeInstr(addsub->firstChild->nextSibling, funTable);
-    if (info != SUCCESS)
-        return info;
-
-    fprintf(f, "\tpop rcx\n");
-    fprintf(f, "\tpop rax\n");
-    fprintf(f, "\t%s rax, rcx\n", !strcmp(addsub->u.ident, "+") ? "add" : "sub");
-    fprintf(f, "\tpush rax\n\n");
-    return SUCCESS;
+    emit("\tcall %s\n", identToString(call->symbol));
+    if (pushedSize)
+        emit("\tadd rsp, %d\n", pushedSize);
+    if (call->dst != NO_VREG)
+        writeMove(locationOf(call->dst), RAX);
 }
 
 /**
- * @fn ReturnInfo writeDivstar(Node *divsta, FunctionInfo funTable)
- * @brief Write the translation of a division or multiplication.
+ * @fn int isTailCall(const IrFunction *ir, int pos)
+ * @brief Tell if an instruction is a call whose value is returned at once, so that the function called may return in its place.
+ * The value may first go through copies, and jumps and labels may come before the return, as left by the inlining.
+ * The main function never returns, and the arguments passed on the stack have to fit in the ones the function received.
  *
- * @param divsta Node* Division or multiplication to write.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @param ir const IrFunction* Function.
+ * @param pos int Position of the instruction.
+ * @return int 1 for a tail call, 0 otherwise.
  */
-ReturnInfo writeDivstar(Node *divsta, FunctionInfo funTable)
+int isTailCall(const IrFunction *ir, int pos)
 {
-    if (getExpressionType(divsta->firstChild, pt, funTable) == Void || getExpressionType(divsta->firstChild->nextSibling, pt, funTable) == Void)
-    {
-        fprintf(stderr, "Error: Division or multiplication of a void-like expression at line %d.\n", divsta->lineno);
-        return VOID_DIVSTA;
-    }
-
-    ReturnInfo info = writeInstr(divsta->firstChild, funTable);
-    if (info != SUCCESS)
-        return info;
-
-    info = writeInstr(divsta->firstChild->nextSibling, funTable);
-    if (info != SUCCESS)
-        return info;
-
-    fprintf(f, "\tpop rcx\n");
-    fprintf(f, "\tpop rax\n");
-    if (!strcmp(divsta->u.ident, "/"))
+    const IrInstr *call = &ir->instrs[pos];
+    if (call->op != IR_CALL || ir->fun->id == mainId || call->imm > (ir->nbParams > 6 ? ir->nbParams : 6))
+        return 0;
+    vreg_t value = call->dst;
+    // the steps are bounded, jumps between labels only may loop forever
+    for (int steps = 0, next = pos + 1; next < ir->len && steps < ir->len; steps++)
     {
-        fprintf(f, "\txor edx, edx;\n");
-        fprintf(f, "\tidiv rcx\n");
+        const IrInstr *instr = &ir->instrs[next];
+        if (instr->op == IR_RET)
+            return instr->a == NO_VREG || instr->a == value;
+        if (instr->op == IR_COPY && instr->a == value && value != NO_VREG)
+            value = instr->dst;
+        else if (instr->op == IR_JUMP && ir->labelBlocks[instr->imm] != NO_BLOCK)
+        {
+            next = ir->blocks[ir->labelBlocks[instr->imm]].first;
+            continue;
+        }
+        else if (instr->op != IR_LABEL)
+            return 0;
+        next++;
     }
-    else
-        fprintf(f, "\timul rax, rcx\n");
-    fprintf(f, "\tpush rax\n\n");
-    return SUCCESS;
+    return 0;
 }
 
 /**
- * @fn ReturnInfo writeEgual(Node *eg, FunctionInfo funTable)
- * @brief Write the translation of an assignment.
- *
- * @param eg Node* Assignment to write.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @fn void writeEpilogue()
+ * @brief Write the restoration of the callee-saved registers and of the frame of the caller.
  */
-ReturnInfo writeEgual(Node *eg, FunctionInfo funTable)
+void writeEpilogue()
 {
-    if (getExpressionType(eg->firstChild, pt, funTable) == Void || getExpressionType(eg->firstChild->nextSibling, pt, funTable) == Void)
+    for (int i = 0, saved = 0; i < NB_CALLEE_SAVED; i++)
+        if (curAlloc.usedRegisters & 1 << CALLEE_SAVED[i])
+        {
+            emit("\tmov %s, [", QWORD_REGISTERS[CALLEE_SAVED[i]]);
+            writeFrameAddress(-(savedBase + 8 * ++saved));
+            emitLit("]\n");
+        }
+    if (frameRegister == RBP)
     {
-        fprintf(stderr, "Error: Assignation of a void-like expression at line %d.\n", eg->lineno);
-        return VOID_ASSIGNMENT;
+        emitLit("\tmov rsp, rbp\n");
+        emitLit("\tpop rbp\n");
     }
-
-    ReturnInfo info = writeInstr(eg->firstChild->nextSibling, funTable);
-    if (info != SUCCESS)
-        return info;
-
-    info = writeGetIdent(eg->firstChild, funTable);
-    if (info != SUCCESS)
-        return info;
-
-    if (getExpressionType(eg->firstChild->nextSibling, pt, funTable) == Num && getExpressionType(eg->firstChild, pt, funTable) == Character)
-        fprintf(stderr, "Warning: Int passed as a character at line %d. May cause a problem if below 0 or above 256.\n", eg->lineno);
-
-    return SUCCESS;
+    else if (frameTop)
+        emit("\tadd rsp, %d\n", frameTop);
 }
 
 /**
- * @fn ReturnInfo writeReturn(Node *retInstr, FunctionInfo funTable)
- * @brief Write the translation of a return.
+ * @fn void writeTailCall(const IrInstr *call)
+ * @brief Write a tail call: the arguments replace the ones the function received, then the function called
+ * is jumped to, returning directly to the caller. A function calling itself jumps back after its prologue,
+ * its frame and saved registers being kept as they are.
  *
- * @param retInstr Node* Return to write.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @param call const IrInstr* Call to write.
  */
-ReturnInfo writeReturn(Node *retInstr, FunctionInfo funTable)
+void writeTailCall(const IrInstr *call)
 {
-    if (funTable.type == VOID_TYPE && retInstr->firstChild)
-    {
-        fprintf(stderr, "Error: No value should be returned in void typed function at line %d.\n", retInstr->lineno);
-        return VOID_RETURN_ILLEGAL;
-    }
-    else if (funTable.type != VOID_TYPE && (!retInstr->firstChild || getExpressionType(retInstr->firstChild, pt, funTable) == Void))
-    {
-        fprintf(stderr, "Error: No value or void-like value returned at line %d while a %s is expected.\n", retInstr->lineno, funTable.type == INT ? "int" : "char");
-        return MISSING_RETURN_VALUE;
-    }
-    else if (funTable.type == CHAR && getExpressionType(retInstr->firstChild, pt, funTable) == Num)
-        fprintf(stderr, "Warning: Int returned while a character is expected at line %d. May cause a problem if below 0 or above 256.\n", retInstr->lineno);
+    const vreg_t *args = &curIr->callArgs[call->a];
+    int dsts[6], srcs[6];
+    int nbArgs = call->imm;
 
-    else if (funTable.type == VOID_TYPE && !retInstr->firstChild)
+    /* The parameters passed on the stack were moved to their locations by the prologue */
+    for (int i = 6; i < nbArgs; i++)
     {
-        fprintf(f, "\tmov rax, 0\n");
-        return SUCCESS;
+        int reg = isRegister(locationOf(args[i])) ? locationOf(args[i]) : RAX;
+        writeMove(reg, locationOf(args[i]));
+        emitLit("\tmov [");
+        writeFrameAddress((frameRegister == RBP ? 16 : 8) + 8 * (i - 6));
+        emit("], %s\n", QWORD_REGISTERS[reg]);
     }
-    ReturnInfo info = writeInstr(retInstr->firstChild, funTable);
-    if (info != SUCCESS)
-        return info;
-    if (strcmp(funTable.id, "main"))
+    for (int i = 0; i < nbArgs && i < 6; i++)
     {
-        fprintf(f, "\tpop rax\n");
-        fprintf(f, "\tmov rsp, rbp\n");
-        fprintf(f, "\tpop rbp\n");
-        fprintf(f, "\tret\n\n");
+        dsts[i] = ARG_REGISTERS[i];
+        srcs[i] = locationOf(args[i]);
     }
-    else
+    writeParallelMove(dsts, srcs, nbArgs < 6 ? nbArgs : 6);
+
+    if (call->symbol == curIr->fun->id)
     {
-        fprintf(f, "\tmov rdi, rax\n");
-        fprintf(f, "\tmov rax, 60\n");
-        fprintf(f, "\tsyscall\n\n");
+        emitLit("\tjmp .entry\n\n");
+        return;
     }
-    return SUCCESS;
+    writeEpilogue();
+    emit("\tjmp %s\n\n", identToString(call->symbol));
 }
 
-/* ------- Writing of boolean operation -------- */
-
 /**
- * @fn ReturnInfo writeRightComp(Node *comp, FunctionInfo funTable)
- * @brief Write the translation of a comparison.
+ * @fn void writeReturn(const IrInstr *ret)
+ * @brief Write a return: restore the callee-saved registers and the frame, or exit for the main function,
+ * once the output is flushed.
  *
- * @param comp Node* Comparison to write.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @param ret const IrInstr* Return to write.
  */
-ReturnInfo writeRightComp(Node *comp, FunctionInfo funTable)
+void writeReturn(const IrInstr *ret)
 {
-    switch (comp->label)
+    if (curIr->fun->id == mainId)
     {
-    case Eq:
-        fprintf(f, "\tcmp rax, rcx\n");
-        fprintf(f, "\tj%s .true%d\n", strcmp(comp->u.ident, "==") ? "ne" : "e", conditionCount);
-        fprintf(f, "\txor rax, rax\n");
-        fprintf(f, "\tjmp .false%d\n", conditionCount);
-        fprintf(f, "\t\t.true%d:\n", conditionCount);
-        fprintf(f, "\tmov rax, 1\n");
-        fprintf(f, "\t\t.false%d:\n", conditionCount);
-        break;
-        break;
-    case Order:
-        fprintf(f, "\tcmp rax, rcx\n");
-        if (comp->u.ident[0] == '>')
-            fprintf(f, "\tjg%c .true%d\n", comp->u.ident[1] == '=' ? 'e' : ' ', conditionCount);
+        if (ret->a != NO_VREG)
+            writeMove(RDI, locationOf(ret->a));
         else
-            fprintf(f, "\tjl%c .true%d\n", comp->u.ident[1] == '=' ? 'e' : ' ', conditionCount);
-
-        fprintf(f, "\txor rax, rax\n");
-        fprintf(f, "\tjmp .false%d\n", conditionCount);
-        fprintf(f, "\t\t.true%d:\n", conditionCount);
-        fprintf(f, "\tmov rax, 1\n");
-        fprintf(f, "\t\t.false%d:\n", conditionCount);
-        break;
-    case And:
-    case Or:
-        fprintf(f, "\t%s rax, rcx\n", comp->label == And ? "and" : "or");
-        fprintf(f, "\ttest rax, rax\n");
-        fprintf(f, "\tsetnz al\n");
-        break;
-    default:
-        fprintf(stderr, "Unkown boolean operation: %s at line: %d\n", StringFromLabel[comp->label], comp->lineno);
-        return UNKOWN_BOOLEAN_OPERATION;
+            emitLit("\tmov rdi, 0\n");
+        emitLit("\tjmp __exit__\n\n");
+        return;
     }
-    conditionCount++;
-    return SUCCESS;
+
+    if (ret->a != NO_VREG)
+        writeMove(RAX, locationOf(ret->a));
+    writeEpilogue();
+    emitLit("\tret\n\n");
 }
 
+/* ---------------------- Writing of operations ----------------------- */
+
 /**
- * @fn ReturnInfo writeBooleanComp(Node *comp, FunctionInfo funTable)
- * @brief Write the two members of the comparison before the boolean operation.
+ * @fn void writeArithmetic(const char *mnemonic, const IrInstr *instr, int commutative)
+ * @brief Write an addition, a subtraction or a multiplication in two-operand form.
  *
- * @param comp Node* Comparison to write.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @param mnemonic const char* Mnemonic of the operation.
+ * @param instr const IrInstr* Operation to write.
+ * @param commutative int Can the operands be swapped.
  */
-ReturnInfo writeBooleanComp(Node *comp, FunctionInfo funTable)
+void writeArithmetic(const char *mnemonic, const IrInstr *instr, int commutative)
 {
-    label_t gauche = getExpressionType(comp->firstChild, pt, funTable);
-    label_t droite = getExpressionType(comp->firstChild->nextSibling, pt, funTable);
-    if (gauche == Void || droite == Void)
+    int dst = locationOf(instr->dst), a = locationOf(instr->a), b = locationOf(instr->b);
+    if (isRegister(dst) && dst != b)
     {
-        fprintf(stderr, "Error: Comparison of a void-like expression at line %d.\n", comp->lineno);
-        return VOID_COMPARATION;
+        writeMove(dst, a);
+        writeOperation(mnemonic, dst, b);
     }
-    if (gauche == Address || droite == Address)
+    else if (isRegister(dst) && commutative)
+        writeOperation(mnemonic, dst, a);
+    else
     {
-        fprintf(stderr, "Error: Comparison with an address at line %d.\n", comp->lineno);
-        return INVALID_ARGUMENT_TYPE;
+        writeMove(RAX, a);
+        writeOperation(mnemonic, RAX, b);
+        writeMove(dst, RAX);
     }
-
-    ReturnInfo info = writeInstr(comp->firstChild, funTable);
-    if (info != SUCCESS)
-        return info;
-
-    info = writeInstr(comp->firstChild->nextSibling, funTable);
-    if (info != SUCCESS)
-        return info;
-
-    fprintf(f, "\tpop rcx\n");
-    fprintf(f, "\tpop rax\n");
-    info = writeRightComp(comp, funTable);
-    if (info != SUCCESS)
-        return info;
-    fprintf(f, "\tpush rax\n\n");
-
-    return SUCCESS;
 }
 
-/* ------- Writing of conditionnal structures -------- */
-
 /**
- * @fn ReturnInfo evaluateCondition(Node *cond, FunctionInfo funTable)
- * @brief Write the translation of the evaluation of a condition.
+ * @fn void writeDivision(const IrInstr *instr)
+ * @brief Write a division or a modulo, the quotient being in rax and the remainder in rdx.
  *
- * @param cond Node* Condition to write.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @param instr const IrInstr* Division to write.
  */
-ReturnInfo evaluateCondition(Node *cond, FunctionInfo funTable)
+void writeDivision(const IrInstr *instr)
 {
-    ReturnInfo info = writeInstr(cond, funTable);
-    if (info != SUCCESS)
-        return info;
-
-    fprintf(f, "\tpop rax\n");
-    fprintf(f, "\tcmp rax, 0\n");
-    return SUCCESS;
+    writeMove(RAX, locationOf(instr->a));
+    emitLit("\tcqo\n");
+    emitLit("\tidiv ");
+    writeOperand(locationOf(instr->b), 8);
+    emitLit("\n");
+    writeMove(locationOf(instr->dst), instr->op == IR_DIV ? RAX : RDX);
 }
 
 /**
- * @fn void handleIfBranching(Node *maybeElse, int curIfCount)
- * @brief Write the translation of the branching of an if.
+ * @fn void writeZeroTest(int location)
+ * @brief Write the comparison of a location with 0.
  *
- * @param maybeElse Node* Possible else of the if.
- * @param curIfCount int Current if count.
+ * @param location int Location compared.
  */
-void handleIfBranching(Node *maybeElse, int curIfCount)
+void writeZeroTest(int location)
 {
-    fprintf(f, "\tje .%s%d\n", maybeElse ? "else" : "endif", curIfCount);
-    fprintf(f, "\n");
-}
-
-/**
- * @fn ReturnInfo processIfBody(Node *body, int curIfCount, FunctionInfo funTable)
- * @brief Write the translation of the body of an if.
- *
- * @param body Node* Body of the if.
- * @param curIfCount int Current if count.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
- */
-ReturnInfo processIfBody(Node *body, int curIfCount, FunctionInfo funTable)
-{
-    ReturnInfo info;
-    if (!body)
-        return SUCCESS;
-    do
+    if (isRegister(location))
+        writeOperation("test", location, location);
+    else
     {
-        if (body->label == Else)
-        {
-            fprintf(f, "\tjmp .endif%d\n\n", curIfCount);
-            info = writeElse(body, funTable, curIfCount);
-        }
-        else
-            info = writeInstr(body, funTable);
-        if (info != SUCCESS)
-            return info;
-
-    } while ((body = body->nextSibling) != NULL);
-    return SUCCESS;
-}
-
-/**
- * @fn ReturnInfo writeIf(Node *ifInstr, FunctionInfo funTable)
- * @brief Write the translation of an if.
- *
- * @param ifInstr Node* If to write.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
- */
-ReturnInfo writeIf(Node *ifInstr, FunctionInfo funTable)
-{
-    ReturnInfo info;
-    Node *cond = ifInstr->firstChild;
-    Node *body = cond->nextSibling;
-
-    Node *maybeElse = getChildLabeled(ifInstr, Else);
-    int curIfCount = ifCount;
-    ifCount++;
-
-    info = evaluateCondition(cond, funTable);
-    if (info != SUCCESS)
-        return info;
-
-    handleIfBranching(maybeElse, curIfCount);
-
-    info = processIfBody(body, curIfCount, funTable);
-    if (info != SUCCESS)
-        return info;
-
-    fprintf(f, "\t.endif%d:\n\n", curIfCount);
-    return SUCCESS;
-}
-
-/**
- * @fn ReturnInfo writeElse(Node *elseInstr, FunctionInfo funTable, int curIfCount)
- * @brief Write the translation of an else.
- *
- * @param elseInstr Node* Else to write.
- * @param funTable FunctionInfo Function table we are in.
- * @param curIfCount int Current if count.
- * @return ReturnInfo Eventual error code.
- */
-ReturnInfo writeElse(Node *elseInstr, FunctionInfo funTable, int curIfCount)
-{
-    Node *body = elseInstr->firstChild;
-    fprintf(f, "\t.else%d:\n", curIfCount);
-
-    return processInstructionBlock(body, funTable);
+        emitLit("\tcmp ");
+        writeOperand(location, 8);
+        emitLit(", 0\n");
+    }
 }
 
 /**
- * @fn ReturnInfo writeWhile(Node *whileInstr, FunctionInfo funTable)
- * @brief Write the translation of a while loop.
+ * @fn void writeCompare(const IrInstr *instr)
+ * @brief Write the comparison of the operands a and b of an instruction, setting the flags.
  *
- * @param whileInstr Node* While to write.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @param instr const IrInstr* Comparison or conditional jump, b being 0 when NO_VREG.
  */
-ReturnInfo writeWhile(Node *whileInstr, FunctionInfo funTable)
+void writeCompare(const IrInstr *instr)
 {
-    ReturnInfo info;
-    Node *cond = whileInstr->firstChild;
-    Node *body = cond->nextSibling;
-    if (cond->label == Ident)
+    int a = locationOf(instr->a), b;
+    if (instr->b == NO_VREG)
     {
-        sprintf(COMPARAISON_NODE.u.ident, "%s", cond->u.ident);
-        cond = &IMPLCITE_IF_NODE;
+        writeZeroTest(a);
+        return;
     }
-    int curWhileCount = whileCount;
-    whileCount++;
-
-    fprintf(f, "\t.loop%d:\n", curWhileCount);
-
-    info = evaluateCondition(cond, funTable);
-    if (info != SUCCESS)
-        return info;
-    fprintf(f, "\tje .endloop%d\n\n", curWhileCount);
-
-    info = processInstructionBlock(body, funTable);
-    if (info != SUCCESS)
-        return info;
-
-    fprintf(f, "\tjmp .loop%d\n", curWhileCount);
-    fprintf(f, "\t.endloop%d:\n\n", curWhileCount);
-    return SUCCESS;
-}
-
-/* ------- Function calls handler -------- */
-
-/**
- * @fn void pushArgs(FunctionInfo funTable)
- * @brief Write the translation of the push of the arguments of a function. Used to save them before the call of another function
- *
- * @param funTable FunctionInfo Function table we are in.
- */
-void pushArgs(FunctionInfo funTable)
-{
-    for (int i = funTable.args.len - 1; i >= 0; i--)
-        fprintf(f, "\tpush %s\n", ARG_REGISTERS[i]);
-    fprintf(f, "\n");
+    b = locationOf(instr->b);
+    if (!isRegister(a) && !isRegister(b))
+    {
+        writeMove(RAX, a);
+        a = RAX;
+    }
+    writeOperation("cmp", a, b);
 }
 
 /**
- * @fn void popArgs(FunctionInfo funTable)
- * @brief Write the translation of the pop of the arguments of a function. Used to restore the stack.
+ * @fn void writeFlagValue(const char *condition, int dst)
+ * @brief Write the setting of a location to 1 if a condition holds on the flags, 0 otherwise.
  *
- * @param funTable FunctionInfo Function table we are in.
+ * @param condition const char* Condition code.
+ * @param dst int Location written.
  */
-void popArgs(FunctionInfo funTable)
+void writeFlagValue(const char *condition, int dst)
 {
-    for (int i = 0; i < funTable.args.len; i++)
-        fprintf(f, "\tpop %s\n", ARG_REGISTERS[i]);
-    fprintf(f, "\n");
+    emit("\tset%s al\n", condition);
+    emit("\tmovzx %s, al\n", QWORD_REGISTERS[isRegister(dst) ? dst : RAX]);
+    if (!isRegister(dst))
+        writeMove(dst, RAX);
 }
 
 /**
- * @fn void writeAlignStackBeforeFunCall(FILE *f)
- * @brief Write the translation of the alignment of the stack before a function call.
+ * @fn void writeComparison(const IrInstr *instr)
+ * @brief Write a comparison giving 0 or 1.
  *
- * @param f FILE* File we are writing to.
+ * @param instr const IrInstr* Comparison to write.
  */
-void writeAlignStackBeforeFunCall(FILE *f)
+void writeComparison(const IrInstr *instr)
 {
-    fprintf(f, "\tpush r15\n");
-    fprintf(f, "\tmov r15, rsp\n");
-    fprintf(f, "\tand rsp, -16\n");
-    fprintf(f, "\tsub rsp, 8\n\n");
+    writeCompare(instr);
+    writeFlagValue(CONDITIONS[instr->op - IR_EQ], locationOf(instr->dst));
 }
 
 /**
- * @fn void writeAlignStackAfterFunCall(FILE *f)
- * @brief Write the translation of the alignment of the stack after a function call.
+ * @fn void writeExtend(const IrInstr *instr)
+ * @brief Write the sign extension of the low bytes of a value, as done by loading it from a variable of that size.
  *
- * @param f FILE* File we are writing to.
+ * @param instr const IrInstr* Extension to write.
  */
-void writeAlignStackAfterFunCall(FILE *f)
+void writeExtend(const IrInstr *instr)
 {
-    fprintf(f, "\tmov rsp, r15\n");
-    fprintf(f, "\tpop r15\n\n");
+    int dst = locationOf(instr->dst);
+    int reg = isRegister(dst) ? dst : RAX;
+    emit("\t%s %s, ", instr->size == 4 ? "movsxd" : "movsx", QWORD_REGISTERS[reg]);
+    writeOperand(locationOf(instr->a), instr->size);
+    emitLit("\n");
+    writeMove(dst, reg);
 }
 
 /**
- * @fn ReturnInfo checkArgummentType(Node *arg, FunctionInfo callingFun, int argIndex, FunctionInfo funCalled)
- * @brief Check if the type of the argument is correct.
+ * @fn void writeConstant(const IrInstr *instr)
+ * @brief Write the move of a constant into a location.
  *
- * @param arg Node* Argument to check.
- * @param callingFun FunctionInfo Function we are calling.
- * @param argIndex int Index of the argument.
- * @param funCalled FunctionInfo Function we are calling.
- * @return ReturnInfo Eventual error code.
+ * @param instr const IrInstr* Constant to write.
  */
-ReturnInfo checkArgummentType(Node *arg, FunctionInfo callingFun, int argIndex, FunctionInfo funCalled)
+void writeConstant(const IrInstr *instr)
 {
-    int callingFunctionsVariablesIndex;
-    Symbol funCalledArg = funCalled.args.symbols[argIndex];
-    if (isInTable(callingFun.args, arg->u.ident, &callingFunctionsVariablesIndex) == ID_IN_TABLE)
-    {
-        Symbol callingArg = callingFun.args.symbols[callingFunctionsVariablesIndex];
-        if (callingArg.isAddress && funCalledArg.isAddress)
-        {
-            if (callingArg.type != funCalled.args.symbols[argIndex].type)
-            {
-                fprintf(stderr, "ERROR: %s[] expected, got %s[] at line %d\n", funCalledArg.type == INT ? "int" : "char", callingArg.type == INT ? "int" : "char", arg->lineno);
-                return INVALID_ARGUMENT_TYPE;
-            }
-        }
-        else if (callingArg.isAddress && !arg->firstChild && !funCalledArg.isAddress)
-        {
-            fprintf(stderr, "ERROR: %s[] expected, got %s at line %d\n", funCalledArg.type == INT ? "int" : "char", callingArg.type == INT ? "int" : "char", arg->lineno);
-            return INVALID_ARGUMENT_TYPE;
-        }
-        else if (!callingArg.isAddress && funCalledArg.isAddress)
-        {
-            fprintf(stderr, "ERROR: %s expected, got %s[] at line %d\n", funCalledArg.type == INT ? "int" : "char", callingArg.type == INT ? "int" : "char", arg->lineno);
-            return INVALID_ARGUMENT_TYPE;
-        }
-    }
+    int dst = locationOf(instr->dst);
+    if (isRegister(dst) && instr->imm == 0)
+        emit("\txor %s, %s\n", DWORD_REGISTERS[dst], DWORD_REGISTERS[dst]);
     else
     {
-        Symbol callingArg;
-        if (isInTable(callingFun.locals, arg->u.ident, &callingFunctionsVariablesIndex) == ID_IN_TABLE)
-            callingArg = callingFun.locals.symbols[callingFunctionsVariablesIndex];
-        else if (isInTable(pt.glob, arg->u.ident, &callingFunctionsVariablesIndex) == ID_IN_TABLE)
-            callingArg = pt.glob.symbols[callingFunctionsVariablesIndex];
-        else
-            return SUCCESS;
-
-        if (callingArg.isArray && !arg->firstChild && !funCalledArg.isAddress)
-        {
-            fprintf(stderr, "ERROR: %s expected, got %s[] at line %d\n", funCalledArg.type == INT ? "int" : "char", callingArg.type == INT ? "int" : "char", arg->lineno);
-            return INVALID_ARGUMENT_TYPE;
-        }
-        else if (callingArg.isArray && arg->firstChild && funCalledArg.isAddress)
-        {
-            fprintf(stderr, "ERROR: %s[] expected, got %s at line %d\n", funCalledArg.type == INT ? "int" : "char", callingArg.type == INT ? "int" : "char", arg->lineno);
-            return INVALID_ARGUMENT_TYPE;
-        }
-        else if (callingArg.isArray && !arg->firstChild && funCalledArg.isAddress && callingArg.type != funCalledArg.type)
-        {
-            fprintf(stderr, "ERROR: %s[] expected, got %s[] at line %d\n", funCalledArg.type == INT ? "int" : "char", callingArg.type == INT ? "int" : "char", arg->lineno);
-            return INVALID_ARGUMENT_TYPE;
-        }
-        else if (!callingArg.isArray && funCalledArg.isAddress)
-        {
-            fprintf(stderr, "ERROR: %s[] expected, got %s at line %d\n", funCalledArg.type == INT ? "int" : "char", callingArg.type == INT ? "int" : "char", arg->lineno);
-            return INVALID_ARGUMENT_TYPE;
-        }
-    }
-    return SUCCESS;
-}
-
-/**
- * @fn ReturnInfo writeArg(Node *arg, FunctionInfo funTable, int argIndex, FunctionInfo funCalled)
- * @brief Translate the placement of the argument in the right registers.
- *
- * @param arg Node* Argument list to write.
- * @param funTable FunctionInfo Function table we are in.
- * @param argIndex int Index of the argument.
- * @param funCalled FunctionInfo Function we are calling.
- * @return ReturnInfo Eventual error code.
- */
-ReturnInfo writeArg(Node *arg, FunctionInfo funTable, int argIndex, FunctionInfo funCalled)
-{
-    if (!arg || arg->label == Void)
-        return SUCCESS;
-
-    if (getExpressionType(arg, pt, funTable) == Void)
-    {
-        fprintf(stderr, "Error: Void-like argument passed to a function at line %d.\n", arg->lineno);
-        return VOID_ARGUMENT_PASSED;
+        emitLit("\tmov ");
+        writeOperand(dst, 8);
+        emit(", %ld\n", instr->imm);
     }
-
-    ReturnInfo info = writeArg(arg->nextSibling, funTable, argIndex + 1, funCalled);
-    if (info != SUCCESS)
-        return info;
-
-    if (arg->label == Ident || arg->label == Array || arg->label == Address)
-    {
-        info = checkArgummentType(arg, funTable, argIndex, funCalled);
-        if (info != SUCCESS)
-            return info;
-    }
-    else if (funCalled.args.symbols[argIndex].isAddress)
-    {
-        fprintf(stderr, "Error: Passing a %s as a %s[] at line %d.\n", funCalled.args.symbols[argIndex].type == INT ? "int" : "char", funCalled.args.symbols[argIndex].type == INT ? "int" : "char", arg->lineno);
-        return ARRAY_EXPECTED;
-    }
-
-    if (getExpressionType(arg, pt, funTable) == Num && funCalled.args.symbols[argIndex].type == CHAR)
-        fprintf(stderr, "Warning: Int passed as a character at line %d. May cause a problem if below 0 or above 256.\n", arg->lineno);
-
-    info = writeInstr(arg, funTable);
-    if (info != SUCCESS)
-        return info;
-
-    if (argIndex < 6)
-    {
-        fprintf(f, "\tpop rax\n");
-        fprintf(f, "\tmov %s, rax\n\n", ARG_REGISTERS[argIndex]);
-    }
-
-    return SUCCESS;
 }
 
 /**
- * @fn ReturnInfo writeCall(Node *call, FunctionInfo funTable, FunctionInfo funCalled)
- * @brief Translate the placement of the call of a function.
+ * @fn void writeLoad(const IrInstr *instr)
+ * @brief Write the load of a variable in memory, or the computation of its address.
  *
- * @param call Node* Call to translate.
- * @param funTable FunctionInfo Function table we are in.
- * @param funCalled FunctionInfo Function we are calling.
- * @return ReturnInfo Eventual error code.
+ * @param instr const IrInstr* Load or address computation to write.
  */
-ReturnInfo writeCall(Node *call, FunctionInfo funTable, FunctionInfo funCalled)
+void writeLoad(const IrInstr *instr)
 {
-    int nbArg = 1;
-    Node *args = call->firstChild;
-    Node *arg = args->firstChild;
-    while ((arg = arg->nextSibling) != NULL)
-        nbArg++;
+    int base, index;
+    int dst = locationOf(instr->dst);
+    int reg = isRegister(dst) ? dst : RAX;
+    writeMemoryRegisters(instr, &base, &index);
 
-    arg = args->firstChild;
-
-    if (arg->label == Void)
-        nbArg = 0;
-
-    if (funCalled.args.len == 0 && arg->label != Void)
-    {
-        fprintf(stderr, "Trying to call a function with arguments but the function does not take any. Line %d\n", call->lineno);
-        return TOO_MANY_ARGUMENT;
-    }
-    else if (nbArg != funCalled.args.len)
-    {
-        fprintf(stderr, "Trying to call a function with too %s arguments. Expected %d, got %d. Line %d\n", nbArg > funCalled.args.len ? "many" : "few", funCalled.args.len, nbArg, call->lineno);
-        return nbArg > funCalled.args.len ? TOO_MANY_ARGUMENT : TOO_FEW_ARGUMENT;
-    }
-
-    pushArgs(funTable);
-    ReturnInfo info = writeArg(arg, funTable, 0, funCalled);
-    if (info != SUCCESS)
-        return info;
-    writeAlignStackBeforeFunCall(f);
-    fprintf(f, "\tcall %s\n\n", call->u.ident);
-    writeAlignStackAfterFunCall(f);
-    popArgs(funTable);
-    return SUCCESS;
+    if (instr->op == IR_ADDR)
+        emit("\tlea %s, ", QWORD_REGISTERS[reg]);
+    else if (instr->size == 8)
+        emit("\tmov %s, qword ", QWORD_REGISTERS[reg]);
+    else
+        emit("\t%s %s, %s ", instr->size == 4 ? "movsxd" : "movsx", QWORD_REGISTERS[reg], instr->size == 4 ? "dword" : "byte");
+    writeMemory(instr, base, index);
+    emitLit("\n");
+    writeMove(dst, reg);
 }
 
 /**
- * @fn ReturnInfo handleFunctionCall(Node *maybeCall, FunctionInfo funTable)
- * @brief Handle the call of a function (check it's existence etc)
+ * @fn void writeStore(const IrInstr *instr)
+ * @brief Write the store of the low bytes of a value in a variable in memory.
  *
- * @param maybeCall Node* Call to handle.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @param instr const IrInstr* Store to write.
  */
-ReturnInfo handleFunctionCall(Node *maybeCall, FunctionInfo funTable)
+void writeStore(const IrInstr *instr)
 {
-    FunctionInfo call = getFunctionsTable(pt, maybeCall->u.ident);
-
-    if (!strcmp(call.id, "err"))
+    int base, index;
+    int value = locationOf(instr->c);
+    if (!isRegister(value))
     {
-        fprintf(stderr, "Unidentified function indetififer : %s. Line %d\n", maybeCall->u.ident, maybeCall->lineno);
-        return NOT_A_FUNCTION;
+        writeMove(RAX, value);
+        value = RAX;
     }
-    ReturnInfo info = writeCall(maybeCall, funTable, call);
-    if (info != SUCCESS)
-        return info;
+    writeMemoryRegisters(instr, &base, &index);
 
-    if (call.type != VOID_TYPE)
-        fprintf(f, "\tpush rax\n\n");
-    return SUCCESS;
+    emitLit("\tmov ");
+    writeMemory(instr, base, index);
+    emitLit(", ");
+    writeOperand(value, instr->size);
+    emitLit("\n");
 }
 
 /**
- * @fn ReturnInfo handleGlobalGetIdent(Node *maybeGlobal, FunctionInfo funTable, int index)
- * @brief Handle the get the global variable's value from the stack.
+ * @fn void writeIrInstr(const IrInstr *instr, const IrInstr *next)
+ * @brief Write the translation of any instruction (switch to the right function).
  *
- * @param maybeGlobal Node* Global variable to handle.
- * @param funTable FunctionInfo Function table we are in.
- * @param index int Index of the global variable in the table.
- * @return ReturnInfo Eventual error code.
+ * @param instr const IrInstr* Instruction to write.
+ * @param next const IrInstr* Following instruction, NULL for the last one.
  */
-ReturnInfo handleGlobalGetIdent(Node *maybeGlobal, FunctionInfo funTable, int index)
+void writeIrInstr(const IrInstr *instr, const IrInstr *next)
 {
-    ReturnInfo info = isInTable(pt.glob, maybeGlobal->u.ident, &index);
-    if (info != ID_IN_TABLE)
+    switch (instr->op)
     {
-        fprintf(stderr, "Unidentified indetififer : %s. Line %d\n", maybeGlobal->u.ident, maybeGlobal->lineno);
-        return info;
-    }
-
-    if (pt.glob.symbols[index].isArray)
-    {
-        info = writeEventualIndex(maybeGlobal->firstChild, funTable, pt.glob.symbols[index]);
-        if (info != SUCCESS)
-            return info;
-    }
-    else if (maybeGlobal->firstChild && pt.glob.symbols[index].isArray)
-    {
-        fprintf(stderr, "Array unexpected at line %d\n", maybeGlobal->lineno);
-        return ARRAY_UNEXPECTED;
+    case IR_PARAM:
+        break;
+    case IR_CONST:
+        writeConstant(instr);
+        break;
+    case IR_COPY:
+        writeMove(locationOf(instr->dst), locationOf(instr->a));
+        break;
+    case IR_EXTEND:
+        writeExtend(instr);
+        break;
+    case IR_ADD:
+        writeArithmetic("add", instr, 1);
+        break;
+    case IR_SUB:
+        writeArithmetic("sub", instr, 0);
+        break;
+    case IR_MUL:
+        writeArithmetic("imul", instr, 1);
+        break;
+    case IR_DIV:
+    case IR_MOD:
+        writeDivision(instr);
+        break;
+    case IR_EQ:
+    case IR_NE:
+    case IR_LT:
+    case IR_LE:
+    case IR_GT:
+    case IR_GE:
+        writeComparison(instr);
+        break;
+    case IR_NEG:
+        writeMove(locationOf(instr->dst), locationOf(instr->a));
+        emitLit("\tneg ");
+        writeOperand(locationOf(instr->dst), 8);
+        emitLit("\n");
+        break;
+    case IR_NOT:
+        writeZeroTest(locationOf(instr->a));
+        writeFlagValue("e", locationOf(instr->dst));
+        break;
+    case IR_ADDR:
+    case IR_LOAD:
+        writeLoad(instr);
+        break;
+    case IR_STORE:
+        writeStore(instr);
+        break;
+    case IR_CALL:
+        writeCall(instr);
+        break;
+    case IR_RET:
+        writeReturn(instr);
+        break;
+    case IR_LABEL:
+        emit("\t.L%ld:\n", instr->imm);
+        break;
+    case IR_JUMP:
+        if (!next || next->op != IR_LABEL || next->imm != instr->imm)
+            emit("\tjmp .L%ld\n\n", instr->imm);
+        break;
+    case IR_JUMP_EQ:
+    case IR_JUMP_NE:
+    case IR_JUMP_LT:
+    case IR_JUMP_LE:
+    case IR_JUMP_GT:
+    case IR_JUMP_GE:
+        writeCompare(instr);
+        emit("\tj%s .L%ld\n\n", CONDITIONS[instr->op - IR_JUMP_EQ], instr->imm);
+        break;
     }
-
-    return writeGlobalVariableGetValue(index);
 }
 
-/**
- * @fn ReturnInfo handlerArgGetIdent(Node *maybeArg, FunctionInfo funTable)
- * @brief Handle the get the argument's value from the stack.
- *
- * @param maybeArg Node* Argument to handle.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
- */
-ReturnInfo handlerArgGetIdent(Node *maybeArg, FunctionInfo funTable)
-{
-    int index;
-    ReturnInfo info = isInTable(funTable.args, maybeArg->u.ident, &index);
-    if (info != ID_IN_TABLE)
-        return handleGlobalGetIdent(maybeArg, funTable, index);
-
-    if (funTable.args.symbols[index].isAddress)
-    {
-        info = writeEventualIndex(maybeArg->firstChild, funTable, funTable.args.symbols[index]);
-        if (info != SUCCESS)
-            return info;
-    }
-    else if (maybeArg->firstChild)
-    {
-        fprintf(stderr, "Array unexpected at line %d\n", maybeArg->lineno);
-        return ARRAY_UNEXPECTED;
-    }
-    return writeArgVariableGetValue(funTable, index);
-}
+/* ------- Writing of functions -------- */
 
 /**
- * @fn ReturnInfo handleLocalGetIdent(Node *maybeLocal, FunctionInfo funTable)
- * @brief Handle the get the local variable's value from the stack.
- *
- * @param maybeLocal Node* Local variable to handle.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @fn void writeParams()
+ * @brief Write the move of the parameters from the registers and the stack they are passed in to their locations.
  */
-ReturnInfo handleLocalGetIdent(Node *maybeLocal, FunctionInfo funTable)
+void writeParams()
 {
-    int index;
-    ReturnInfo info = isInTable(funTable.locals, maybeLocal->u.ident, &index);
-    if (info != ID_IN_TABLE)
-        return handlerArgGetIdent(maybeLocal, funTable);
+    int dsts[6], srcs[6], nb = 0;
+    for (int i = 0; i < curIr->nbParams && i < 6; i++)
+        if (locationOf(i) != NO_LOCATION)
+        {
+            dsts[nb] = locationOf(i);
+            srcs[nb++] = ARG_REGISTERS[i];
+        }
+    writeParallelMove(dsts, srcs, nb);
 
-    if (funTable.locals.symbols[index].isArray && maybeLocal->firstChild)
-    {
-        info = writeEventualIndex(maybeLocal->firstChild, funTable, funTable.locals.symbols[index]);
-        if (info != SUCCESS)
-            return info;
-    }
-    else if (maybeLocal->firstChild)
+    for (int i = 6; i < curIr->nbParams; i++)
     {
-        fprintf(stderr, "Array unexpected at line %d\n", maybeLocal->lineno);
-        return ARRAY_UNEXPECTED;
+        if (locationOf(i) == NO_LOCATION)
+            continue;
+        int reg = isRegister(locationOf(i)) ? locationOf(i) : RAX;
+        emit("\tmov %s, [", QWORD_REGISTERS[reg]);
+        writeFrameAddress((frameRegister == RBP ? 16 : 8) + 8 * (i - 6));
+        emitLit("]\n");
+        writeMove(locationOf(i), reg);
     }
-    return writeLocalVariableGetValue(funTable, index);
+    emitLit("\n");
 }
 
 /**
- * @fn ReturnInfo handleGlobalPushIdent(Node *maybeGlobal, FunctionInfo funTable, int index)
- * @brief Handle the push of a global variable.
+ * @fn int isLeaf(const IrFunction *ir)
+ * @brief Tell if a function calls no other function, but by tail calls which leave it first.
  *
- * @param maybeGlobal Node* Global variable to handle.
- * @param funTable FunctionInfo Function table we are in.
- * @param index int Index of the global variable in the table.
- * @return ReturnInfo Eventual error code.
+ * @param ir const IrFunction* Function.
+ * @return int 1 for a leaf function, 0 otherwise.
  */
-ReturnInfo handleGlobalPushIdent(Node *maybeGlobal, FunctionInfo funTable, int index)
+int isLeaf(const IrFunction *ir)
 {
-    ReturnInfo info = isInTable(pt.glob, maybeGlobal->u.ident, &index);
-
-    if (info != ID_IN_TABLE)
-    {
-        fprintf(stderr, "Unidentified indetififer : %s. Line %d\n", maybeGlobal->u.ident, maybeGlobal->lineno);
-        return info;
-    }
-
-    if (pt.glob.symbols[index].isArray && maybeGlobal->firstChild)
-    {
-        info = writeEventualIndex(maybeGlobal->firstChild, funTable, pt.glob.symbols[index]);
-        if (info != SUCCESS)
-            return info;
-    }
-    else if (maybeGlobal->firstChild)
-    {
-        fprintf(stderr, "Array unexpected at line %d\n", maybeGlobal->lineno);
-        return ARRAY_UNEXPECTED;
-    }
-    return writeGlobalVariablePushValue(index);
+    for (int pos = 0; pos < ir->len; pos++)
+        if (ir->instrs[pos].op == IR_CALL && !isTailCall(ir, pos))
+            return 0;
+    return 1;
 }
 
 /**
- * @fn ReturnInfo handlerArgPushIdent(Node *maybeArg, FunctionInfo funTable)
- * @brief Handle the push of an argument.
+ * @fn int callsItselfLast(const IrFunction *ir)
+ * @brief Tell if a function calls itself by a tail call.
  *
- * @param maybeArg Node* Argument to handle.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @param ir const IrFunction* Function.
+ * @return int 1 if so, 0 otherwise.
  */
-ReturnInfo handlerArgPushIdent(Node *maybeArg, FunctionInfo funTable)
+int callsItselfLast(const IrFunction *ir)
 {
-    int index;
-    ReturnInfo info = isInTable(funTable.args, maybeArg->u.ident, &index);
-
-    if (info != ID_IN_TABLE)
-        return handleGlobalPushIdent(maybeArg, funTable, index);
-
-    if (funTable.args.symbols[index].isAddress && maybeArg->firstChild)
-    {
-        info = writeEventualIndex(maybeArg->firstChild, funTable, funTable.args.symbols[index]);
-        if (info != SUCCESS)
-            return info;
-    }
-    else if (maybeArg->firstChild)
-    {
-        fprintf(stderr, "Array unexpected at line %d\n", maybeArg->lineno);
-        return ARRAY_UNEXPECTED;
-    }
-    return writeArgVariablePushValue(funTable, index);
+    for (int pos = 0; pos < ir->len; pos++)
+        if (isTailCall(ir, pos) && ir->instrs[pos].symbol == ir->fun->id)
+            return 1;
+    return 0;
 }
 
 /**
- * @fn ReturnInfo handleLocalPushIdent(Node *maybeLocal, FunctionInfo funTable)
- * @brief Handle the push of a local variable.
- *
- * @param maybeLocal Node* Local variable to handle.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
+ * @fn void writeFrame()
+ * @brief Write the reservation of the frame: the local variables, the callee-saved registers and the spill slots.
+ * The callee-saved registers given to virtual registers are saved, except in the main function which never returns.
+ * A leaf function keeps no frame pointer: rsp never moves in it, so its frame is addressed
+ * from rsp, and is even left unreserved in the red zone below rsp when it fits there.
+ * Any other frame is a multiple of 16 bytes, rsp staying aligned for the calls: it is
+ * aligned at the entry point, and after the push of rbp in the other functions.
  */
-ReturnInfo handleLocalPushIdent(Node *maybeLocal, FunctionInfo funTable)
+void writeFrame()
 {
-    int index;
-    ReturnInfo info = isInTable(funTable.locals, maybeLocal->u.ident, &index);
+    int nbSaved = 0;
+    for (int i = 0; i < NB_CALLEE_SAVED; i++)
+        if (curIr->fun->id != mainId && curAlloc.usedRegisters & 1 << CALLEE_SAVED[i])
+            nbSaved++;
 
-    if (info != ID_IN_TABLE)
-        return handlerArgPushIdent(maybeLocal, funTable);
+    savedBase = (curIr->frameSize + 7) / 8 * 8;
+    spillBase = savedBase + 8 * nbSaved;
+    int frameSize = spillBase + 8 * curAlloc.nbSpillSlots;
 
-    if (funTable.locals.symbols[index].isArray && maybeLocal->firstChild)
+    frameRegister = RBP;
+    frameTop = 0;
+    if (curIr->fun->id == mainId)
+        emitLit("\tmov rbp, rsp\n");
+    else if (isLeaf(curIr))
     {
-        info = writeEventualIndex(maybeLocal->firstChild, funTable, funTable.locals.symbols[index]);
-        if (info != SUCCESS)
-            return info;
+        frameRegister = RSP;
+        frameTop = frameSize > RED_ZONE ? frameSize : 0;
     }
-    else if (maybeLocal->firstChild)
+    else
     {
-        fprintf(stderr, "Array unexpected at line %d\n", maybeLocal->lineno);
-        return ARRAY_UNEXPECTED;
+        emitLit("\tpush rbp\n");
+        emitLit("\tmov rbp, rsp\n");
     }
-    return writeLocalVariablePushValue(funTable, index);
-}
-
-/**
- * @fn ReturnInfo writeDeclVarsLocale(Node *decl, FunctionInfo funTable)
- * @brief Write the translation of the declaration of the local variables.
- *
- * @param decl Node* Declaration to write.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
- */
-ReturnInfo writeDeclVarsLocale(Node *decl, FunctionInfo funTable)
-{
-    fprintf(f, "\tsub rsp, %d\n", funTable.locals.size);
-    fprintf(f, "\n");
+    if (frameRegister == RBP)
+        frameSize = (frameSize + 15) / 16 * 16;
+    if (frameSize && (frameRegister == RBP || frameTop))
+        emit("\tsub rsp, %d\n", frameSize);
 
-    return SUCCESS;
+    for (int i = 0, saved = 0; i < NB_CALLEE_SAVED && curIr->fun->id != mainId; i++)
+        if (curAlloc.usedRegisters & 1 << CALLEE_SAVED[i])
+        {
+            emitLit("\tmov [");
+            writeFrameAddress(-(savedBase + 8 * ++saved));
+            emit("], %s\n", QWORD_REGISTERS[CALLEE_SAVED[i]]);
+        }
 }
 
 /**
- * @fn ReturnInfo writeInstr(Node *instr, FunctionInfo funTable)
- * @brief Write the translation of any instruction (switch to the right function).
+ * @fn ReturnInfo writeFunction(const IrFunction *ir)
+ * @brief Write the translation of a lowered function, block by block, main being the entry point of the program,
+ * then run the peephole on it.
  *
- * @param instr Node* Instruction to write.
- * @param funTable FunctionInfo Function table we are in.
+ * @param ir const IrFunction* Function to write.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo writeInstr(Node *instr, FunctionInfo funTable)
+ReturnInfo writeFunction(const IrFunction *ir)
 {
-    switch (instr->label)
-    {
-    case DeclVarsLocale:
-        return writeDeclVarsLocale(instr, funTable);
-        break;
-    case If:
-        return writeIf(instr, funTable);
-        break;
-    case Array:
-    case Ident:
-        return writePushIdent(instr, funTable);
-        break;
-    case Else:
-        return writeElse(instr, funTable, ifCount);
-        break;
-    case While:
-        return writeWhile(instr, funTable);
-        break;
-    case Return:
-        return writeReturn(instr, funTable);
-        break;
-    case Or:
-    case And:
-    case Eq:
-    case Order:
-        return writeBooleanComp(instr, funTable);
-        break;
-    case Addsub:
-        return writeAddsub(instr, funTable);
-        break;
-    case Divstar:
-        return writeDivstar(instr, funTable);
-        break;
-    case Num:
-        return writeNum(instr, funTable);
-        break;
-    case Character:
-        return writeCharacter(instr, funTable);
-        break;
-    case Egual:
-        return writeEgual(instr, funTable);
-        break;
-    default:
-        fprintf(stderr, "huh ?\t%s\t%s\n\n", StringFromLabel[instr->label], instr->u.ident);
-        break;
-    }
+    ReturnInfo info = allocateRegisters(ir, &curAlloc);
+    if (info != SUCCESS)
+        return info;
+    curIr = ir;
 
-    return FAILURE;
-}
+    unsigned long start;
+    emittedText(&start);
 
-/**
- * @fn ReturnInfo writeBody(Node *body, FunctionInfo funTable)
- * @brief Write the translation of the body of a function.
- *
- * @param body Node* Body to write.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
- */
-ReturnInfo writeBody(Node *body, FunctionInfo funTable)
-{
-    if (!body)
-        return SUCCESS;
-    return processInstructionBlock(body->firstChild, funTable);
-}
+    if (ir->fun->id == mainId)
+        emitLit("_start:\n");
+    else
+        emit("%s:\n", identToString(ir->fun->id));
+    writeFrame();
+    if (callsItselfLast(ir))
+        emitLit("\t.entry:\n");
+    writeParams();
+
+    for (int b = 0; b < ir->nbBlocks; b++)
+        for (int i = ir->blocks[b].first; i < ir->blocks[b].end; i++)
+        {
+            if (isTailCall(ir, i))
+            {
+                writeTailCall(&ir->instrs[i]);
+                i = ir->blocks[b].end; // the code following until the return is never reached
+            }
+            else
+                writeIrInstr(&ir->instrs[i], i + 1 < ir->len ? &ir->instrs[i + 1] : NULL);
+        }
 
-/**
- * @fn ReturnInfo writeMain(Node *mainFun, FunctionInfo funTable)
- * @brief Write the translation of the main function.
- *
- * @param mainFun Node* Main function to write.
- * @param funTable FunctionInfo Function table we are in.
- * @return ReturnInfo Eventual error code.
- */
-ReturnInfo writeMain(Node *mainFun, FunctionInfo funTable)
-{
-    fprintf(f, "_start:\n\tmov rbp, rsp\n");
-    ReturnInfo info = writeBody(getChildLabeled(mainFun, Body), funTable);
-    if (info != SUCCESS)
-        return info;
+    freeAllocation(&curAlloc);
+    curIr = NULL;
 
-    if (!getChildLabeled(getChildLabeled(mainFun, Body), Return))
-    {
-        fprintf(f, "\tmov rax, 60\n");
-        fprintf(f, "\tmov rdi, 0\n");
-        fprintf(f, "\tsyscall\n\n");
-    }
-    return SUCCESS;
+    PeepholeStats stats;
+    info = peepholeEmitted(start, peepholeWindow, &stats);
+    if (info == SUCCESS && printPeephole && peepholeWindow >= MIN_PEEPHOLE_WINDOW)
+        printPeepholeStats(identToString(ir->fun->id), &stats);
+    return info;
 }
 
 /**
- * @fn ReturnInfo writeFunction(Node *fun, FunctionInfo funTable)
- * @brief Write the translation of a function.
+ * @fn ReturnInfo writeGlobals()
+ * @brief Write the translation of the global variables.
  *
- * @param fun Node* Function to write.
- * @param funTable FunctionInfo Function table we are in.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo writeFunction(Node *fun, FunctionInfo funTable)
+ReturnInfo writeGlobals()
 {
-    ReturnInfo info;
-    fprintf(f, "%s:\n", funTable.id);
-    fprintf(f, "\tpush rbp\n");
-    fprintf(f, "\tmov rbp, rsp\n\n");
-
-    info = writeBody(getChildLabeled(fun, Body), funTable);
-    if (info != SUCCESS)
-        return info;
-
-    if (!getChildLabeled(getChildLabeled(fun, Body), Return))
-    {
-        fprintf(f, "\tmov rsp, rbp\n");
-        fprintf(f, "\tpop rbp\n");
-        fprintf(f, "\tret\n\n");
-    }
+    emitLit("section .bss\n");
+    for (int i = 0; i < pt->glob.len; i++)
+        emit("\t%s: %s %d\n", identToString(pt->glob.symbols[i].id), sizeToAsm(pt->glob.symbols[i].type), pt->glob.symbols[i].numberOfValues);
+    emitLit("\n");
 
     return SUCCESS;
 }
 
 /**
- * @fn ReturnInfo writeGlobals()
- * @brief Write the translation of the global variables.
+ * @fn void findCalledRuntime(const IrProgram *prog, int *called)
+ * @brief Find the parts of the runtime whose functions a program calls.
  *
- * @return ReturnInfo Eventual error code.
+ * @param prog const IrProgram* Lowered program.
+ * @param called int* 1 for each part of the runtime called, filled.
  */
-ReturnInfo writeGlobals()
+void findCalledRuntime(const IrProgram *prog, int *called)
 {
-    fprintf(f, "section .bss\n");
-    for (int i = 0; i < pt.glob.len; i++)
-        fprintf(f, "\t%s: %s %d\n", pt.glob.symbols[i].id, sizeToAsm(pt.glob.symbols[i].type), pt.glob.symbols[i].numberOfValues);
-    fprintf(f, "\n");
-
-    return SUCCESS;
+    for (int unit = 0; unit < NB_RUNTIME_UNITS; unit++)
+        called[unit] = 0;
+    for (int i = 0; i < prog->len; i++)
+        for (int pos = 0; pos < prog->functions[i].len; pos++)
+        {
+            const IrInstr *instr = &prog->functions[i].instrs[pos];
+            int unit = instr->op == IR_CALL ? findRuntimeFunction(identToString(instr->symbol)) : -1;
+            if (unit >= 0)
+                called[unit] = 1;
+        }
 }
 
 /**
- * @fn ReturnInfo writeProg(Node *prog)
- * @brief Write the translation of the whole program.
+ * @fn ReturnInfo writeProg(const IrProgram *prog, const int *called)
+ * @brief Write the translation of the whole program, the functions of the runtime it calls being declared external.
  *
- * @param prog Node* Program to write.
+ * @param prog const IrProgram* Lowered program to write.
+ * @param called const int* 1 for each part of the runtime called by the program.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo writeProg(Node *prog)
+ReturnInfo writeProg(const IrProgram *prog, const int *called)
 {
     ReturnInfo info = writeGlobals();
     if (info != SUCCESS)
         return info;
 
-    fprintf(f, "\n");
+    emitLit("\n");
 
-    fprintf(f, "global _start\nsection .text\n\n");
-    writeDefaultFunctions(f);
+    emitLit("global _start\nextern __exit__\n");
+    for (int unit = 0; unit < NB_RUNTIME_UNITS; unit++)
+        if (called[unit])
+            emit("extern %s\n", runtimeFunctionName(unit));
+    emitLit("section .text\n\n");
 
-    Node *fun = prog->firstChild;
-    do
+    for (int i = 0; i < prog->len; i++)
     {
-        if (fun->label == DeclVarsGlobale)
-            continue;
-
-        char id[SIZE_ID];
-        getFunId(fun, id);
-
-        FunctionInfo funTable = getFunctionsTable(pt, id);
-        if (!strcmp(id, "main"))
-            info = writeMain(fun, funTable);
-        else if (strcmp(id, "err"))
-            info = writeFunction(fun, funTable);
-        else
-            printTree(fun);
-
+        info = writeFunction(&prog->functions[i]);
         if (info != SUCCESS)
             return info;
 
-        fprintf(f, "\n");
-    } while ((fun = fun->nextSibling) != NULL);
+        emitLit("\n");
+    }
     return SUCCESS;
 }
 
 /**
- * @fn ReturnInfo writeAll(Node *root, ProgTable progt, char *fileName)
+ * @fn ReturnInfo writeAll(const IrProgram *prog, const ProgTable *progt, char *fileName, int window, int printStats, int linkArchive)
  * @brief Write the translation of the whole program after checking quick verifications.
+ * The file only holds the program, the runtime being linked from its archive. Without an
+ * archive, the parts of the runtime used are then emitted after the program for the built-in assembler.
  *
- * @param root Node* Root of the program to write.
- * @param progt ProgTable Program table we are in.
+ * @param prog const IrProgram* Lowered program to write.
+ * @param progt const ProgTable* Program table we are in.
  * @param fileName char* Name of the file to write.
+ * @param window int Window of the peephole, below MIN_PEEPHOLE_WINDOW disabling it.
+ * @param printStats int Print what the peephole did to each function.
+ * @param linkArchive int The built-in assembler links the runtime from its archive.
  * @return ReturnInfo Eventual error code.
  */
-ReturnInfo writeAll(Node *root, ProgTable progt, char *fileName)
+ReturnInfo writeAll(const IrProgram *prog, const ProgTable *progt, char *fileName, int window, int printStats, int linkArchive)
 {
     pt = progt;
-    ReturnInfo verif = quickVerif(root, fileName);
+    peepholeWindow = window;
+    printPeephole = printStats;
+    mainId = internString("main");
+    ReturnInfo verif = quickVerif(prog, fileName);
     if (verif != SUCCESS)
         return verif;
 
-    f = fopen(fileName, "w");
-
-    if (!f)
-        return COULD_NOT_OPEN_FILE;
+    verif = startEmitter();
+    if (verif != SUCCESS)
+        return verif;
 
-    verif = writeProg(root);
+    int called[NB_RUNTIME_UNITS];
+    findCalledRuntime(prog, called);
+    verif = writeProg(prog, called);
     if (verif != SUCCESS)
         return verif;
 
-    fclose(f);
-    return SUCCESS;
+    verif = writeEmitted(fileName);
+    if (verif != SUCCESS || linkArchive)
+        return verif;
+
+    return writeLinkedRuntime(called);
 }
 
 /*
@@ -1462,11 +992,7 @@ ReturnInfo writeAll(Node *root, ProgTable progt, char *fileName)
 
 /*
 
-TODO :
-1. Gérer les listes d'argument de plus de 6.
-2. Gérer les return de la main
-
 TODO (but in the end)
 1. Gérer les valeurs de retour qui doivent être obligatoirement présente pour les non-void fonctions (optionnel)
 
-*/
\ No newline at end of file
+*/